@@ -35,6 +35,8 @@ limitations under the License.
 #include "itkParametricImageSource.h"
 #include "itkSize.h"
 
+#include <vector>
+
 namespace itk
 {
 namespace tube
@@ -92,6 +94,15 @@ protected:
 
   void ComputeInputImageFFT();
   void ComputeKernelImageFFT();
+
+  /** Builds the kernel FFT directly in the frequency domain, as the
+   *  product of the 1D FFTs of the separable factors of the kernel.
+   *  Returns false if the kernel is not separable on the FFT grid. */
+  bool ComputeSeparableKernelImageFFT();
+
+  /** Physical point at which the kernels are centered */
+  typename GaussianDerivativeImageSourceType::PointType GetKernelMean()
+    const;
   void ComputeConvolvedImageFFT();
   void ComputeConvolvedImage();
 
@@ -113,6 +124,7 @@ private:
   typename TOutputImage::Pointer                      m_ConvolvedImage;
 
   const InputImageType *                              m_LastInputImage;
+  ModifiedTimeType                                    m_LastInputImageMTime;
 };
 
 
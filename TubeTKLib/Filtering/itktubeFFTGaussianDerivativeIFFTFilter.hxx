@@ -22,6 +22,7 @@
 #include "itktubePadImageFilter.h"
 #include "itktubeRegionFromReferenceImageFilter.h"
 
+#include <itkImageRegionIteratorWithIndex.h>
 #include <itkTimeProbesCollectorBase.h>
 #include <itkParametricImageSource.h>
 #include <itkSize.h>
@@ -40,6 +41,7 @@ FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
   m_ConvolvedImage = NULL;
 
   this->m_LastInputImage = NULL;
+  this->m_LastInputImageMTime = 0;
 }
 
 template< typename TInputImage, typename TOutputImage >
@@ -62,18 +64,171 @@ FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
 }
 
 template< typename TInputImage, typename TOutputImage >
-void
+typename FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
+::GaussianDerivativeImageSourceType::PointType
 FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
-::ComputeKernelImageFFT()
+::GetKernelMean() const
 {
-  typename GaussianDerivativeImageSourceType::Pointer gaussSource =
-    GaussianDerivativeImageSourceType::New();
-
   const typename ComplexImageType::RegionType inputRegion(
     this->GetInput()->GetLargestPossibleRegion() );
   const typename ComplexImageType::SizeType inputSize
     = inputRegion.GetSize();
 
+  typename GaussianDerivativeImageSourceType::PointType mean;
+  typename GaussianDerivativeImageSourceType::IndexType meanIndex;
+  for( unsigned int ii = 0; ii < ImageDimension; ++ii )
+    {
+    const int halfLength = ( inputSize[ii]  / 2.0 );
+    meanIndex[ii] = inputRegion.GetIndex()[ii] + halfLength;
+    }
+  this->GetInput()->TransformIndexToPhysicalPoint( meanIndex, mean );
+
+  return mean;
+}
+
+template< typename TInputImage, typename TOutputImage >
+bool
+FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
+::ComputeSeparableKernelImageFFT()
+{
+  // Along axis-aligned grids, the kernels of orders 0 and 1 are products
+  // of 1D kernels ( including their normalization ), so their FFT is the
+  // product of the 1D FFTs of those kernels.
+  typename ComplexImageType::DirectionType identity;
+  identity.SetIdentity();
+  if( m_InputImageFFT->GetDirection() != identity )
+    {
+    return false;
+    }
+  for( unsigned int ii = 0; ii < ImageDimension; ++ii )
+    {
+    if( this->m_Orders[ii] < 0 || this->m_Orders[ii] > 1 )
+      {
+      return false;
+      }
+    }
+
+  typedef Image< double, 1 >                               LineImageType;
+  typedef GaussianDerivativeImageSource< LineImageType >   LineSourceType;
+  typedef FFTShiftImageFilter< LineImageType, LineImageType >
+                                                           LineShiftFilterType;
+  typedef typename ComplexImageType::PixelType             ComplexType;
+
+  const typename ComplexImageType::RegionType fftRegion(
+    m_InputImageFFT->GetLargestPossibleRegion() );
+  const typename ComplexImageType::SizeType fftSize
+    = fftRegion.GetSize();
+  const typename ComplexImageType::SpacingType fftSpacing =
+    m_InputImageFFT->GetSpacing();
+  const typename ComplexImageType::PointType fftOrigin =
+    m_InputImageFFT->GetOrigin();
+
+  const typename GaussianDerivativeImageSourceType::PointType mean =
+    this->GetKernelMean();
+
+  std::vector< std::vector< ComplexType > > lineFFT( ImageDimension );
+  for( unsigned int ii = 0; ii < ImageDimension; ++ii )
+    {
+    typename LineSourceType::Pointer lineSource = LineSourceType::New();
+
+    typename LineSourceType::IndexType lineIndex;
+    lineIndex[0] = fftRegion.GetIndex()[ii];
+    typename LineSourceType::SizeType lineSize;
+    lineSize[0] = fftSize[ii];
+    typename LineSourceType::SpacingType lineSpacing;
+    lineSpacing[0] = fftSpacing[ii];
+    typename LineSourceType::PointType lineOrigin;
+    lineOrigin[0] = fftOrigin[ii];
+    typename LineSourceType::DirectionType lineDirection;
+    lineDirection.SetIdentity();
+
+    lineSource->SetIndex( lineIndex );
+    lineSource->SetSize( lineSize );
+    lineSource->SetSpacing( lineSpacing );
+    lineSource->SetOrigin( lineOrigin );
+    lineSource->SetDirection( lineDirection );
+
+    typename LineSourceType::SigmasType lineSigmas;
+    lineSigmas[0] = this->m_Sigmas[ii];
+    typename LineSourceType::PointType lineMean;
+    lineMean[0] = mean[ii];
+    typename LineSourceType::OrdersType lineOrders;
+    lineOrders[0] = this->m_Orders[ii];
+
+    lineSource->SetSigmas( lineSigmas );
+    lineSource->SetMean( lineMean );
+    lineSource->SetOrders( lineOrders );
+
+    typename LineShiftFilterType::Pointer lineShiftFilter =
+      LineShiftFilterType::New();
+    lineShiftFilter->SetInput( lineSource->GetOutput() );
+    lineShiftFilter->Update();
+
+    // Forward DFT with the sign and scaling of ForwardFFTImageFilter
+    const double * line = lineShiftFilter->GetOutput()->GetBufferPointer();
+    const SizeValueType n = fftSize[ii];
+    std::vector< double > cosTable( n );
+    std::vector< double > sinTable( n );
+    for( SizeValueType j = 0; j < n; ++j )
+      {
+      const double angle = -2 * vnl_math::pi * static_cast< double >( j )
+        / n;
+      cosTable[j] = std::cos( angle );
+      sinTable[j] = std::sin( angle );
+      }
+    lineFFT[ii].resize( n );
+    for( SizeValueType k = 0; k < n; ++k )
+      {
+      double re = 0;
+      double im = 0;
+      for( SizeValueType j = 0; j < n; ++j )
+        {
+        const SizeValueType t = ( k * j ) % n;
+        re += line[j] * cosTable[t];
+        im += line[j] * sinTable[t];
+        }
+      lineFFT[ii][k] = ComplexType( re, im );
+      }
+    }
+
+  typename ComplexImageType::Pointer kernelImageFFT =
+    ComplexImageType::New();
+  kernelImageFFT->CopyInformation( m_InputImageFFT );
+  kernelImageFFT->SetRegions( fftRegion );
+  kernelImageFFT->Allocate();
+
+  ImageRegionIteratorWithIndex< ComplexImageType > iter( kernelImageFFT,
+    fftRegion );
+  while( !iter.IsAtEnd() )
+    {
+    const typename ComplexImageType::IndexType indx = iter.GetIndex();
+    ComplexType value = lineFFT[0][ indx[0] - fftRegion.GetIndex()[0] ];
+    for( unsigned int ii = 1; ii < ImageDimension; ++ii )
+      {
+      value *= lineFFT[ii][ indx[ii] - fftRegion.GetIndex()[ii] ];
+      }
+    iter.Set( value );
+    ++iter;
+    }
+
+  m_KernelImageFFT = kernelImageFFT;
+
+  return true;
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
+::ComputeKernelImageFFT()
+{
+  if( this->ComputeSeparableKernelImageFFT() )
+    {
+    return;
+    }
+
+  typename GaussianDerivativeImageSourceType::Pointer gaussSource =
+    GaussianDerivativeImageSourceType::New();
+
   const typename ComplexImageType::RegionType fftRegion(
     m_InputImageFFT->GetLargestPossibleRegion() );
   const typename ComplexImageType::SizeType fftSize
@@ -91,17 +246,8 @@ FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
   gaussSource->SetOrigin( fftOrigin );
   gaussSource->SetDirection( fftDirection );
 
-  typename GaussianDerivativeImageSourceType::PointType mean;
-  typename GaussianDerivativeImageSourceType::IndexType meanIndex;
-  for( unsigned int ii = 0; ii < ImageDimension; ++ii )
-    {
-    const int halfLength = ( inputSize[ii]  / 2.0 );
-    meanIndex[ii] = inputRegion.GetIndex()[ii] + halfLength;
-    }
-  this->GetInput()->TransformIndexToPhysicalPoint( meanIndex, mean );
-
   gaussSource->SetSigmas( this->m_Sigmas );
-  gaussSource->SetMean( mean );
+  gaussSource->SetMean( this->GetKernelMean() );
   gaussSource->SetOrders( this->m_Orders );
 
   gaussSource->Update();
@@ -158,9 +304,11 @@ void
 FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
 ::GenerateData()
 {
-  if( m_LastInputImage != this->GetInput() )
+  if( m_LastInputImage != this->GetInput()
+    || m_LastInputImageMTime != this->GetInput()->GetMTime() )
     {
     m_LastInputImage = this->GetInput();
+    m_LastInputImageMTime = this->GetInput()->GetMTime();
     ComputeInputImageFFT();
     }
 
@@ -179,9 +327,11 @@ FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
   std::vector< typename TOutputImage::Pointer > & dXX )
 {
 
-  if( m_LastInputImage != this->GetInput() )
+  if( m_LastInputImage != this->GetInput()
+    || m_LastInputImageMTime != this->GetInput()->GetMTime() )
     {
     m_LastInputImage = this->GetInput();
+    m_LastInputImageMTime = this->GetInput()->GetMTime();
     ComputeInputImageFFT();
     }
 
@@ -288,6 +438,8 @@ FFTGaussianDerivativeIFFTFilter<TInputImage, TOutputImage>
     os << indent << "Convolved Image   : NULL" << std::endl;
     }
   os << indent << "Last Input Image    : " << m_LastInputImage << std::endl;
+  os << indent << "Last Input Image MTime : " << m_LastInputImageMTime
+    << std::endl;
 }
 
 } // End namespace tube
@@ -30,6 +30,7 @@
 #include "itkVesselTubeSpatialObject.h"
 #include "itksys/hash_map.hxx"
 
+#include <algorithm>
 #include <map>
 #include <queue>
 #include <math.h>
@@ -65,6 +66,7 @@ public:
   typedef typename TubeType::Pointer            TubePointerType;
   typedef typename TubeType::ConstPointer       TubeConstPointerType;
   typedef itk::IndexValueType                   TubeIdType;
+  typedef typename TubeType::PointType          PointType;
   typedef std::vector< TubeIdType >             TubeIdListType;
 
   /** Run-time type information ( and related methods ).   */
@@ -138,6 +140,42 @@ private:
     bool operator>( const ConnectionPointType & rhs ) const;
     };
 
+  /** End point of a tube with more than one point.  endNumber is 0 for
+   *  the first point of the tube and 1 for its last point. */
+  struct TubeEndPointType
+    {
+    PointType    position;
+    unsigned int tubeNumber;
+    unsigned int endNumber;
+    };
+
+  typedef std::vector< TubeEndPointType > TubeEndPointListType;
+
+  struct TubeEndPointLess
+    {
+    unsigned int dimension;
+
+    bool operator()( const TubeEndPointType & a,
+      const TubeEndPointType & b ) const;
+    };
+
+  itkStaticConstMacro( TubeEndPointTreeLeafSize, unsigned int, 8 );
+
+  /** Arrange the end points as an implicit k-d tree, so that the end
+   *  points near a source point are found without visiting every tube */
+  static void BuildTubeEndPointTree( TubeEndPointListType & endPoints,
+    unsigned int begin, unsigned int end, unsigned int depth );
+
+  /** Append 2 * tubeNumber + endNumber of each end point that lies within
+   *  the box of half-width radius around center */
+  static void FindTubeEndPoints( const TubeEndPointListType & endPoints,
+    unsigned int begin, unsigned int end, unsigned int depth,
+    const PointType & center, double radius,
+    std::vector< unsigned int > & found );
+
+  static bool IsTubeEndPointInBox( const TubeEndPointType & endPoint,
+    const PointType & center, double radius );
+
   typedef itksys::hash_map< TubeIdType, GraphEdgeType >
   GraphEdgeListType;
   typedef itksys::hash_map< TubeIdType, GraphEdgeListType >
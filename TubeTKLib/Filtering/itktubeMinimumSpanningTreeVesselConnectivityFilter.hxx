@@ -118,6 +118,104 @@ MinimumSpanningTreeVesselConnectivityFilter< VDimension >
   return m_RootTubeIdList;
 }
 
+template< unsigned int VDimension >
+bool
+MinimumSpanningTreeVesselConnectivityFilter< VDimension >
+::TubeEndPointLess
+::operator()( const TubeEndPointType & a, const TubeEndPointType & b ) const
+{
+  return a.position[dimension] < b.position[dimension];
+}
+
+/**
+ * BuildTubeEndPointTree */
+template< unsigned int VDimension >
+void
+MinimumSpanningTreeVesselConnectivityFilter< VDimension >
+::BuildTubeEndPointTree( TubeEndPointListType & endPoints,
+  unsigned int begin, unsigned int end, unsigned int depth )
+{
+  // leaves are scanned linearly by FindTubeEndPoints
+  if( end - begin <= TubeEndPointTreeLeafSize )
+    {
+    return;
+    }
+
+  unsigned int mid = begin + ( end - begin ) / 2;
+
+  TubeEndPointLess lessThan;
+  lessThan.dimension = depth % VDimension;
+  std::nth_element( endPoints.begin() + begin, endPoints.begin() + mid,
+    endPoints.begin() + end, lessThan );
+
+  BuildTubeEndPointTree( endPoints, begin, mid, depth + 1 );
+  BuildTubeEndPointTree( endPoints, mid + 1, end, depth + 1 );
+}
+
+/**
+ * FindTubeEndPoints */
+template< unsigned int VDimension >
+void
+MinimumSpanningTreeVesselConnectivityFilter< VDimension >
+::FindTubeEndPoints( const TubeEndPointListType & endPoints,
+  unsigned int begin, unsigned int end, unsigned int depth,
+  const PointType & center, double radius,
+  std::vector< unsigned int > & found )
+{
+  if( end - begin <= TubeEndPointTreeLeafSize )
+    {
+    for( unsigned int i = begin; i < end; ++i )
+      {
+      if( IsTubeEndPointInBox( endPoints[i], center, radius ) )
+        {
+        found.push_back( 2 * endPoints[i].tubeNumber
+          + endPoints[i].endNumber );
+        }
+      }
+    return;
+    }
+
+  unsigned int mid = begin + ( end - begin ) / 2;
+  unsigned int dimension = depth % VDimension;
+  double offset = endPoints[mid].position[dimension] - center[dimension];
+
+  if( IsTubeEndPointInBox( endPoints[mid], center, radius ) )
+    {
+    found.push_back( 2 * endPoints[mid].tubeNumber
+      + endPoints[mid].endNumber );
+    }
+  if( offset >= -radius )
+    {
+    FindTubeEndPoints( endPoints, begin, mid, depth + 1, center, radius,
+      found );
+    }
+  if( offset <= radius )
+    {
+    FindTubeEndPoints( endPoints, mid + 1, end, depth + 1, center, radius,
+      found );
+    }
+}
+
+/**
+ * IsTubeEndPointInBox */
+template< unsigned int VDimension >
+bool
+MinimumSpanningTreeVesselConnectivityFilter< VDimension >
+::IsTubeEndPointInBox( const TubeEndPointType & endPoint,
+  const PointType & center, double radius )
+{
+  // the box contains every point within radius of center, and uses the
+  // same differences as the exact distance test in BuildTubeGraph
+  for( unsigned int d = 0; d < VDimension; ++d )
+    {
+    if( !( std::fabs( endPoint.position[d] - center[d] ) <= radius ) )
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
 template< unsigned int VDimension >
 void
 MinimumSpanningTreeVesselConnectivityFilter< VDimension >
@@ -153,16 +251,50 @@ MinimumSpanningTreeVesselConnectivityFilter< VDimension >
   typedef typename TubeType::PointType      PositionType;
   typedef typename PositionType::VectorType PositionVectorType;
 
-  m_TubeGraph.clear();
+  // index the end points of all tubes that can be connection targets, so
+  // that each source point only visits the end points within its reach
+  std::vector< TubePointerType > tubeList;
+  tubeList.reserve( pTubeList->size() );
+
+  TubeEndPointListType endPoints;
+  endPoints.reserve( 2 * pTubeList->size() );
 
   for( typename TubeGroupType::ChildrenListType::iterator
-    itSourceTubes = pTubeList->begin();
-    itSourceTubes != pTubeList->end(); ++itSourceTubes )
+    itTubes = pTubeList->begin();
+    itTubes != pTubeList->end(); ++itTubes )
     {
-    TubePointerType pCurSourceTube
-      = dynamic_cast< TubeType * >( itSourceTubes->GetPointer() );
+    TubePointerType pTube
+      = dynamic_cast< TubeType * >( itTubes->GetPointer() );
+    const TubePointListType & pointList = pTube->GetPoints();
+
+    if( pointList.size() > 1 )
+      {
+      TubeEndPointType endPoint;
+      endPoint.tubeNumber = tubeList.size();
+      endPoint.endNumber = 0;
+      endPoint.position = pointList.front().GetPosition();
+      endPoints.push_back( endPoint );
+
+      endPoint.endNumber = 1;
+      endPoint.position = pointList.back().GetPosition();
+      endPoints.push_back( endPoint );
+      }
+
+    tubeList.push_back( pTube );
+    }
+
+  BuildTubeEndPointTree( endPoints, 0, endPoints.size(), 0 );
+
+  m_TubeGraph.clear();
+
+  std::vector< unsigned int > foundEndPoints;
+
+  for( unsigned int sourceTubeNumber = 0;
+    sourceTubeNumber < tubeList.size(); ++sourceTubeNumber )
+    {
+    TubePointerType pCurSourceTube = tubeList[sourceTubeNumber];
     TubeIdType curSourceTubeId = pCurSourceTube->GetId();
-    TubePointListType sourcePointList = pCurSourceTube->GetPoints();
+    const TubePointListType & sourcePointList = pCurSourceTube->GetPoints();
 
     m_TubeGraph[curSourceTubeId].clear();
 
@@ -171,31 +303,40 @@ MinimumSpanningTreeVesselConnectivityFilter< VDimension >
       itSourcePoints = sourcePointList.begin();
       itSourcePoints != sourcePointList.end(); ++itSourcePoints )
       {
-      TubePointType ptSource = *itSourcePoints;
+      const TubePointType & ptSource = *itSourcePoints;
       PositionVectorType ptSourcePos
         = ptSource.GetPosition().GetVectorFromOrigin();
+      double maxDist = m_MaxTubeDistanceToRadiusRatio * ptSource.GetRadius();
 
-      for( typename TubeGroupType::ChildrenListType::iterator
-        itTargetTubes = pTubeList->begin();
-        itTargetTubes != pTubeList->end(); ++itTargetTubes )
-        {
-        TubePointerType curTargetTube
-          = dynamic_cast< TubeType * >( itTargetTubes->GetPointer() );
-        TubeIdType curTargetTubeId = curTargetTube->GetId();
+      // visit the candidate end points in tube list order, so that ties
+      // are resolved exactly as in an exhaustive search
+      foundEndPoints.clear();
+      FindTubeEndPoints( endPoints, 0, endPoints.size(), 0,
+        ptSource.GetPosition(), maxDist, foundEndPoints );
+      std::sort( foundEndPoints.begin(), foundEndPoints.end() );
 
-        if( curSourceTubeId == curTargetTubeId )
+      unsigned int foundNum = 0;
+      while( foundNum < foundEndPoints.size() )
+        {
+        unsigned int targetTubeNumber = foundEndPoints[foundNum] / 2;
+        unsigned int foundEnd = foundNum;
+        while( foundEnd < foundEndPoints.size()
+          && foundEndPoints[foundEnd] / 2 == targetTubeNumber )
           {
-          continue;
+          ++foundEnd;
           }
 
-        TubePointListType targetPointList = curTargetTube->GetPoints();
+        TubePointerType curTargetTube = tubeList[targetTubeNumber];
+        TubeIdType curTargetTubeId = curTargetTube->GetId();
 
-        if( targetPointList.size() <= 1 )
+        if( curSourceTubeId == curTargetTubeId )
           {
+          foundNum = foundEnd;
           continue;
           }
 
-        int ptCandidateIdList[] = {0, ( int ) targetPointList.size() - 1};
+        const TubePointListType & targetPointList
+          = curTargetTube->GetPoints();
 
         std::priority_queue< ConnectionPointType,
           std::vector< ConnectionPointType >,
@@ -203,10 +344,14 @@ MinimumSpanningTreeVesselConnectivityFilter< VDimension >
         minpqConnPoint;
         ConnectionPointType ePtConn;
 
-        for( unsigned int i = 0; i < 2; i++ )
+        for( ; foundNum < foundEnd; ++foundNum )
           {
-          int curPtId = ptCandidateIdList[i];
-          TubePointType ptCur = targetPointList[curPtId];
+          int curPtId = 0;
+          if( foundEndPoints[foundNum] % 2 == 1 )
+            {
+            curPtId = ( int ) targetPointList.size() - 1;
+            }
+          const TubePointType & ptCur = targetPointList[curPtId];
 
           PositionVectorType ptCurPos
             = ptCur.GetPosition().GetVectorFromOrigin();
@@ -216,7 +361,7 @@ MinimumSpanningTreeVesselConnectivityFilter< VDimension >
           // compute and check distance
           double curDist = vecToCurPt.GetNorm();
 
-          if( curDist > m_MaxTubeDistanceToRadiusRatio * ptSource.GetRadius() )
+          if( curDist > maxDist )
             {
             continue;
             }
@@ -262,11 +407,6 @@ MinimumSpanningTreeVesselConnectivityFilter< VDimension >
 
         ePtConn = minpqConnPoint.top();
 
-        while( !minpqConnPoint.empty() )
-          {
-          minpqConnPoint.pop();
-          }
-
         GraphEdgeType e;
         e.sourceTube       = pCurSourceTube;
         e.sourceTubeId      = curSourceTubeId;
@@ -281,20 +421,20 @@ MinimumSpanningTreeVesselConnectivityFilter< VDimension >
         e.continuityAngleError = ePtConn.angle;
 
         // if edge to current target is present then update it, else add it
-        if( m_TubeGraph[curSourceTubeId].find( curTargetTubeId )
-          != m_TubeGraph[curSourceTubeId].end() )
+        GraphEdgeListType & sourceEdges = m_TubeGraph[curSourceTubeId];
+        typename GraphEdgeListType::iterator itEdge
+          = sourceEdges.find( curTargetTubeId );
+        if( itEdge != sourceEdges.end() )
           {
-          GraphEdgeType eOld = m_TubeGraph[curSourceTubeId][curTargetTubeId];
-
           // add only if current weight is better
-          if( e.weight < eOld.weight )
+          if( e.weight < itEdge->second.weight )
             {
-            m_TubeGraph[curSourceTubeId][curTargetTubeId] = e;
+            itEdge->second = e;
             }
           }
         else
           {
-          m_TubeGraph[curSourceTubeId][curTargetTubeId] = e;
+          sourceEdges[curTargetTubeId] = e;
           }
 
         }
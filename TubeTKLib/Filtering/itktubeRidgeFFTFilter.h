@@ -22,6 +22,10 @@
 
 #include "itktubeGaussianDerivativeFilter.h"
 
+#include <itkMultiThreaderBase.h>
+
+#include <vector>
+
 namespace itk
 {
 namespace tube
@@ -78,6 +82,18 @@ private:
   typedef GaussianDerivativeFilter< InputImageType, OutputImageType >
     DerivativeFilterType;
 
+  /** Structure for passing information into static callback methods */
+  struct RidgeThreadStruct
+    {
+    std::vector< typename OutputImageType::Pointer > * Dx;
+    std::vector< typename OutputImageType::Pointer > * Ddx;
+    Self *                                             Filter;
+    };
+
+  /** Computes the ridge measures of the work unit's range of pixels */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION RidgeThreaderCallback(
+    void * arg );
+
   typename DerivativeFilterType::Pointer                m_DerivativeFilter;
 
   typename OutputImageType::Pointer                     m_Intensity;
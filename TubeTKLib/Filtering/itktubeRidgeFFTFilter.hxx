@@ -73,16 +73,32 @@ RidgeFFTFilter< TInputImage >
   sigmas.Fill( m_Scale );
   m_DerivativeFilter->SetSigmas( sigmas );
 
-  // Intensity
-  //timeCollector.Start( "RidgeFFT Intensity" );
-  orders.Fill( 0 );
-  m_DerivativeFilter->SetOrders( orders );
-  m_DerivativeFilter->Update();
-  m_Intensity = m_DerivativeFilter->GetOutput();
-  //timeCollector.Stop( "RidgeFFT Intensity" );
-
-  if( !m_UseIntensityOnly )
+  if( m_UseIntensityOnly )
     {
+    // Intensity
+    //timeCollector.Start( "RidgeFFT Intensity" );
+    orders.Fill( 0 );
+    m_DerivativeFilter->SetOrders( orders );
+    m_DerivativeFilter->Update();
+    m_Intensity = m_DerivativeFilter->GetOutput();
+    //timeCollector.Stop( "RidgeFFT Intensity" );
+    }
+  else
+    {
+    std::vector< typename OutputImageType::Pointer > dx( ImageDimension );
+
+    int ddxSize = 0;
+    for( unsigned int i=1; i<=ImageDimension; ++i )
+      {
+      ddxSize += i;
+      }
+    std::vector< typename OutputImageType::Pointer > ddx( ddxSize );
+
+    // The N-jet includes the intensity
+    //timeCollector.Start( "RidgeFFT GenereateNJet" );
+    m_DerivativeFilter->GenerateNJet( m_Intensity, dx, ddx );
+    //timeCollector.Stop( "RidgeFFT GenereateNJet" );
+
     m_Ridgeness = OutputImageType::New();
     m_Ridgeness->CopyInformation( m_Intensity );
     m_Ridgeness->SetRegions( m_Intensity->GetLargestPossibleRegion() );
@@ -103,90 +119,107 @@ RidgeFFTFilter< TInputImage >
     m_Levelness->SetRegions( m_Intensity->GetLargestPossibleRegion() );
     m_Levelness->Allocate();
 
-    std::vector< typename OutputImageType::Pointer > dx( ImageDimension );
-
-    int ddxSize = 0;
-    for( unsigned int i=1; i<=ImageDimension; ++i )
+    // The derivative images are read as separate arrays ( one per
+    // component ), which the threads traverse linearly
+    for( unsigned int i=0; i<ImageDimension; ++i )
       {
-      ddxSize += i;
+      if( dx[i]->GetBufferedRegion() != m_Ridgeness->GetBufferedRegion() )
+        {
+        itkExceptionMacro( << "Derivative image region mismatch." );
+        }
+      }
+    for( int i=0; i<ddxSize; ++i )
+      {
+      if( ddx[i]->GetBufferedRegion() != m_Ridgeness->GetBufferedRegion() )
+        {
+        itkExceptionMacro( << "Derivative image region mismatch." );
+        }
       }
-    std::vector< typename OutputImageType::Pointer > ddx( ddxSize );
 
-    //timeCollector.Start( "RidgeFFT GenereateNJet" );
-    m_DerivativeFilter->GenerateNJet( m_Intensity, dx, ddx );
-    //timeCollector.Stop( "RidgeFFT GenereateNJet" );
+    RidgeThreadStruct str;
+    str.Dx = &dx;
+    str.Ddx = &ddx;
+    str.Filter = this;
 
-    ImageRegionIterator< OutputImageType > iterRidge( m_Ridgeness,
-      m_Ridgeness->GetLargestPossibleRegion() );
-    ImageRegionIterator< OutputImageType > iterRound( m_Roundness,
-      m_Roundness->GetLargestPossibleRegion() );
-    ImageRegionIterator< OutputImageType > iterCurve( m_Curvature,
-      m_Curvature->GetLargestPossibleRegion() );
-    ImageRegionIterator< OutputImageType > iterLevel( m_Levelness,
-      m_Levelness->GetLargestPossibleRegion() );
+    //timeCollector.Start( "RidgeFFT Compute" );
+    MultiThreaderBase * threader = this->GetMultiThreader();
+    threader->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+    threader->SetSingleMethod( this->RidgeThreaderCallback, &str );
+    threader->SingleMethodExecute();
+    //timeCollector.Stop( "RidgeFFT Compute" );
+    }
 
-    std::vector< ImageRegionIterator< OutputImageType > > iterDx(
-      ImageDimension );
+  this->SetNthOutput( 0, m_Intensity );
+  //timeCollector.Stop( "RidgeFFT GenerateData" );
+  //timeCollector.Report();
+}
 
-    std::vector< ImageRegionIterator< OutputImageType > > iterDdx(
-      ddxSize );
+template< typename TInputImage >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+RidgeFFTFilter< TInputImage >
+::RidgeThreaderCallback( void * arg )
+{
+  unsigned int threadId = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+  unsigned int threadCount = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->NumberOfWorkUnits;
 
-    unsigned int count = 0;
-    for( unsigned int i=0; i<ImageDimension; ++i )
+  RidgeThreadStruct * str = ( RidgeThreadStruct * )
+    ( ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  Self * filter = str->Filter;
+
+  const SizeValueType numPixels = filter->m_Ridgeness->GetBufferedRegion()
+    .GetNumberOfPixels();
+  const SizeValueType begin = ( numPixels * threadId ) / threadCount;
+  const SizeValueType end = ( numPixels * ( threadId + 1 ) ) / threadCount;
+
+  const float * dxBuffer[ ImageDimension ];
+  const float * ddxBuffer[ ImageDimension * ( ImageDimension + 1 ) / 2 ];
+  unsigned int count = 0;
+  for( unsigned int i=0; i<ImageDimension; ++i )
+    {
+    dxBuffer[i] = ( *str->Dx )[i]->GetBufferPointer();
+    for( unsigned int j=i; j<ImageDimension; ++j )
       {
-      iterDx[i] = ImageRegionIterator< OutputImageType >( dx[i],
-        dx[i]->GetLargestPossibleRegion() );
-      for( unsigned int j=i; j<ImageDimension; ++j )
-        {
-        iterDdx[count] = ImageRegionIterator< OutputImageType >( ddx[count],
-          ddx[count]->GetLargestPossibleRegion() );
-        ++count;
-        }
+      ddxBuffer[count] = ( *str->Ddx )[count]->GetBufferPointer();
+      ++count;
       }
+    }
 
-    double ridgeness = 0;
-    double roundness = 0;
-    double curvature = 0;
-    double levelness = 0;
-    vnl_matrix<double> H( ImageDimension, ImageDimension );
-    vnl_vector<double> D( ImageDimension );
-    vnl_matrix<double> HEVect( ImageDimension, ImageDimension );
-    vnl_vector<double> HEVal( ImageDimension );
-    //timeCollector.Start( "RidgeFFT Compute" );
-    while( !iterRidge.IsAtEnd() )
+  float * ridgeBuffer = filter->m_Ridgeness->GetBufferPointer();
+  float * roundBuffer = filter->m_Roundness->GetBufferPointer();
+  float * curveBuffer = filter->m_Curvature->GetBufferPointer();
+  float * levelBuffer = filter->m_Levelness->GetBufferPointer();
+
+  double ridgeness = 0;
+  double roundness = 0;
+  double curvature = 0;
+  double levelness = 0;
+  vnl_matrix_fixed< double, ImageDimension, ImageDimension > H;
+  vnl_vector_fixed< double, ImageDimension > D;
+  for( SizeValueType p = begin; p < end; ++p )
+    {
+    count = 0;
+    for( unsigned int i=0; i<ImageDimension; ++i )
       {
-      count = 0;
-      for( unsigned int i=0; i<ImageDimension; ++i )
+      D[i] = dxBuffer[i][p];
+      for( unsigned int j=i; j<ImageDimension; ++j )
         {
-        D[i] = iterDx[i].Get();
-        ++iterDx[i];
-        for( unsigned int j=i; j<ImageDimension; ++j )
-          {
-          H[i][j] = iterDdx[count].Get();
-          H[j][i] = H[i][j];
-          ++iterDdx[count];
-          ++count;
-          }
+        H( i, j ) = ddxBuffer[count][p];
+        H( j, i ) = H( i, j );
+        ++count;
         }
-      vnl_vector<double> prevTangent;
-      ::tube::ComputeRidgeness( H, D, prevTangent, ridgeness, roundness,
-        curvature, levelness, HEVect, HEVal );
-      iterRidge.Set( ridgeness );
-      iterRound.Set( roundness );
-      iterCurve.Set( curvature );
-      iterLevel.Set( levelness );
-
-      ++iterRidge;
-      ++iterRound;
-      ++iterCurve;
-      ++iterLevel;
       }
-    //timeCollector.Stop( "RidgeFFT Compute" );
+    ::tube::ComputeRidgeness( H, D, ridgeness, roundness, curvature,
+      levelness );
+    ridgeBuffer[p] = ridgeness;
+    roundBuffer[p] = roundness;
+    curveBuffer[p] = curvature;
+    levelBuffer[p] = levelness;
     }
 
-  this->SetNthOutput( 0, m_Intensity );
-  //timeCollector.Stop( "RidgeFFT GenerateData" );
-  //timeCollector.Report();
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
 }
 
 template< typename TInputImage >
@@ -23,15 +23,19 @@ limitations under the License.
 
 #include "itktubePDFSegmenterParzenIO.h"
 
+#include <itkImageRegionConstIterator.h>
+
+#include <cmath>
+
 int itktubePDFSegmenterParzenIOTest( int argc, char * argv[] )
 {
-  if( argc != 8 )
+  if( argc != 8 && argc != 9 )
     {
     std::cout << "Missing arguments." << std::endl;
     std::cout << "Usage: " << std::endl;
     std::cout << argv[0]
       << " inputImage1 inputImage2 inputLabelMap outputLabelMap"
-      << " pdfFile outputLabelMap2 pdfFile2"
+      << " pdfFile outputLabelMap2 pdfFile2 [useSparseHistogram]"
       << std::endl;
     return EXIT_FAILURE;
     }
@@ -117,6 +121,11 @@ int itktubePDFSegmenterParzenIOTest( int argc, char * argv[] )
   filter->SetReclassifyObjectLabels( true );
   filter->SetReclassifyNotObjectLabels( true );
   filter->SetForceClassification( true );
+  if( argc > 8 && ( argv[8][0] == 't' || argv[8][0] == 'T'
+    || argv[8][0] == '1' ) )
+    {
+    filter->SetUseSparseHistogram( true );
+    }
   filter->Update();
   std::cout << "*** Filter 1 ***" << std::endl << filter << std::endl;
   filter->ClassifyImages();
@@ -180,6 +189,78 @@ int itktubePDFSegmenterParzenIOTest( int argc, char * argv[] )
   PDFIO2.PrintInfo();
 
   std::cout << "*** Filter 2 ***" << std::endl << filter2 << std::endl;
+
+  // Every field written must be read back
+  bool fieldsMatch =
+    filter2->GetObjectId() == filter->GetObjectId()
+    && filter2->GetObjectPDFWeight() == filter->GetObjectPDFWeight()
+    && filter2->GetVoidId() == filter->GetVoidId()
+    && filter2->GetErodeRadius() == filter->GetErodeRadius()
+    && filter2->GetHoleFillIterations() == filter->GetHoleFillIterations()
+    && filter2->GetProbabilityImageSmoothingStandardDeviation()
+      == filter->GetProbabilityImageSmoothingStandardDeviation()
+    && filter2->GetHistogramSmoothingStandardDeviation()
+      == filter->GetHistogramSmoothingStandardDeviation()
+    && std::fabs( filter2->GetOutlierRejectPortion()
+      - filter->GetOutlierRejectPortion() ) < 1e-6
+    && filter2->GetReclassifyObjectLabels()
+      == filter->GetReclassifyObjectLabels()
+    && filter2->GetReclassifyNotObjectLabels()
+      == filter->GetReclassifyNotObjectLabels()
+    && filter2->GetForceClassification()
+      == filter->GetForceClassification()
+    && filter2->GetUsingSparseHistogram()
+      == filter->GetUsingSparseHistogram()
+    && filter2->GetNumberOfBinsPerFeature()
+      == filter->GetNumberOfBinsPerFeature();
+  for( unsigned int i = 0; i < filter->GetNumberOfFeatures(); ++i )
+    {
+    if( std::fabs( filter2->GetBinMin()[i] - filter->GetBinMin()[i] )
+      > 0.005 * filter->GetBinSize()[i]
+      || std::fabs( filter2->GetBinSize()[i] - filter->GetBinSize()[i] )
+      > 0.005 * filter->GetBinSize()[i] )
+      {
+      fieldsMatch = false;
+      }
+    }
+  if( !fieldsMatch )
+    {
+    std::cout << "Fields read do not match the fields written."
+      << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  for( unsigned int c = 0; c < filter->GetNumberOfClasses(); ++c )
+    {
+    if( filter->GetUsingSparseHistogram() )
+      {
+      if( filter2->GetClassSparseHistogram( c )
+        != filter->GetClassSparseHistogram( c ) )
+        {
+        std::cout << "Sparse PDF " << c << " read does not match the PDF"
+          << " written." << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    else
+      {
+      typedef itk::ImageRegionConstIterator< FilterType::PDFImageType >
+        PDFIteratorType;
+      PDFIteratorType pdfIt( filter->GetClassPDFImage( c ),
+        filter->GetClassPDFImage( c )->GetLargestPossibleRegion() );
+      PDFIteratorType pdfIt2( filter2->GetClassPDFImage( c ),
+        filter2->GetClassPDFImage( c )->GetLargestPossibleRegion() );
+      for( ; !pdfIt.IsAtEnd(); ++pdfIt, ++pdfIt2 )
+        {
+        if( pdfIt2.IsAtEnd() || pdfIt2.Get() != pdfIt.Get() )
+          {
+          std::cout << "PDF " << c << " read does not match the PDF"
+            << " written." << std::endl;
+          return EXIT_FAILURE;
+          }
+        }
+      }
+    }
   filter2->ClassifyImages();
 
   WriterType::Pointer labelmapWriter2 = WriterType::New();
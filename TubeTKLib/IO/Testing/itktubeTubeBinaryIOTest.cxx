@@ -0,0 +1,209 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeTubeBinaryIO.h"
+#include "itktubeTubeXIO.h"
+
+#include <fstream>
+#include <iterator>
+
+int itktubeTubeBinaryIOTest( int argc, char * argv[] )
+{
+  if( argc != 4 )
+    {
+    std::cerr << "Missing arguments." << std::endl;
+    std::cerr << "Usage: " << std::endl;
+    std::cerr << argv[0] << " input.tre output.tbt output2.tbt"
+      << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  typedef itk::tube::TubeXIO< 3 >         TubeXIOType;
+  typedef itk::tube::TubeBinaryIO< 3 >    IOMethodType;
+  typedef IOMethodType::TubeType          TubeType;
+
+  TubeXIOType::Pointer tubeXIO = TubeXIOType::New();
+  if( !tubeXIO->Read( argv[1] ) )
+    {
+    std::cerr << "Error reading TubeX file." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  IOMethodType::Pointer ioMethod = IOMethodType::New();
+  ioMethod->SetTubeGroup( tubeXIO->GetTubeGroup() );
+  if( !ioMethod->Write( argv[2] ) )
+    {
+    std::cerr << "Error writing binary tube file." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( !IOMethodType::CanReadFile( argv[2] )
+    || IOMethodType::CanReadFile( argv[1] ) )
+    {
+    std::cerr << "Error, CanReadFile is wrong." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  IOMethodType::Pointer ioMethod2 = IOMethodType::New();
+  if( !ioMethod2->Open( argv[2] ) )
+    {
+    std::cerr << "Error opening binary tube file." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  char soType[80];
+  sprintf( soType, "Tube" );
+  TubeType::ChildrenListType * tubeList =
+    tubeXIO->GetTubeGroup()->GetChildren( 99999, soType );
+  if( tubeList->size() != ioMethod2->GetNumberOfTubes() )
+    {
+    std::cerr << "Error, number of tubes: expected " << tubeList->size()
+      << " got " << ioMethod2->GetNumberOfTubes() << std::endl;
+    delete tubeList;
+    return EXIT_FAILURE;
+    }
+
+  int failures = 0;
+  unsigned int tubeNumber = 0;
+  TubeType::ChildrenListType::iterator tIt = tubeList->begin();
+  while( tIt != tubeList->end() )
+    {
+    TubeType * tube = static_cast< TubeType * >( tIt->GetPointer() );
+
+    if( ioMethod2->GetTubeId( tubeNumber ) != tube->GetId()
+      || ioMethod2->GetTubeNumberOfPoints( tubeNumber )
+      != tube->GetPoints().size() )
+      {
+      std::cerr << "Error, index of tube " << tubeNumber << " differs."
+        << std::endl;
+      ++failures;
+      }
+
+    const double * radii = ioMethod2->GetTubeColumn( tubeNumber,
+      IOMethodType::RadiusColumn );
+    TubeType::Pointer tube2 = ioMethod2->GetTube( tubeNumber );
+    for( unsigned int p = 0; p < tube->GetPoints().size(); ++p )
+      {
+      const TubeType::TubePointType & pnt = tube->GetPoints()[p];
+      const TubeType::TubePointType & pnt2 = tube2->GetPoints()[p];
+      if( radii[p] != pnt.GetRadius()
+        || pnt2.GetRadius() != pnt.GetRadius()
+        || pnt2.GetPosition() != pnt.GetPosition()
+        || pnt2.GetTangent() != pnt.GetTangent()
+        || pnt2.GetNormal1() != pnt.GetNormal1()
+        || pnt2.GetNormal2() != pnt.GetNormal2() )
+        {
+        std::cerr << "Error, point " << p << " of tube " << tubeNumber
+          << " differs." << std::endl;
+        ++failures;
+        break;
+        }
+      }
+
+    ++tubeNumber;
+    ++tIt;
+    }
+  delete tubeList;
+
+  IOMethodType::Pointer ioMethod5 = IOMethodType::New();
+  ioMethod5->SetTubeGroup( tubeXIO->GetTubeGroup() );
+  ioMethod5->GenerateColumns();
+  if( ioMethod5->GetNumberOfPoints() != ioMethod2->GetNumberOfPoints()
+    || ioMethod2->GetMutableColumn( IOMethodType::RadiusColumn ) != NULL )
+    {
+    std::cerr << "Error, generated columns differ from mapped columns."
+      << std::endl;
+    ++failures;
+    }
+  else
+    {
+    for( unsigned int c = 0; c < IOMethodType::NumberOfColumns; ++c )
+      {
+      const double * column = ioMethod5->GetColumn( c );
+      const double * mappedColumn = ioMethod2->GetColumn( c );
+      for( unsigned int p = 0; p < ioMethod5->GetNumberOfPoints(); ++p )
+        {
+        if( column[p] != mappedColumn[p] )
+          {
+          std::cerr << "Error, generated column " << c << " differs."
+            << std::endl;
+          ++failures;
+          break;
+          }
+        }
+      }
+
+    if( ioMethod5->GetNumberOfTubes() > 0
+      && ioMethod5->GetTubeNumberOfPoints( 0 ) > 0 )
+      {
+      double * radii = ioMethod5->GetMutableColumn(
+        IOMethodType::RadiusColumn );
+      SizeValueType firstPoint = ioMethod5->GetTubeFirstPoint( 0 );
+      radii[ firstPoint ] *= 2;
+      TubeType::Pointer tube5 = ioMethod5->GetTube( 0 );
+      if( tube5->GetPoints()[0].GetRadius() != radii[ firstPoint ] )
+        {
+        std::cerr << "Error, modified column is not used by GetTube."
+          << std::endl;
+        ++failures;
+        }
+      }
+    }
+
+  ioMethod2->Close();
+
+  IOMethodType::Pointer ioMethod3 = IOMethodType::New();
+  if( !ioMethod3->Read( argv[2] ) )
+    {
+    std::cerr << "Error reading binary tube file." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  IOMethodType::Pointer ioMethod4 = IOMethodType::New();
+  ioMethod4->SetTubeGroup( ioMethod3->GetTubeGroup() );
+  if( !ioMethod4->Write( argv[3] ) )
+    {
+    std::cerr << "Error writing second binary tube file." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::ifstream file1( argv[2], std::ios::binary );
+  std::ifstream file2( argv[3], std::ios::binary );
+  std::string contents1( ( std::istreambuf_iterator< char >( file1 ) ),
+    std::istreambuf_iterator< char >() );
+  std::string contents2( ( std::istreambuf_iterator< char >( file2 ) ),
+    std::istreambuf_iterator< char >() );
+  if( contents1 != contents2 )
+    {
+    std::cerr << "Error, rewritten binary tube file differs." << std::endl;
+    ++failures;
+    }
+
+  if( failures > 0 )
+    {
+    return EXIT_FAILURE;
+    }
+
+  // All objects should be automatically destroyed at this point
+  return EXIT_SUCCESS;
+}
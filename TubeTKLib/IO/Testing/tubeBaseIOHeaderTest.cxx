@@ -30,6 +30,7 @@ limitations under the License.
 #ifdef TubeTK_USE_RANDOMFOREST
 #  include "itktubePDFSegmenterRandomForestIO.h"
 #endif
+#include "itktubeTubeBinaryIO.h"
 #include "itktubeTubeExtractorIO.h"
 #include "itktubeTubeXIO.h"
 
@@ -30,6 +30,7 @@ limitations under the License.
 #  include "itktubePDFSegmenterRandomForestIO.h"
 #endif
 #include "itktubeRidgeSeedFilterIO.h"
+#include "itktubeTubeBinaryIO.h"
 #include "itktubeTubeExtractorIO.h"
 #include "itktubeTubeXIO.h"
 
@@ -63,6 +64,11 @@ int tubeBaseIOPrintTest( int tubeNotUsed( argc ), char * tubeNotUsed( argv )[] )
   std::cout << "-------------tubeExtractorIO" << std::endl;
   tubeExtractorIO.PrintInfo();
 
+  itk::tube::TubeBinaryIO< 3 >::Pointer tubeTubeBinaryIO =
+    itk::tube::TubeBinaryIO< 3 >::New();
+  std::cout << "-------------tubeTubeBinaryIO" << tubeTubeBinaryIO
+    << std::endl;
+
   itk::tube::TubeXIO< 3 >::Pointer tubeTubeXIO;
   std::cout << "-------------tubeTubeXIO" << tubeTubeXIO << std::endl;
 
@@ -36,6 +36,7 @@ void RegisterTests( void )
   REGISTER_TEST( itktubePDFSegmenterRandomForestIOTest );
 #endif
   REGISTER_TEST( itktubeRidgeSeedFilterIOTest );
+  REGISTER_TEST( itktubeTubeBinaryIOTest );
   REGISTER_TEST( itktubeTubeExtractorIOTest );
   REGISTER_TEST( itktubeTubeXIOTest );
 }
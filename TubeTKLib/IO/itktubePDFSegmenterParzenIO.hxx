@@ -25,8 +25,11 @@ limitations under the License.
 
 #include "itktubePDFSegmenterParzenIO.h"
 #include "itktubeMetaClassPDF.h"
+#include "metaImage.h"
 #include "metaUtils.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -277,6 +280,10 @@ Read( const char * _headerName )
   MET_InitReadField( mF, "ForceClassification", MET_STRING, true );
   metaFields.push_back( mF );
 
+  mF = new MET_FieldRecordType;
+  MET_InitReadField( mF, "SparseHistogram", MET_STRING, false );
+  metaFields.push_back( mF );
+
   mF = new MET_FieldRecordType;
   MET_InitReadField( mF, "ObjectPDFFile", MET_STRING, true );
   metaFields.push_back( mF );
@@ -436,6 +443,15 @@ Read( const char * _headerName )
     m_PDFSegmenter->SetForceClassification( false );
     }
 
+  bool sparseHistogram = false;
+  mF = MET_GetFieldRecord( "SparseHistogram", &metaFields );
+  if( mF->defined && ( ( ( char * )( mF->value ) )[0] == 'T'
+    || ( ( char * )( mF->value ) )[0] == 't' ) )
+    {
+    sparseHistogram = true;
+    }
+  m_PDFSegmenter->SetUseSparseHistogram( sparseHistogram );
+
   mF = MET_GetFieldRecord( "ObjectPDFFile", &metaFields );
   std::string str = ( char * )( mF->value );
   std::vector< std::string > fileName;
@@ -454,6 +470,62 @@ Read( const char * _headerName )
     return false;
     }
 
+  if( sparseHistogram )
+    {
+    // Each sparse PDF is stored as a 2D float image with one row per
+    //   occupied bin: the bin index of each feature, then the bin count.
+    for( unsigned int i = 0; i < nObjects; ++i )
+      {
+      char filePath[255];
+      MET_GetFilePath( _headerName, filePath );
+      std::string fullFileName = filePath + fileName[i];
+
+      MetaImage pdfReader;
+      if( !pdfReader.Read( fullFileName.c_str() )
+        || pdfReader.NDims() != 2
+        || pdfReader.ElementType() != MET_FLOAT
+        || pdfReader.DimSize()[0] != static_cast< int >( numFeatures + 1 ) )
+        {
+        std::cout << "ERROR: Cannot read sparse PDF " << fullFileName
+          << std::endl;
+        for( unsigned int f=0; f<metaFields.size(); ++f )
+          {
+          delete metaFields[f];
+          }
+        metaFields.clear();
+        return false;
+        }
+
+      const float * data = static_cast< const float * >(
+        pdfReader.ElementData() );
+      typename PDFSegmenterType::SparseHistogramType histogram;
+      typename PDFSegmenterType::SparseBinIndexType binIndex;
+      binIndex.Fill( 0 );
+      for( int e = 0; e < pdfReader.DimSize()[1]; ++e )
+        {
+        for( unsigned int j = 0; j < numFeatures; ++j )
+          {
+          binIndex[j] = static_cast< unsigned short >( *data++ );
+          }
+        if( *data > 0 )
+          {
+          histogram[binIndex] = *data;
+          }
+        ++data;
+        }
+
+      m_PDFSegmenter->SetClassSparseHistogram( i, histogram );
+      }
+
+    for( unsigned int i=0; i<metaFields.size(); ++i )
+      {
+      delete metaFields[i];
+      }
+    metaFields.clear();
+
+    return true;
+    }
+
   for( unsigned int i = 0; i < nObjects; ++i )
     {
     typedef Image< float, PARZEN_MAX_NUMBER_OF_FEATURES >  pdfImageType;
@@ -683,6 +755,19 @@ Write( const char * _headerName )
     strlen( tmpC ), tmpC );
   metaFields.push_back( mF );
 
+  if( m_PDFSegmenter->GetUsingSparseHistogram() )
+    {
+    strcpy( tmpC, "True" );
+    }
+  else
+    {
+    strcpy( tmpC, "False" );
+    }
+  mF = new MET_FieldRecordType;
+  MET_InitWriteField< const char >( mF, "SparseHistogram", MET_STRING,
+    strlen( tmpC ), tmpC );
+  metaFields.push_back( mF );
+
   char filePath[255];
   MET_GetFilePath( _headerName, filePath );
   int skip = strlen( filePath );
@@ -729,6 +814,46 @@ Write( const char * _headerName )
     return false;
     }
 
+  if( m_PDFSegmenter->GetUsingSparseHistogram() )
+    {
+    for( unsigned int i = 0; i < nObjects; ++i )
+      {
+      const typename PDFSegmenterType::SparseHistogramType & histogram =
+        m_PDFSegmenter->GetClassSparseHistogram( i );
+
+      // An empty histogram is written as a single empty bin
+      int nEntries = std::max( static_cast< int >( histogram.size() ), 1 );
+      std::vector< float > data( nEntries * ( numFeatures + 1 ), 0 );
+      typename PDFSegmenterType::SparseHistogramType::const_iterator iter =
+        histogram.begin();
+      for( unsigned int e = 0; iter != histogram.end(); ++iter, ++e )
+        {
+        for( unsigned int j = 0; j < numFeatures; ++j )
+          {
+          data[e * ( numFeatures + 1 ) + j] = iter->first[j];
+          }
+        data[e * ( numFeatures + 1 ) + numFeatures] = iter->second;
+        }
+
+      MetaImage pdfWriter( static_cast< int >( numFeatures + 1 ), nEntries,
+        1.0, 1.0, MET_FLOAT, 1, &( data[0] ) );
+      pdfWriter.CompressedData( true );
+
+      char objectFileName[4096];
+      sprintf( objectFileName, "%s.%02d.mha", fullFileName.c_str(), i );
+
+      pdfWriter.Write( objectFileName );
+      }
+
+    for( unsigned int i=0; i<metaFields.size(); ++i )
+      {
+      delete metaFields[i];
+      }
+    metaFields.clear();
+
+    return true;
+    }
+
   for( unsigned int i = 0; i < nObjects; ++i )
     {
     MetaClassPDF pdfClassWriter( m_PDFSegmenter->GetNumberOfFeatures(),
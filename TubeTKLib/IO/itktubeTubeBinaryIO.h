@@ -0,0 +1,196 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+#ifndef __itktubeTubeBinaryIO_h
+#define __itktubeTubeBinaryIO_h
+
+#include "itkVesselTubeSpatialObject.h"
+#include "itkGroupSpatialObject.h"
+
+#include <string>
+#include <vector>
+
+namespace itk
+{
+
+namespace tube
+{
+
+/**
+ * Reads and writes vessel tubes in a binary, column-oriented file.
+ *
+ * The file is little-endian and starts with a versioned header, followed
+ * by an index holding the id, tree properties, color and point range of
+ * every tube.  The point data follows as one contiguous array of doubles
+ * per column ( position, radius, tangent, normals, medialness, ... ), so
+ * that the points of every tube are contiguous within each column.
+ *
+ * Open() memory-maps the file.  The columns of a tube can then be used in
+ * place through GetTubeColumn(), and GetTube() builds the spatial object
+ * of a single tube on demand.  Read() builds every tube, as TubeXIO does.
+ * GenerateColumns() instead lays out the tubes of a tube group in memory,
+ * so that their points can be modified column by column and GetTube()
+ * used to rebuild them.
+ *
+ * \sa TubeXIO
+ */
+template< unsigned int TDimension = 3 >
+class TubeBinaryIO : public Object
+{
+public:
+
+  typedef TubeBinaryIO                            Self;
+  typedef Object                                  Superclass;
+  typedef SmartPointer< Self >                    Pointer;
+  typedef SmartPointer< const Self >              ConstPointer;
+
+  typedef VesselTubeSpatialObject< TDimension >   TubeType;
+  typedef typename TubeType::TubePointType        TubePointType;
+  typedef GroupSpatialObject< TDimension >        TubeGroupType;
+
+  itkTypeMacro( TubeBinaryIO, Object );
+
+  itkNewMacro( TubeBinaryIO );
+
+  /** File format version written by this class */
+  itkStaticConstMacro( FileVersion, unsigned int, 1 );
+
+  /** Point data columns */
+  itkStaticConstMacro( PositionColumn, unsigned int, 0 );
+  itkStaticConstMacro( RadiusColumn, unsigned int, TDimension );
+  itkStaticConstMacro( TangentColumn, unsigned int, TDimension + 1 );
+  itkStaticConstMacro( Normal1Column, unsigned int, 2 * TDimension + 1 );
+  itkStaticConstMacro( Normal2Column, unsigned int, 3 * TDimension + 1 );
+  itkStaticConstMacro( MedialnessColumn, unsigned int, 4 * TDimension + 1 );
+  itkStaticConstMacro( RidgenessColumn, unsigned int, 4 * TDimension + 2 );
+  itkStaticConstMacro( BranchnessColumn, unsigned int, 4 * TDimension + 3 );
+  itkStaticConstMacro( Alpha1Column, unsigned int, 4 * TDimension + 4 );
+  itkStaticConstMacro( Alpha2Column, unsigned int, 4 * TDimension + 5 );
+  itkStaticConstMacro( Alpha3Column, unsigned int, 4 * TDimension + 6 );
+  itkStaticConstMacro( PointIdColumn, unsigned int, 4 * TDimension + 7 );
+  itkStaticConstMacro( NumberOfColumns, unsigned int, 4 * TDimension + 8 );
+
+  /** Return true if the file starts with the binary tube file signature */
+  static bool CanReadFile( const std::string & _fileName );
+
+  /** Read every tube of the file into the tube group */
+  bool  Read( const std::string & _fileName );
+
+  /** Write the tubes of the tube group */
+  bool  Write( const std::string & _fileName );
+
+  /** Memory-map the file and read its tube index */
+  bool  Open( const std::string & _fileName );
+
+  /** Release the mapped file */
+  void  Close( void );
+
+  /** Build the tube index and the point columns in memory from the tube
+   *  group, in place of an open file.  These columns are writable. */
+  void  GenerateColumns( void );
+
+  bool  IsOpen( void ) const;
+
+  unsigned int GetNumberOfTubes( void ) const;
+
+  SizeValueType GetNumberOfPoints( void ) const;
+
+  int GetTubeId( unsigned int _tubeNumber ) const;
+
+  SizeValueType GetTubeNumberOfPoints( unsigned int _tubeNumber ) const;
+
+  /** Position of the first point of a tube within the columns */
+  SizeValueType GetTubeFirstPoint( unsigned int _tubeNumber ) const;
+
+  /** Return the values of one column for all points */
+  const double * GetColumn( unsigned int _column ) const;
+
+  /** Return the values of one column for all points, or NULL if the
+   *  columns refer to a mapped file. */
+  double * GetMutableColumn( unsigned int _column );
+
+  /** Return the values of one column for the points of a tube.  The
+   *  pointer refers to the mapped file and is valid until Close(). */
+  const double * GetTubeColumn( unsigned int _tubeNumber,
+    unsigned int _column ) const;
+
+  /** Build the spatial object of one tube of the open file */
+  typename TubeType::Pointer GetTube( unsigned int _tubeNumber ) const;
+
+  void  SetTubeGroup( TubeGroupType * _tubes );
+
+  typename TubeGroupType::Pointer & GetTubeGroup( void );
+
+protected:
+
+  TubeBinaryIO( void );
+  virtual ~TubeBinaryIO( void );
+
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
+private:
+
+  TubeBinaryIO( const Self& );
+  void operator=( const Self& );
+
+  struct TubeIndexEntryType
+    {
+    int            id;
+    int            parentId;
+    int            parentPoint;
+    unsigned int   flags;
+    float          color[4];
+    SizeValueType  firstPoint;
+    SizeValueType  numberOfPoints;
+    };
+
+  /** Return the value of one column for a tube point */
+  static double GetPointValue( const TubePointType & _pnt,
+    unsigned int _column );
+
+  typename TubeGroupType::Pointer    m_TubeGroup;
+
+  std::vector< TubeIndexEntryType >  m_TubeIndex;
+  double                             m_Spacing[ TDimension ];
+  SizeValueType                      m_NumberOfPoints;
+
+  /** Start of the point columns, in the mapped file or in m_Buffer */
+  const double                     * m_Columns;
+
+  /** Used in place of the mapping on big-endian systems */
+  std::vector< double >              m_Buffer;
+
+  void                             * m_MappedData;
+  SizeValueType                      m_MappedSize;
+  void                             * m_MappingHandle;
+
+}; // TubeBinaryIO
+
+} // namespace tube
+
+} // namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itktubeTubeBinaryIO.hxx"
+#endif
+
+#endif
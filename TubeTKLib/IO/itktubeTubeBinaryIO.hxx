@@ -0,0 +1,831 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __itktubeTubeBinaryIO_hxx
+#define __itktubeTubeBinaryIO_hxx
+
+#include "itktubeTubeBinaryIO.h"
+
+#include <itkByteSwapper.h>
+#include <itkIntTypes.h>
+
+#include <cstring>
+#include <fstream>
+
+#if defined( _WIN32 )
+// Keep windows.h from defining min and max macros, which would break
+// std::min and std::max in every file that includes this header
+#ifndef NOMINMAX
+#define NOMINMAX
+#define __itktubeTubeBinaryIO_NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#define __itktubeTubeBinaryIO_WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#ifdef __itktubeTubeBinaryIO_NOMINMAX
+#undef NOMINMAX
+#undef __itktubeTubeBinaryIO_NOMINMAX
+#endif
+#ifdef __itktubeTubeBinaryIO_WIN32_LEAN_AND_MEAN
+#undef WIN32_LEAN_AND_MEAN
+#undef __itktubeTubeBinaryIO_WIN32_LEAN_AND_MEAN
+#endif
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace itk
+{
+
+namespace tube
+{
+
+/**
+ * File layout, all values little-endian:
+ *   header : char[8] signature, uint32 version, uint32 dimension,
+ *            uint32 number of columns, uint32 number of tubes,
+ *            uint64 number of points, double[ dimension ] spacing
+ *   index  : per tube, int32 id, int32 parent id, int32 parent point,
+ *            uint32 flags, float[4] color, uint64 first point,
+ *            uint64 number of points
+ *   columns: per column, double[ number of points ]
+ * Every section starts on an 8 byte boundary. */
+static const char         TubeBinaryIOSignature[9] = "TubeTKBT";
+static const unsigned int TubeBinaryIOIndexEntrySize = 48;
+static const unsigned int TubeBinaryIOArteryFlag = 1;
+static const unsigned int TubeBinaryIORootFlag = 2;
+
+template< unsigned int TDimension >
+TubeBinaryIO< TDimension >
+::TubeBinaryIO( void )
+{
+  m_TubeGroup = TubeGroupType::New();
+
+  m_TubeIndex.clear();
+  for( unsigned int i = 0; i < TDimension; ++i )
+    {
+    m_Spacing[i] = 1;
+    }
+  m_NumberOfPoints = 0;
+
+  m_Columns = NULL;
+  m_Buffer.clear();
+
+  m_MappedData = NULL;
+  m_MappedSize = 0;
+  m_MappingHandle = NULL;
+}
+
+template< unsigned int TDimension >
+TubeBinaryIO< TDimension >
+::~TubeBinaryIO( void )
+{
+  this->Close();
+}
+
+template< unsigned int TDimension >
+void
+TubeBinaryIO< TDimension >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  if( this->m_TubeGroup.IsNotNull() )
+    {
+    os << indent << "Tube Group = " << this->m_TubeGroup << std::endl;
+    }
+  else
+    {
+    os << indent << "Tube Group = NULL" << std::endl;
+    }
+  os << indent << "Number of indexed tubes = " << m_TubeIndex.size()
+    << std::endl;
+  os << indent << "Spacing =";
+  for( unsigned int i = 0; i < TDimension; ++i )
+    {
+    os << " " << m_Spacing[i];
+    }
+  os << std::endl;
+  os << indent << "Number of points = " << m_NumberOfPoints << std::endl;
+  os << indent << "Columns = " << m_Columns << std::endl;
+  os << indent << "Buffer size = " << m_Buffer.size() << std::endl;
+  os << indent << "Mapped data = " << m_MappedData << std::endl;
+  os << indent << "Mapped size = " << m_MappedSize << std::endl;
+  os << indent << "Mapping handle = " << m_MappingHandle << std::endl;
+}
+
+template< unsigned int TDimension >
+bool
+TubeBinaryIO< TDimension >
+::CanReadFile( const std::string & _fileName )
+{
+  std::ifstream tmpReadStream( _fileName.c_str(), std::ios::binary |
+    std::ios::in );
+  if( !tmpReadStream.rdbuf()->is_open() )
+    {
+    return false;
+    }
+
+  char signature[8];
+  tmpReadStream.read( signature, 8 );
+  if( tmpReadStream.gcount() != 8 )
+    {
+    return false;
+    }
+
+  return std::memcmp( signature, TubeBinaryIOSignature, 8 ) == 0;
+}
+
+template< unsigned int TDimension >
+bool
+TubeBinaryIO< TDimension >
+::Read( const std::string & _fileName )
+{
+  if( !this->Open( _fileName ) )
+    {
+    return false;
+    }
+
+  for( unsigned int t = 0; t < m_TubeIndex.size(); ++t )
+    {
+    m_TubeGroup->AddSpatialObject( this->GetTube( t ) );
+    }
+
+  this->Close();
+
+  return true;
+}
+
+template< unsigned int TDimension >
+double
+TubeBinaryIO< TDimension >
+::GetPointValue( const TubePointType & _pnt, unsigned int _column )
+{
+  if( _column < RadiusColumn )
+    {
+    return _pnt.GetPosition()[ _column - PositionColumn ];
+    }
+  else if( _column == RadiusColumn )
+    {
+    return _pnt.GetRadius();
+    }
+  else if( _column < Normal1Column )
+    {
+    return _pnt.GetTangent()[ _column - TangentColumn ];
+    }
+  else if( _column < Normal2Column )
+    {
+    return _pnt.GetNormal1()[ _column - Normal1Column ];
+    }
+  else if( _column < MedialnessColumn )
+    {
+    return _pnt.GetNormal2()[ _column - Normal2Column ];
+    }
+
+  switch( _column - MedialnessColumn )
+    {
+    case 0:
+      return _pnt.GetMedialness();
+    case 1:
+      return _pnt.GetRidgeness();
+    case 2:
+      return _pnt.GetBranchness();
+    case 3:
+      return _pnt.GetAlpha1();
+    case 4:
+      return _pnt.GetAlpha2();
+    case 5:
+      return _pnt.GetAlpha3();
+    default:
+      return _pnt.GetID();
+    }
+}
+
+template< unsigned int TDimension >
+bool
+TubeBinaryIO< TDimension >
+::Write( const std::string & _fileName )
+{
+  char soType[80];
+  sprintf( soType, "Tube" );
+  typename TubeType::ChildrenListType * childrenList =
+    m_TubeGroup->GetChildren( 99999, soType );
+
+  std::vector< const TubeType * > tubeList;
+  typename TubeType::ChildrenListType::iterator cIt = childrenList->begin();
+  while( cIt != childrenList->end() )
+    {
+    const TubeType * tube = dynamic_cast< const TubeType * >(
+      cIt->GetPointer() );
+    if( tube != NULL )
+      {
+      tubeList.push_back( tube );
+      }
+    ++cIt;
+    }
+
+  std::ofstream tmpWriteStream( _fileName.c_str(), std::ios::binary |
+    std::ios::out );
+  if( !tmpWriteStream.rdbuf()->is_open() )
+    {
+    delete childrenList;
+    return false;
+    }
+
+  typedef ByteSwapper< uint32_t >  UInt32SwapperType;
+  typedef ByteSwapper< int32_t >   Int32SwapperType;
+  typedef ByteSwapper< uint64_t >  UInt64SwapperType;
+  typedef ByteSwapper< float >     FloatSwapperType;
+  typedef ByteSwapper< double >    DoubleSwapperType;
+
+  uint64_t numberOfPoints = 0;
+  for( unsigned int t = 0; t < tubeList.size(); ++t )
+    {
+    numberOfPoints += tubeList[t]->GetPoints().size();
+    }
+
+  tmpWriteStream.write( TubeBinaryIOSignature, 8 );
+  uint32_t header[4];
+  header[0] = FileVersion;
+  header[1] = TDimension;
+  header[2] = NumberOfColumns;
+  header[3] = tubeList.size();
+  UInt32SwapperType::SwapWriteRangeFromSystemToLittleEndian( header, 4,
+    &tmpWriteStream );
+  UInt64SwapperType::SwapWriteRangeFromSystemToLittleEndian(
+    &numberOfPoints, 1, &tmpWriteStream );
+  double spacing[ TDimension ];
+  for( unsigned int i = 0; i < TDimension; ++i )
+    {
+    spacing[i] = 1;
+    if( !tubeList.empty() )
+      {
+      spacing[i] = tubeList[0]->GetSpacing()[i];
+      }
+    }
+  DoubleSwapperType::SwapWriteRangeFromSystemToLittleEndian( spacing,
+    TDimension, &tmpWriteStream );
+
+  uint64_t firstPoint = 0;
+  for( unsigned int t = 0; t < tubeList.size(); ++t )
+    {
+    const TubeType * tube = tubeList[t];
+
+    int32_t tubeIds[3];
+    tubeIds[0] = tube->GetId();
+    tubeIds[1] = tube->GetParentId();
+    tubeIds[2] = tube->GetParentPoint();
+    Int32SwapperType::SwapWriteRangeFromSystemToLittleEndian( tubeIds, 3,
+      &tmpWriteStream );
+
+    uint32_t flags = 0;
+    if( tube->GetArtery() )
+      {
+      flags |= TubeBinaryIOArteryFlag;
+      }
+    if( tube->GetRoot() )
+      {
+      flags |= TubeBinaryIORootFlag;
+      }
+    UInt32SwapperType::SwapWriteRangeFromSystemToLittleEndian( &flags, 1,
+      &tmpWriteStream );
+
+    float color[4];
+    color[0] = tube->GetProperty()->GetRed();
+    color[1] = tube->GetProperty()->GetGreen();
+    color[2] = tube->GetProperty()->GetBlue();
+    color[3] = tube->GetProperty()->GetAlpha();
+    FloatSwapperType::SwapWriteRangeFromSystemToLittleEndian( color, 4,
+      &tmpWriteStream );
+
+    uint64_t pointRange[2];
+    pointRange[0] = firstPoint;
+    pointRange[1] = tube->GetPoints().size();
+    UInt64SwapperType::SwapWriteRangeFromSystemToLittleEndian( pointRange,
+      2, &tmpWriteStream );
+
+    firstPoint += pointRange[1];
+    }
+
+  std::vector< double > column( numberOfPoints );
+  for( unsigned int c = 0; c < NumberOfColumns; ++c )
+    {
+    SizeValueType p = 0;
+    for( unsigned int t = 0; t < tubeList.size(); ++t )
+      {
+      typename TubeType::PointListType::const_iterator pntIt =
+        tubeList[t]->GetPoints().begin();
+      while( pntIt != tubeList[t]->GetPoints().end() )
+        {
+        column[p++] = this->GetPointValue( *pntIt, c );
+        ++pntIt;
+        }
+      }
+    if( numberOfPoints > 0 )
+      {
+      DoubleSwapperType::SwapWriteRangeFromSystemToLittleEndian(
+        &( column[0] ), numberOfPoints, &tmpWriteStream );
+      }
+    }
+
+  bool result = tmpWriteStream.good();
+  tmpWriteStream.close();
+
+  childrenList->clear();
+  delete childrenList;
+
+  return result;
+}
+
+template< unsigned int TDimension >
+bool
+TubeBinaryIO< TDimension >
+::Open( const std::string & _fileName )
+{
+  this->Close();
+
+#if defined( _WIN32 )
+  HANDLE fileHandle = CreateFileA( _fileName.c_str(), GENERIC_READ,
+    FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+  if( fileHandle == INVALID_HANDLE_VALUE )
+    {
+    return false;
+    }
+  LARGE_INTEGER fileSize;
+  if( !GetFileSizeEx( fileHandle, &fileSize ) || fileSize.QuadPart == 0 )
+    {
+    CloseHandle( fileHandle );
+    return false;
+    }
+  HANDLE mappingHandle = CreateFileMappingA( fileHandle, NULL,
+    PAGE_READONLY, 0, 0, NULL );
+  CloseHandle( fileHandle );
+  if( mappingHandle == NULL )
+    {
+    return false;
+    }
+  m_MappedData = MapViewOfFile( mappingHandle, FILE_MAP_READ, 0, 0, 0 );
+  if( m_MappedData == NULL )
+    {
+    CloseHandle( mappingHandle );
+    return false;
+    }
+  m_MappingHandle = mappingHandle;
+  m_MappedSize = fileSize.QuadPart;
+#else
+  int fileDescriptor = open( _fileName.c_str(), O_RDONLY );
+  if( fileDescriptor < 0 )
+    {
+    return false;
+    }
+  struct stat fileStat;
+  if( fstat( fileDescriptor, &fileStat ) != 0 || fileStat.st_size == 0 )
+    {
+    close( fileDescriptor );
+    return false;
+    }
+  void * mappedData = mmap( NULL, fileStat.st_size, PROT_READ, MAP_SHARED,
+    fileDescriptor, 0 );
+  close( fileDescriptor );
+  if( mappedData == MAP_FAILED )
+    {
+    return false;
+    }
+  m_MappedData = mappedData;
+  m_MappedSize = fileStat.st_size;
+#endif
+
+  const char * data = static_cast< const char * >( m_MappedData );
+
+  typedef ByteSwapper< uint32_t >  UInt32SwapperType;
+  typedef ByteSwapper< int32_t >   Int32SwapperType;
+  typedef ByteSwapper< uint64_t >  UInt64SwapperType;
+  typedef ByteSwapper< float >     FloatSwapperType;
+  typedef ByteSwapper< double >    DoubleSwapperType;
+
+  SizeValueType headerSize = 32 + 8 * TDimension;
+  if( m_MappedSize < headerSize
+    || std::memcmp( data, TubeBinaryIOSignature, 8 ) != 0 )
+    {
+    std::cerr << "TubeBinaryIO: Not a binary tube file: " << _fileName
+      << std::endl;
+    this->Close();
+    return false;
+    }
+
+  uint32_t header[4];
+  std::memcpy( header, data + 8, sizeof( header ) );
+  UInt32SwapperType::SwapRangeFromSystemToLittleEndian( header, 4 );
+  uint64_t numberOfPoints = 0;
+  std::memcpy( &numberOfPoints, data + 24, sizeof( numberOfPoints ) );
+  UInt64SwapperType::SwapFromSystemToLittleEndian( &numberOfPoints );
+  std::memcpy( m_Spacing, data + 32, sizeof( m_Spacing ) );
+  DoubleSwapperType::SwapRangeFromSystemToLittleEndian( m_Spacing,
+    TDimension );
+
+  if( header[0] > FileVersion || header[1] != TDimension
+    || header[2] < NumberOfColumns )
+    {
+    std::cerr << "TubeBinaryIO: Unsupported version " << header[0]
+      << ", dimension " << header[1] << ", or number of columns "
+      << header[2] << std::endl;
+    this->Close();
+    return false;
+    }
+
+  unsigned int numberOfTubes = header[3];
+  SizeValueType columnsOffset = headerSize
+    + TubeBinaryIOIndexEntrySize * numberOfTubes;
+  if( m_MappedSize < columnsOffset + sizeof( double ) * header[2]
+    * numberOfPoints )
+    {
+    std::cerr << "TubeBinaryIO: File is truncated: " << _fileName
+      << std::endl;
+    this->Close();
+    return false;
+    }
+
+  m_NumberOfPoints = numberOfPoints;
+  m_TubeIndex.resize( numberOfTubes );
+  const char * entry = data + headerSize;
+  for( unsigned int t = 0; t < numberOfTubes; ++t )
+    {
+    int32_t tubeIds[3];
+    std::memcpy( tubeIds, entry, sizeof( tubeIds ) );
+    Int32SwapperType::SwapRangeFromSystemToLittleEndian( tubeIds, 3 );
+    uint32_t flags = 0;
+    std::memcpy( &flags, entry + 12, sizeof( flags ) );
+    UInt32SwapperType::SwapFromSystemToLittleEndian( &flags );
+    float color[4];
+    std::memcpy( color, entry + 16, sizeof( color ) );
+    FloatSwapperType::SwapRangeFromSystemToLittleEndian( color, 4 );
+    uint64_t pointRange[2];
+    std::memcpy( pointRange, entry + 32, sizeof( pointRange ) );
+    UInt64SwapperType::SwapRangeFromSystemToLittleEndian( pointRange, 2 );
+
+    if( pointRange[0] + pointRange[1] > numberOfPoints )
+      {
+      std::cerr << "TubeBinaryIO: Tube " << t << " is out of range."
+        << std::endl;
+      this->Close();
+      return false;
+      }
+
+    m_TubeIndex[t].id = tubeIds[0];
+    m_TubeIndex[t].parentId = tubeIds[1];
+    m_TubeIndex[t].parentPoint = tubeIds[2];
+    m_TubeIndex[t].flags = flags;
+    for( unsigned int i = 0; i < 4; ++i )
+      {
+      m_TubeIndex[t].color[i] = color[i];
+      }
+    m_TubeIndex[t].firstPoint = pointRange[0];
+    m_TubeIndex[t].numberOfPoints = pointRange[1];
+
+    entry += TubeBinaryIOIndexEntrySize;
+    }
+
+  // The columns are used in place, unless they must be byte swapped
+  if( DoubleSwapperType::SystemIsBigEndian() )
+    {
+    m_Buffer.resize( NumberOfColumns * m_NumberOfPoints );
+    if( !m_Buffer.empty() )
+      {
+      std::memcpy( &( m_Buffer[0] ), data + columnsOffset,
+        m_Buffer.size() * sizeof( double ) );
+      DoubleSwapperType::SwapRangeFromSystemToLittleEndian(
+        &( m_Buffer[0] ), m_Buffer.size() );
+      m_Columns = &( m_Buffer[0] );
+      }
+    }
+  else
+    {
+    m_Columns = reinterpret_cast< const double * >( data + columnsOffset );
+    }
+
+  return true;
+}
+
+template< unsigned int TDimension >
+void
+TubeBinaryIO< TDimension >
+::Close( void )
+{
+  if( m_MappedData != NULL )
+    {
+#if defined( _WIN32 )
+    UnmapViewOfFile( m_MappedData );
+    CloseHandle( static_cast< HANDLE >( m_MappingHandle ) );
+#else
+    munmap( m_MappedData, m_MappedSize );
+#endif
+    }
+  m_MappedData = NULL;
+  m_MappedSize = 0;
+  m_MappingHandle = NULL;
+
+  m_Columns = NULL;
+  m_Buffer.clear();
+  m_TubeIndex.clear();
+  m_NumberOfPoints = 0;
+}
+
+template< unsigned int TDimension >
+void
+TubeBinaryIO< TDimension >
+::GenerateColumns( void )
+{
+  this->Close();
+
+  char soType[80];
+  sprintf( soType, "Tube" );
+  typename TubeType::ChildrenListType * childrenList =
+    m_TubeGroup->GetChildren( 99999, soType );
+
+  std::vector< const TubeType * > tubeList;
+  typename TubeType::ChildrenListType::iterator cIt = childrenList->begin();
+  while( cIt != childrenList->end() )
+    {
+    const TubeType * tube = dynamic_cast< const TubeType * >(
+      cIt->GetPointer() );
+    if( tube != NULL )
+      {
+      TubeIndexEntryType tubeEntry;
+      tubeEntry.id = tube->GetId();
+      tubeEntry.parentId = tube->GetParentId();
+      tubeEntry.parentPoint = tube->GetParentPoint();
+      tubeEntry.flags = 0;
+      if( tube->GetArtery() )
+        {
+        tubeEntry.flags |= TubeBinaryIOArteryFlag;
+        }
+      if( tube->GetRoot() )
+        {
+        tubeEntry.flags |= TubeBinaryIORootFlag;
+        }
+      tubeEntry.color[0] = tube->GetProperty()->GetRed();
+      tubeEntry.color[1] = tube->GetProperty()->GetGreen();
+      tubeEntry.color[2] = tube->GetProperty()->GetBlue();
+      tubeEntry.color[3] = tube->GetProperty()->GetAlpha();
+      tubeEntry.firstPoint = m_NumberOfPoints;
+      tubeEntry.numberOfPoints = tube->GetPoints().size();
+      m_TubeIndex.push_back( tubeEntry );
+
+      tubeList.push_back( tube );
+      m_NumberOfPoints += tubeEntry.numberOfPoints;
+      }
+    ++cIt;
+    }
+
+  if( !tubeList.empty() )
+    {
+    for( unsigned int i = 0; i < TDimension; ++i )
+      {
+      m_Spacing[i] = tubeList[0]->GetSpacing()[i];
+      }
+    }
+
+  m_Buffer.resize( NumberOfColumns * m_NumberOfPoints );
+  for( unsigned int t = 0; t < tubeList.size(); ++t )
+    {
+    SizeValueType p = m_TubeIndex[t].firstPoint;
+    typename TubeType::PointListType::const_iterator pntIt =
+      tubeList[t]->GetPoints().begin();
+    while( pntIt != tubeList[t]->GetPoints().end() )
+      {
+      for( unsigned int c = 0; c < NumberOfColumns; ++c )
+        {
+        m_Buffer[ c * m_NumberOfPoints + p ] =
+          this->GetPointValue( *pntIt, c );
+        }
+      ++p;
+      ++pntIt;
+      }
+    }
+  if( !m_Buffer.empty() )
+    {
+    m_Columns = &( m_Buffer[0] );
+    }
+
+  childrenList->clear();
+  delete childrenList;
+}
+
+template< unsigned int TDimension >
+bool
+TubeBinaryIO< TDimension >
+::IsOpen( void ) const
+{
+  return m_MappedData != NULL;
+}
+
+template< unsigned int TDimension >
+unsigned int
+TubeBinaryIO< TDimension >
+::GetNumberOfTubes( void ) const
+{
+  return m_TubeIndex.size();
+}
+
+template< unsigned int TDimension >
+SizeValueType
+TubeBinaryIO< TDimension >
+::GetNumberOfPoints( void ) const
+{
+  return m_NumberOfPoints;
+}
+
+template< unsigned int TDimension >
+int
+TubeBinaryIO< TDimension >
+::GetTubeId( unsigned int _tubeNumber ) const
+{
+  if( _tubeNumber >= m_TubeIndex.size() )
+    {
+    return -1;
+    }
+  return m_TubeIndex[ _tubeNumber ].id;
+}
+
+template< unsigned int TDimension >
+SizeValueType
+TubeBinaryIO< TDimension >
+::GetTubeNumberOfPoints( unsigned int _tubeNumber ) const
+{
+  if( _tubeNumber >= m_TubeIndex.size() )
+    {
+    return 0;
+    }
+  return m_TubeIndex[ _tubeNumber ].numberOfPoints;
+}
+
+template< unsigned int TDimension >
+SizeValueType
+TubeBinaryIO< TDimension >
+::GetTubeFirstPoint( unsigned int _tubeNumber ) const
+{
+  if( _tubeNumber >= m_TubeIndex.size() )
+    {
+    return 0;
+    }
+  return m_TubeIndex[ _tubeNumber ].firstPoint;
+}
+
+template< unsigned int TDimension >
+const double *
+TubeBinaryIO< TDimension >
+::GetColumn( unsigned int _column ) const
+{
+  if( m_Columns == NULL || _column >= NumberOfColumns )
+    {
+    return NULL;
+    }
+  return m_Columns + _column * m_NumberOfPoints;
+}
+
+template< unsigned int TDimension >
+double *
+TubeBinaryIO< TDimension >
+::GetMutableColumn( unsigned int _column )
+{
+  if( m_MappedData != NULL || m_Buffer.empty()
+    || _column >= NumberOfColumns )
+    {
+    return NULL;
+    }
+  return &( m_Buffer[0] ) + _column * m_NumberOfPoints;
+}
+
+template< unsigned int TDimension >
+const double *
+TubeBinaryIO< TDimension >
+::GetTubeColumn( unsigned int _tubeNumber, unsigned int _column ) const
+{
+  if( m_Columns == NULL || _tubeNumber >= m_TubeIndex.size()
+    || _column >= NumberOfColumns )
+    {
+    return NULL;
+    }
+  return m_Columns + _column * m_NumberOfPoints
+    + m_TubeIndex[ _tubeNumber ].firstPoint;
+}
+
+template< unsigned int TDimension >
+typename TubeBinaryIO< TDimension >::TubeType::Pointer
+TubeBinaryIO< TDimension >
+::GetTube( unsigned int _tubeNumber ) const
+{
+  if( m_Columns == NULL && m_NumberOfPoints > 0 )
+    {
+    return NULL;
+    }
+  if( _tubeNumber >= m_TubeIndex.size() )
+    {
+    return NULL;
+    }
+
+  const TubeIndexEntryType & tubeEntry = m_TubeIndex[ _tubeNumber ];
+
+  typename TubeType::Pointer tube = TubeType::New();
+
+  std::vector< const double * > columns( NumberOfColumns );
+  for( unsigned int c = 0; c < NumberOfColumns; ++c )
+    {
+    columns[c] = this->GetTubeColumn( _tubeNumber, c );
+    }
+
+  typename TubeType::PointListType & points = tube->GetPoints();
+  points.resize( tubeEntry.numberOfPoints );
+  for( SizeValueType p = 0; p < tubeEntry.numberOfPoints; ++p )
+    {
+    TubePointType & pnt = points[p];
+
+    typename TubePointType::PointType x;
+    typename TubePointType::VectorType t;
+    typename TubePointType::CovariantVectorType n1;
+    typename TubePointType::CovariantVectorType n2;
+    for( unsigned int d = 0; d < TDimension; ++d )
+      {
+      x[d] = columns[ PositionColumn + d ][p];
+      t[d] = columns[ TangentColumn + d ][p];
+      n1[d] = columns[ Normal1Column + d ][p];
+      n2[d] = columns[ Normal2Column + d ][p];
+      }
+    pnt.SetPosition( x );
+    pnt.SetRadius( columns[ RadiusColumn ][p] );
+    pnt.SetTangent( t );
+    pnt.SetNormal1( n1 );
+    pnt.SetNormal2( n2 );
+    pnt.SetMedialness( columns[ MedialnessColumn ][p] );
+    pnt.SetRidgeness( columns[ RidgenessColumn ][p] );
+    pnt.SetBranchness( columns[ BranchnessColumn ][p] );
+    pnt.SetAlpha1( columns[ Alpha1Column ][p] );
+    pnt.SetAlpha2( columns[ Alpha2Column ][p] );
+    pnt.SetAlpha3( columns[ Alpha3Column ][p] );
+    pnt.SetID( static_cast< int >( columns[ PointIdColumn ][p] ) );
+    }
+
+  double spacing[ TDimension ];
+  for( unsigned int i = 0; i < TDimension; ++i )
+    {
+    spacing[i] = m_Spacing[i];
+    }
+  tube->SetSpacing( spacing );
+  tube->SetId( tubeEntry.id );
+  tube->SetParentId( tubeEntry.parentId );
+  tube->SetParentPoint( tubeEntry.parentPoint );
+  tube->SetArtery( ( tubeEntry.flags & TubeBinaryIOArteryFlag ) != 0 );
+  tube->SetRoot( ( tubeEntry.flags & TubeBinaryIORootFlag ) != 0 );
+  tube->GetProperty()->SetColor( tubeEntry.color[0], tubeEntry.color[1],
+    tubeEntry.color[2] );
+  tube->GetProperty()->SetAlpha( tubeEntry.color[3] );
+
+  return tube;
+}
+
+template< unsigned int TDimension >
+void
+TubeBinaryIO< TDimension >
+::SetTubeGroup( TubeGroupType * _tubes )
+{
+  m_TubeGroup = _tubes;
+}
+
+template< unsigned int TDimension >
+typename GroupSpatialObject< TDimension >::Pointer &
+TubeBinaryIO< TDimension >
+::GetTubeGroup( void )
+{
+  return m_TubeGroup;
+}
+
+} // tube namespace
+
+} // itk namespace
+
+#endif
@@ -0,0 +1,119 @@
+/*=========================================================================
+
+Library:   TubeTKLib
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+
+#include "itktubeKdTreePointLocator.h"
+
+#include <itkMersenneTwisterRandomVariateGenerator.h>
+
+template< unsigned int VDimension >
+int TestKdTreePointLocator( void )
+{
+  typedef itk::tube::KdTreePointLocator< VDimension >  LocatorType;
+  typedef typename LocatorType::PointType              PointType;
+  typedef typename LocatorType::PointContainerType     PointContainerType;
+  typedef typename LocatorType::IdentifierType         IdentifierType;
+
+  itk::Statistics::MersenneTwisterRandomVariateGenerator::Pointer rndGen
+    = itk::Statistics::MersenneTwisterRandomVariateGenerator::New();
+  rndGen->Initialize( 1 );
+
+  // Points on a sphere, like the vertices of a border surface
+  PointContainerType points( 2000 );
+  for( unsigned int i = 0; i < points.size(); ++i )
+    {
+    double norm = 0;
+    for( unsigned int d = 0; d < VDimension; ++d )
+      {
+      points[i][d] = rndGen->GetNormalVariate( 0.0, 1.0 );
+      norm += points[i][d] * points[i][d];
+      }
+    norm = std::sqrt( norm );
+    for( unsigned int d = 0; d < VDimension; ++d )
+      {
+      points[i][d] = 10 * points[i][d] / norm;
+      }
+    }
+
+  typename LocatorType::Pointer locator = LocatorType::New();
+  locator->SetPoints( points );
+  locator->Initialize();
+  std::cout << locator << std::endl;
+
+  int returnStatus = EXIT_SUCCESS;
+  for( unsigned int count = 0; count < 500; ++count )
+    {
+    PointType x;
+    for( unsigned int d = 0; d < VDimension; ++d )
+      {
+      x[d] = rndGen->GetUniformVariate( -15.0, 15.0 );
+      }
+
+    double distance = 0;
+    IdentifierType id = locator->FindClosestPoint( x, distance );
+
+    double closestDistance = x.EuclideanDistanceTo( points[0] );
+    for( unsigned int i = 1; i < points.size(); ++i )
+      {
+      closestDistance = std::min( closestDistance,
+        x.EuclideanDistanceTo( points[i] ) );
+      }
+
+    if( std::fabs( distance - closestDistance ) > 1e-12
+      || std::fabs( x.EuclideanDistanceTo( locator->GetPoint( id ) )
+        - closestDistance ) > 1e-12 )
+      {
+      std::cerr << count << " : FAILURE: closest point to " << x
+        << " found at " << distance << " instead of " << closestDistance
+        << std::endl;
+      returnStatus = EXIT_FAILURE;
+      }
+    }
+
+  return returnStatus;
+}
+
+int itktubeKdTreePointLocatorTest( int itkNotUsed( argc ),
+  char * itkNotUsed( argv )[] )
+{
+  typedef itk::tube::KdTreePointLocator< 3 > LocatorType;
+
+  LocatorType::Pointer emptyLocator = LocatorType::New();
+  try
+    {
+    emptyLocator->FindClosestPoint( LocatorType::PointType() );
+    std::cerr << "FAILURE: no exception from an empty locator."
+      << std::endl;
+    return EXIT_FAILURE;
+    }
+  catch( itk::ExceptionObject & )
+    {
+    }
+
+  if( TestKdTreePointLocator< 2 >() == EXIT_FAILURE ||
+      TestKdTreePointLocator< 3 >() == EXIT_FAILURE )
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
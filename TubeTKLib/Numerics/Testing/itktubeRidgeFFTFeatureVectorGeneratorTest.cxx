@@ -23,6 +23,10 @@ limitations under the License.
 
 #include "itktubeRidgeFFTFeatureVectorGenerator.h"
 
+#include <itkImageRegionConstIterator.h>
+
+#include <cmath>
+
 int itktubeRidgeFFTFeatureVectorGeneratorTest( int argc, char * argv[] )
 {
   if( argc != 4 )
@@ -78,6 +82,104 @@ int itktubeRidgeFFTFeatureVectorGeneratorTest( int argc, char * argv[] )
   filter->SetUpdateWhitenStatisticsOnUpdate( true );
   filter->Update();
 
+  // Folding each scale into the optimal scale features as it is computed
+  // must give the same optimal scale features ( up to FFT rounding, which
+  // may also flip the optimal scale at near ties )
+  FilterType::Pointer optimalFilter = FilterType::New();
+  optimalFilter->SetInput( inputImage );
+  optimalFilter->SetScales( scales );
+  optimalFilter->SetUseOptimalScaleFeaturesOnly( true );
+  optimalFilter->Update();
+
+  const unsigned int numFeatures = filter->GetNumberOfFeatures();
+  const unsigned int numOptimalFeatures =
+    optimalFilter->GetNumberOfFeatures();
+  const unsigned int numPixels =
+    inputImage->GetLargestPossibleRegion().GetNumberOfPixels();
+  for( unsigned int f = 0; f < numOptimalFeatures; ++f )
+    {
+    itk::ImageRegionConstIterator< ImageType > iter(
+      filter->GetFeatureImage( numFeatures - numOptimalFeatures + f ),
+      inputImage->GetLargestPossibleRegion() );
+    itk::ImageRegionConstIterator< ImageType > iterOptimal(
+      optimalFilter->GetFeatureImage( f ),
+      inputImage->GetLargestPossibleRegion() );
+    unsigned int numDifferent = 0;
+    while( !iter.IsAtEnd() )
+      {
+      if( std::fabs( iter.Get() - iterOptimal.Get() )
+        > 0.0001 * ( 1 + std::fabs( iter.Get() ) ) )
+        {
+        ++numDifferent;
+        }
+      ++iter;
+      ++iterOptimal;
+      }
+    if( numDifferent > numPixels / 1000 )
+      {
+      std::cerr << "Optimal scale feature " << f << " differs at "
+        << numDifferent << " pixels." << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Processing the image in slabs along its last axis must give the
+  // features of the whole image.  Near the image boundaries along that
+  // axis the FFT wraps around the slab instead of the image, so only the
+  // rows at least the slab margin away from them are compared.
+  FilterType::Pointer slabFilter = FilterType::New();
+  slabFilter->SetInput( inputImage );
+  slabFilter->SetScales( scales );
+  slabFilter->SetSlabSize( 10 );
+  slabFilter->Update();
+
+  if( slabFilter->GetNumberOfFeatures() != numFeatures )
+    {
+    std::cerr << "Slab filter has " << slabFilter->GetNumberOfFeatures()
+      << " features instead of " << numFeatures << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const unsigned int slabAxis = Dimension - 1;
+  const itk::IndexValueType margin = static_cast< itk::IndexValueType >(
+    std::ceil( 6 * scales[1] / inputImage->GetSpacing()[slabAxis] ) );
+  ImageType::RegionType coreRegion = inputImage->GetLargestPossibleRegion();
+  if( coreRegion.GetSize()[slabAxis] <= static_cast< itk::SizeValueType >(
+    2 * margin + 10 ) )
+    {
+    std::cerr << "Input image is too small to test the slabs."
+      << std::endl;
+    return EXIT_FAILURE;
+    }
+  coreRegion.SetIndex( slabAxis, coreRegion.GetIndex()[slabAxis] + margin );
+  coreRegion.SetSize( slabAxis, coreRegion.GetSize()[slabAxis]
+    - 2 * margin );
+  const unsigned int numCorePixels = coreRegion.GetNumberOfPixels();
+  for( unsigned int f = 0; f < numFeatures; ++f )
+    {
+    itk::ImageRegionConstIterator< ImageType > iter(
+      filter->GetFeatureImage( f ), coreRegion );
+    itk::ImageRegionConstIterator< ImageType > iterSlab(
+      slabFilter->GetFeatureImage( f ), coreRegion );
+    unsigned int numDifferent = 0;
+    while( !iter.IsAtEnd() )
+      {
+      if( std::fabs( iter.Get() - iterSlab.Get() )
+        > 0.0001 * ( 1 + std::fabs( iter.Get() ) ) )
+        {
+        ++numDifferent;
+        }
+      ++iter;
+      ++iterSlab;
+      }
+    if( numDifferent > numCorePixels / 1000 )
+      {
+      std::cerr << "Slab feature " << f << " differs at "
+        << numDifferent << " pixels." << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
   WriterType::Pointer imageFeature0Writer = WriterType::New();
   imageFeature0Writer->SetFileName( argv[2] );
   imageFeature0Writer->SetUseCompression( true );
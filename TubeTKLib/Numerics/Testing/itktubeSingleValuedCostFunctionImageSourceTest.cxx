@@ -26,6 +26,7 @@ limitations under the License.
 #include <itkSingleValuedCostFunction.h>
 #include <itkCastImageFilter.h>
 #include <itkImageFileWriter.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
 
 namespace itk
 {
@@ -57,10 +58,13 @@ public:
            4 * parameters[2] * parameters[2];
     }
 
-  virtual void GetDerivative( const ParametersType &,
-                             DerivativeType & ) const
+  virtual void GetDerivative( const ParametersType & parameters,
+                             DerivativeType & derivative ) const
     {
-    // irrevelant for this test
+    derivative.SetSize( 3 );
+    derivative[0] = 4 * parameters[0];
+    derivative[1] = 6 * parameters[1];
+    derivative[2] = 8 * parameters[2];
     }
 
   virtual unsigned int GetNumberOfParameters( void ) const
@@ -102,6 +106,8 @@ int itktubeSingleValuedCostFunctionImageSourceTest( int argc, char * argv[] )
   CostFunctionImageSourceType::Pointer costFunctionImageSource =
     CostFunctionImageSourceType::New();
   costFunctionImageSource->SetCostFunction( costFunction );
+  costFunctionImageSource->SetCloneCostFunction( true );
+  costFunctionImageSource->SetComputeDerivative( true );
 
   typedef CostFunctionImageSourceType::ParametersType ParametersType;
 
@@ -145,5 +151,36 @@ int itktubeSingleValuedCostFunctionImageSourceTest( int argc, char * argv[] )
     return EXIT_FAILURE;
     }
 
+  // Check the derivative output against the cost function
+  typedef CostFunctionImageSourceType::DerivativeImageType
+    DerivativeImageType;
+  const DerivativeImageType * derivativeImage =
+    costFunctionImageSource->GetDerivativeOutput();
+  itk::ImageRegionConstIteratorWithIndex< DerivativeImageType > derivativeIt(
+    derivativeImage, derivativeImage->GetLargestPossibleRegion() );
+  CostFunctionType::DerivativeType derivative;
+  for( derivativeIt.GoToBegin(); !derivativeIt.IsAtEnd(); ++derivativeIt )
+    {
+    DerivativeImageType::PointType point;
+    derivativeImage->TransformIndexToPhysicalPoint( derivativeIt.GetIndex(),
+      point );
+    ParametersType parameters( Dimension );
+    for( unsigned int ii = 0; ii < Dimension; ++ii )
+      {
+      parameters[ii] = point[ii];
+      }
+    costFunction->GetDerivative( parameters, derivative );
+    for( unsigned int ii = 0; ii < Dimension; ++ii )
+      {
+      if( derivativeIt.Get()[ii] != derivative[ii] )
+        {
+        std::cerr << "Derivative at " << point << " is "
+                  << derivativeIt.Get() << ", expected " << derivative
+                  << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
   return EXIT_SUCCESS;
 }
@@ -26,6 +26,7 @@ limitations under the License.
 #include "itktubeFeatureVectorGenerator.h"
 #include "itktubeImageRegionMomentsCalculator.h"
 #include "itktubeJointHistogramImageFunction.h"
+#include "itktubeKdTreePointLocator.h"
 #include "itktubeNJetFeatureVectorGenerator.h"
 #include "itktubeNJetImageFunction.h"
 #include "itktubeRecordOptimizationParameterProgressionCommand.h"
@@ -34,6 +34,7 @@ void RegisterTests( void )
   REGISTER_TEST( itktubeBlurImageFunctionTest );
   REGISTER_TEST( itktubeImageRegionMomentsCalculatorTest );
   REGISTER_TEST( itktubeJointHistogramImageFunctionTest );
+  REGISTER_TEST( itktubeKdTreePointLocatorTest );
   REGISTER_TEST( itktubeNJetBasisFeatureVectorGeneratorTest );
   REGISTER_TEST( itktubeNJetFeatureVectorGeneratorTest );
   REGISTER_TEST( itktubeNJetImageFunctionTest );
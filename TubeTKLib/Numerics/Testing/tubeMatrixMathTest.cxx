@@ -114,6 +114,119 @@ int Test( void )
         returnStatus = EXIT_FAILURE;
         }
       }
+
+    vnl_matrix_fixed<double, VDimension, VDimension> h;
+    vnl_vector_fixed<double, VDimension> g;
+    vnl_matrix<double> hd( VDimension, VDimension );
+    vnl_vector<double> gd( VDimension );
+    for( unsigned int r=0; r<VDimension; r++ )
+      {
+      g[r] = rndGen->GetNormalVariate( 0.0, 1.0 );
+      gd[r] = g[r];
+      for( unsigned int c=r; c<VDimension; c++ )
+        {
+        h( r,c ) = rndGen->GetNormalVariate( 0.0, 1.0 );
+        h( c,r ) = h( r,c );
+        hd( r,c ) = h( r,c );
+        hd( c,r ) = h( r,c );
+        }
+      }
+
+    vnl_matrix_fixed<double, VDimension, VDimension> eVectsFixed;
+    vnl_vector_fixed<double, VDimension> eValsFixed;
+    tube::ComputeSymmetricEigen( h, eVectsFixed, eValsFixed, true );
+    for( unsigned int d=0; d<VDimension; d++ )
+      {
+      vnl_vector_fixed<double, VDimension> hv = h
+        * eVectsFixed.get_column( d );
+      if( ( hv - eValsFixed[d] * eVectsFixed.get_column( d ) ).magnitude()
+        > epsilon )
+        {
+        std::cout << count << " : ";
+        std::cout << "FAILURE: ComputeSymmetricEigen : "
+          << " M * v = " << hv
+          << " != " << eValsFixed[d] << " * v"
+          << std::endl;
+        returnStatus = EXIT_FAILURE;
+        }
+      }
+
+    double ridgeness = 0;
+    double roundness = 0;
+    double curvature = 0;
+    double levelness = 0;
+    tube::ComputeRidgeness( h, g, ridgeness, roundness, curvature,
+      levelness );
+
+    double ridgenessD = 0;
+    double roundnessD = 0;
+    double curvatureD = 0;
+    double levelnessD = 0;
+    vnl_vector<double> prevTangent;
+    vnl_matrix<double> hEVects( VDimension, VDimension );
+    vnl_vector<double> hEVals( VDimension );
+    tube::ComputeRidgeness( hd, gd, prevTangent, ridgenessD, roundnessD,
+      curvatureD, levelnessD, hEVects, hEVals );
+    if( std::fabs( ridgeness - ridgenessD ) > epsilon
+      || std::fabs( roundness - roundnessD ) > epsilon
+      || std::fabs( curvature - curvatureD ) > epsilon
+      || std::fabs( levelness - levelnessD ) > epsilon )
+      {
+      std::cout << count << " : ";
+      std::cout << "FAILURE: ComputeRidgeness fixed size : "
+        << ridgeness << " " << roundness << " " << curvature << " "
+        << levelness << " != " << ridgenessD << " " << roundnessD << " "
+        << curvatureD << " " << levelnessD << std::endl;
+      returnStatus = EXIT_FAILURE;
+      }
+
+    vnl_matrix_fixed<double, VDimension, VDimension> eVectsFixed2;
+    vnl_vector_fixed<double, VDimension> eValsFixed2;
+    tube::ComputeEigen( h, eVectsFixed2, eValsFixed2, true );
+    if( ( eValsFixed2 - eValsFixed ).magnitude() > epsilon )
+      {
+      std::cout << count << " : ";
+      std::cout << "FAILURE: ComputeEigen fixed size : "
+        << eValsFixed2 << " != " << eValsFixed << std::endl;
+      returnStatus = EXIT_FAILURE;
+      }
+
+    vnl_vector_fixed<double, VDimension> tangent;
+    for( unsigned int d=0; d<VDimension; d++ )
+      {
+      tangent[d] = rndGen->GetNormalVariate( 0.0, 1.0 );
+      }
+    tangent.normalize();
+    prevTangent.set_size( VDimension );
+    for( unsigned int d=0; d<VDimension; d++ )
+      {
+      prevTangent[d] = tangent[d];
+      }
+    tube::ComputeRidgeness( hd, gd, prevTangent, ridgenessD, roundnessD,
+      curvatureD, levelnessD, hEVects, hEVals );
+
+    vnl_matrix_fixed<double, VDimension, VDimension> hEVectsFixed;
+    vnl_vector_fixed<double, VDimension> hEValsFixed;
+    tube::ComputeRidgeness( h, g, &tangent, ridgeness, roundness,
+      curvature, levelness, hEVectsFixed, hEValsFixed );
+    if( std::fabs( ridgeness - ridgenessD ) > epsilon
+      || std::fabs( roundness - roundnessD ) > epsilon
+      || std::fabs( curvature - curvatureD ) > epsilon
+      || std::fabs( levelness - levelnessD ) > epsilon
+      || std::fabs( hEValsFixed[VDimension-1] - hEVals[VDimension-1] )
+        > epsilon
+      || dot_product( tangent, hEVectsFixed.get_column( VDimension-1 ) )
+        < 0
+      || dot_product( prevTangent, hEVects.get_column( VDimension-1 ) )
+        < 0 )
+      {
+      std::cout << count << " : ";
+      std::cout << "FAILURE: ComputeRidgeness fixed size with tangent : "
+        << ridgeness << " " << roundness << " " << curvature << " "
+        << levelness << " != " << ridgenessD << " " << roundnessD << " "
+        << curvatureD << " " << levelnessD << std::endl;
+      returnStatus = EXIT_FAILURE;
+      }
     }
 
   return returnStatus;
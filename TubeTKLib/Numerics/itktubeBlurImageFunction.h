@@ -27,6 +27,8 @@ limitations under the License.
 #include <itkImageFunction.h>
 #include <itkIndex.h>
 
+#include <vector>
+
 namespace itk
 {
 
@@ -126,14 +128,19 @@ protected:
 
   void RecomputeKernel( void );
 
+  /** Compute the buffer offset of each kernel row for the input image */
+  void RecomputeKernelOffsets( void );
+
 private:
 
   BlurImageFunction( const Self& );
   void operator=( const Self& );
 
-  typedef std::list< double > KernelWeightsListType;
+  typedef std::vector< double > KernelWeightsListType;
+
+  typedef std::vector< typename InputImageType::IndexType > KernelXListType;
 
-  typedef std::list< typename InputImageType::IndexType > KernelXListType;
+  typedef std::vector< OffsetValueType > KernelOffsetListType;
 
   bool                    m_UseRelativeSpacing;
   SpacingType             m_Spacing;
@@ -142,6 +149,8 @@ private:
   double                  m_Extent;
   KernelWeightsListType   m_KernelWeights;
   KernelXListType         m_KernelX;
+  KernelOffsetListType    m_KernelRowOffsets;
+  unsigned int            m_KernelRowLength;
   IndexType               m_KernelMin;
   IndexType               m_KernelMax;
   SizeType                m_KernelSize;
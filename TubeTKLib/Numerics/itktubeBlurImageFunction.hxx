@@ -28,7 +28,6 @@ limitations under the License.
 
 #include <itkContinuousIndex.h>
 #include <itkImage.h>
-#include <itkImageRegionConstIterator.h>
 
 #include <cmath>
 #include <algorithm>
@@ -60,6 +59,8 @@ BlurImageFunction<TInputImage>
   m_KernelSize.Fill( 0 );
   m_KernelX.clear();
   m_KernelWeights.clear();
+  m_KernelRowOffsets.clear();
+  m_KernelRowLength = 0;
 
   m_ImageIndexMin.Fill( 0 );
   m_ImageIndexMax.Fill( 0 );
@@ -143,6 +144,9 @@ BlurImageFunction<TInputImage>
   os << indent << "KernelWeights.size = " << m_KernelWeights.size()
     << std::endl;
   os << indent << "KernelX.size = " << m_KernelX.size() << std::endl;
+  os << indent << "KernelRowOffsets.size = " << m_KernelRowOffsets.size()
+    << std::endl;
+  os << indent << "KernelRowLength = " << m_KernelRowLength << std::endl;
   os << indent << "KernelMin = " << m_KernelMin << std::endl;
   os << indent << "KernelMax = " << m_KernelMax << std::endl;
   os << indent << "KernelSize = " << m_KernelSize << std::endl;
@@ -189,46 +193,66 @@ BlurImageFunction<TInputImage>
   m_KernelWeights.clear();
   m_KernelX.clear();
 
-  IndexType index;
+  unsigned int kernelCount = 1;
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    kernelCount *= static_cast< unsigned int >( m_KernelSize[i] );
+    }
+  m_KernelWeights.reserve( kernelCount );
+  m_KernelX.reserve( kernelCount );
+  m_KernelRowLength = static_cast< unsigned int >( m_KernelSize[0] );
+
+  // Kernel entries are stored with the first index varying fastest, so
+  //   that each run of m_KernelRowLength weights is one kernel row.
+  IndexType index = m_KernelMin;
   m_KernelTotal = 0;
-  if( ImageDimension == 3 )
+  for( unsigned int k=0; k<kernelCount; k++ )
     {
-    for( index[2] = m_KernelMin[2]; index[2]<=m_KernelMax[2]; index[2]++ )
+    double dist = 0;
+    for( unsigned int i=0; i<ImageDimension; i++ )
       {
-      double distZ = index[2] * m_Spacing[2];
-      distZ = distZ * distZ;
-      for( index[1] = m_KernelMin[1]; index[1]<=m_KernelMax[1]; index[1]++ )
-        {
-        double distY = index[1] * m_Spacing[1];
-        distY = distY * distY + distZ;
-        for( index[0] = m_KernelMin[0]; index[0]<=m_KernelMax[0]; index[0]++ )
-          {
-          double dist = index[0] * m_Spacing[0];
-          dist = dist * dist + distY;
-          double w = std::exp( gfact*( dist ) );
-          m_KernelWeights.push_back( w );
-          m_KernelX.push_back( index );
-          m_KernelTotal += w;
-          }
-        }
+      double tf = index[i] * m_Spacing[i];
+      dist += tf * tf;
+      }
+    double w = std::exp( gfact*( dist ) );
+    m_KernelWeights.push_back( w );
+    m_KernelX.push_back( index );
+    m_KernelTotal += w;
+
+    unsigned int i = 0;
+    while( i<ImageDimension && ++index[i]>m_KernelMax[i] )
+      {
+      index[i] = m_KernelMin[i];
+      ++i;
       }
     }
-  else if( ImageDimension == 2 )
+
+  this->RecomputeKernelOffsets();
+}
+
+/**
+ * Pre-compute the buffer offset of the first voxel of each kernel row */
+template< class TInputImage >
+void
+BlurImageFunction<TInputImage>
+::RecomputeKernelOffsets( void )
+{
+  m_KernelRowOffsets.clear();
+  if( !this->m_Image || m_KernelRowLength == 0 )
+    {
+    return;
+    }
+
+  const OffsetValueType * offsetTable = this->m_Image->GetOffsetTable();
+  m_KernelRowOffsets.reserve( m_KernelX.size() / m_KernelRowLength );
+  for( unsigned int k=0; k<m_KernelX.size(); k+=m_KernelRowLength )
     {
-    for( index[1] = m_KernelMin[1]; index[1]<=m_KernelMax[1]; index[1]++ )
+    OffsetValueType offset = 0;
+    for( unsigned int i=0; i<ImageDimension; i++ )
       {
-      double distY = index[1] * m_Spacing[1];
-      distY = distY * distY;
-      for( index[0] = m_KernelMin[0]; index[0]<=m_KernelMax[0]; index[0]++ )
-        {
-        double dist = index[0] * m_Spacing[0];
-        dist = dist * dist + distY;
-        double w = std::exp( gfact*( dist ) );
-        m_KernelWeights.push_back( w );
-        m_KernelX.push_back( index );
-        m_KernelTotal += w;
-        }
+      offset += m_KernelX[k][i] * offsetTable[i];
       }
+    m_KernelRowOffsets.push_back( offset );
     }
 }
 
@@ -328,28 +352,41 @@ BlurImageFunction<TInputImage>
 
   if( !boundary )
     {
-    itk::ImageRegionConstIterator< InputImageType > imIt( this->m_Image,
-      this->m_Image->GetLargestPossibleRegion() );
-    imIt.GoToBegin();
-    KernelWeightsListType::const_iterator it = m_KernelWeights.begin();
-    KernelWeightsListType::const_iterator itEnd = m_KernelWeights.end();
-    typename KernelXListType::const_iterator  itX = m_KernelX.begin();
-    int skipX = ( *itX )[0];
-    while( it != itEnd )
+    typedef typename InputImageType::PixelType PixelType;
+
+    const PixelType * center = this->m_Image->GetBufferPointer()
+      + this->m_Image->ComputeOffset( point );
+    const double * w = &( m_KernelWeights[0] );
+    const unsigned int rowLength = m_KernelRowLength;
+
+    // Each kernel row is contiguous in the image buffer and in the weight
+    //   array.  Four partial sums let the compiler vectorize the row.
+    typename KernelOffsetListType::const_iterator itOffset =
+      m_KernelRowOffsets.begin();
+    typename KernelOffsetListType::const_iterator itOffsetEnd =
+      m_KernelRowOffsets.end();
+    while( itOffset != itOffsetEnd )
       {
-      if( ( *itX )[0] == skipX )
+      const PixelType * p = center + *itOffset;
+      double s0 = 0;
+      double s1 = 0;
+      double s2 = 0;
+      double s3 = 0;
+      unsigned int k = 0;
+      for( ; k+3<rowLength; k+=4 )
         {
-        for( unsigned int i=0; i<ImageDimension; i++ )
-          {
-          kernelX[i] = point[i] + ( *itX )[i];
-          }
-        imIt.SetIndex( kernelX );
+        s0 += p[k] * w[k];
+        s1 += p[k+1] * w[k+1];
+        s2 += p[k+2] * w[k+2];
+        s3 += p[k+3] * w[k+3];
+        }
+      for( ; k<rowLength; k++ )
+        {
+        s0 += p[k] * w[k];
         }
-      res += ( imIt.Get() ) * ( *it );
-      ++imIt;
-      ++it;
-      ++itX;
-      ++kernelX[0];
+      res += ( s0 + s1 ) + ( s2 + s3 );
+      w += rowLength;
+      ++itOffset;
       }
     wTotal = m_KernelTotal;
     }
@@ -359,20 +396,14 @@ BlurImageFunction<TInputImage>
       {
       std::cout << "  Boundary point" << std::endl;
       }
-    KernelWeightsListType::const_iterator it;
-    KernelWeightsListType::const_iterator itEnd;
-    typename KernelXListType::const_iterator  itX;
-    it = m_KernelWeights.begin();
-    itEnd = m_KernelWeights.end();
-    itX = m_KernelX.begin();
     wTotal = 0;
     double w;
-    while( it != itEnd )
+    for( unsigned int k=0; k<m_KernelWeights.size(); k++ )
       {
       bool valid = true;
       for( unsigned int i=0; i<ImageDimension; i++ )
         {
-        kernelX[i] = point[i] + ( *itX )[i];
+        kernelX[i] = point[i] + m_KernelX[k][i];
         if( kernelX[i] < m_ImageIndexMin[i] ||
             kernelX[i] > m_ImageIndexMax[i] )
           {
@@ -382,16 +413,14 @@ BlurImageFunction<TInputImage>
         }
       if( valid )
         {
-        w = *it;
+        w = m_KernelWeights[k];
         res += this->m_Image->GetPixel( kernelX ) * w;
         wTotal += w;
         }
-      ++it;
-      ++itX;
       }
     }
 
-  if( wTotal < *( m_KernelWeights.begin() ) )
+  if( wTotal < m_KernelWeights[0] )
     {
     return 0;
     }
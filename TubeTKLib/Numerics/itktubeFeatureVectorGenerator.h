@@ -70,7 +70,7 @@ public:
 
   virtual void SetInput( const ImageType * img );
   virtual void SetInput( unsigned int id, const ImageType * img );
-  void AddInput( const ImageType * img );
+  virtual void AddInput( const ImageType * img );
 
   typename ImageType::ConstPointer GetInput( unsigned int imageNum );
 
@@ -0,0 +1,137 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __itktubeKdTreePointLocator_h
+#define __itktubeKdTreePointLocator_h
+
+#include <itkObject.h>
+#include <itkObjectFactory.h>
+#include <itkPoint.h>
+
+#include <vector>
+
+namespace itk
+{
+
+namespace tube
+{
+
+/** \class KdTreePointLocator
+ * \brief Finds the closest of a set of points to a query point.
+ *
+ * The points are stored in a balanced k-d tree that is built once by
+ * Initialize().  Afterwards FindClosestPoint() does not modify the
+ * locator, so it may be called concurrently by many threads.
+ */
+template< unsigned int VDimension >
+class KdTreePointLocator : public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef KdTreePointLocator                       Self;
+  typedef Object                                   Superclass;
+  typedef SmartPointer< Self >                     Pointer;
+  typedef SmartPointer< const Self >               ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information ( and related methods ). */
+  itkTypeMacro( KdTreePointLocator, Object );
+
+  itkStaticConstMacro( Dimension, unsigned int, VDimension );
+
+  typedef Point< double, VDimension >              PointType;
+  typedef std::vector< PointType >                 PointContainerType;
+  typedef SizeValueType                            IdentifierType;
+
+  /** Set the points to locate.  The points are copied, and their ids are
+   *  their positions in the container.  Call Initialize() afterwards. */
+  void SetPoints( const PointContainerType & points );
+  const PointContainerType & GetPoints( void ) const
+    { return m_Points; }
+
+  SizeValueType GetNumberOfPoints( void ) const
+    { return m_Points.size(); }
+  const PointType & GetPoint( IdentifierType id ) const
+    { return m_Points[id]; }
+
+  /** Build the tree over the points. */
+  void Initialize( void );
+
+  /** Return the id of the point closest to x, and optionally the distance
+   *  to that point. */
+  IdentifierType FindClosestPoint( const PointType & x ) const;
+  IdentifierType FindClosestPoint( const PointType & x,
+    double & distance ) const;
+
+protected:
+
+  KdTreePointLocator( void );
+  ~KdTreePointLocator( void ) {}
+
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
+private:
+
+  // Purposely not implemented
+  KdTreePointLocator( const Self & );
+  void operator=( const Self & ); // Purposely not implemented
+
+  /** Orders point ids along one coordinate. */
+  struct CoordinateLess
+    {
+    const PointContainerType * Points;
+    unsigned int               Dimension;
+
+    bool operator()( IdentifierType a, IdentifierType b ) const
+      { return ( *Points )[a][Dimension] < ( *Points )[b][Dimension]; }
+    };
+
+  /** Build the subtree over the ids in [begin, end).  Its root is the
+   *  median at the middle of the range. */
+  void BuildSubtree( SizeValueType begin, SizeValueType end );
+
+  /** Search the subtree over the ids in [begin, end). */
+  void SearchSubtree( SizeValueType begin, SizeValueType end,
+    const PointType & x, IdentifierType & closestId,
+    double & closestDistance2 ) const;
+
+  PointContainerType                m_Points;
+
+  /** Point ids in tree order, and the dimension each node splits */
+  std::vector< IdentifierType >     m_TreeIds;
+  std::vector< unsigned char >      m_TreeSplitDimensions;
+
+}; // End class KdTreePointLocator
+
+} // End namespace tube
+
+} // End namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itktubeKdTreePointLocator.hxx"
+#endif
+
+#endif // End !defined( __itktubeKdTreePointLocator_h )
@@ -0,0 +1,206 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __itktubeKdTreePointLocator_hxx
+#define __itktubeKdTreePointLocator_hxx
+
+#include "itktubeKdTreePointLocator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+namespace tube
+{
+
+template< unsigned int VDimension >
+KdTreePointLocator< VDimension >
+::KdTreePointLocator( void )
+{
+}
+
+template< unsigned int VDimension >
+void
+KdTreePointLocator< VDimension >
+::SetPoints( const PointContainerType & points )
+{
+  m_Points = points;
+  m_TreeIds.clear();
+  m_TreeSplitDimensions.clear();
+  this->Modified();
+}
+
+template< unsigned int VDimension >
+void
+KdTreePointLocator< VDimension >
+::Initialize( void )
+{
+  m_TreeIds.resize( m_Points.size() );
+  for( SizeValueType i = 0; i < m_Points.size(); ++i )
+    {
+    m_TreeIds[i] = i;
+    }
+  m_TreeSplitDimensions.assign( m_Points.size(), 0 );
+
+  this->BuildSubtree( 0, m_Points.size() );
+}
+
+template< unsigned int VDimension >
+void
+KdTreePointLocator< VDimension >
+::BuildSubtree( SizeValueType begin, SizeValueType end )
+{
+  if( end - begin < 2 )
+    {
+    return;
+    }
+
+  // Split along the dimension in which the points spread the most
+  PointType minPoint = m_Points[ m_TreeIds[begin] ];
+  PointType maxPoint = minPoint;
+  for( SizeValueType i = begin + 1; i < end; ++i )
+    {
+    const PointType & p = m_Points[ m_TreeIds[i] ];
+    for( unsigned int d = 0; d < VDimension; ++d )
+      {
+      minPoint[d] = std::min( minPoint[d], p[d] );
+      maxPoint[d] = std::max( maxPoint[d], p[d] );
+      }
+    }
+  unsigned int splitDimension = 0;
+  for( unsigned int d = 1; d < VDimension; ++d )
+    {
+    if( maxPoint[d] - minPoint[d]
+      > maxPoint[splitDimension] - minPoint[splitDimension] )
+      {
+      splitDimension = d;
+      }
+    }
+
+  const SizeValueType middle = begin + ( end - begin ) / 2;
+  CoordinateLess less;
+  less.Points = &m_Points;
+  less.Dimension = splitDimension;
+  std::nth_element( m_TreeIds.begin() + begin, m_TreeIds.begin() + middle,
+    m_TreeIds.begin() + end, less );
+  m_TreeSplitDimensions[middle] =
+    static_cast< unsigned char >( splitDimension );
+
+  this->BuildSubtree( begin, middle );
+  this->BuildSubtree( middle + 1, end );
+}
+
+template< unsigned int VDimension >
+typename KdTreePointLocator< VDimension >::IdentifierType
+KdTreePointLocator< VDimension >
+::FindClosestPoint( const PointType & x ) const
+{
+  double distance;
+  return this->FindClosestPoint( x, distance );
+}
+
+template< unsigned int VDimension >
+typename KdTreePointLocator< VDimension >::IdentifierType
+KdTreePointLocator< VDimension >
+::FindClosestPoint( const PointType & x, double & distance ) const
+{
+  if( m_TreeIds.empty() || m_TreeIds.size() != m_Points.size() )
+    {
+    itkExceptionMacro( << "The locator has no points, or was not "
+      << "initialized after setting them." );
+    }
+
+  IdentifierType closestId = m_TreeIds[ m_TreeIds.size() / 2 ];
+  double closestDistance2 = x.SquaredEuclideanDistanceTo(
+    m_Points[closestId] );
+  this->SearchSubtree( 0, m_TreeIds.size(), x, closestId,
+    closestDistance2 );
+
+  distance = std::sqrt( closestDistance2 );
+  return closestId;
+}
+
+template< unsigned int VDimension >
+void
+KdTreePointLocator< VDimension >
+::SearchSubtree( SizeValueType begin, SizeValueType end,
+  const PointType & x, IdentifierType & closestId,
+  double & closestDistance2 ) const
+{
+  if( begin >= end )
+    {
+    return;
+    }
+
+  const SizeValueType middle = begin + ( end - begin ) / 2;
+  const IdentifierType id = m_TreeIds[middle];
+  const double distance2 = x.SquaredEuclideanDistanceTo( m_Points[id] );
+  if( distance2 < closestDistance2 )
+    {
+    closestId = id;
+    closestDistance2 = distance2;
+    }
+
+  // Search the side of the split containing x first; the other side can
+  // only hold a closer point if the split plane is closer than the best
+  const unsigned int splitDimension = m_TreeSplitDimensions[middle];
+  const double offset = x[splitDimension] - m_Points[id][splitDimension];
+  if( offset < 0 )
+    {
+    this->SearchSubtree( begin, middle, x, closestId, closestDistance2 );
+    if( offset * offset < closestDistance2 )
+      {
+      this->SearchSubtree( middle + 1, end, x, closestId,
+        closestDistance2 );
+      }
+    }
+  else
+    {
+    this->SearchSubtree( middle + 1, end, x, closestId, closestDistance2 );
+    if( offset * offset < closestDistance2 )
+      {
+      this->SearchSubtree( begin, middle, x, closestId, closestDistance2 );
+      }
+    }
+}
+
+template< unsigned int VDimension >
+void
+KdTreePointLocator< VDimension >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Number of points: " << m_Points.size() << std::endl;
+  os << indent << "Initialized: "
+    << ( !m_TreeIds.empty() && m_TreeIds.size() == m_Points.size() )
+    << std::endl;
+}
+
+} // End namespace tube
+
+} // End namespace itk
+
+#endif // End !defined( __itktubeKdTreePointLocator_hxx )
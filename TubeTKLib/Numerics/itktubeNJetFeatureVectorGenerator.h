@@ -25,6 +25,7 @@ limitations under the License.
 #define __itktubeNJetFeatureVectorGenerator_h
 
 #include "itktubeFeatureVectorGenerator.h"
+#include "itktubeNJetImageFunction.h"
 
 #include <itkImage.h>
 
@@ -68,6 +69,12 @@ public:
 
   typedef std::vector< double >                   NJetScalesType;
 
+  typedef NJetImageFunction< ImageType >          NJetFunctionType;
+
+  virtual void SetInput( const ImageType * img );
+  virtual void SetInput( unsigned int id, const ImageType * img );
+  virtual void AddInput( const ImageType * img );
+
   virtual unsigned int GetNumberOfFeatures( void ) const;
 
   void SetZeroScales( const NJetScalesType & scales );
@@ -86,11 +93,22 @@ public:
   virtual FeatureValueType  GetFeatureVectorValue( const IndexType & indx,
     unsigned int fNum ) const;
 
+  virtual void Update( void );
+
 protected:
 
   NJetFeatureVectorGenerator( void );
   virtual ~NJetFeatureVectorGenerator( void );
 
+  /** Create one NJet function per input image.  The functions are only
+   *  used through their stateless ComputeJet methods, so GetFeatureVector
+   *  can be called from several threads at once. */
+  void UpdateNJetFunctions( void );
+
+  /** Collect the distinct scales used by the zero, first, second, and
+   *  ridge features so each jet is computed once per voxel and scale. */
+  void UpdateJetScales( void );
+
   void PrintSelf( std::ostream & os, Indent indent ) const;
 
 private:
@@ -104,6 +122,18 @@ private:
   NJetScalesType m_SecondScales;
   NJetScalesType m_RidgeScales;
 
+  typedef std::vector< typename NJetFunctionType::Pointer >
+    NJetFunctionListType;
+  typedef std::vector< unsigned int > JetScaleIndexListType;
+
+  NJetFunctionListType  m_NJetFunctionList;
+
+  NJetScalesType        m_JetScales;
+  JetScaleIndexListType m_ZeroJetIndex;
+  JetScaleIndexListType m_FirstJetIndex;
+  JetScaleIndexListType m_SecondJetIndex;
+  JetScaleIndexListType m_RidgeJetIndex;
+
 }; // End class NJetFeatureVectorGenerator
 
 }  // End namespace tube
@@ -47,6 +47,9 @@ NJetFeatureVectorGenerator< TImage >
   m_FirstScales.clear();
   m_SecondScales.clear();
   m_RidgeScales.clear();
+
+  m_NJetFunctionList.clear();
+  m_JetScales.clear();
 }
 
 template< class TImage >
@@ -57,6 +60,100 @@ NJetFeatureVectorGenerator< TImage >
   m_FirstScales.clear();
   m_SecondScales.clear();
   m_RidgeScales.clear();
+
+  m_NJetFunctionList.clear();
+  m_JetScales.clear();
+}
+
+template< class TImage >
+void
+NJetFeatureVectorGenerator< TImage >
+::SetInput( const ImageType * img )
+{
+  Superclass::SetInput( img );
+  this->UpdateNJetFunctions();
+}
+
+template< class TImage >
+void
+NJetFeatureVectorGenerator< TImage >
+::SetInput( unsigned int id, const ImageType * img )
+{
+  Superclass::SetInput( id, img );
+  this->UpdateNJetFunctions();
+}
+
+template< class TImage >
+void
+NJetFeatureVectorGenerator< TImage >
+::AddInput( const ImageType * img )
+{
+  Superclass::AddInput( img );
+  this->UpdateNJetFunctions();
+}
+
+template< class TImage >
+void
+NJetFeatureVectorGenerator< TImage >
+::Update( void )
+{
+  // Input images may have been (re)allocated since they were set
+  this->UpdateNJetFunctions();
+
+  Superclass::Update();
+}
+
+template< class TImage >
+void
+NJetFeatureVectorGenerator< TImage >
+::UpdateNJetFunctions( void )
+{
+  const unsigned int numInputImages = this->GetNumberOfInputImages();
+
+  m_NJetFunctionList.resize( numInputImages );
+  for( unsigned int i = 0; i < numInputImages; ++i )
+    {
+    if( m_NJetFunctionList[i].IsNull() )
+      {
+      m_NJetFunctionList[i] = NJetFunctionType::New();
+      }
+    if( this->m_InputImageList[i].IsNotNull() )
+      {
+      m_NJetFunctionList[i]->SetInputImage( this->m_InputImageList[i] );
+      }
+    }
+}
+
+template< class TImage >
+void
+NJetFeatureVectorGenerator< TImage >
+::UpdateJetScales( void )
+{
+  m_JetScales.clear();
+
+  const NJetScalesType * scales[4] = { &m_ZeroScales, &m_FirstScales,
+    &m_SecondScales, &m_RidgeScales };
+  JetScaleIndexListType * jetIndex[4] = { &m_ZeroJetIndex,
+    &m_FirstJetIndex, &m_SecondJetIndex, &m_RidgeJetIndex };
+
+  for( unsigned int g = 0; g < 4; ++g )
+    {
+    jetIndex[g]->resize( scales[g]->size() );
+    for( unsigned int s = 0; s < scales[g]->size(); ++s )
+      {
+      const double scale = ( *scales[g] )[s];
+      unsigned int j = 0;
+      while( j < m_JetScales.size() && m_JetScales[j] != scale )
+        {
+        ++j;
+        }
+      if( j == m_JetScales.size() )
+        {
+        m_JetScales.push_back( scale );
+        }
+      ( *jetIndex[g] )[s] = j;
+      }
+    }
 }
 
 template< class TImage >
@@ -84,10 +181,16 @@ NJetFeatureVectorGenerator< TImage >
 
   const unsigned int numInputImages = this->GetNumberOfInputImages();
 
-  typedef NJetImageFunction< ImageType > NJetFunctionType;
-  typename NJetFunctionType::Pointer njet = NJetFunctionType::New();
-  typename NJetFunctionType::VectorType v;
-  typename NJetFunctionType::MatrixType m;
+  if( m_NJetFunctionList.size() != numInputImages )
+    {
+    itkExceptionMacro( << "NJet functions do not match the inputs." );
+    }
+
+  // One jet per distinct scale, shared by all feature groups
+  const unsigned int numJetScales = m_JetScales.size();
+  std::vector< double > jetV( numJetScales );
+  std::vector< typename NJetFunctionType::VectorType > jetD( numJetScales );
+  std::vector< typename NJetFunctionType::MatrixType > jetH( numJetScales );
 
   double val = 0.0;
   FeatureVectorType featureVector;
@@ -96,18 +199,24 @@ NJetFeatureVectorGenerator< TImage >
   for( unsigned int inputImageNum = 0; inputImageNum < numInputImages;
     inputImageNum++ )
     {
-    njet->SetInputImage( this->m_InputImageList[inputImageNum] );
+    const NJetFunctionType * njet = m_NJetFunctionList[inputImageNum];
+
+    for( unsigned int j = 0; j < numJetScales; j++ )
+      {
+      jetV[j] = njet->ComputeJetAtIndex( indx, jetD[j], jetH[j],
+        m_JetScales[j] );
+      }
 
     for( unsigned int s = 0; s < m_ZeroScales.size(); s++ )
       {
-      featureVector[featureCount++] = njet->EvaluateAtIndex( indx,
-        this->m_ZeroScales[s] );
+      featureVector[featureCount++] = jetV[ m_ZeroJetIndex[s] ];
       }
 
     for( unsigned int s = 0; s < m_FirstScales.size(); s++ )
       {
+      const typename NJetFunctionType::VectorType & v =
+        jetD[ m_FirstJetIndex[s] ];
       val = 0.0;
-      njet->DerivativeAtIndex( indx, m_FirstScales[s], v );
       for( unsigned int d = 0; d < ImageDimension; d++ )
         {
         featureVector[featureCount++] = v[d];
@@ -118,8 +227,9 @@ NJetFeatureVectorGenerator< TImage >
 
     for( unsigned int s = 0; s < m_SecondScales.size(); s++ )
       {
+      const typename NJetFunctionType::MatrixType & m =
+        jetH[ m_SecondJetIndex[s] ];
       val = 0.0;
-      njet->HessianAtIndex( indx, m_SecondScales[s], m );
       for( unsigned int d = 0; d < ImageDimension; d++ )
         {
         featureVector[featureCount++] = m[d][d];
@@ -130,11 +240,15 @@ NJetFeatureVectorGenerator< TImage >
 
     for( unsigned int s = 0; s < m_RidgeScales.size(); s++ )
       {
-      featureVector[featureCount++] = njet->RidgenessAtIndex( indx,
-        m_RidgeScales[s] );
-      featureVector[featureCount++] = njet->GetMostRecentRidgeRoundness();
-      featureVector[featureCount++] = njet->GetMostRecentRidgeCurvature();
-      featureVector[featureCount++] = njet->GetMostRecentRidgeLevelness();
+      const unsigned int j = m_RidgeJetIndex[s];
+      double roundness = 0;
+      double curvature = 0;
+      double levelness = 0;
+      featureVector[featureCount++] = njet->RidgenessFromJet( jetD[j],
+        jetH[j], roundness, curvature, levelness );
+      featureVector[featureCount++] = roundness;
+      featureVector[featureCount++] = curvature;
+      featureVector[featureCount++] = levelness;
       }
     }
 
@@ -163,10 +277,20 @@ NJetFeatureVectorGenerator< TImage >
 {
   const unsigned int numInputImages = this->GetNumberOfInputImages();
 
-  typedef NJetImageFunction< ImageType > NJetFunctionType;
-  typename NJetFunctionType::Pointer njet = NJetFunctionType::New();
-  typename NJetFunctionType::VectorType v;
-  typename NJetFunctionType::MatrixType m;
+  const unsigned int numFirst = m_FirstScales.size() * ( ImageDimension + 1 );
+  const unsigned int numSecond = m_SecondScales.size()
+    * ( ImageDimension + 1 );
+  const unsigned int featuresPerImage = m_ZeroScales.size() + numFirst
+    + numSecond + m_RidgeScales.size() * 4;
+
+  if( featuresPerImage == 0 || fNum >= numInputImages * featuresPerImage )
+    {
+    itkExceptionMacro( << "Requested non-existent FeatureVectorValue." );
+    }
+  if( m_NJetFunctionList.size() != numInputImages )
+    {
+    itkExceptionMacro( << "NJet functions do not match the inputs." );
+    }
 
   double fNumMean = this->GetWhitenMean( fNum );
   double fNumStdDev = this->GetWhitenStdDev( fNum );
@@ -175,114 +299,61 @@ NJetFeatureVectorGenerator< TImage >
     fNumMean = 0;
     fNumStdDev = 1;
     }
+
+  const NJetFunctionType * njet =
+    m_NJetFunctionList[ fNum / featuresPerImage ];
+  unsigned int f = fNum % featuresPerImage;
+
+  typename NJetFunctionType::VectorType v;
+  typename NJetFunctionType::MatrixType m;
   double val = 0.0;
-  unsigned int featureCount = 0;
-  for( unsigned int inputImageNum = 0; inputImageNum < numInputImages;
-    inputImageNum++ )
+  if( f < m_ZeroScales.size() )
     {
-    njet->SetInputImage( this->m_InputImageList[inputImageNum] );
-
-    if( fNum < m_ZeroScales.size() )
+    val = njet->ComputeJetAtIndex( indx, v, m, m_ZeroScales[f] );
+    }
+  else if( ( f -= m_ZeroScales.size() ) < numFirst )
+    {
+    const unsigned int s = f / ( ImageDimension + 1 );
+    const unsigned int d = f % ( ImageDimension + 1 );
+    njet->ComputeJetAtIndex( indx, v, m, m_FirstScales[s] );
+    if( d < ImageDimension )
       {
-      for( unsigned int s = 0; s < m_ZeroScales.size(); s++ )
-        {
-        if( featureCount == fNum )
-          {
-          return ( njet->EvaluateAtIndex( indx, m_ZeroScales[s] )
-            - fNumMean ) / fNumStdDev;
-          }
-        featureCount++;
-        }
+      val = v[d];
       }
-    else if( fNum < ( m_ZeroScales.size()
-      + m_FirstScales.size() * ( ImageDimension + 1 ) ) )
+    else
       {
-      featureCount = m_ZeroScales.size();
-      for( unsigned int s = 0; s < m_FirstScales.size(); s++ )
-        {
-        val = 0.0;
-        njet->DerivativeAtIndex( indx, m_FirstScales[s], v );
-        for( unsigned int d = 0; d < ImageDimension; d++ )
-          {
-          if( featureCount == fNum )
-            {
-            return ( v[d] - fNumMean ) / fNumStdDev;
-            }
-          featureCount++;
-          val += v[d]*v[d];
-          }
-        if( featureCount == fNum )
-          {
-          return ( std::sqrt( val ) - fNumMean ) / fNumStdDev;
-          }
-        featureCount++;
-        }
+      val = v.GetNorm();
       }
-    else if( fNum < m_ZeroScales.size()
-      + m_FirstScales.size() * ( ImageDimension + 1 )
-      + m_SecondScales.size() * ( ImageDimension + 1 ) )
+    }
+  else if( ( f -= numFirst ) < numSecond )
+    {
+    const unsigned int s = f / ( ImageDimension + 1 );
+    const unsigned int d = f % ( ImageDimension + 1 );
+    njet->ComputeJetAtIndex( indx, v, m, m_SecondScales[s] );
+    if( d < ImageDimension )
       {
-      featureCount = m_ZeroScales.size()
-        + m_FirstScales.size() * ( ImageDimension + 1 );
-      for( unsigned int s = 0; s < m_SecondScales.size(); s++ )
-        {
-        val = 0.0;
-        njet->HessianAtIndex( indx, m_SecondScales[s], m );
-        for( unsigned int d = 0; d < ImageDimension; d++ )
-          {
-          if( featureCount == fNum )
-            {
-            return ( m[d][d] - fNumMean ) / fNumStdDev;
-            }
-          featureCount++;
-          val += m[d][d]*m[d][d];
-          }
-        if( featureCount == fNum )
-          {
-          return ( std::sqrt( val ) - fNumMean ) / fNumStdDev;
-          }
-        featureCount++;
-        }
+      val = m[d][d];
       }
     else
       {
-      featureCount = m_ZeroScales.size()
-        + m_FirstScales.size() * ( ImageDimension + 1 )
-        + m_SecondScales.size() * ( ImageDimension + 1 );
-      for( unsigned int s = 0; s < m_RidgeScales.size(); s++ )
+      for( unsigned int i = 0; i < ImageDimension; i++ )
         {
-        if( featureCount == fNum )
-          {
-          njet->RidgenessAtIndex( indx, m_RidgeScales[s] );
-          return ( njet->GetMostRecentRidgeness()
-            - fNumMean ) / fNumStdDev;
-          }
-        featureCount++;
-        if( featureCount == fNum )
-          {
-          njet->RidgenessAtIndex( indx, m_RidgeScales[s] );
-          return ( njet->GetMostRecentRidgeRoundness()
-            - fNumMean ) / fNumStdDev;
-          }
-        featureCount++;
-        if( featureCount == fNum )
-          {
-          njet->RidgenessAtIndex( indx, m_RidgeScales[s] );
-          return ( njet->GetMostRecentRidgeCurvature()
-            - fNumMean ) / fNumStdDev;
-          }
-        featureCount++;
-        if( featureCount == fNum )
-          {
-          njet->RidgenessAtIndex( indx, m_RidgeScales[s] );
-          return ( njet->GetMostRecentRidgeLevelness()
-            - fNumMean ) / fNumStdDev;
-          }
-        featureCount++;
+        val += m[i][i]*m[i][i];
         }
+      val = std::sqrt( val );
       }
     }
-  itkExceptionMacro( << "Requested non-existent FeatureVectorValue." );
+  else
+    {
+    f -= numSecond;
+    njet->ComputeJetAtIndex( indx, v, m, m_RidgeScales[f / 4] );
+    double measures[4];
+    measures[0] = njet->RidgenessFromJet( v, m, measures[1], measures[2],
+      measures[3] );
+    val = measures[f % 4];
+    }
+
+  return ( val - fNumMean ) / fNumStdDev;
 }
 
 template< class TImage >
@@ -291,6 +362,7 @@ NJetFeatureVectorGenerator< TImage >
 ::SetZeroScales( const NJetScalesType & scales )
 {
   m_ZeroScales = scales;
+  this->UpdateJetScales();
 }
 
 template< class TImage >
@@ -299,6 +371,7 @@ NJetFeatureVectorGenerator< TImage >
 ::SetFirstScales( const NJetScalesType & scales )
 {
   m_FirstScales = scales;
+  this->UpdateJetScales();
 }
 
 template< class TImage >
@@ -307,6 +380,7 @@ NJetFeatureVectorGenerator< TImage >
 ::SetSecondScales( const NJetScalesType & scales )
 {
   m_SecondScales = scales;
+  this->UpdateJetScales();
 }
 
 template< class TImage >
@@ -315,6 +389,7 @@ NJetFeatureVectorGenerator< TImage >
 ::SetRidgeScales( const NJetScalesType & scales )
 {
   m_RidgeScales = scales;
+  this->UpdateJetScales();
 }
 
 template< class TImage >
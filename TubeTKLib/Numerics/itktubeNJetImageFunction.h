@@ -231,6 +231,23 @@ public:
                        VectorType & d, MatrixType & h,
                        double scale=1 ) const;
 
+  /** Compute the value, derivative, and Hessian in one pass over the
+   *  kernel without updating the MostRecent values.  Once the input
+   *  image is set, these may be called concurrently from many threads. */
+  double  ComputeJetAtIndex( const IndexType & index, VectorType & d,
+                       MatrixType & h, double scale=1 ) const;
+
+  double  ComputeJetAtContinuousIndex( const ContinuousIndexType & cIndex,
+                       VectorType & d, MatrixType & h,
+                       double scale=1 ) const;
+
+  /** Compute the ridgeness, roundness, curvature, and levelness from a
+   *  derivative and Hessian returned by ComputeJet*( ).  Does not update
+   *  the MostRecent values. */
+  double  RidgenessFromJet( const VectorType & d, const MatrixType & h,
+                       double & roundness, double & curvature,
+                       double & levelness ) const;
+
   double  Ridgeness( const PointType & point, double scale=1 ) const;
   double  Ridgeness( const PointType & point,
                        const VectorType & v1, double scale=1 ) const;
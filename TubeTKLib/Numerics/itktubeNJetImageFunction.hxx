@@ -30,8 +30,6 @@ limitations under the License.
 #include <itkImageRegionConstIterator.h>
 #include <itkImageRegionIteratorWithIndex.h>
 
-#include <vnl/algo/vnl_symmetric_eigensystem.h>
-
 namespace itk
 {
 
@@ -1304,13 +1302,19 @@ HessianAtContinuousIndex( const ContinuousIndexType & cIndex,
   if( m_UseProjection )
     {
     HessianAtContinuousIndex( cIndex, scale, m );
-    vnl_symmetric_eigensystem< double > eigSys( m.GetVnlMatrix() );
+    vnl_matrix_fixed< double, ImageDimension, ImageDimension > eVect;
+    vnl_vector_fixed< double, ImageDimension > eVal;
+    ::tube::ComputeEigen( m.GetVnlMatrix(), eVect, eVal );
 
     double dp = 0;
     for( unsigned int i = 0; i < ImageDimension; i++ )
       {
-      dp += dot_product( v1.GetVnlVector(), eigSys.get_eigenvector( i ) )
-              * eigSys.get_eigenvalue( i );
+      double vp = 0;
+      for( unsigned int j = 0; j < ImageDimension; j++ )
+        {
+        vp += v1[j] * eVect( j, i );
+        }
+      dp += vp * eVal[i];
       }
 
     m.Fill( 0 );
@@ -1353,16 +1357,23 @@ HessianAtContinuousIndex( const ContinuousIndexType & cIndex,
   if( m_UseProjection )
     {
     HessianAtContinuousIndex( cIndex, scale, m );
-    vnl_symmetric_eigensystem< double > eigSys( m.GetVnlMatrix() );
+    vnl_matrix_fixed< double, ImageDimension, ImageDimension > eVect;
+    vnl_vector_fixed< double, ImageDimension > eVal;
+    ::tube::ComputeEigen( m.GetVnlMatrix(), eVect, eVal );
 
     double dp0 = 0;
     double dp1 = 0;
     for( unsigned int i = 0; i < ImageDimension; i++ )
       {
-      dp0 += dot_product( v1.GetVnlVector(), eigSys.get_eigenvector( i ) )
-              * eigSys.get_eigenvalue( i );
-      dp1 += dot_product( v2.GetVnlVector(), eigSys.get_eigenvector( i ) )
-              * eigSys.get_eigenvalue( i );
+      double vp0 = 0;
+      double vp1 = 0;
+      for( unsigned int j = 0; j < ImageDimension; j++ )
+        {
+        vp0 += v1[j] * eVect( j, i );
+        vp1 += v2[j] * eVect( j, i );
+        }
+      dp0 += vp0 * eVal[i];
+      dp1 += vp1 * eVal[i];
       }
 
     m[0][0] = dp0;
@@ -1462,6 +1473,36 @@ double
 NJetImageFunction<TInputImage>::
 JetAtContinuousIndex( const ContinuousIndexType & cIndex, VectorType & d,
   MatrixType & h, double scale ) const
+{
+  double v = ComputeJetAtContinuousIndex( cIndex, d, h, scale );
+
+  m_MostRecentIntensity = v;
+  m_MostRecentDerivative = d;
+  m_MostRecentHessian = h;
+
+  return v;
+}
+
+template< class TInputImage >
+double
+NJetImageFunction<TInputImage>::
+ComputeJetAtIndex( const IndexType & index, VectorType & d, MatrixType & h,
+  double scale ) const
+{
+  ContinuousIndexType cIndex;
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    cIndex[i] = index[i];
+    }
+
+  return ComputeJetAtContinuousIndex( cIndex, d, h, scale );
+}
+
+template< class TInputImage >
+double
+NJetImageFunction<TInputImage>::
+ComputeJetAtContinuousIndex( const ContinuousIndexType & cIndex,
+  VectorType & d, MatrixType & h, double scale ) const
 {
   // JET
   double physGaussFactor = -1.0 / ( 2 * scale * scale );
@@ -1633,7 +1674,6 @@ JetAtContinuousIndex( const ContinuousIndexType & cIndex, VectorType & d,
     {
     v = 0;
     }
-  m_MostRecentIntensity = v;
 
   for( unsigned int i = 0; i < ImageDimension; i++ )
     {
@@ -1645,7 +1685,6 @@ JetAtContinuousIndex( const ContinuousIndexType & cIndex, VectorType & d,
       {
       d[i] = 0;
       }
-    m_MostRecentDerivative[i] = d[i];
 
     if( hTotal[i][i] != 0 )
       {
@@ -1655,7 +1694,6 @@ JetAtContinuousIndex( const ContinuousIndexType & cIndex, VectorType & d,
       {
       h[i][i] = 0;
       }
-    m_MostRecentHessian[i][i] = h[i][i];
     for( unsigned int j=i+1; j<ImageDimension; j++ )
       {
       if( hTotal[i][j] != 0 )
@@ -1668,8 +1706,6 @@ JetAtContinuousIndex( const ContinuousIndexType & cIndex, VectorType & d,
         h[i][j] = 0;
         h[j][i] = 0;
         }
-      m_MostRecentHessian[i][j] = h[i][j];
-      m_MostRecentHessian[j][i] = h[j][i];
       }
     }
 
@@ -1821,23 +1857,43 @@ RidgenessAtContinuousIndex( const ContinuousIndexType & cIndex,
   double roundness = 0;
   double curvature = 0;
   double levelness = 0;
-  vnl_matrix<double> eVect( ImageDimension, ImageDimension );
-  vnl_vector<double> eVal( ImageDimension );
-  vnl_vector<double> prevTangent;
-  ::tube::ComputeRidgeness<double>( h.GetVnlMatrix(), d.GetVnlVector(),
-    prevTangent, ridgeness, roundness, curvature, levelness, eVect, eVal );
+  vnl_matrix_fixed<double, ImageDimension, ImageDimension> eVect;
+  vnl_vector_fixed<double, ImageDimension> eVal;
+  vnl_vector_fixed<double, ImageDimension> dv( d.GetDataPointer() );
+  ::tube::ComputeRidgeness( h.GetVnlMatrix(), dv,
+    static_cast< const vnl_vector_fixed<double, ImageDimension> * >( NULL ),
+    ridgeness, roundness, curvature, levelness, eVect, eVal );
 
   m_MostRecentIntensity = intensity;
   m_MostRecentRidgeness = ridgeness;
   m_MostRecentRidgeRoundness = roundness;
   m_MostRecentRidgeCurvature = curvature;
   m_MostRecentRidgeLevelness = levelness;
-  m_MostRecentRidgeTangent.SetVnlVector( eVect.get_column(
-    ImageDimension-1 ) );
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    m_MostRecentRidgeTangent[i] = eVect( i, ImageDimension-1 );
+    }
 
   return m_MostRecentRidgeness;
 }
 
+template< class TInputImage >
+double
+NJetImageFunction<TInputImage>::
+RidgenessFromJet( const VectorType & d, const MatrixType & h,
+  double & roundness, double & curvature, double & levelness ) const
+{
+  double ridgeness = 0;
+  roundness = 0;
+  curvature = 0;
+  levelness = 0;
+  vnl_vector_fixed<double, ImageDimension> dv( d.GetDataPointer() );
+  ::tube::ComputeRidgeness( h.GetVnlMatrix(), dv, ridgeness, roundness,
+    curvature, levelness );
+
+  return ridgeness;
+}
+
 template< class TInputImage >
 double
 NJetImageFunction<TInputImage>::
@@ -1854,9 +1910,11 @@ RidgenessAtContinuousIndex( const ContinuousIndexType & cIndex,
 
   val = JetAtContinuousIndex( cIndex, d, h, scale );
 
-  vnl_symmetric_eigensystem< double > eigSys( h.GetVnlMatrix() );
+  vnl_matrix_fixed< double, ImageDimension, ImageDimension > eVect;
+  vnl_vector_fixed< double, ImageDimension > eVal;
+  ::tube::ComputeEigen( h.GetVnlMatrix(), eVect, eVal );
 
-  assert( eigSys.get_eigenvalue( 0 ) <= eigSys.get_eigenvalue( 1 ) );
+  assert( eVal[0] <= eVal[1] );
 
   if( d.GetNorm() != 0 )
     {
@@ -1864,7 +1922,10 @@ RidgenessAtContinuousIndex( const ContinuousIndexType & cIndex,
     }
   else
     {
-    d.SetVnlVector( eigSys.get_eigenvector( ImageDimension-1 ) );
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      d[i] = eVect( i, ImageDimension-1 );
+      }
     }
 
   for( unsigned int i = 0; i < ImageDimension; i++ )
@@ -1873,14 +1934,14 @@ RidgenessAtContinuousIndex( const ContinuousIndexType & cIndex,
     double dp = 0;
     for( unsigned int j=0; j<ImageDimension; j++ )
       {
-      dp += eigSys.get_eigenvector( i )[j] * v1[j];
+      dp += eVect( j, i ) * v1[j];
       }
     dp = std::fabs( dp );
     for( unsigned int j=0; j<ImageDimension; j++ )
       {
-      p[i] += dp * eigSys.get_eigenvector( i )[j] * d[j];
+      p[i] += dp * eVect( j, i ) * d[j];
       }
-    vv[i] = dp * eigSys.get_eigenvalue( i );
+    vv[i] = dp * eVal[i];
     }
 
   double sums = 0;
@@ -1924,9 +1985,11 @@ RidgenessAtContinuousIndex( const ContinuousIndexType & cIndex,
 
   val = JetAtContinuousIndex( cIndex, d, h, scale );
 
-  vnl_symmetric_eigensystem< double > eigSys( h.GetVnlMatrix() );
+  vnl_matrix_fixed< double, ImageDimension, ImageDimension > eVect;
+  vnl_vector_fixed< double, ImageDimension > eVal;
+  ::tube::ComputeEigen( h.GetVnlMatrix(), eVect, eVal );
 
-  assert( eigSys.get_eigenvalue( 0 ) <= eigSys.get_eigenvalue( 1 ) );
+  assert( eVal[0] <= eVal[1] );
 
   if( d.GetNorm() != 0 )
     {
@@ -1934,7 +1997,10 @@ RidgenessAtContinuousIndex( const ContinuousIndexType & cIndex,
     }
   else
     {
-    d.SetVnlVector( eigSys.get_eigenvector( ImageDimension-1 ) );
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      d[i] = eVect( i, ImageDimension-1 );
+      }
     }
 
   for( unsigned int i = 0; i < ImageDimension; i++ )
@@ -1943,25 +2009,25 @@ RidgenessAtContinuousIndex( const ContinuousIndexType & cIndex,
     double dp = 0;
     for( unsigned int j=0; j<ImageDimension; j++ )
       {
-      dp += eigSys.get_eigenvector( i )[j] * v1[j];
+      dp += eVect( j, i ) * v1[j];
       }
     dp = std::fabs( dp );
     for( unsigned int j=0; j<ImageDimension; j++ )
       {
-      p[i] += dp * eigSys.get_eigenvector( i )[j] * d[j];
+      p[i] += dp * eVect( j, i ) * d[j];
       }
-    vv[i] = dp * eigSys.get_eigenvalue( i );
+    vv[i] = dp * eVal[i];
     dp = 0;
     for( unsigned int j=0; j<ImageDimension; j++ )
       {
-      dp += eigSys.get_eigenvector( i )[j] * v2[j];
+      dp += eVect( j, i ) * v2[j];
       }
     dp = std::fabs( dp );
     for( unsigned int j=0; j<ImageDimension; j++ )
       {
-      p[i] += dp * eigSys.get_eigenvector( i )[j] * d[j];
+      p[i] += dp * eVect( j, i ) * d[j];
       }
-    vv[i] += dp * eigSys.get_eigenvalue( i );
+    vv[i] += dp * eVal[i];
     }
 
   double sums = 0;
@@ -96,6 +96,20 @@ public:
   itkSetMacro( UseIntensityOnly, bool );
   itkGetMacro( UseIntensityOnly, bool );
 
+  /** Only produce the features at the optimal scale ( and the optimal
+   *  scale itself ).  The per-scale features are then folded into a
+   *  running maximum as soon as they are computed and released, so memory
+   *  no longer grows with the number of scales. */
+  itkSetMacro( UseOptimalScaleFeaturesOnly, bool );
+  itkGetMacro( UseOptimalScaleFeaturesOnly, bool );
+
+  /** Number of slices along the last image axis processed at a time.
+   *  Each slab is extended by six times the largest scale on both sides.
+   *  Features are then equal to the whole-image features up to the
+   *  boundary effects of the FFT.  0 processes the whole image at once. */
+  itkSetMacro( SlabSize, unsigned int );
+  itkGetMacro( SlabSize, unsigned int );
+
 protected:
 
   RidgeFFTFeatureVectorGenerator( void );
@@ -103,6 +117,16 @@ protected:
 
   virtual void UpdateWhitenStatistics( void );
 
+  /** Computes the features slab by slab, folding each scale into the
+   *  optimal scale features as soon as it is computed */
+  void UpdateUsingSlabs( void );
+
+  /** Stores the features of one scale within region, and updates the
+   *  features at the optimal scale */
+  void AccumulateScaleFeatures( unsigned int scaleNum,
+    const FeatureImageListType & scaleFeatures,
+    const typename FeatureImageType::RegionType & region );
+
   void PrintSelf( std::ostream & os, Indent indent ) const;
 
 private:
@@ -117,6 +141,10 @@ private:
 
   bool                               m_UseIntensityOnly;
 
+  bool                               m_UseOptimalScaleFeaturesOnly;
+
+  unsigned int                       m_SlabSize;
+
 }; // End class RidgeFFTFeatureVectorGenerator
 
 } // End namespace tube
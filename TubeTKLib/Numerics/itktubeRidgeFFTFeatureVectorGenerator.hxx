@@ -28,9 +28,12 @@ limitations under the License.
 #include "itktubeRidgeFFTFilter.h"
 #include "tubeMatrixMath.h"
 
+#include <itkExtractImageFilter.h>
 #include <itkImage.h>
+#include <itkImageRegionConstIterator.h>
 #include <itkProgressReporter.h>
 
+#include <algorithm>
 #include <limits>
 
 namespace itk
@@ -44,6 +47,8 @@ RidgeFFTFeatureVectorGenerator< TImage >
 ::RidgeFFTFeatureVectorGenerator( void )
 {
   m_UseIntensityOnly = false;
+  m_UseOptimalScaleFeaturesOnly = false;
+  m_SlabSize = 0;
   m_Scales.resize( 0 );
   m_FeatureImageList.resize( 0 );
 }
@@ -59,14 +64,20 @@ unsigned int
 RidgeFFTFeatureVectorGenerator< TImage >
 ::GetNumberOfFeatures( void ) const
 {
-  unsigned int numFeatures = m_Scales.size() * 5 + 6;
-
+  unsigned int numFeaturesPerScale = 5;
   if( m_UseIntensityOnly )
     {
-    numFeatures = m_Scales.size() * 2 + 3;
+    numFeaturesPerScale = 2;
     }
 
-  return numFeatures;
+  // The features at each scale, followed by the optimal scale and the
+  // features at the optimal scale
+  if( m_UseOptimalScaleFeaturesOnly )
+    {
+    return numFeaturesPerScale + 1;
+    }
+
+  return ( m_Scales.size() + 1 ) * numFeaturesPerScale + 1;
 }
 
 
@@ -119,6 +130,17 @@ void
 RidgeFFTFeatureVectorGenerator< TImage >
 ::Update( void )
 {
+  if( m_UseOptimalScaleFeaturesOnly || m_SlabSize > 0 )
+    {
+    this->UpdateUsingSlabs();
+
+    if( this->GetUpdateWhitenStatisticsOnUpdate() )
+      {
+      this->UpdateWhitenStatistics();
+      }
+    return;
+    }
+
   typedef RidgeFFTFilter< TImage > RidgeFilterType;
   typename RidgeFilterType::Pointer ridgeF = RidgeFilterType::New();
   ridgeF->SetInput( this->m_InputImageList[0] );
@@ -315,6 +337,229 @@ RidgeFFTFeatureVectorGenerator< TImage >
 
 }
 
+template< class TImage >
+void
+RidgeFFTFeatureVectorGenerator< TImage >
+::UpdateUsingSlabs( void )
+{
+  typedef RidgeFFTFilter< TImage >                   RidgeFilterType;
+  typedef ExtractImageFilter< TImage, TImage >       ExtractFilterType;
+  typedef typename FeatureImageType::RegionType      RegionType;
+  typedef ImageRegionIterator< FeatureImageType >    IterType;
+  typedef ImageRegionConstIterator< FeatureImageType >
+                                                     ConstIterType;
+
+  const unsigned int numFeatures = this->GetNumberOfFeatures();
+  const unsigned int numScales = m_Scales.size();
+
+  const TImage * input = this->m_InputImageList[0];
+  const RegionType region = input->GetLargestPossibleRegion();
+
+  m_FeatureImageList.resize( numFeatures );
+  for( unsigned int f=0; f<numFeatures; ++f )
+    {
+    m_FeatureImageList[f] = FeatureImageType::New();
+    m_FeatureImageList[f]->CopyInformation( input );
+    m_FeatureImageList[f]->SetRegions( region );
+    m_FeatureImageList[f]->Allocate();
+    }
+
+  const unsigned int slabAxis = ImageDimension - 1;
+  const IndexValueType regionBegin = region.GetIndex()[slabAxis];
+  const IndexValueType regionEnd = regionBegin
+    + static_cast< IndexValueType >( region.GetSize()[slabAxis] );
+
+  IndexValueType slabSize = m_SlabSize;
+  if( slabSize == 0 || slabSize > regionEnd - regionBegin )
+    {
+    slabSize = regionEnd - regionBegin;
+    }
+
+  double maxScale = 0;
+  for( unsigned int s=0; s<numScales; ++s )
+    {
+    if( m_Scales[s] > maxScale )
+      {
+      maxScale = m_Scales[s];
+      }
+    }
+  const IndexValueType margin = static_cast< IndexValueType >(
+    std::ceil( 6 * maxScale / input->GetSpacing()[slabAxis] ) );
+
+  for( IndexValueType slabBegin = regionBegin; slabBegin < regionEnd;
+    slabBegin += slabSize )
+    {
+    RegionType coreRegion = region;
+    coreRegion.SetIndex( slabAxis, slabBegin );
+    coreRegion.SetSize( slabAxis, static_cast< SizeValueType >(
+      std::min( slabSize, regionEnd - slabBegin ) ) );
+
+    RegionType slabRegion = coreRegion;
+    slabRegion.SetIndex( slabAxis, slabBegin - margin );
+    slabRegion.SetSize( slabAxis, coreRegion.GetSize()[slabAxis]
+      + static_cast< SizeValueType >( 2 * margin ) );
+    slabRegion.Crop( region );
+
+    typename ExtractFilterType::Pointer extractF = ExtractFilterType::New();
+    extractF->SetInput( input );
+    extractF->SetExtractionRegion( slabRegion );
+    extractF->SetDirectionCollapseToSubmatrix();
+    extractF->Update();
+
+    typename RidgeFilterType::Pointer ridgeF = RidgeFilterType::New();
+    ridgeF->SetInput( extractF->GetOutput() );
+    ridgeF->SetUseIntensityOnly( m_UseIntensityOnly );
+
+    if( !m_UseIntensityOnly )
+      {
+      // intensity, ridgeness, roundness, curvature, and levelness
+      FeatureImageListType scaleFeatures( 5 );
+      for( unsigned int s=0; s<numScales; ++s )
+        {
+        ridgeF->SetScale( m_Scales[s] );
+        ridgeF->Update();
+
+        scaleFeatures[0] = ridgeF->GetIntensity();
+        scaleFeatures[1] = ridgeF->GetRidgeness();
+        scaleFeatures[2] = ridgeF->GetRoundness();
+        scaleFeatures[3] = ridgeF->GetCurvature();
+        scaleFeatures[4] = ridgeF->GetLevelness();
+        this->AccumulateScaleFeatures( s, scaleFeatures, coreRegion );
+        }
+      }
+    else
+      {
+      // intensity and its difference to the next scale ( the last scale
+      // is compared to the middle scale ), so each scale is complete once
+      // the next one has been computed
+      FeatureImageListType scaleFeatures( 2 );
+      typename FeatureImageType::Pointer prevIntensity;
+      typename FeatureImageType::Pointer midIntensity;
+      for( unsigned int s=0; s<=numScales; ++s )
+        {
+        typename FeatureImageType::Pointer intensity;
+        typename FeatureImageType::Pointer prevOrMid;
+        if( s < numScales )
+          {
+          ridgeF->SetScale( m_Scales[s] );
+          ridgeF->Update();
+          intensity = ridgeF->GetIntensity();
+          if( s == ( numScales - 1 ) / 2 )
+            {
+            midIntensity = intensity;
+            }
+          prevOrMid = prevIntensity;
+          }
+        else
+          {
+          intensity = prevIntensity;
+          prevOrMid = midIntensity;
+          }
+
+        if( s > 0 )
+          {
+          typename FeatureImageType::Pointer diff = FeatureImageType::New();
+          diff->CopyInformation( input );
+          diff->SetRegions( coreRegion );
+          diff->Allocate();
+
+          ConstIterType iterPrevS( prevOrMid, coreRegion );
+          ConstIterType iterCurS( intensity, coreRegion );
+          IterType iterDiff( diff, coreRegion );
+          while( !iterDiff.IsAtEnd() )
+            {
+            iterDiff.Set( iterPrevS.Get() - iterCurS.Get() );
+            ++iterPrevS;
+            ++iterCurS;
+            ++iterDiff;
+            }
+
+          scaleFeatures[0] = prevIntensity;
+          scaleFeatures[1] = diff;
+          this->AccumulateScaleFeatures( s - 1, scaleFeatures,
+            coreRegion );
+          }
+
+        prevIntensity = intensity;
+        }
+      }
+    }
+}
+
+template< class TImage >
+void
+RidgeFFTFeatureVectorGenerator< TImage >
+::AccumulateScaleFeatures( unsigned int scaleNum,
+  const FeatureImageListType & scaleFeatures,
+  const typename FeatureImageType::RegionType & region )
+{
+  typedef ImageRegionIterator< FeatureImageType >    IterType;
+  typedef ImageRegionConstIterator< FeatureImageType >
+                                                     ConstIterType;
+
+  const unsigned int featureForOptimalScale = 1;
+
+  const unsigned int numFeatures = this->GetNumberOfFeatures();
+  const unsigned int numFeaturesPerScale = scaleFeatures.size();
+  const unsigned int foScale = numFeatures - numFeaturesPerScale - 1;
+  const unsigned int foFeat = numFeatures - numFeaturesPerScale;
+
+  std::vector< ConstIterType > iterS( numFeaturesPerScale );
+  std::vector< IterType > iterFO( numFeaturesPerScale );
+  for( unsigned int f=0; f<numFeaturesPerScale; ++f )
+    {
+    iterS[f] = ConstIterType( scaleFeatures[f], region );
+    iterFO[f] = IterType( m_FeatureImageList[ foFeat + f ], region );
+
+    if( !m_UseOptimalScaleFeaturesOnly )
+      {
+      IterType iterF( m_FeatureImageList[
+        scaleNum * numFeaturesPerScale + f ], region );
+      while( !iterF.IsAtEnd() )
+        {
+        iterF.Set( iterS[f].Get() );
+        ++iterF;
+        ++iterS[f];
+        }
+      iterS[f].GoToBegin();
+      }
+    }
+  IterType iterFOScale( m_FeatureImageList[ foScale ], region );
+
+  // Same comparisons, in the same scale order, as Update( void )
+  while( !iterFOScale.IsAtEnd() )
+    {
+    if( scaleNum == 0 )
+      {
+      for( unsigned int f=0; f<numFeaturesPerScale; ++f )
+        {
+        iterFO[f].Set( iterS[f].Get() );
+        }
+      iterFOScale.Set( m_Scales[ 0 ] );
+      }
+    else
+      {
+      for( unsigned int f=0; f<numFeaturesPerScale; ++f )
+        {
+        if( iterS[f].Get() > iterFO[f].Get() )
+          {
+          iterFO[f].Set( iterS[f].Get() );
+          if( f == featureForOptimalScale )
+            {
+            iterFOScale.Set( m_Scales[ scaleNum ] );
+            }
+          }
+        }
+      }
+    for( unsigned int f=0; f<numFeaturesPerScale; ++f )
+      {
+      ++iterS[f];
+      ++iterFO[f];
+      }
+    ++iterFOScale;
+    }
+}
+
 template< class TImage >
 typename RidgeFFTFeatureVectorGenerator< TImage >::FeatureVectorType
 RidgeFFTFeatureVectorGenerator< TImage >
@@ -372,6 +617,10 @@ RidgeFFTFeatureVectorGenerator< TImage >
   Superclass::PrintSelf( os, indent );
 
   os << indent << "Scales.size() = " << m_Scales.size() << std::endl;
+  os << indent << "UseIntensityOnly = " << m_UseIntensityOnly << std::endl;
+  os << indent << "UseOptimalScaleFeaturesOnly = "
+    << m_UseOptimalScaleFeaturesOnly << std::endl;
+  os << indent << "SlabSize = " << m_SlabSize << std::endl;
 }
 
 } // End namespace tube
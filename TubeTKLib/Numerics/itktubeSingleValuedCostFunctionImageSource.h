@@ -24,8 +24,11 @@ limitations under the License.
 #ifndef __itktubeSingleValuedCostFunctionImageSource_h
 #define __itktubeSingleValuedCostFunctionImageSource_h
 
+#include <itkImageRegionSplitterMultidimensional.h>
 #include <itkImageSource.h>
 
+#include <vector>
+
 namespace itk
 {
 
@@ -38,6 +41,10 @@ namespace tube
  * \brief Create an image by evaluating a single valued cost function on a
  * uniform grid evaluated over parameter ranges.
  *
+ * The grid is split over all of its dimensions between the threads.  The
+ * derivative of the cost function at every grid node can be written to a
+ * second output.
+ *
  */
 template< class TCostFunction, unsigned int VNumberOfParameters >
 class SingleValuedCostFunctionImageSource
@@ -60,6 +67,10 @@ public:
   typedef typename Superclass::OutputImageType       OutputImageType;
   typedef typename Superclass::OutputImageRegionType OutputImageRegionType;
 
+  typedef Vector< MeasureType, VNumberOfParameters > DerivativePixelType;
+  typedef Image< DerivativePixelType, VNumberOfParameters >
+                                                     DerivativeImageType;
+
   /** Dimensionality of the output image. */
   itkStaticConstMacro( NumberOfParameters, unsigned int, VNumberOfParameters );
 
@@ -91,14 +102,44 @@ public:
   virtual void SetParametersStep( const ParametersType & step );
   ParametersType GetParametersStep() const;
 
+  /** Evaluate a clone of the cost function in every thread, instead of
+   * sharing the cost function between threads.  The clones are created by
+   * Clone(), so the cost function must copy its state in InternalClone(). */
+  itkSetMacro( CloneCostFunction, bool );
+  itkGetConstMacro( CloneCostFunction, bool );
+  itkBooleanMacro( CloneCostFunction );
+
+  /** Also compute the derivative of the cost function at every grid node,
+   * in the derivative output. */
+  itkSetMacro( ComputeDerivative, bool );
+  itkGetConstMacro( ComputeDerivative, bool );
+  itkBooleanMacro( ComputeDerivative );
+
+  /** Get the derivative output.  It only holds the derivatives if
+   * ComputeDerivative is on. */
+  DerivativeImageType * GetDerivativeOutput( void );
+
+  using Superclass::MakeOutput;
+  virtual ProcessObject::DataObjectPointer
+    MakeOutput( ProcessObject::DataObjectPointerArraySizeType idx );
+
 protected:
   SingleValuedCostFunctionImageSource();
   virtual ~SingleValuedCostFunctionImageSource() {}
 
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
   virtual void GenerateOutputInformation();
 
+  virtual void GenerateOutputRequestedRegion( DataObject * output );
+
+  virtual const ImageRegionSplitterBase * GetImageRegionSplitter( void )
+    const;
+
   virtual void BeforeThreadedGenerateData();
 
+  virtual void AfterThreadedGenerateData();
+
   virtual void ThreadedGenerateData( const OutputImageRegionType &
     outputRegionForThread, ThreadIdType threadId );
 
@@ -113,6 +154,14 @@ private:
   ParametersType m_ParametersLowerBound;
   ParametersType m_ParametersUpperBound;
   ParametersType m_ParametersStep;
+
+  bool m_CloneCostFunction;
+  bool m_ComputeDerivative;
+
+  /** The cost function of every thread */
+  std::vector< typename CostFunctionType::Pointer > m_ThreadCostFunctions;
+
+  ImageRegionSplitterMultidimensional::Pointer m_ImageRegionSplitter;
 }; // End class SingleValuedCostFunctionImageSource
 
 } // End namespace tube
@@ -26,6 +26,7 @@ limitations under the License.
 
 #include "itktubeSingleValuedCostFunctionImageSource.h"
 
+#include <itkImageRegionIterator.h>
 #include <itkImageRegionIteratorWithIndex.h>
 #include <itkProgressReporter.h>
 
@@ -46,10 +47,53 @@ SingleValuedCostFunctionImageSource< TCostFunction, VNumberOfParameters >
   this->m_ParametersUpperBound.Fill( 10.0 );
   this->m_ParametersStep.Fill( 1.0 );
 
+  this->m_CloneCostFunction = false;
+  this->m_ComputeDerivative = false;
+
+  this->m_ImageRegionSplitter = ImageRegionSplitterMultidimensional::New();
+
+  this->SetNumberOfRequiredOutputs( 2 );
+  this->SetNthOutput( 1, this->MakeOutput( 1 ) );
+
   //Use the ITKv4 Threading Model (call ThreadedGenerateData instead of DynamicThreadedGenerateData)
   this->DynamicMultiThreadingOff();
 }
 
+template< class TCostFunction, unsigned int VNumberOfParameters >
+ProcessObject::DataObjectPointer
+SingleValuedCostFunctionImageSource< TCostFunction, VNumberOfParameters >
+::MakeOutput( ProcessObject::DataObjectPointerArraySizeType idx )
+{
+  if( idx == 1 )
+    {
+    return DerivativeImageType::New().GetPointer();
+    }
+  return Superclass::MakeOutput( idx );
+}
+
+
+template< class TCostFunction, unsigned int VNumberOfParameters >
+typename SingleValuedCostFunctionImageSource< TCostFunction,
+  VNumberOfParameters >::DerivativeImageType *
+SingleValuedCostFunctionImageSource< TCostFunction, VNumberOfParameters >
+::GetDerivativeOutput( void )
+{
+  return static_cast< DerivativeImageType * >(
+    this->ProcessObject::GetOutput( 1 ) );
+}
+
+
+template< class TCostFunction, unsigned int VNumberOfParameters >
+const ImageRegionSplitterBase *
+SingleValuedCostFunctionImageSource< TCostFunction, VNumberOfParameters >
+::GetImageRegionSplitter( void ) const
+{
+  // The default splitter only splits the slowest dimension, which often
+  // has few grid nodes.
+  return this->m_ImageRegionSplitter;
+}
+
+
 template< class TCostFunction, unsigned int VNumberOfParameters >
 void
 SingleValuedCostFunctionImageSource< TCostFunction, VNumberOfParameters >
@@ -184,6 +228,39 @@ SingleValuedCostFunctionImageSource< TCostFunction, VNumberOfParameters >
   typename OutputImageType::DirectionType direction;
   direction.SetIdentity();
   outputImage->SetDirection( direction );
+
+  // The derivative output is reduced to a single pixel when unused
+  DerivativeImageType * derivativeImage = this->GetDerivativeOutput();
+  typename DerivativeImageType::RegionType derivativeRegion;
+  derivativeRegion.SetIndex( index );
+  if( this->m_ComputeDerivative )
+    {
+    derivativeRegion.SetSize( size );
+    }
+  else
+    {
+    typename DerivativeImageType::SizeType derivativeSize;
+    derivativeSize.Fill( 1 );
+    derivativeRegion.SetSize( derivativeSize );
+    }
+  derivativeImage->SetLargestPossibleRegion( derivativeRegion );
+  derivativeImage->SetSpacing( spacing );
+  derivativeImage->SetOrigin( origin );
+  derivativeImage->SetDirection( direction );
+}
+
+
+template< class TCostFunction, unsigned int VNumberOfParameters >
+void
+SingleValuedCostFunctionImageSource< TCostFunction, VNumberOfParameters >
+::GenerateOutputRequestedRegion( DataObject * output )
+{
+  Superclass::GenerateOutputRequestedRegion( output );
+
+  if( !this->m_ComputeDerivative )
+    {
+    this->GetDerivativeOutput()->SetRequestedRegionToLargestPossibleRegion();
+    }
 }
 
 
@@ -196,6 +273,38 @@ SingleValuedCostFunctionImageSource< TCostFunction, VNumberOfParameters >
     {
     itkExceptionMacro( << "Cost function must be assigned!" );
     }
+
+  const ThreadIdType numberOfWorkUnits = this->GetNumberOfWorkUnits();
+  this->m_ThreadCostFunctions.resize( numberOfWorkUnits );
+  for( ThreadIdType ii = 0; ii < numberOfWorkUnits; ++ii )
+    {
+    this->m_ThreadCostFunctions[ii] = this->m_CostFunction;
+    if( this->m_CloneCostFunction )
+      {
+      LightObject::Pointer clone = this->m_CostFunction->Clone();
+      this->m_ThreadCostFunctions[ii] =
+        dynamic_cast< CostFunctionType * >( clone.GetPointer() );
+      if( this->m_ThreadCostFunctions[ii].IsNull() )
+        {
+        itkExceptionMacro( << "Cost function could not be cloned!" );
+        }
+      }
+    }
+
+  if( !this->m_ComputeDerivative )
+    {
+    this->GetDerivativeOutput()->FillBuffer(
+      NumericTraits< DerivativePixelType >::ZeroValue() );
+    }
+}
+
+
+template< class TCostFunction, unsigned int VNumberOfParameters >
+void
+SingleValuedCostFunctionImageSource< TCostFunction, VNumberOfParameters >
+::AfterThreadedGenerateData()
+{
+  this->m_ThreadCostFunctions.clear();
 }
 
 
@@ -206,27 +315,78 @@ SingleValuedCostFunctionImageSource< TCostFunction, VNumberOfParameters >
   ThreadIdType threadId )
 {
   OutputImageType * outputImage = this->GetOutput( 0 );
+  const CostFunctionType * costFunction =
+    this->m_ThreadCostFunctions[threadId];
 
   ProgressReporter progress( this, threadId,
     outputRegionForThread.GetNumberOfPixels() );
 
   typedef ImageRegionIteratorWithIndex< OutputImageType > ImageIteratorType;
   ImageIteratorType imageIt( outputImage, outputRegionForThread );
+
+  typedef ImageRegionIterator< DerivativeImageType > DerivativeIteratorType;
+  DerivativeIteratorType derivativeIt;
+  if( this->m_ComputeDerivative )
+    {
+    derivativeIt = DerivativeIteratorType( this->GetDerivativeOutput(),
+      outputRegionForThread );
+    }
+
+  ParametersType parameters( NumberOfParameters );
+  typename CostFunctionType::DerivativeType derivative;
+  DerivativePixelType derivativePixel;
   for( imageIt.GoToBegin(); !imageIt.IsAtEnd(); ++imageIt )
     {
     const typename OutputImageType::IndexType index = imageIt.GetIndex();
     typename OutputImageType::PointType point;
     outputImage->TransformIndexToPhysicalPoint( index, point );
-    ParametersType parameters( NumberOfParameters );
-    parameters.SetDataSameSize( point.GetDataPointer() );
-    const MeasureType measure = this->m_CostFunction->GetValue(
-      parameters );
+    for( unsigned int ii = 0; ii < NumberOfParameters; ++ii )
+      {
+      parameters[ii] = point[ii];
+      }
+    MeasureType measure;
+    if( this->m_ComputeDerivative )
+      {
+      costFunction->GetValueAndDerivative( parameters, measure,
+        derivative );
+      for( unsigned int ii = 0; ii < NumberOfParameters; ++ii )
+        {
+        derivativePixel[ii] = derivative[ii];
+        }
+      derivativeIt.Set( derivativePixel );
+      ++derivativeIt;
+      }
+    else
+      {
+      measure = costFunction->GetValue( parameters );
+      }
     imageIt.Set( static_cast< typename OutputImageType::PixelType >(
       measure ) );
     progress.CompletedPixel();
     }
 }
 
+
+template< class TCostFunction, unsigned int VNumberOfParameters >
+void
+SingleValuedCostFunctionImageSource< TCostFunction, VNumberOfParameters >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "CostFunction: " << this->m_CostFunction.GetPointer()
+    << std::endl;
+  os << indent << "ParametersLowerBound: " << this->m_ParametersLowerBound
+    << std::endl;
+  os << indent << "ParametersUpperBound: " << this->m_ParametersUpperBound
+    << std::endl;
+  os << indent << "ParametersStep: " << this->m_ParametersStep << std::endl;
+  os << indent << "CloneCostFunction: " << this->m_CloneCostFunction
+    << std::endl;
+  os << indent << "ComputeDerivative: " << this->m_ComputeDerivative
+    << std::endl;
+}
+
 } // End namespace tube
 
 } // End namespace itk
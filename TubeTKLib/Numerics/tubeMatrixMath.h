@@ -27,6 +27,8 @@ limitations under the License.
 #include "tubeMacro.h"
 
 #include <vnl/vnl_math.h>
+#include <vnl/vnl_matrix_fixed.h>
+#include <vnl/vnl_vector_fixed.h>
 #include <vnl/vnl_vector_ref.h>
 
 #define EIGEN_MAX_ITERATIONS 100
@@ -94,6 +96,51 @@ void
 ComputeEigen( vnl_matrix<T> const & mat, vnl_matrix<T> &eVects,
   vnl_vector<T> &eVals, bool orderByAbs = false, bool minToMax = true );
 
+/** Compute eigenvalues and vectors of a symmetric matrix of fixed size.
+ *  Uses Jacobi rotations ( a single rotation in 2D ), without heap
+ *  allocation or output, so it can be called per voxel by many threads. */
+template< class T, unsigned int N >
+void
+ComputeSymmetricEigen( vnl_matrix_fixed<T, N, N> const & mat,
+  vnl_matrix_fixed<T, N, N> &eVects, vnl_vector_fixed<T, N> &eVals,
+  bool orderByAbs = false, bool minToMax = true );
+
+/** Compute eigenvalues and vectors of a matrix of fixed size.
+ *  The matrix is symmetrized and passed to ComputeSymmetricEigen, so
+ *  unlike the vnl_matrix version it never allocates or reports
+ *  asymmetry.  itk::Matrix arguments can be passed via GetVnlMatrix(). */
+template< class T, unsigned int N >
+void
+ComputeEigen( vnl_matrix_fixed<T, N, N> const & mat,
+  vnl_matrix_fixed<T, N, N> &eVects, vnl_vector_fixed<T, N> &eVals,
+  bool orderByAbs = false, bool minToMax = true );
+
+/** Compute Ridgeness measures from a Hessian and gradient of fixed size.
+ *  Equivalent to the vnl_matrix version with an empty prevTangent. */
+template< class T, unsigned int N >
+void
+ComputeRidgeness( const vnl_matrix_fixed<T, N, N> & H,
+  const vnl_vector_fixed<T, N> & D,
+  double & ridgeness,
+  double & roundness,
+  double & curvature,
+  double & levelness );
+
+/** Compute Ridgeness measures from a Hessian and gradient of fixed size,
+ *  also returning the Hessian eigen basis.  If prevTangent is not NULL,
+ *  the eigenvector closest to it is moved to the last column and
+ *  oriented along it, as in the vnl_matrix version. */
+template< class T, unsigned int N >
+void
+ComputeRidgeness( const vnl_matrix_fixed<T, N, N> & H,
+  const vnl_vector_fixed<T, N> & D,
+  const vnl_vector_fixed<T, N> * prevTangent,
+  double & ridgeness,
+  double & roundness,
+  double & curvature,
+  double & levelness,
+  vnl_matrix_fixed<T, N, N> & HEVect, vnl_vector_fixed<T, N> & HEVal );
+
 } // End namespace tube
 
 
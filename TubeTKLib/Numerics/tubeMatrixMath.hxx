@@ -177,8 +177,6 @@ ComputeRidgeness( const vnl_matrix<T> & H,
       }
     if( closestV != ImageDimension-1 )
       {
-      std::cout << "***********Mixing things up: Chosen t=evect#"
-        << closestV << " dotProd = " << closestVDProd << std::endl;
       double tf = HEVal[closestV];
       HEVal[closestV] = HEVal[ImageDimension-1];
       HEVal[ImageDimension-1] = tf;
@@ -190,11 +188,8 @@ ComputeRidgeness( const vnl_matrix<T> & H,
     if( dot_product( prevTangent, HEVect.get_column( ImageDimension-1 ) )
       < 0 )
       {
-      for( unsigned int i=0; i<ImageDimension-1; ++i )
-        {
-        HEVect.get_column( ImageDimension-1 )[i] = -1 * HEVect.get_column(
-          ImageDimension-1 )[i];
-        }
+      HEVect.set_column( ImageDimension-1,
+        -HEVect.get_column( ImageDimension-1 ) );
       }
     }
 
@@ -608,6 +603,317 @@ ComputeEigen( vnl_matrix<T> const & mat,
     }
 }
 
+/**
+ * Compute eigenvalues and vectors of a fixed size symmetric matrix */
+template< class T, unsigned int N >
+void
+ComputeSymmetricEigen( vnl_matrix_fixed<T, N, N> const & mat,
+  vnl_matrix_fixed<T, N, N> &eVects, vnl_vector_fixed<T, N> &eVals,
+  bool orderByAbs, bool minToMax )
+{
+  double a[N][N];
+  double v[N][N];
+  for( unsigned int r=0; r<N; ++r )
+    {
+    for( unsigned int c=0; c<N; ++c )
+      {
+      a[r][c] = ( mat( r, c ) + mat( c, r ) ) / 2;
+      v[r][c] = ( r == c ) ? 1 : 0;
+      }
+    }
+
+  // Cyclic Jacobi: each rotation zeroes one off-diagonal element
+  for( unsigned int sweep=0; sweep<EIGEN_MAX_ITERATIONS; ++sweep )
+    {
+    double off = 0;
+    for( unsigned int p=0; p<N-1; ++p )
+      {
+      for( unsigned int q=p+1; q<N; ++q )
+        {
+        off += std::fabs( a[p][q] );
+        }
+      }
+    if( off == 0 )
+      {
+      break;
+      }
+
+    for( unsigned int p=0; p<N-1; ++p )
+      {
+      for( unsigned int q=p+1; q<N; ++q )
+        {
+        const double apq = a[p][q];
+        if( apq == 0 )
+          {
+          continue;
+          }
+        // After a few sweeps, drop elements that no longer change the
+        // diagonal at double precision
+        const double g = 100 * std::fabs( apq );
+        if( sweep > 3
+          && std::fabs( a[p][p] ) + g == std::fabs( a[p][p] )
+          && std::fabs( a[q][q] ) + g == std::fabs( a[q][q] ) )
+          {
+          a[p][q] = 0;
+          a[q][p] = 0;
+          continue;
+          }
+
+        const double theta = ( a[q][q] - a[p][p] ) / ( 2 * apq );
+        double t;
+        if( std::fabs( theta ) > 1e150 )
+          {
+          t = 1 / ( 2 * theta );
+          }
+        else
+          {
+          t = 1 / ( std::fabs( theta ) + std::sqrt( theta * theta + 1 ) );
+          if( theta < 0 )
+            {
+            t = -t;
+            }
+          }
+        const double c = 1 / std::sqrt( t * t + 1 );
+        const double s = t * c;
+
+        for( unsigned int k=0; k<N; ++k )
+          {
+          const double akp = a[k][p];
+          const double akq = a[k][q];
+          a[k][p] = c * akp - s * akq;
+          a[k][q] = s * akp + c * akq;
+          }
+        for( unsigned int k=0; k<N; ++k )
+          {
+          const double apk = a[p][k];
+          const double aqk = a[q][k];
+          a[p][k] = c * apk - s * aqk;
+          a[q][k] = s * apk + c * aqk;
+          }
+        a[p][q] = 0;
+        a[q][p] = 0;
+
+        for( unsigned int k=0; k<N; ++k )
+          {
+          const double vkp = v[k][p];
+          const double vkq = v[k][q];
+          v[k][p] = c * vkp - s * vkq;
+          v[k][q] = s * vkp + c * vkq;
+          }
+        }
+      }
+    }
+
+  for( unsigned int c=0; c<N; ++c )
+    {
+    eVals( c ) = static_cast< T >( a[c][c] );
+    for( unsigned int r=0; r<N; ++r )
+      {
+      eVects( r, c ) = static_cast< T >( v[r][c] );
+      }
+    }
+
+  // Same ordering as ComputeEigen
+  for( unsigned int i=0; i<N-1; i++ )
+    {
+    for( unsigned int j=i+1; j<N; j++ )
+      {
+      bool swap;
+      if( orderByAbs )
+        {
+        swap = ( std::fabs( eVals( j ) )>std::fabs( eVals( i ) )
+            && !minToMax )
+          || ( std::fabs( eVals( j ) )<std::fabs( eVals( i ) )
+            && minToMax );
+        }
+      else
+        {
+        swap = ( eVals( j )>eVals( i ) && !minToMax )
+          || ( eVals( j )<eVals( i ) && minToMax );
+        }
+      if( swap )
+        {
+        T tf = eVals( j );
+        eVals( j ) = eVals( i );
+        eVals( i ) = tf;
+        for( unsigned int r=0; r<N; ++r )
+          {
+          tf = eVects( r, j );
+          eVects( r, j ) = eVects( r, i );
+          eVects( r, i ) = tf;
+          }
+        }
+      }
+    }
+}
+
+/**
+ * Compute eigenvalues and vectors of a fixed size matrix */
+template< class T, unsigned int N >
+void
+ComputeEigen( vnl_matrix_fixed<T, N, N> const & mat,
+  vnl_matrix_fixed<T, N, N> &eVects, vnl_vector_fixed<T, N> &eVals,
+  bool orderByAbs, bool minToMax )
+{
+  ::tube::ComputeSymmetricEigen( mat, eVects, eVals, orderByAbs,
+    minToMax );
+}
+
+/**
+ * Compute Ridgeness measures from a fixed size Hessian and gradient */
+template< class T, unsigned int N >
+void
+ComputeRidgeness( const vnl_matrix_fixed<T, N, N> & H,
+  const vnl_vector_fixed<T, N> & D,
+  double & ridgeness,
+  double & roundness,
+  double & curvature,
+  double & levelness )
+{
+  vnl_matrix_fixed<T, N, N> HEVect;
+  vnl_vector_fixed<T, N> HEVal;
+  ::tube::ComputeRidgeness( H, D,
+    static_cast< const vnl_vector_fixed<T, N> * >( NULL ), ridgeness,
+    roundness, curvature, levelness, HEVect, HEVal );
+}
+
+/**
+ * Compute Ridgeness measures and eigen basis from a fixed size Hessian
+ * and gradient */
+template< class T, unsigned int N >
+void
+ComputeRidgeness( const vnl_matrix_fixed<T, N, N> & H,
+  const vnl_vector_fixed<T, N> & D,
+  const vnl_vector_fixed<T, N> * prevTangent,
+  double & ridgeness,
+  double & roundness,
+  double & curvature,
+  double & levelness,
+  vnl_matrix_fixed<T, N, N> & HEVect, vnl_vector_fixed<T, N> & HEVal )
+{
+  ::tube::ComputeSymmetricEigen( H, HEVect, HEVal, true, false );
+
+  vnl_vector_fixed<T, N> Dv = D;
+  if( Dv.magnitude() > 0 )
+    {
+    Dv.normalize();
+    }
+  else
+    {
+    Dv = HEVect.get_column( N-1 );
+    }
+
+  if( prevTangent != NULL )
+    {
+    // Keep the eigenvector closest to the previous tangent in the last
+    // column, pointing the same way as the previous tangent
+    unsigned int closestV = 0;
+    double closestVDProd = 0;
+    for( unsigned int i=0; i<N; i++ )
+      {
+      double dProd = 0;
+      for( unsigned int r=0; r<N; r++ )
+        {
+        dProd += ( *prevTangent )[r] * HEVect( r, i );
+        }
+      dProd = std::fabs( dProd );
+      if( dProd > closestVDProd )
+        {
+        closestV = i;
+        closestVDProd = dProd;
+        }
+      }
+    if( closestV != N-1 )
+      {
+      T tf = HEVal[closestV];
+      HEVal[closestV] = HEVal[N-1];
+      HEVal[N-1] = tf;
+      for( unsigned int r=0; r<N; r++ )
+        {
+        tf = HEVect( r, closestV );
+        HEVect( r, closestV ) = HEVect( r, N-1 );
+        HEVect( r, N-1 ) = tf;
+        }
+      }
+    double dProd = 0;
+    for( unsigned int r=0; r<N; r++ )
+      {
+      dProd += ( *prevTangent )[r] * HEVect( r, N-1 );
+      }
+    if( dProd < 0 )
+      {
+      for( unsigned int r=0; r<N; r++ )
+        {
+        HEVect( r, N-1 ) = -HEVect( r, N-1 );
+        }
+      }
+    }
+
+  double sump = 0;
+  double sumv = 0;
+  int ridge = 1;
+  for( unsigned int i=0; i<N-1; i++ )
+    {
+    double dProd = 0;
+    for( unsigned int r=0; r<N; r++ )
+      {
+      dProd += Dv[r] * HEVect( r, i );
+      }
+    sump += dProd * dProd;
+
+    double tf = HEVal[i];
+    sumv += tf * tf;
+    if( tf >= 0 )
+      {
+      ridge = -1;
+      }
+    }
+  double avgp = sump / ( N - 1 );
+  double avgv = sumv / ( N - 1 );
+
+  double curv = sumv / ( sumv + HEVal[ N - 1 ] * HEVal[ N - 1] );
+  ridgeness = ridge * ( 1 - avgp ) * curv;
+
+  // See the vnl_matrix version for a description of the measures
+  roundness = 0;
+  if( avgv != 0 )
+    {
+    if( N > 2 )
+      {
+      roundness =
+        1 - std::fabs( 1 - ( ( HEVal[ N-2 ] * HEVal[ N-2] ) / avgv ) );
+      }
+    else
+      {
+      double denom = sumv + ( HEVal[1] * HEVal[1] );
+      if( denom != 0 )
+        {
+        roundness = ridge * ( 1 - ( HEVal[1] * HEVal[1] ) / denom );
+        }
+      }
+    }
+
+  curvature = 0;
+  if( avgv != 0 )
+    {
+    if( N > 2 )
+      {
+      curvature = ridge * std::sqrt( avgv ) * 50;
+      }
+    else
+      {
+      curvature = ridge * std::sqrt( avgv ) / 4;
+      }
+    }
+
+  levelness = 0;
+  double denom = sumv + ( HEVal[ N-1 ] * HEVal[ N-1] );
+  if( denom != 0 )
+    {
+    levelness = ridge * sumv / denom;
+    }
+}
+
 } // End namespace tube
 
 #endif // End !defined( __tubeMatrixMath_hxx )
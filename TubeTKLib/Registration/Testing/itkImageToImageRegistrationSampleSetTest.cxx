@@ -0,0 +1,365 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itkImageToImageRegistrationSampleSet.h"
+
+#include <itkEllipseSpatialObject.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <cmath>
+#include <set>
+
+int itkImageToImageRegistrationSampleSetTest( int argc, char * argv[] )
+{
+  if( argc != 1 )
+    {
+    std::cout << "Usage: " << argv[0] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  enum { Dimension = 2 };
+
+  typedef itk::Image< float, Dimension >                       ImageType;
+  typedef itk::ImageToImageRegistrationSampleSet< ImageType >  SampleSetType;
+  typedef SampleSetType::SampleContainerType          SampleContainerType;
+  typedef SampleSetType::IndexContainerType           IndexContainerType;
+  typedef itk::EllipseSpatialObject< Dimension >               EllipseType;
+
+  // A 40x40 image with a vertical step edge between columns 19 and 20
+  const unsigned int imageSize = 40;
+  const unsigned int edgeColumn = 20;
+
+  ImageType::RegionType region;
+  ImageType::SizeType size;
+  size.Fill( imageSize );
+  region.SetSize( size );
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > iter( image, region );
+  for( iter.GoToBegin(); !iter.IsAtEnd(); ++iter )
+    {
+    if( iter.GetIndex()[0] >= static_cast< long >( edgeColumn ) )
+      {
+      iter.Set( 100 );
+      }
+    else
+      {
+      iter.Set( 0 );
+      }
+    }
+
+  const unsigned int numberOfPixels = imageSize * imageSize;
+
+  // Intensity threshold exclusion
+  SampleSetType::Pointer thresholdSet = SampleSetType::New();
+  thresholdSet->SetFixedImage( image );
+  thresholdSet->SetNumberOfSamples( numberOfPixels );
+  thresholdSet->SetFixedImageSamplesIntensityThreshold( 50 );
+  thresholdSet->Update();
+  if( thresholdSet->GetNumberOfValidPixels()
+    != numberOfPixels - edgeColumn * imageSize )
+    {
+    std::cerr << "Threshold: wrong number of valid pixels: "
+              << thresholdSet->GetNumberOfValidPixels() << std::endl;
+    return EXIT_FAILURE;
+    }
+  const SampleContainerType & thresholdSamples = thresholdSet->GetSamples();
+  for( unsigned int i = 0; i < thresholdSamples.size(); ++i )
+    {
+    if( thresholdSamples[i].Value < 50 )
+      {
+      std::cerr << "Threshold: sample below the threshold at "
+                << thresholdSamples[i].Index << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Region of interest exclusion
+  SampleSetType::PointType roiPoint1;
+  roiPoint1.Fill( 5 );
+  SampleSetType::PointType roiPoint2;
+  roiPoint2.Fill( 14 );
+
+  SampleSetType::Pointer roiSet = SampleSetType::New();
+  roiSet->SetFixedImage( image );
+  roiSet->SetNumberOfSamples( numberOfPixels );
+  roiSet->SetRegionOfInterest( roiPoint2, roiPoint1 );
+  roiSet->Update();
+  if( roiSet->GetNumberOfValidPixels() != 100 )
+    {
+    std::cerr << "Region of interest: wrong number of valid pixels: "
+              << roiSet->GetNumberOfValidPixels() << std::endl;
+    return EXIT_FAILURE;
+    }
+  const SampleContainerType & roiSamples = roiSet->GetSamples();
+  for( unsigned int i = 0; i < roiSamples.size(); ++i )
+    {
+    for( unsigned int d = 0; d < Dimension; ++d )
+      {
+      if( roiSamples[i].Point[d] < roiPoint1[d]
+        || roiSamples[i].Point[d] > roiPoint2[d] )
+        {
+        std::cerr << "Region of interest: sample outside at "
+                  << roiSamples[i].Point << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  // Mask exclusion: the mask object is zero inside an ellipse
+  EllipseType::Pointer ellipse = EllipseType::New();
+  ellipse->SetRadius( 6 );
+  ellipse->SetDefaultInsideValue( 0 );
+  ellipse->SetDefaultOutsideValue( 1 );
+  EllipseType::VectorType ellipseOffset;
+  ellipseOffset.Fill( 10 );
+  ellipse->GetObjectToParentTransform()->SetOffset( ellipseOffset );
+  ellipse->ComputeObjectToWorldTransform();
+
+  unsigned int numberOfMaskedPixels = 0;
+  for( iter.GoToBegin(); !iter.IsAtEnd(); ++iter )
+    {
+    ImageType::PointType point;
+    image->TransformIndexToPhysicalPoint( iter.GetIndex(), point );
+    if( ellipse->IsInside( point ) )
+      {
+      ++numberOfMaskedPixels;
+      }
+    }
+  if( numberOfMaskedPixels == 0 )
+    {
+    std::cerr << "Mask: the ellipse covers no pixel" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  SampleSetType::Pointer maskSet = SampleSetType::New();
+  maskSet->SetFixedImage( image );
+  maskSet->SetNumberOfSamples( numberOfPixels );
+  maskSet->SetFixedImageMaskObject( ellipse );
+  maskSet->Update();
+  if( maskSet->GetNumberOfValidPixels()
+    != numberOfPixels - numberOfMaskedPixels )
+    {
+    std::cerr << "Mask: wrong number of valid pixels: "
+              << maskSet->GetNumberOfValidPixels() << " != "
+              << numberOfPixels - numberOfMaskedPixels << std::endl;
+    return EXIT_FAILURE;
+    }
+  const SampleContainerType & maskSamples = maskSet->GetSamples();
+  for( unsigned int i = 0; i < maskSamples.size(); ++i )
+    {
+    if( ellipse->IsInside( maskSamples[i].Point ) )
+      {
+      std::cerr << "Mask: sample inside the mask hole at "
+                << maskSamples[i].Point << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Regular sampling: every fourth pixel, and evenly spaced subsets
+  SampleSetType::Pointer regularSet = SampleSetType::New();
+  regularSet->SetFixedImage( image );
+  regularSet->SetNumberOfSamples( numberOfPixels / 4 );
+  regularSet->SetSamplingStrategyEnum( SampleSetType::REGULAR_SAMPLING );
+  regularSet->Update();
+  const SampleContainerType & regularSamples = regularSet->GetSamples();
+  if( regularSamples.size() != numberOfPixels / 4 )
+    {
+    std::cerr << "Regular: wrong number of samples: "
+              << regularSamples.size() << std::endl;
+    return EXIT_FAILURE;
+    }
+  for( unsigned int i = 1; i < regularSamples.size(); ++i )
+    {
+    if( image->ComputeOffset( regularSamples[i].Index )
+      - image->ComputeOffset( regularSamples[i - 1].Index ) != 4 )
+      {
+      std::cerr << "Regular: samples not evenly spaced at "
+                << regularSamples[i].Index << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  IndexContainerType regularIndexes;
+  regularSet->GetFixedImageIndexes( image, numberOfPixels / 16,
+    regularIndexes );
+  if( regularIndexes.size() != numberOfPixels / 16 )
+    {
+    std::cerr << "Regular: wrong number of subset indexes: "
+              << regularIndexes.size() << std::endl;
+    return EXIT_FAILURE;
+    }
+  for( unsigned int i = 1; i < regularIndexes.size(); ++i )
+    {
+    if( image->ComputeOffset( regularIndexes[i] )
+      - image->ComputeOffset( regularIndexes[i - 1] ) != 16 )
+      {
+      std::cerr << "Regular: subset not evenly spaced at "
+                << regularIndexes[i] << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Stratified sampling: one sample per 4x4 cell, repeatable for a seed
+  const unsigned int cellSize = 4;
+  const unsigned int numberOfCells = numberOfPixels / ( cellSize * cellSize );
+  SampleSetType::Pointer stratifiedSet = SampleSetType::New();
+  stratifiedSet->SetFixedImage( image );
+  stratifiedSet->SetNumberOfSamples( numberOfCells );
+  stratifiedSet->SetSamplingStrategyEnum(
+    SampleSetType::STRATIFIED_SAMPLING );
+  stratifiedSet->SetRandomNumberSeed( 7 );
+  stratifiedSet->Update();
+  const SampleContainerType & stratifiedSamples =
+    stratifiedSet->GetSamples();
+  if( stratifiedSamples.size() != numberOfCells )
+    {
+    std::cerr << "Stratified: wrong number of samples: "
+              << stratifiedSamples.size() << std::endl;
+    return EXIT_FAILURE;
+    }
+  std::set< unsigned int > cells;
+  for( unsigned int i = 0; i < stratifiedSamples.size(); ++i )
+    {
+    const SampleSetType::IndexType & index = stratifiedSamples[i].Index;
+    cells.insert( ( index[1] / cellSize ) * ( imageSize / cellSize )
+      + index[0] / cellSize );
+    }
+  if( cells.size() != numberOfCells )
+    {
+    std::cerr << "Stratified: " << cells.size() << " of " << numberOfCells
+              << " cells covered" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  SampleSetType::Pointer stratifiedSet2 = SampleSetType::New();
+  stratifiedSet2->SetFixedImage( image );
+  stratifiedSet2->SetNumberOfSamples( numberOfCells );
+  stratifiedSet2->SetSamplingStrategyEnum(
+    SampleSetType::STRATIFIED_SAMPLING );
+  stratifiedSet2->SetRandomNumberSeed( 7 );
+  stratifiedSet2->Update();
+  const SampleContainerType & stratifiedSamples2 =
+    stratifiedSet2->GetSamples();
+  if( stratifiedSamples2.size() != stratifiedSamples.size() )
+    {
+    std::cerr << "Stratified: not repeatable for a fixed seed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  for( unsigned int i = 0; i < stratifiedSamples.size(); ++i )
+    {
+    if( stratifiedSamples2[i].Index != stratifiedSamples[i].Index )
+      {
+      std::cerr << "Stratified: sample " << i
+                << " not repeatable for a fixed seed: "
+                << stratifiedSamples2[i].Index << " != "
+                << stratifiedSamples[i].Index << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Edge weighted sampling: the two columns at the step edge hold 5% of
+  // the pixels, and must hold a much larger share of the samples
+  SampleSetType::Pointer edgeSet = SampleSetType::New();
+  edgeSet->SetFixedImage( image );
+  edgeSet->SetNumberOfSamples( numberOfPixels / 10 );
+  edgeSet->SetSamplingStrategyEnum(
+    SampleSetType::EDGE_WEIGHTED_SAMPLING );
+  edgeSet->SetRandomNumberSeed( 7 );
+  edgeSet->Update();
+  const SampleContainerType & edgeSamples = edgeSet->GetSamples();
+  if( edgeSamples.size() != numberOfPixels / 10 )
+    {
+    std::cerr << "Edge weighted: wrong number of samples: "
+              << edgeSamples.size() << std::endl;
+    return EXIT_FAILURE;
+    }
+  unsigned int numberOfEdgeSamples = 0;
+  for( unsigned int i = 0; i < edgeSamples.size(); ++i )
+    {
+    if( edgeSamples[i].Gradient.GetNorm() > 0 )
+      {
+      ++numberOfEdgeSamples;
+      }
+    }
+  const double edgePixelFraction = 2.0 / imageSize;
+  const double edgeSampleFraction = static_cast< double >(
+    numberOfEdgeSamples ) / edgeSamples.size();
+  std::cout << "Edge weighted: " << edgeSampleFraction
+            << " of the samples on the edge, which holds "
+            << edgePixelFraction << " of the pixels" << std::endl;
+  if( edgeSampleFraction < 4 * edgePixelFraction )
+    {
+    std::cerr << "Edge weighted: samples not biased toward the edge"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Mapping to a coarser image: two by two fine pixels per coarse pixel,
+  // so that the indexes must be deduplicated
+  ImageType::SizeType coarseSize;
+  coarseSize.Fill( imageSize / 2 );
+  ImageType::RegionType coarseRegion;
+  coarseRegion.SetSize( coarseSize );
+  ImageType::SpacingType coarseSpacing;
+  coarseSpacing.Fill( 2 );
+  ImageType::PointType coarseOrigin;
+  coarseOrigin.Fill( 0.5 );
+
+  ImageType::Pointer coarseImage = ImageType::New();
+  coarseImage->SetRegions( coarseRegion );
+  coarseImage->SetSpacing( coarseSpacing );
+  coarseImage->SetOrigin( coarseOrigin );
+  coarseImage->Allocate();
+
+  SampleSetType::Pointer fullSet = SampleSetType::New();
+  fullSet->SetFixedImage( image );
+  fullSet->SetNumberOfSamples( numberOfPixels );
+  fullSet->Update();
+
+  IndexContainerType coarseIndexes;
+  fullSet->GetFixedImageIndexes( coarseImage, numberOfPixels,
+    coarseIndexes );
+  if( coarseIndexes.size() != numberOfPixels / 4 )
+    {
+    std::cerr << "Coarse image: " << coarseIndexes.size()
+              << " indexes instead of " << numberOfPixels / 4 << std::endl;
+    return EXIT_FAILURE;
+    }
+  std::set< itk::OffsetValueType > coarseOffsets;
+  for( unsigned int i = 0; i < coarseIndexes.size(); ++i )
+    {
+    if( !coarseRegion.IsInside( coarseIndexes[i] )
+      || !coarseOffsets.insert(
+        coarseImage->ComputeOffset( coarseIndexes[i] ) ).second )
+      {
+      std::cerr << "Coarse image: invalid or repeated index "
+                << coarseIndexes[i] << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,222 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeAnisotropicDiffusiveRegistrationFilter.h"
+
+#include <itkImageRegionConstIteratorWithIndex.h>
+
+#ifdef TubeTK_USE_VTK
+#include <vtkPlaneSource.h>
+#endif
+
+#include <cmath>
+
+namespace
+{
+
+enum { Dimension = 3 };
+
+typedef itk::Image< double, Dimension >                 ImageType;
+typedef itk::Vector< double, Dimension >                VectorType;
+typedef itk::Image< VectorType, Dimension >             DeformationFieldType;
+
+typedef itk::tube::AnisotropicDiffusiveRegistrationFilter< ImageType,
+  ImageType, DeformationFieldType >                     FilterType;
+
+/** The border is the plane z = 7.5, sampled every 0.5 from -2 to 17 along
+ *  x and y, so that the distance from a voxel of a 16^3 image to its
+ *  closest border point is | z - 7.5 | */
+const double PlaneZ = 7.5;
+const double PlaneMin = -2;
+const double PlaneMax = 17;
+const unsigned int PlaneResolution = 38;
+
+FilterType::BorderPointSetType::Pointer CreatePlanePointSet( void )
+{
+  FilterType::BorderPointSetType::Pointer pointSet =
+    FilterType::BorderPointSetType::New();
+
+  FilterType::NormalVectorType normal;
+  normal.Fill( 0 );
+  normal[2] = 1;
+
+  FilterType::BorderPointSetType::PointType point;
+  point[2] = PlaneZ;
+  const double step = ( PlaneMax - PlaneMin ) / PlaneResolution;
+  unsigned int id = 0;
+  for( unsigned int j = 0; j <= PlaneResolution; ++j )
+    {
+    point[1] = PlaneMin + j * step;
+    for( unsigned int i = 0; i <= PlaneResolution; ++i )
+      {
+      point[0] = PlaneMin + i * step;
+      pointSet->SetPoint( id, point );
+      pointSet->SetPointData( id, normal );
+      ++id;
+      }
+    }
+  return pointSet;
+}
+
+/** Registers two blank images, so that only the normal and weight images
+ *  are computed */
+FilterType::Pointer CreateFilter( const ImageType * image )
+{
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetFixedImage( image );
+  filter->SetMovingImage( image );
+  filter->SetComputeIntensityDistanceTerm( false );
+  filter->SetTimeStep( 0.125 );
+  filter->SetNumberOfIterations( 1 );
+  filter->SetLambda( 0.5 );
+  return filter;
+}
+
+#ifdef TubeTK_USE_VTK
+/** Compares the normal and weight images of two filters voxel by voxel */
+bool CompareNormalsAndWeights( const FilterType * filter1,
+  const FilterType * filter2, double tolerance )
+{
+  itk::ImageRegionConstIteratorWithIndex< FilterType::NormalVectorImageType >
+    normalIt1( filter1->GetNormalVectorImage(),
+      filter1->GetNormalVectorImage()->GetLargestPossibleRegion() );
+  itk::ImageRegionConstIteratorWithIndex< FilterType::NormalVectorImageType >
+    normalIt2( filter2->GetNormalVectorImage(),
+      filter2->GetNormalVectorImage()->GetLargestPossibleRegion() );
+  itk::ImageRegionConstIteratorWithIndex< FilterType::WeightImageType >
+    weightIt1( filter1->GetWeightImage(),
+      filter1->GetWeightImage()->GetLargestPossibleRegion() );
+  itk::ImageRegionConstIteratorWithIndex< FilterType::WeightImageType >
+    weightIt2( filter2->GetWeightImage(),
+      filter2->GetWeightImage()->GetLargestPossibleRegion() );
+  for( ; !normalIt1.IsAtEnd();
+    ++normalIt1, ++normalIt2, ++weightIt1, ++weightIt2 )
+    {
+    if( ( normalIt1.Get() - normalIt2.Get() ).GetNorm() > tolerance
+      || std::fabs( weightIt1.Get() - weightIt2.Get() ) > tolerance )
+      {
+      std::cerr << "At " << normalIt1.GetIndex() << ": point set normal "
+                << normalIt1.Get() << " and weight " << weightIt1.Get()
+                << ", surface normal " << normalIt2.Get()
+                << " and weight " << weightIt2.Get() << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+#endif
+
+} // End namespace
+
+int itktubeAnisotropicDiffusiveRegistrationBorderPointSetTest( int argc,
+  char * argv[] )
+{
+  if( argc != 1 )
+    {
+    std::cout << "Usage: " << argv[0] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  ImageType::RegionType region;
+  ImageType::SizeType size;
+  size.Fill( 16 );
+  region.SetSize( size );
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+  image->FillBuffer( 0 );
+
+  try
+    {
+    FilterType::Pointer pointSetFilter = CreateFilter( image );
+    pointSetFilter->SetBorderPointSet( CreatePlanePointSet() );
+    pointSetFilter->Update();
+
+    // Every voxel takes the normal of the plane.  The distances are
+    // smoothed with a Gaussian of sigma 1 voxel, which has no effect on
+    // the linear distance at least three voxels away from the plane and
+    // from the image boundaries.
+    const double tolerance = 0.001;
+    itk::ImageRegionConstIteratorWithIndex< FilterType::NormalVectorImageType >
+      normalIt( pointSetFilter->GetNormalVectorImage(), region );
+    itk::ImageRegionConstIteratorWithIndex< FilterType::WeightImageType >
+      weightIt( pointSetFilter->GetWeightImage(), region );
+    for( ; !normalIt.IsAtEnd(); ++normalIt, ++weightIt )
+      {
+      FilterType::NormalVectorType expectedNormal;
+      expectedNormal.Fill( 0 );
+      expectedNormal[2] = 1;
+      if( ( normalIt.Get() - expectedNormal ).GetNorm() > tolerance )
+        {
+        std::cerr << "Normal " << normalIt.Get() << " at "
+                  << normalIt.GetIndex() << " instead of "
+                  << expectedNormal << std::endl;
+        return EXIT_FAILURE;
+        }
+
+      const int z = weightIt.GetIndex()[2];
+      if( std::fabs( z - PlaneZ ) < 3 || z < 3 || z > 12 )
+        {
+        continue;
+        }
+      const double expectedWeight = std::exp( -0.5 * std::fabs( z - PlaneZ ) );
+      if( std::fabs( weightIt.Get() - expectedWeight ) > tolerance )
+        {
+        std::cerr << "Weight " << weightIt.Get() << " at "
+                  << weightIt.GetIndex() << " instead of "
+                  << expectedWeight << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+
+#ifdef TubeTK_USE_VTK
+    // The same plane given as a surface must give the same normals and
+    // weights
+    vtkSmartPointer< vtkPlaneSource > plane =
+      vtkSmartPointer< vtkPlaneSource >::New();
+    plane->SetOrigin( PlaneMin, PlaneMin, PlaneZ );
+    plane->SetPoint1( PlaneMax, PlaneMin, PlaneZ );
+    plane->SetPoint2( PlaneMin, PlaneMax, PlaneZ );
+    plane->SetXResolution( PlaneResolution );
+    plane->SetYResolution( PlaneResolution );
+    plane->Update();
+
+    FilterType::Pointer surfaceFilter = CreateFilter( image );
+    surfaceFilter->SetBorderSurface( plane->GetOutput() );
+    surfaceFilter->Update();
+
+    if( !CompareNormalsAndWeights( pointSetFilter, surfaceFilter, 1e-6 ) )
+      {
+      return EXIT_FAILURE;
+      }
+#endif
+    }
+  catch( itk::ExceptionObject & err )
+    {
+    std::cerr << "Exception caught: " << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
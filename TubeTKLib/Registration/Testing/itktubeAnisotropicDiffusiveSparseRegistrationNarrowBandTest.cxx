@@ -0,0 +1,316 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeAnisotropicDiffusiveSparseRegistrationFilter.h"
+
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <vtkPlaneSource.h>
+
+#include <cmath>
+
+namespace
+{
+
+enum { Dimension = 3 };
+
+typedef itk::Image< double, Dimension >                 ImageType;
+typedef itk::Vector< double, Dimension >                VectorType;
+typedef itk::Image< VectorType, Dimension >             DeformationFieldType;
+
+typedef itk::tube::AnisotropicDiffusiveSparseRegistrationFilter< ImageType,
+  ImageType, DeformationFieldType >                     FilterType;
+
+/** Plane z = planeZ with a vertex above every voxel of a 16^3 image, so
+ *  that the distance from a voxel to its closest vertex is | z - planeZ |
+ */
+vtkSmartPointer< vtkPolyData > CreatePlane( double planeZ )
+{
+  vtkSmartPointer< vtkPlaneSource > plane =
+    vtkSmartPointer< vtkPlaneSource >::New();
+  plane->SetOrigin( -2, -2, planeZ );
+  plane->SetPoint1( 17, -2, planeZ );
+  plane->SetPoint2( -2, 17, planeZ );
+  plane->SetXResolution( 38 );
+  plane->SetYResolution( 38 );
+  plane->Update();
+  return plane->GetOutput();
+}
+
+/** Smooth initial deformation field with tangential and normal components
+ *  everywhere */
+DeformationFieldType::Pointer CreateInitialField(
+  const ImageType * image )
+{
+  DeformationFieldType::Pointer field = DeformationFieldType::New();
+  field->CopyInformation( image );
+  field->SetRegions( image->GetLargestPossibleRegion() );
+  field->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< DeformationFieldType > it( field,
+    field->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    const DeformationFieldType::IndexType & index = it.GetIndex();
+    VectorType u;
+    u[0] = 0.2 * std::sin( 0.4 * index[0] + 0.3 * index[2] );
+    u[1] = 0.2 * std::cos( 0.3 * index[1] + 0.2 * index[2] );
+    u[2] = 0.2 * std::sin( 0.2 * index[0] + 0.5 * index[2] );
+    it.Set( u );
+    }
+  return field;
+}
+
+/** Regularizes the initial field of two blank images */
+FilterType::Pointer CreateFilter( const ImageType * image, double lambda,
+  unsigned int numberOfIterations )
+{
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetFixedImage( image );
+  filter->SetMovingImage( image );
+  filter->SetInitialDisplacementField( CreateInitialField( image ) );
+  filter->SetComputeIntensityDistanceTerm( false );
+  filter->SetTimeStep( 0.05 );
+  filter->SetNumberOfIterations( numberOfIterations );
+  filter->SetMaximumRMSError( 0 );
+  filter->SetLambda( lambda );
+  return filter;
+}
+
+/** Filter computing the regularization over the entire image from the
+ *  normals and weights of the plane z = 7.5, with w set to zero outside
+ *  the slices firstZ to lastZ */
+FilterType::Pointer CreateFullFilter( const ImageType * image,
+  double lambda, unsigned int numberOfIterations, int firstZ, int lastZ )
+{
+  FilterType::Pointer filter =
+    CreateFilter( image, lambda, numberOfIterations );
+
+  FilterType::NormalMatrixImageType::Pointer normals =
+    FilterType::NormalMatrixImageType::New();
+  normals->CopyInformation( image );
+  normals->SetRegions( image->GetLargestPossibleRegion() );
+  normals->Allocate();
+  FilterType::NormalMatrixType normal;
+  normal.Fill( 0 );
+  normal( 2, 0 ) = 1;
+  normals->FillBuffer( normal );
+
+  FilterType::WeightMatrixImageType::Pointer weightStructures =
+    FilterType::WeightMatrixImageType::New();
+  weightStructures->CopyInformation( image );
+  weightStructures->SetRegions( image->GetLargestPossibleRegion() );
+  weightStructures->Allocate();
+  FilterType::WeightMatrixType weightStructure;
+  weightStructure.Fill( 0 );
+  weightStructure( 0, 0 ) = 1;
+  weightStructures->FillBuffer( weightStructure );
+
+  FilterType::WeightComponentImageType::Pointer weightRegularizations =
+    FilterType::WeightComponentImageType::New();
+  weightRegularizations->CopyInformation( image );
+  weightRegularizations->SetRegions( image->GetLargestPossibleRegion() );
+  weightRegularizations->Allocate();
+  itk::ImageRegionIteratorWithIndex< FilterType::WeightComponentImageType >
+    it( weightRegularizations,
+      weightRegularizations->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    const int z = it.GetIndex()[2];
+    it.Set( z < firstZ || z > lastZ
+      ? 0 : std::exp( -lambda * std::fabs( z - 7.5 ) ) );
+    }
+
+  filter->SetNormalMatrixImage( normals );
+  filter->SetWeightStructuresImage( weightStructures );
+  filter->SetWeightRegularizationsImage( weightRegularizations );
+  return filter;
+}
+
+/** Filter computing the regularization in a narrow band around the plane
+ *  z = planeZ */
+FilterType::Pointer CreateBandFilter( const ImageType * image,
+  double lambda, unsigned int numberOfIterations, double planeZ,
+  double narrowBandWidth )
+{
+  FilterType::Pointer filter =
+    CreateFilter( image, lambda, numberOfIterations );
+  filter->SetBorderSurface( CreatePlane( planeZ ) );
+  filter->SetNarrowBandWidth( narrowBandWidth );
+  return filter;
+}
+
+/** Compares the output fields of two filters on the slices firstZ to
+ *  lastZ */
+bool CompareFields( const FilterType * filter1, const FilterType * filter2,
+  int firstZ, int lastZ, double tolerance )
+{
+  itk::ImageRegionConstIteratorWithIndex< DeformationFieldType > it1(
+    filter1->GetOutput(), filter1->GetOutput()->GetLargestPossibleRegion() );
+  itk::ImageRegionConstIteratorWithIndex< DeformationFieldType > it2(
+    filter2->GetOutput(), filter2->GetOutput()->GetLargestPossibleRegion() );
+  for( ; !it1.IsAtEnd(); ++it1, ++it2 )
+    {
+    const int z = it1.GetIndex()[2];
+    if( z < firstZ || z > lastZ )
+      {
+      continue;
+      }
+    if( ( it1.Get() - it2.Get() ).GetNorm() > tolerance )
+      {
+      std::cerr << "At " << it1.GetIndex() << ": " << it1.Get()
+                << " instead of " << it2.Get() << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+} // End namespace
+
+int itktubeAnisotropicDiffusiveSparseRegistrationNarrowBandTest( int argc,
+  char * argv[] )
+{
+  if( argc != 1 )
+    {
+    std::cout << "Usage: " << argv[0] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  ImageType::RegionType region;
+  ImageType::SizeType size;
+  size.Fill( 16 );
+  region.SetSize( size );
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+  image->FillBuffer( 0 );
+
+  try
+    {
+    // A band covering the image must reproduce the regularization
+    // computed over the entire image, which is given the same normals
+    // and weights
+    FilterType::Pointer fullFilter =
+      CreateFullFilter( image, 0.5, 3, 0, 15 );
+    fullFilter->Update();
+    FilterType::Pointer bandFilter =
+      CreateBandFilter( image, 0.5, 3, 7.5, 100 );
+    bandFilter->Update();
+
+    if( bandFilter->GetNumberOfNarrowBandVoxels()
+      != region.GetNumberOfPixels() )
+      {
+      std::cerr << "The band covers "
+                << bandFilter->GetNumberOfNarrowBandVoxels() << " of "
+                << region.GetNumberOfPixels() << " voxels" << std::endl;
+      return EXIT_FAILURE;
+      }
+    if( !CompareFields( bandFilter, fullFilter, 0, 15, 1e-6 ) )
+      {
+      return EXIT_FAILURE;
+      }
+    const double fullEnergy =
+      fullFilter->GetEnergies().RegularizationEnergy;
+    const double bandEnergy =
+      bandFilter->GetEnergies().RegularizationEnergy;
+    if( std::fabs( bandEnergy - fullEnergy ) > 1e-6 * fullEnergy )
+      {
+      std::cerr << "Regularization energy " << bandEnergy
+                << " instead of " << fullEnergy << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    // With lambda = 1, w falls below 0.01 at a distance of 4.6, so a band
+    // of width 1 is widened to the slices 3 to 12.  It is then dilated by
+    // twice the stencil radius of 1, to the slices 1 to 14.
+    FilterType::Pointer narrowFilter =
+      CreateBandFilter( image, 1.0, 1, 7.5, 1.0 );
+    narrowFilter->Update();
+    const double minimumWidth = std::log( 100.0 );
+    if( std::fabs( narrowFilter->GetNarrowBandMinimumWidth()
+      - minimumWidth ) > 1e-6 )
+      {
+      std::cerr << "Minimum band width "
+                << narrowFilter->GetNarrowBandMinimumWidth()
+                << " instead of " << minimumWidth << std::endl;
+      return EXIT_FAILURE;
+      }
+    const itk::SizeValueType expectedNumberOfVoxels = 14 * 16 * 16;
+    if( narrowFilter->GetNumberOfNarrowBandVoxels()
+      != expectedNumberOfVoxels )
+      {
+      std::cerr << "The band has "
+                << narrowFilter->GetNumberOfNarrowBandVoxels()
+                << " voxels instead of " << expectedNumberOfVoxels
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    // Away from the band, w = 0.  After one iteration, the update of the
+    // slices 2 to 13 only reads the band, where the normal components are
+    // those of the entire image.
+    FilterType::Pointer clippedFullFilter =
+      CreateFullFilter( image, 1.0, 1, 1, 14 );
+    clippedFullFilter->Update();
+    if( !CompareFields( narrowFilter, clippedFullFilter, 2, 13, 1e-6 ) )
+      {
+      return EXIT_FAILURE;
+      }
+
+    // Moving the border surface must recompute the normals and the band,
+    // as for a new filter.  The band around z = 5.5 covers the slices 1
+    // to 10, dilated to the slices 0 to 12.
+    narrowFilter->SetBorderSurface( CreatePlane( 5.5 ) );
+    narrowFilter->Update();
+    FilterType::Pointer movedFilter =
+      CreateBandFilter( image, 1.0, 1, 5.5, 1.0 );
+    movedFilter->Update();
+    const itk::SizeValueType expectedNumberOfMovedVoxels = 13 * 16 * 16;
+    if( narrowFilter->GetNumberOfNarrowBandVoxels()
+      != expectedNumberOfMovedVoxels
+      || movedFilter->GetNumberOfNarrowBandVoxels()
+      != expectedNumberOfMovedVoxels )
+      {
+      std::cerr << "The moved bands have "
+                << narrowFilter->GetNumberOfNarrowBandVoxels() << " and "
+                << movedFilter->GetNumberOfNarrowBandVoxels()
+                << " voxels instead of " << expectedNumberOfMovedVoxels
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    if( !CompareFields( narrowFilter, movedFilter, 0, 15, 0 ) )
+      {
+      return EXIT_FAILURE;
+      }
+    }
+  catch( itk::ExceptionObject & err )
+    {
+    std::cerr << "Exception caught: " << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
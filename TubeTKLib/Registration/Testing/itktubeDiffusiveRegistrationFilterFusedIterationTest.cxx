@@ -0,0 +1,252 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeDiffusiveRegistrationFilter.h"
+
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+enum { Dimension = 3 };
+
+typedef itk::Image< double, Dimension >                 ImageType;
+typedef itk::Vector< double, Dimension >                VectorType;
+typedef itk::Image< VectorType, Dimension >             DeformationFieldType;
+
+typedef itk::tube::DiffusiveRegistrationFilter< ImageType, ImageType,
+  DeformationFieldType >                                FilterType;
+
+/** Image whose size is not a multiple of the tile size, with anisotropic
+ *  spacing */
+template< class TImage >
+typename TImage::Pointer CreateImage( void )
+{
+  typename TImage::SizeType size;
+  size[0] = 20;
+  size[1] = 18;
+  size[2] = 17;
+  typename TImage::RegionType region;
+  region.SetSize( size );
+  typename TImage::SpacingType spacing;
+  spacing[0] = 1.0;
+  spacing[1] = 1.25;
+  spacing[2] = 0.8;
+
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions( region );
+  image->SetSpacing( spacing );
+  image->Allocate();
+  return image;
+}
+
+/** Gaussian blob centered in the image, shifted by offset voxels along x
+ */
+ImageType::Pointer CreateBlobImage( double offset )
+{
+  ImageType::Pointer image = CreateImage< ImageType >();
+  const ImageType::SizeType & size =
+    image->GetLargestPossibleRegion().GetSize();
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image,
+    image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    double distance = 0;
+    for( unsigned int i = 0; i < Dimension; ++i )
+      {
+      double d = it.GetIndex()[i] - ( size[i] - 1 ) / 2.0;
+      if( i == 0 )
+        {
+        d -= offset;
+        }
+      distance += d * d;
+      }
+    it.Set( std::exp( -distance / 18 ) );
+    }
+  return image;
+}
+
+/** Smooth initial deformation field, so that the regularization is not
+ *  zero on the first iterations, including at the image boundaries */
+DeformationFieldType::Pointer CreateInitialField( void )
+{
+  DeformationFieldType::Pointer field =
+    CreateImage< DeformationFieldType >();
+  itk::ImageRegionIteratorWithIndex< DeformationFieldType > it( field,
+    field->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    const DeformationFieldType::IndexType & index = it.GetIndex();
+    VectorType u;
+    u[0] = 0.2 * std::sin( 0.4 * index[0] + 0.3 * index[2] );
+    u[1] = 0.2 * std::cos( 0.3 * index[1] + 0.2 * index[2] );
+    u[2] = 0.2 * std::sin( 0.2 * index[0] + 0.5 * index[1] );
+    it.Set( u );
+    }
+  return field;
+}
+
+/** Stopping criterion mask excluding the first slices along x */
+ImageType::Pointer CreateStoppingCriterionMask( void )
+{
+  ImageType::Pointer mask = CreateImage< ImageType >();
+  itk::ImageRegionIteratorWithIndex< ImageType > it( mask,
+    mask->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    it.Set( it.GetIndex()[0] < 3 ? 1 : 0 );
+    }
+  return mask;
+}
+
+/** Registers the blobs for a few iterations */
+FilterType::Pointer CreateFilter( const ImageType * fixedImage,
+  const ImageType * movingImage, ImageType * mask,
+  double regularizationWeighting, bool useFusedIteration )
+{
+  std::vector< double > regularizationWeightings;
+  regularizationWeightings.push_back( regularizationWeighting );
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetFixedImage( fixedImage );
+  filter->SetMovingImage( movingImage );
+  filter->SetInitialDisplacementField( CreateInitialField() );
+  filter->SetTimeStep( 0.04 );
+  filter->SetNumberOfIterations( 5 );
+  filter->SetMaximumRMSError( 0 );
+  filter->SetRegularizationWeightings( regularizationWeightings );
+  filter->SetStoppingCriterionMask( mask );
+  filter->SetUseFusedIteration( useFusedIteration );
+  return filter;
+}
+
+bool IsClose( const char * name, double value, double expectedValue )
+{
+  const double tolerance = 1e-9 * std::max( 1.0, std::fabs( expectedValue ) );
+  if( std::fabs( value - expectedValue ) > tolerance )
+    {
+    std::cerr << name << " " << value << " instead of " << expectedValue
+              << std::endl;
+    return false;
+    }
+  return true;
+}
+
+/** Compares the output fields, energies and RMS changes of the two
+ *  filters */
+bool CompareFilters( const FilterType * fusedFilter,
+  const FilterType * filter )
+{
+  itk::ImageRegionConstIteratorWithIndex< DeformationFieldType > fusedIt(
+    fusedFilter->GetOutput(),
+    fusedFilter->GetOutput()->GetLargestPossibleRegion() );
+  itk::ImageRegionConstIteratorWithIndex< DeformationFieldType > it(
+    filter->GetOutput(), filter->GetOutput()->GetLargestPossibleRegion() );
+  for( ; !it.IsAtEnd(); ++fusedIt, ++it )
+    {
+    if( ( fusedIt.Get() - it.Get() ).GetNorm() > 1e-9 )
+      {
+      std::cerr << "At " << it.GetIndex() << ": " << fusedIt.Get()
+                << " instead of " << it.Get() << std::endl;
+      return false;
+      }
+    }
+
+  const itk::tube::EnergiesStruct & fusedEnergies =
+    fusedFilter->GetEnergies();
+  const itk::tube::EnergiesStruct & energies = filter->GetEnergies();
+  if( !( energies.IntensityDistanceEnergy > 0 )
+    || !( energies.RegularizationEnergy > 0 ) )
+    {
+    std::cerr << "Both energies should be positive: "
+              << energies.IntensityDistanceEnergy << ", "
+              << energies.RegularizationEnergy << std::endl;
+    return false;
+    }
+  return IsClose( "Total energy", fusedEnergies.TotalEnergy,
+      energies.TotalEnergy )
+    && IsClose( "Intensity distance energy",
+      fusedEnergies.IntensityDistanceEnergy,
+      energies.IntensityDistanceEnergy )
+    && IsClose( "Regularization energy",
+      fusedEnergies.RegularizationEnergy, energies.RegularizationEnergy )
+    && IsClose( "RMS change", fusedFilter->GetRMSChange(),
+      filter->GetRMSChange() );
+}
+
+} // End namespace
+
+int itktubeDiffusiveRegistrationFilterFusedIterationTest( int argc,
+  char * argv[] )
+{
+  if( argc != 1 )
+    {
+    std::cout << "Usage: " << argv[0] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Two blobs, offset by two voxels along x
+  ImageType::Pointer fixedImage = CreateBlobImage( 0 );
+  ImageType::Pointer movingImage = CreateBlobImage( 2 );
+
+  try
+    {
+    // The fused iteration must give the deformation field and energies of
+    // the separate passes, with and without a stopping criterion mask
+    for( unsigned int useMask = 0; useMask < 2; ++useMask )
+      {
+      ImageType::Pointer mask;
+      if( useMask )
+        {
+        mask = CreateStoppingCriterionMask();
+        }
+      const double regularizationWeighting = useMask ? 0.5 : 1.0;
+
+      FilterType::Pointer filter = CreateFilter( fixedImage, movingImage,
+        mask, regularizationWeighting, false );
+      filter->Update();
+      FilterType::Pointer fusedFilter = CreateFilter( fixedImage,
+        movingImage, mask, regularizationWeighting, true );
+      fusedFilter->Update();
+
+      if( !CompareFilters( fusedFilter, filter ) )
+        {
+        std::cerr << "The fused iteration differs "
+                  << ( useMask ? "with" : "without" )
+                  << " a stopping criterion mask" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+  catch( itk::ExceptionObject & err )
+    {
+    std::cerr << "Exception caught: " << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
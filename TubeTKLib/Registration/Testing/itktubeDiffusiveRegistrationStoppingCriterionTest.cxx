@@ -0,0 +1,227 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeDiffusiveRegistrationFilter.h"
+
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <cmath>
+
+namespace
+{
+
+enum { Dimension = 3 };
+
+typedef itk::Image< double, Dimension >                 ImageType;
+typedef itk::Vector< double, Dimension >                VectorType;
+typedef itk::Image< VectorType, Dimension >             DeformationFieldType;
+
+/** Diffusive registration filter whose total energy increases or
+ *  decreases by one on every iteration, so that the number of energy
+ *  violations of each run is known */
+class ScriptedEnergiesRegistrationFilter
+  : public itk::tube::DiffusiveRegistrationFilter< ImageType, ImageType,
+    DeformationFieldType >
+{
+public:
+  typedef ScriptedEnergiesRegistrationFilter              Self;
+  typedef itk::tube::DiffusiveRegistrationFilter< ImageType, ImageType,
+    DeformationFieldType >                                Superclass;
+  typedef itk::SmartPointer< Self >                       Pointer;
+  typedef itk::SmartPointer< const Self >                 ConstPointer;
+
+  itkNewMacro( Self );
+
+  itkTypeMacro( ScriptedEnergiesRegistrationFilter,
+    DiffusiveRegistrationFilter );
+
+  typedef Superclass::OutputImageType OutputImageType;
+
+  itkSetMacro( IncreasingEnergies, bool );
+  itkGetConstMacro( IncreasingEnergies, bool );
+
+protected:
+  ScriptedEnergiesRegistrationFilter( void )
+    {
+    m_IncreasingEnergies = false;
+    m_Energy = 0;
+    }
+  ~ScriptedEnergiesRegistrationFilter( void ) {}
+
+  virtual void CalculateEnergies( itk::tube::EnergiesStruct & energies,
+                                  OutputImageType * itkNotUsed( output ) )
+    {
+    if( m_IncreasingEnergies )
+      {
+      m_Energy += 1;
+      }
+    else
+      {
+      m_Energy -= 1;
+      }
+    energies.TotalEnergy = m_Energy;
+    energies.IntensityDistanceEnergy = m_Energy;
+    energies.RegularizationEnergy = 0;
+    }
+
+private:
+  // Purposely not implemented
+  ScriptedEnergiesRegistrationFilter( const Self & );
+  // Purposely not implemented
+  void operator=( const Self & );
+
+  bool   m_IncreasingEnergies;
+  double m_Energy;
+
+}; // End class ScriptedEnergiesRegistrationFilter
+
+} // End namespace
+
+int itktubeDiffusiveRegistrationStoppingCriterionTest( int argc,
+  char * argv[] )
+{
+  if( argc != 1 )
+    {
+    std::cout << "Usage: " << argv[0] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const unsigned int numberOfIterations = 30;
+
+  // Two blobs, offset by two voxels along x
+  ImageType::RegionType region;
+  ImageType::SizeType size;
+  size.Fill( 16 );
+  region.SetSize( size );
+
+  ImageType::Pointer fixedImage = ImageType::New();
+  fixedImage->SetRegions( region );
+  fixedImage->Allocate();
+  ImageType::Pointer movingImage = ImageType::New();
+  movingImage->SetRegions( region );
+  movingImage->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > fixedIt( fixedImage,
+    region );
+  itk::ImageRegionIteratorWithIndex< ImageType > movingIt( movingImage,
+    region );
+  for( fixedIt.GoToBegin(), movingIt.GoToBegin(); !fixedIt.IsAtEnd();
+    ++fixedIt, ++movingIt )
+    {
+    double fixedDistance = 0;
+    double movingDistance = 0;
+    for( unsigned int i = 0; i < Dimension; ++i )
+      {
+      double d = fixedIt.GetIndex()[i] - 7.5;
+      fixedDistance += d * d;
+      if( i == 0 )
+        {
+        d -= 2;
+        }
+      movingDistance += d * d;
+      }
+    fixedIt.Set( std::exp( -fixedDistance / 18 ) );
+    movingIt.Set( std::exp( -movingDistance / 18 ) );
+    }
+
+  ScriptedEnergiesRegistrationFilter::Pointer firstFilter =
+    ScriptedEnergiesRegistrationFilter::New();
+  ScriptedEnergiesRegistrationFilter::Pointer secondFilter =
+    ScriptedEnergiesRegistrationFilter::New();
+  ScriptedEnergiesRegistrationFilter::Pointer filters[2] =
+    { firstFilter, secondFilter };
+  for( unsigned int f = 0; f < 2; ++f )
+    {
+    filters[f]->SetFixedImage( fixedImage );
+    filters[f]->SetMovingImage( movingImage );
+    filters[f]->SetTimeStep( 0.05 );
+    filters[f]->SetNumberOfIterations( numberOfIterations );
+    filters[f]->SetMaximumRMSError( 0 );
+    }
+
+  try
+    {
+    // The energy increases on every iteration, so the first filter halts
+    // once it has seen more than ten violations
+    firstFilter->SetIncreasingEnergies( true );
+    firstFilter->Update();
+    std::cout << "Increasing energies: halted after "
+              << firstFilter->GetElapsedIterations() << " iterations"
+              << std::endl;
+    if( firstFilter->GetElapsedIterations() >= numberOfIterations )
+      {
+      std::cerr << "Increasing energies did not halt the registration"
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    // Another filter instance must not inherit those violations
+    secondFilter->SetIncreasingEnergies( false );
+    secondFilter->Update();
+    std::cout << "Second instance: " << secondFilter->GetElapsedIterations()
+              << " iterations" << std::endl;
+    if( secondFilter->GetElapsedIterations() != numberOfIterations )
+      {
+      std::cerr << "The second filter instance halted after "
+                << secondFilter->GetElapsedIterations() << " of "
+                << numberOfIterations << " iterations" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    // Nor must the next level of the first filter
+    firstFilter->SetIncreasingEnergies( false );
+    firstFilter->Update();
+    std::cout << "Second level: " << firstFilter->GetElapsedIterations()
+              << " iterations" << std::endl;
+    if( firstFilter->GetCurrentLevel() != 2 )
+      {
+      std::cerr << "Wrong level: " << firstFilter->GetCurrentLevel()
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    if( firstFilter->GetElapsedIterations() != numberOfIterations )
+      {
+      std::cerr << "The second level halted after "
+                << firstFilter->GetElapsedIterations() << " of "
+                << numberOfIterations << " iterations" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    // The total time is also counted from the start of each run and level
+    if( std::fabs( firstFilter->GetTotalTime()
+      - secondFilter->GetTotalTime() ) > 1e-6 )
+      {
+      std::cerr << "The second level ran for a total time of "
+                << firstFilter->GetTotalTime() << " instead of "
+                << secondFilter->GetTotalTime() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  catch( itk::ExceptionObject & err )
+    {
+    std::cerr << "Exception caught: " << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -27,6 +27,8 @@ limitations under the License.
 #include <itkImageFileReader.h>
 #include <itkSpatialObjectReader.h>
 
+#include <cmath>
+
 /**
  *  This test exercised the metric evaluation methods in the
  *  itktubeImageToTubeRigidMetric class. The distance between
@@ -139,5 +141,108 @@ int itktubeImageToTubeRigidMetricTest( int argc, char * argv[] )
     return EXIT_FAILURE;
     }
 
+  // The fused evaluation and the separate evaluations must agree, for any
+  // number of threads.
+  MetricType::DerivativeType derivative;
+  metric->GetDerivative( parameters, derivative );
+
+  MetricType::MeasureType fusedValue;
+  MetricType::DerivativeType fusedDerivative;
+  metric->SetNumberOfThreads( 1 );
+  metric->GetValueAndDerivative( parameters, fusedValue, fusedDerivative );
+  if( fusedValue != value )
+    {
+    std::cerr << "Fused value different than value: "
+              << fusedValue << " != " << value << std::endl;
+    return EXIT_FAILURE;
+    }
+  for( unsigned int ii = 0; ii < derivative.GetSize(); ++ii )
+    {
+    if( fusedDerivative[ii] != derivative[ii] )
+      {
+      std::cerr << "Fused derivative different than derivative: "
+                << fusedDerivative << " != " << derivative << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Evaluate the metric from a bank of precomputed derivative images
+  metric->SetUseDerivativeImageBank( true );
+  metric->SetNumberOfDerivativeImageBankScales( 3 );
+  try
+    {
+    metric->Initialize();
+    }
+  catch( itk::ExceptionObject &excp )
+    {
+    std::cerr << "Exception caught while initializing metric bank."
+              << std::endl;
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+  if( metric->GetDerivativeImageBankScales().empty() ||
+      metric->GetDerivativeImageBankScales().size() > 3 )
+    {
+    std::cerr << "Wrong number of derivative image bank scales: "
+              << metric->GetDerivativeImageBankScales().size()
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  MetricType::MeasureType bankValue;
+  MetricType::DerivativeType bankDerivative;
+  metric->GetValueAndDerivative( parameters, bankValue, bankDerivative );
+  std::cout << "Value = " << value << ", from the derivative image bank = "
+            << bankValue << std::endl;
+  std::cout << "Derivative = " << derivative
+            << ", from the derivative image bank = " << bankDerivative
+            << std::endl;
+  if( !( bankValue > 0 ) )
+    {
+    std::cerr << "Derivative image bank value is not positive: "
+              << bankValue << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The bank rounds the scale of each tube point to the nearest bank
+  // scale, uses recursive rather than truncated Gaussian derivatives and
+  // interpolates them linearly, so it approximates the sampled path
+  // within a relative tolerance rather than exactly.
+  const double bankValueTolerance = 0.1;
+  const double bankDerivativeTolerance = 0.25;
+  const double valueError = std::fabs( bankValue - value );
+  if( valueError > bankValueTolerance * std::fabs( value ) )
+    {
+    std::cerr << "Derivative image bank value different than value: "
+              << bankValue << " != " << value
+              << " (relative tolerance " << bankValueTolerance << ")"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  if( bankDerivative.GetSize() != derivative.GetSize() )
+    {
+    std::cerr << "Derivative image bank derivative has "
+              << bankDerivative.GetSize() << " parameters instead of "
+              << derivative.GetSize() << std::endl;
+    return EXIT_FAILURE;
+    }
+  double derivativeNorm = 0;
+  double derivativeError = 0;
+  for( unsigned int ii = 0; ii < derivative.GetSize(); ++ii )
+    {
+    derivativeNorm += derivative[ii] * derivative[ii];
+    derivativeError += ( bankDerivative[ii] - derivative[ii] )
+      * ( bankDerivative[ii] - derivative[ii] );
+    }
+  derivativeNorm = std::sqrt( derivativeNorm );
+  derivativeError = std::sqrt( derivativeError );
+  if( derivativeError > bankDerivativeTolerance * derivativeNorm )
+    {
+    std::cerr << "Derivative image bank derivative different than "
+              << "derivative: " << bankDerivative << " != " << derivative
+              << " (relative tolerance " << bankDerivativeTolerance << ")"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
   return EXIT_SUCCESS;
 }
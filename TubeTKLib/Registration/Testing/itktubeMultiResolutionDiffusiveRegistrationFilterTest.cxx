@@ -0,0 +1,208 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeMultiResolutionDiffusiveRegistrationFilter.h"
+
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkWarpImageFilter.h>
+
+#include <cmath>
+
+namespace
+{
+
+enum { Dimension = 3 };
+
+typedef itk::Image< float, Dimension >                  ImageType;
+typedef itk::Vector< float, Dimension >                 VectorType;
+typedef itk::Image< VectorType, Dimension >             DeformationFieldType;
+
+typedef itk::tube::MultiResolutionDiffusiveRegistrationFilter< ImageType,
+  ImageType, DeformationFieldType, float >              MultiResolutionType;
+typedef MultiResolutionType::DiffusiveRegistrationFilterType
+                                                        RegistrationType;
+
+/** Gaussian blob of the given size, centered at the image center shifted
+ *  by offset voxels along x */
+ImageType::Pointer CreateBlobImage( unsigned int size, double offset )
+{
+  ImageType::RegionType region;
+  ImageType::SizeType imageSize;
+  imageSize.Fill( size );
+  region.SetSize( imageSize );
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+
+  const double center = ( size - 1 ) / 2.0;
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, region );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    double distance = 0;
+    for( unsigned int i = 0; i < Dimension; ++i )
+      {
+      double d = it.GetIndex()[i] - center;
+      if( i == 0 )
+        {
+        d -= offset;
+        }
+      distance += d * d;
+      }
+    it.Set( std::exp( -distance / 18 ) );
+    }
+  return image;
+}
+
+/** Mean squared difference between the fixed image and the moving image
+ *  warped by the deformation field */
+double ComputeMeanSquaredDifference( const ImageType * fixedImage,
+  const ImageType * movingImage, const DeformationFieldType * field )
+{
+  typedef itk::WarpImageFilter< ImageType, ImageType, DeformationFieldType >
+    WarperType;
+  WarperType::Pointer warper = WarperType::New();
+  warper->SetInput( movingImage );
+  warper->SetDisplacementField( field );
+  warper->SetOutputParametersFromImage( fixedImage );
+  warper->Update();
+
+  itk::ImageRegionConstIterator< ImageType > fixedIt( fixedImage,
+    fixedImage->GetLargestPossibleRegion() );
+  itk::ImageRegionConstIterator< ImageType > warpedIt( warper->GetOutput(),
+    fixedImage->GetLargestPossibleRegion() );
+  double sum = 0;
+  for( ; !fixedIt.IsAtEnd(); ++fixedIt, ++warpedIt )
+    {
+    double d = fixedIt.Get() - warpedIt.Get();
+    sum += d * d;
+    }
+  return sum / fixedImage->GetLargestPossibleRegion().GetNumberOfPixels();
+}
+
+/** Registers the two images on two levels, and checks that the output
+ *  and the high resolution template match the fixed image, and that the
+ *  registration reduced the mean squared difference */
+bool RunTwoLevels( MultiResolutionType * multires,
+  RegistrationType * registrator, const ImageType * fixedImage,
+  const ImageType * movingImage )
+{
+  unsigned int iterations[2] = { 20, 20 };
+  multires->SetFixedImage( fixedImage );
+  multires->SetMovingImage( movingImage );
+  multires->SetNumberOfLevels( 2 );
+  multires->SetNumberOfIterations( iterations );
+  multires->Update();
+
+  const DeformationFieldType * field = multires->GetOutput();
+  if( field->GetLargestPossibleRegion()
+    != fixedImage->GetLargestPossibleRegion() )
+    {
+    std::cerr << "Deformation field region "
+              << field->GetLargestPossibleRegion()
+              << " instead of " << fixedImage->GetLargestPossibleRegion()
+              << std::endl;
+    return false;
+    }
+
+  if( !registrator->GetHighResolutionTemplate()
+    || registrator->GetHighResolutionTemplate()->GetLargestPossibleRegion()
+    != fixedImage->GetLargestPossibleRegion()
+    || registrator->GetHighResolutionTemplate()->GetSpacing()
+    != fixedImage->GetSpacing() )
+    {
+    std::cerr << "The high resolution template does not match the fixed"
+              << " image" << std::endl;
+    return false;
+    }
+
+  DeformationFieldType::Pointer zeroField = DeformationFieldType::New();
+  zeroField->CopyInformation( fixedImage );
+  zeroField->SetRegions( fixedImage->GetLargestPossibleRegion() );
+  zeroField->Allocate();
+  VectorType zero;
+  zero.Fill( 0 );
+  zeroField->FillBuffer( zero );
+
+  double initialDifference = ComputeMeanSquaredDifference( fixedImage,
+    movingImage, zeroField );
+  double finalDifference = ComputeMeanSquaredDifference( fixedImage,
+    movingImage, field );
+  std::cout << "Mean squared difference: " << initialDifference << " -> "
+            << finalDifference << std::endl;
+  if( !( finalDifference < 0.5 * initialDifference ) )
+    {
+    std::cerr << "The registration did not halve the mean squared"
+              << " difference" << std::endl;
+    return false;
+    }
+
+  return true;
+}
+
+} // End namespace
+
+int itktubeMultiResolutionDiffusiveRegistrationFilterTest( int argc,
+  char * argv[] )
+{
+  if( argc != 1 )
+    {
+    std::cout << "Usage: " << argv[0] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  RegistrationType::Pointer registrator = RegistrationType::New();
+  registrator->SetTimeStep( 0.05 );
+  registrator->SetMaximumRMSError( 0 );
+
+  MultiResolutionType::Pointer multires = MultiResolutionType::New();
+  multires->SetRegistrationFilter( registrator );
+
+  try
+    {
+    // Two blobs, offset by two voxels along x
+    ImageType::Pointer fixedImage = CreateBlobImage( 16, 0 );
+    ImageType::Pointer movingImage = CreateBlobImage( 16, 2 );
+    if( !RunTwoLevels( multires, registrator, fixedImage, movingImage ) )
+      {
+      return EXIT_FAILURE;
+      }
+
+    // A new pair of a different size must replace the template of the
+    // first pair
+    fixedImage = CreateBlobImage( 20, 0 );
+    movingImage = CreateBlobImage( 20, 2 );
+    if( !RunTwoLevels( multires, registrator, fixedImage, movingImage ) )
+      {
+      return EXIT_FAILURE;
+      }
+    }
+  catch( itk::ExceptionObject & err )
+    {
+    std::cerr << "Exception caught: " << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
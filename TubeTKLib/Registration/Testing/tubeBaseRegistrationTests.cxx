@@ -33,11 +33,17 @@ void RegisterTests( void )
 #ifdef TubeTK_USE_VTK
   REGISTER_TEST( itkAnisotropicDiffusiveRegistrationGenerateTestingImages );
   REGISTER_TEST( itkAnisotropicDiffusiveRegistrationRegularizationTest );
+  REGISTER_TEST( itktubeAnisotropicDiffusiveSparseRegistrationNarrowBandTest );
 #endif
+  REGISTER_TEST( itktubeAnisotropicDiffusiveRegistrationBorderPointSetTest );
+  REGISTER_TEST( itkImageToImageRegistrationSampleSetTest );
+  REGISTER_TEST( itktubeDiffusiveRegistrationFilterFusedIterationTest );
+  REGISTER_TEST( itktubeDiffusiveRegistrationStoppingCriterionTest );
   REGISTER_TEST( itktubeImageToTubeRigidMetricPerformanceTest );
   REGISTER_TEST( itktubeImageToTubeRigidMetricTest );
   REGISTER_TEST( itktubeImageToTubeRigidRegistrationPerformanceTest );
   REGISTER_TEST( itktubeImageToTubeRigidRegistrationTest );
+  REGISTER_TEST( itktubeMultiResolutionDiffusiveRegistrationFilterTest );
   REGISTER_TEST( itktubePointsToImageTest );
   REGISTER_TEST( itktubeSyntheticTubeImageGenerationTest );
   REGISTER_TEST( itktubeTubeAngleOfIncidenceWeightFunctionTest );
@@ -626,6 +626,7 @@ BSplineImageToImageRegistrationMethod<TImage>
       this->GetFixedImageSamplesIntensityThreshold() );
     reg->SetUseFixedImageSamplesIntensityThreshold(
       this->GetUseFixedImageSamplesIntensityThreshold() );
+    reg->SetFixedImageSampleSet( this->GetFixedImageSampleSet() );
     reg->SetMaxIterations( (unsigned int)(this->GetMaxIterations()
       * levelFactor) );
     reg->SetMetricMethodEnum( this->GetMetricMethodEnum() );
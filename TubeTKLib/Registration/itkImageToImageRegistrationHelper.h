@@ -97,6 +97,12 @@ public:
   typedef typename OptimizedRegistrationMethodType::InterpolationMethodEnumType
   InterpolationMethodEnumType;
 
+  typedef typename OptimizedRegistrationMethodType::FixedImageSampleSetType
+  FixedImageSampleSetType;
+
+  typedef typename FixedImageSampleSetType::SamplingStrategyEnumType
+  SamplingStrategyEnumType;
+
   enum InitialMethodEnumType { INIT_WITH_NONE,
                                INIT_WITH_CURRENT_RESULTS,
                                INIT_WITH_IMAGE_CENTERS,
@@ -206,6 +212,20 @@ public:
   itkSetMacro( SampleIntensityPortion, double );
   itkGetConstMacro( SampleIntensityPortion, double );
 
+  // **************
+  //  Select the fixed image samples once, and share them between the
+  //  rigid, affine and BSpline registrations
+  // **************
+  itkSetMacro( UseFixedImageSampleSet, bool );
+  itkGetConstMacro( UseFixedImageSampleSet, bool );
+  itkBooleanMacro( UseFixedImageSampleSet );
+
+  itkSetMacro( FixedImageSamplingStrategyEnum, SamplingStrategyEnumType );
+  itkGetConstMacro( FixedImageSamplingStrategyEnum,
+    SamplingStrategyEnumType );
+
+  itkGetConstObjectMacro( FixedImageSampleSet, FixedImageSampleSetType );
+
   // **************
   // **************
   //  Update
@@ -472,6 +492,8 @@ private:
 
   void AffineRegND( Image< double, 3 > * t );
 
+  void UpdateFixedImageSampleSet( void );
+
   typedef typename InitialRegistrationMethodType::LandmarkPointType
   LandmarkPointType;
   typedef typename InitialRegistrationMethodType::LandmarkPointContainer
@@ -489,6 +511,10 @@ private:
   bool   m_SampleFromOverlap;
   double m_SampleIntensityPortion;
 
+  bool                                      m_UseFixedImageSampleSet;
+  SamplingStrategyEnumType                  m_FixedImageSamplingStrategyEnum;
+  typename FixedImageSampleSetType::Pointer m_FixedImageSampleSet;
+
   bool                                  m_UseFixedImageMaskObject;
   typename MaskObjectType::ConstPointer m_FixedImageMaskObject;
 
@@ -50,6 +50,10 @@ ImageToImageRegistrationHelper<TImage>
   m_SampleFromOverlap = false;
   m_SampleIntensityPortion = 0.0;
 
+  m_UseFixedImageSampleSet = false;
+  m_FixedImageSamplingStrategyEnum = FixedImageSampleSetType::REGULAR_SAMPLING;
+  m_FixedImageSampleSet = NULL;
+
   // Masks
   m_UseFixedImageMaskObject = false;
   m_FixedImageMaskObject = NULL;
@@ -327,6 +331,10 @@ ImageToImageRegistrationHelper<TImage>
     }
   regAff->SetSampleFromOverlap( m_SampleFromOverlap );
   regAff->SetMinimizeMemory( m_MinimizeMemory );
+  if( m_UseFixedImageSampleSet )
+    {
+    regAff->SetFixedImageSampleSet( m_FixedImageSampleSet );
+    }
   regAff->SetMaxIterations( m_AffineMaxIterations );
   regAff->SetTargetError( m_AffineTargetError );
   if( m_EnableRigidRegistration || !m_UseEvolutionaryOptimization )
@@ -430,6 +438,10 @@ ImageToImageRegistrationHelper<TImage>
     }
   regAff->SetSampleFromOverlap( m_SampleFromOverlap );
   regAff->SetMinimizeMemory( m_MinimizeMemory );
+  if( m_UseFixedImageSampleSet )
+    {
+    regAff->SetFixedImageSampleSet( m_FixedImageSampleSet );
+    }
   regAff->SetMaxIterations( m_AffineMaxIterations );
   regAff->SetTargetError( m_AffineTargetError );
   if( m_EnableRigidRegistration || !m_UseEvolutionaryOptimization )
@@ -514,6 +526,77 @@ ImageToImageRegistrationHelper<TImage>
   m_CompletedResampling = false;
 }
 
+/** Select the fixed image samples shared by the registration stages */
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::UpdateFixedImageSampleSet( void )
+{
+  unsigned long fixedImageNumPixels = m_FixedImage->GetLargestPossibleRegion()
+    .GetNumberOfPixels();
+
+  // The set holds as many samples as the most demanding stage
+  double samplingRatio = 0;
+  if( m_EnableRigidRegistration )
+    {
+    samplingRatio = m_RigidSamplingRatio;
+    }
+  if( m_EnableAffineRegistration && m_AffineSamplingRatio > samplingRatio )
+    {
+    samplingRatio = m_AffineSamplingRatio;
+    }
+  if( m_EnableBSplineRegistration && m_BSplineSamplingRatio > samplingRatio )
+    {
+    samplingRatio = m_BSplineSamplingRatio;
+    }
+
+  if( m_FixedImageSampleSet.IsNull() )
+    {
+    m_FixedImageSampleSet = FixedImageSampleSetType::New();
+    }
+  // The set is only selected again if one of these settings changed
+  m_FixedImageSampleSet->SetReportProgress( m_ReportProgress );
+  m_FixedImageSampleSet->SetFixedImage( m_FixedImage );
+  m_FixedImageSampleSet->SetNumberOfSamples( (unsigned int)( samplingRatio
+    * fixedImageNumPixels ) );
+  m_FixedImageSampleSet->SetSamplingStrategyEnum(
+    m_FixedImageSamplingStrategyEnum );
+  m_FixedImageSampleSet->SetRandomNumberSeed( m_RandomNumberSeed );
+  if( m_UseFixedImageMaskObject && m_FixedImageMaskObject.IsNotNull() )
+    {
+    m_FixedImageSampleSet->SetFixedImageMaskObject( m_FixedImageMaskObject );
+    }
+  else
+    {
+    m_FixedImageSampleSet->SetFixedImageMaskObject( NULL );
+    }
+  m_FixedImageSampleSet->SetUseRegionOfInterest( m_UseRegionOfInterest );
+  m_FixedImageSampleSet->SetRegionOfInterestPoint1(
+    m_RegionOfInterestPoint1 );
+  m_FixedImageSampleSet->SetRegionOfInterestPoint2(
+    m_RegionOfInterestPoint2 );
+  if( m_SampleIntensityPortion > 0 )
+    {
+    typedef MinimumMaximumImageCalculator<ImageType> MinMaxCalcType;
+    typename MinMaxCalcType::Pointer calc = MinMaxCalcType::New();
+    calc->SetImage( m_FixedImage );
+    calc->Compute();
+    PixelType fixedImageMax = calc->GetMaximum();
+    PixelType fixedImageMin = calc->GetMinimum();
+
+    m_FixedImageSampleSet->SetFixedImageSamplesIntensityThreshold(
+      static_cast<PixelType>( ( m_SampleIntensityPortion
+        * (fixedImageMax - fixedImageMin) ) + fixedImageMin ) );
+    }
+  else
+    {
+    m_FixedImageSampleSet->SetUseFixedImageSamplesIntensityThreshold(
+      false );
+    }
+
+  m_FixedImageSampleSet->Update();
+}
+
 /** This class provides an Update() method to fit the appearance of a
  * ProcessObject API, but it is not a ProcessObject.  */
 template <class TImage>
@@ -645,6 +728,12 @@ ImageToImageRegistrationHelper<TImage>
   unsigned long fixedImageNumPixels = m_FixedImage->GetLargestPossibleRegion()
     .GetNumberOfPixels();
 
+  if( m_UseFixedImageSampleSet && ( m_EnableRigidRegistration
+      || m_EnableAffineRegistration || m_EnableBSplineRegistration ) )
+    {
+    this->UpdateFixedImageSampleSet();
+    }
+
   if( m_EnableRigidRegistration )
     {
     if( this->GetReportProgress() )
@@ -666,6 +755,10 @@ ImageToImageRegistrationHelper<TImage>
                                                   * fixedImageNumPixels ) );
     regRigid->SetSampleFromOverlap( m_SampleFromOverlap );
     regRigid->SetMinimizeMemory( m_MinimizeMemory );
+    if( m_UseFixedImageSampleSet )
+      {
+      regRigid->SetFixedImageSampleSet( m_FixedImageSampleSet );
+      }
     regRigid->SetMaxIterations( m_RigidMaxIterations );
     regRigid->SetTargetError( m_RigidTargetError );
     if( m_UseFixedImageMaskObject )
@@ -805,6 +898,10 @@ ImageToImageRegistrationHelper<TImage>
       }
     regBspline->SetSampleFromOverlap( m_SampleFromOverlap );
     regBspline->SetMinimizeMemory( m_MinimizeMemory );
+    if( m_UseFixedImageSampleSet )
+      {
+      regBspline->SetFixedImageSampleSet( m_FixedImageSampleSet );
+      }
     regBspline->SetMaxIterations( m_BSplineMaxIterations );
     regBspline->SetExpectedDeformationMagnitude( m_ExpectedDeformationMagnitude );
     regBspline->SetTargetError( m_BSplineTargetError );
@@ -1603,6 +1700,24 @@ ImageToImageRegistrationHelper<TImage>
   os << indent << "Random Number Seed = " << m_RandomNumberSeed
     << std::endl;
   os << indent << std::endl;
+  os << indent << "Use Fixed Image Sample Set = "
+    << m_UseFixedImageSampleSet << std::endl;
+  switch( m_FixedImageSamplingStrategyEnum )
+    {
+    case FixedImageSampleSetType::REGULAR_SAMPLING:
+      os << indent << "Fixed Image Sampling Strategy = Regular"
+        << std::endl;
+      break;
+    case FixedImageSampleSetType::STRATIFIED_SAMPLING:
+      os << indent << "Fixed Image Sampling Strategy = Stratified"
+        << std::endl;
+      break;
+    case FixedImageSampleSetType::EDGE_WEIGHTED_SAMPLING:
+      os << indent << "Fixed Image Sampling Strategy = Edge weighted"
+        << std::endl;
+      break;
+    }
+  os << indent << std::endl;
   os << indent << "Enable Loaded Registration = "
     << m_EnableLoadedRegistration << std::endl;
   os << indent << "Enable Initial Registration = "
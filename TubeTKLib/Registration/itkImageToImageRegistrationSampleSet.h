@@ -0,0 +1,219 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    $RCSfile: ITKHeader.h,v $
+  Language:  C++
+  Date:      $Date: 2007-07-10 11:35:36 -0400 ( Tue, 10 Jul 2007 ) $
+  Version:   $Revision: 0 $
+
+  Copyright ( c ) 2002 Insight Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __itkImageToImageRegistrationSampleSet_h
+#define __itkImageToImageRegistrationSampleSet_h
+
+#include "itkImage.h"
+#include "itkSpatialObject.h"
+#include "itkCentralDifferenceImageFunction.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class ImageToImageRegistrationSampleSet
+ * \brief Fixed image samples shared by the stages of a registration.
+ *
+ * The fixed image is scanned once to select the voxels that pass the
+ * fixed image mask, the region of interest and the intensity threshold,
+ * and the point, value and gradient of the selected voxels are cached.
+ * The rigid, affine and BSpline stages, and the levels of the BSpline
+ * stage, then draw their metric samples from this set instead of
+ * rescanning the fixed image.
+ *
+ * The set holds NumberOfSamples samples, which should be the largest
+ * number requested by any stage.  Regular sampling selects evenly spaced
+ * voxels, and smaller requests take evenly spaced samples of the set.
+ * Stratified sampling selects one random voxel per cell of a regular
+ * grid, and edge weighted sampling selects voxels with a probability
+ * that increases with their gradient magnitude.  Both are stored in
+ * random order, so that smaller requests take the first samples of the
+ * set.
+ */
+template <class TImage>
+class ImageToImageRegistrationSampleSet
+  : public Object
+{
+
+public:
+
+  typedef ImageToImageRegistrationSampleSet Self;
+  typedef Object                            Superclass;
+  typedef SmartPointer<Self>                Pointer;
+  typedef SmartPointer<const Self>          ConstPointer;
+
+  itkTypeMacro( ImageToImageRegistrationSampleSet, Object );
+
+  itkNewMacro( Self );
+
+  //
+  // Custom Typedefs
+  //
+  itkStaticConstMacro( ImageDimension, unsigned int,
+                       TImage::ImageDimension );
+
+  typedef TImage ImageType;
+
+  typedef typename ImageType::PixelType PixelType;
+  typedef typename ImageType::IndexType IndexType;
+  typedef typename ImageType::PointType PointType;
+
+  typedef CentralDifferenceImageFunction<ImageType, double>
+  GradientFunctionType;
+
+  typedef typename GradientFunctionType::OutputType GradientType;
+
+  typedef SpatialObject<itkGetStaticConstMacro( ImageDimension )>
+  MaskObjectType;
+
+  typedef std::vector<IndexType> IndexContainerType;
+
+  enum SamplingStrategyEnumType { REGULAR_SAMPLING,
+                                  STRATIFIED_SAMPLING,
+                                  EDGE_WEIGHTED_SAMPLING };
+
+  /** A fixed image sample */
+  struct SampleType
+    {
+    IndexType    Index;
+    PointType    Point;
+    PixelType    Value;
+    GradientType Gradient;
+    };
+
+  typedef std::vector<SampleType> SampleContainerType;
+
+  //
+  // Custom Methods
+  //
+  itkSetConstObjectMacro( FixedImage, ImageType );
+  itkGetConstObjectMacro( FixedImage, ImageType );
+
+  void SetRegionOfInterest( const PointType & point1,
+    const PointType & point2 );
+
+  itkSetMacro( UseRegionOfInterest, bool );
+  itkGetMacro( UseRegionOfInterest, bool );
+  itkSetMacro( RegionOfInterestPoint1, PointType );
+  itkGetMacro( RegionOfInterestPoint1, PointType );
+  itkSetMacro( RegionOfInterestPoint2, PointType );
+  itkGetMacro( RegionOfInterestPoint2, PointType );
+
+  void SetFixedImageMaskObject( const MaskObjectType * maskObject );
+
+  itkGetConstObjectMacro( FixedImageMaskObject, MaskObjectType );
+
+  itkSetMacro( UseFixedImageMaskObject, bool );
+  itkGetMacro( UseFixedImageMaskObject, bool );
+
+  itkSetMacro( UseFixedImageSamplesIntensityThreshold, bool );
+  itkGetConstMacro( UseFixedImageSamplesIntensityThreshold, bool );
+  void SetFixedImageSamplesIntensityThreshold( PixelType val );
+
+  itkGetConstMacro( FixedImageSamplesIntensityThreshold, PixelType );
+
+  /** Maximum number of samples requested by the registration stages */
+  itkSetMacro( NumberOfSamples, unsigned int );
+  itkGetConstMacro( NumberOfSamples, unsigned int );
+
+  itkSetMacro( SamplingStrategyEnum, SamplingStrategyEnumType );
+  itkGetConstMacro( SamplingStrategyEnum, SamplingStrategyEnumType );
+
+  itkSetMacro( RandomNumberSeed, int );
+  itkGetConstMacro( RandomNumberSeed, int );
+
+  itkSetMacro( ReportProgress, bool );
+  itkGetMacro( ReportProgress, bool );
+  itkBooleanMacro( ReportProgress );
+
+  /** Select the samples, unless the set is up to date */
+  void Update( void );
+
+  const SampleContainerType & GetSamples( void ) const
+    { return m_Samples; }
+
+  /** Number of fixed image voxels that pass the mask, the region of
+   *  interest and the intensity threshold */
+  itkGetConstMacro( NumberOfValidPixels, SizeValueType );
+
+  /** Returns the indexes, in the given image, of numberOfSamples samples
+   *  of the set.  The image can be the fixed image or a resampled version
+   *  of it, such as a level of a multi-resolution pyramid. */
+  void GetFixedImageIndexes( const ImageType * image,
+    unsigned int numberOfSamples, IndexContainerType & indexes ) const;
+
+  ModifiedTimeType GetMTime( void ) const;
+
+protected:
+
+  ImageToImageRegistrationSampleSet( void );
+  virtual ~ImageToImageRegistrationSampleSet( void );
+
+  /** Whether a fixed image voxel may be sampled */
+  bool IsValidPixel( const IndexType & index, PixelType value ) const;
+
+  void SelectRegularSamples( IndexContainerType & indexes );
+
+  void SelectStratifiedSamples( IndexContainerType & indexes );
+
+  void SelectEdgeWeightedSamples( const GradientFunctionType * gradient,
+    IndexContainerType & indexes );
+
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
+private:
+
+  // Purposely not implemented
+  ImageToImageRegistrationSampleSet( const Self & );
+  // Purposely not implemented
+  void operator =( const Self & );
+
+  typename ImageType::ConstPointer       m_FixedImage;
+
+  bool      m_UseRegionOfInterest;
+  PointType m_RegionOfInterestPoint1;
+  PointType m_RegionOfInterestPoint2;
+
+  bool                                   m_UseFixedImageMaskObject;
+  typename MaskObjectType::ConstPointer  m_FixedImageMaskObject;
+
+  bool      m_UseFixedImageSamplesIntensityThreshold;
+  PixelType m_FixedImageSamplesIntensityThreshold;
+
+  unsigned int m_NumberOfSamples;
+
+  SamplingStrategyEnumType m_SamplingStrategyEnum;
+
+  int m_RandomNumberSeed;
+
+  bool m_ReportProgress;
+
+  SizeValueType       m_NumberOfValidPixels;
+  SampleContainerType m_Samples;
+  TimeStamp           m_SamplesTime;
+
+};
+
+}
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkImageToImageRegistrationSampleSet.txx"
+#endif
+
+#endif
@@ -0,0 +1,603 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    $RCSfile: MomentRegistrator.txx,v $
+  Language:  C++
+  Date:      $Date: 2007/03/29 17:52:55 $
+  Version:   $Revision: 1.6 $
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __ImageToImageRegistrationSampleSet_txx
+#define __ImageToImageRegistrationSampleSet_txx
+
+#include "itkImageToImageRegistrationSampleSet.h"
+
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <cmath>
+#include <functional>
+#include <map>
+#include <queue>
+#include <set>
+
+namespace itk
+{
+
+template <class TImage>
+ImageToImageRegistrationSampleSet<TImage>
+::ImageToImageRegistrationSampleSet( void )
+{
+  m_FixedImage = 0;
+
+  m_UseRegionOfInterest = false;
+  m_RegionOfInterestPoint1.Fill(0);
+  m_RegionOfInterestPoint2.Fill(0);
+
+  m_UseFixedImageMaskObject = false;
+  m_FixedImageMaskObject = 0;
+
+  m_UseFixedImageSamplesIntensityThreshold = false;
+  m_FixedImageSamplesIntensityThreshold = 0;
+
+  m_NumberOfSamples = 100000;
+
+  m_SamplingStrategyEnum = REGULAR_SAMPLING;
+
+  m_RandomNumberSeed = 0;
+
+  m_ReportProgress = false;
+
+  m_NumberOfValidPixels = 0;
+}
+
+template <class TImage>
+ImageToImageRegistrationSampleSet<TImage>
+::~ImageToImageRegistrationSampleSet( void )
+{
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationSampleSet<TImage>
+::SetRegionOfInterest( const PointType & point1, const PointType & point2 )
+{
+  m_RegionOfInterestPoint1 = point1;
+  m_RegionOfInterestPoint2 = point2;
+  m_UseRegionOfInterest = true;
+  this->Modified();
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationSampleSet<TImage>
+::SetFixedImageMaskObject( const MaskObjectType * maskObject )
+{
+  if( this->m_FixedImageMaskObject.GetPointer() != maskObject )
+    {
+    this->m_FixedImageMaskObject = maskObject;
+
+    this->Modified();
+
+    if( maskObject )
+      {
+      m_UseFixedImageMaskObject = true;
+      }
+    else
+      {
+      m_UseFixedImageMaskObject = false;
+      }
+    }
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationSampleSet<TImage>
+::SetFixedImageSamplesIntensityThreshold( PixelType val )
+{
+  if( !m_UseFixedImageSamplesIntensityThreshold
+    || m_FixedImageSamplesIntensityThreshold != val )
+    {
+    m_FixedImageSamplesIntensityThreshold = val;
+    m_UseFixedImageSamplesIntensityThreshold = true;
+    this->Modified();
+    }
+}
+
+template <class TImage>
+ModifiedTimeType
+ImageToImageRegistrationSampleSet<TImage>
+::GetMTime( void ) const
+{
+  ModifiedTimeType mtime = Superclass::GetMTime();
+  ModifiedTimeType m;
+
+  if( m_FixedImage.IsNotNull() )
+    {
+    m = m_FixedImage->GetMTime();
+    mtime = (m > mtime ? m : mtime);
+    }
+
+  if( m_FixedImageMaskObject.IsNotNull() )
+    {
+    m = m_FixedImageMaskObject->GetMTime();
+    mtime = (m > mtime ? m : mtime);
+    }
+
+  return mtime;
+}
+
+template <class TImage>
+bool
+ImageToImageRegistrationSampleSet<TImage>
+::IsValidPixel( const IndexType & index, PixelType value ) const
+{
+  if( m_UseFixedImageSamplesIntensityThreshold )
+    {
+    if( value < m_FixedImageSamplesIntensityThreshold )
+      {
+      return false;
+      }
+    }
+
+  if( !( m_UseFixedImageMaskObject && m_FixedImageMaskObject.IsNotNull() )
+    && !m_UseRegionOfInterest )
+    {
+    return true;
+    }
+
+  PointType point;
+  m_FixedImage->TransformIndexToPhysicalPoint( index, point );
+  if( m_UseFixedImageMaskObject && m_FixedImageMaskObject.IsNotNull() )
+    {
+    double val;
+    if( m_FixedImageMaskObject->ValueAt( point, val ) )
+      {
+      if( val == 0 )
+        {
+        return false;
+        }
+      }
+    }
+  if( m_UseRegionOfInterest )
+    {
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      if( !( (point[i] >= m_RegionOfInterestPoint1[i] &&
+              point[i] <= m_RegionOfInterestPoint2[i])
+             || (point[i] >= m_RegionOfInterestPoint2[i] &&
+                 point[i] <= m_RegionOfInterestPoint1[i]) ) )
+        {
+        return false;
+        }
+      }
+    }
+
+  return true;
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationSampleSet<TImage>
+::Update( void )
+{
+  if( m_FixedImage.IsNull() )
+    {
+    itkExceptionMacro( << "Fixed image not set." );
+    }
+
+  if( m_SamplesTime.GetMTime() > this->GetMTime() )
+    {
+    return;
+    }
+
+  if( this->GetReportProgress() )
+    {
+    std::cout << "Creating shared fixed image samples" << std::endl;
+    }
+
+  typename GradientFunctionType::Pointer gradient =
+    GradientFunctionType::New();
+  gradient->SetInputImage( m_FixedImage );
+
+  IndexContainerType indexes;
+  switch( m_SamplingStrategyEnum )
+    {
+    case REGULAR_SAMPLING:
+    default:
+      this->SelectRegularSamples( indexes );
+      break;
+    case STRATIFIED_SAMPLING:
+      this->SelectStratifiedSamples( indexes );
+      break;
+    case EDGE_WEIGHTED_SAMPLING:
+      this->SelectEdgeWeightedSamples( gradient, indexes );
+      break;
+    }
+
+  if( indexes.size() < m_NumberOfSamples )
+    {
+    itkWarningMacro( << "Full set of samples not collected. Collected "
+                     << indexes.size() << " of " << m_NumberOfSamples );
+    }
+
+  m_Samples.resize( indexes.size() );
+  for( unsigned int i = 0; i < indexes.size(); i++ )
+    {
+    SampleType & sample = m_Samples[i];
+    sample.Index = indexes[i];
+    m_FixedImage->TransformIndexToPhysicalPoint( sample.Index,
+      sample.Point );
+    sample.Value = m_FixedImage->GetPixel( sample.Index );
+    sample.Gradient = gradient->EvaluateAtIndex( sample.Index );
+    }
+
+  if( this->GetReportProgress() )
+    {
+    std::cout << "  Valid pixels = " << m_NumberOfValidPixels << std::endl;
+    std::cout << "  Number of samples = " << m_Samples.size() << std::endl;
+    }
+
+  m_SamplesTime.Modified();
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationSampleSet<TImage>
+::SelectRegularSamples( IndexContainerType & indexes )
+{
+  ImageRegionConstIteratorWithIndex<ImageType> iter( m_FixedImage,
+    m_FixedImage->GetLargestPossibleRegion() );
+
+  SizeValueType count = 0;
+  for( iter.GoToBegin(); !iter.IsAtEnd(); ++iter )
+    {
+    if( this->IsValidPixel( iter.GetIndex(), iter.Get() ) )
+      {
+      ++count;
+      }
+    }
+  m_NumberOfValidPixels = count;
+
+  indexes.clear();
+  if( count == 0 || m_NumberOfSamples == 0 )
+    {
+    return;
+    }
+
+  double samplingRate = (double)m_NumberOfSamples / (double)count;
+  if( samplingRate > 1 )
+    {
+    samplingRate = 1;
+    }
+  double step = 0;
+  for( iter.GoToBegin(); !iter.IsAtEnd(); ++iter )
+    {
+    if( !this->IsValidPixel( iter.GetIndex(), iter.Get() ) )
+      {
+      continue;
+      }
+    step += samplingRate;
+    if( step >= 1 )
+      {
+      step -= 1;
+      indexes.push_back( iter.GetIndex() );
+      if( indexes.size() == m_NumberOfSamples )
+        {
+        break;
+        }
+      }
+    }
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationSampleSet<TImage>
+::SelectStratifiedSamples( IndexContainerType & indexes )
+{
+  typedef Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+  typename GeneratorType::Pointer generator = GeneratorType::New();
+  if( m_RandomNumberSeed != 0 )
+    {
+    generator->Initialize( m_RandomNumberSeed );
+    }
+  else
+    {
+    generator->Initialize();
+    }
+
+  const typename ImageType::RegionType & region =
+    m_FixedImage->GetLargestPossibleRegion();
+  ImageRegionConstIteratorWithIndex<ImageType> iter( m_FixedImage, region );
+
+  SizeValueType count = 0;
+  for( iter.GoToBegin(); !iter.IsAtEnd(); ++iter )
+    {
+    if( this->IsValidPixel( iter.GetIndex(), iter.Get() ) )
+      {
+      ++count;
+      }
+    }
+  m_NumberOfValidPixels = count;
+
+  indexes.clear();
+  if( count == 0 || m_NumberOfSamples == 0 )
+    {
+    return;
+    }
+
+  // Cubic cells that hold count / m_NumberOfSamples valid pixels on
+  //   average
+  SizeValueType cellSize = 1;
+  if( count > m_NumberOfSamples )
+    {
+    cellSize = static_cast< SizeValueType >( std::pow(
+      (double)count / (double)m_NumberOfSamples, 1.0 / ImageDimension ) );
+    if( cellSize < 1 )
+      {
+      cellSize = 1;
+      }
+    }
+  SizeValueType cellStride[ImageDimension];
+  cellStride[0] = 1;
+  for( unsigned int i = 1; i < ImageDimension; i++ )
+    {
+    cellStride[i] = cellStride[i - 1]
+      * ( ( region.GetSize( i - 1 ) + cellSize - 1 ) / cellSize );
+    }
+
+  // Select one pixel per cell by reservoir sampling
+  struct CellType
+    {
+    SizeValueType NumberOfPixels;
+    IndexType     Index;
+    };
+  typedef std::map< SizeValueType, CellType > CellMapType;
+  CellMapType cells;
+  for( iter.GoToBegin(); !iter.IsAtEnd(); ++iter )
+    {
+    const IndexType & index = iter.GetIndex();
+    if( !this->IsValidPixel( index, iter.Get() ) )
+      {
+      continue;
+      }
+    SizeValueType cellId = 0;
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      cellId += ( ( index[i] - region.GetIndex( i ) ) / cellSize )
+        * cellStride[i];
+      }
+    CellType & cell = cells[cellId];
+    if( ++cell.NumberOfPixels == 1
+      || generator->GetIntegerVariate( cell.NumberOfPixels - 1 ) == 0 )
+      {
+      cell.Index = index;
+      }
+    }
+
+  indexes.reserve( cells.size() );
+  typename CellMapType::const_iterator cellIter = cells.begin();
+  while( cellIter != cells.end() )
+    {
+    indexes.push_back( cellIter->second.Index );
+    ++cellIter;
+    }
+
+  // Shuffle, so that the first samples are spread over the image
+  for( SizeValueType i = indexes.size(); i > 1; i-- )
+    {
+    SizeValueType j = generator->GetIntegerVariate( i - 1 );
+    std::swap( indexes[i - 1], indexes[j] );
+    }
+  if( indexes.size() > m_NumberOfSamples )
+    {
+    indexes.resize( m_NumberOfSamples );
+    }
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationSampleSet<TImage>
+::SelectEdgeWeightedSamples( const GradientFunctionType * gradient,
+  IndexContainerType & indexes )
+{
+  typedef Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+  typename GeneratorType::Pointer generator = GeneratorType::New();
+  if( m_RandomNumberSeed != 0 )
+    {
+    generator->Initialize( m_RandomNumberSeed );
+    }
+  else
+    {
+    generator->Initialize();
+    }
+
+  ImageRegionConstIteratorWithIndex<ImageType> iter( m_FixedImage,
+    m_FixedImage->GetLargestPossibleRegion() );
+
+  SizeValueType count = 0;
+  double sumGradientMagnitude = 0;
+  for( iter.GoToBegin(); !iter.IsAtEnd(); ++iter )
+    {
+    if( this->IsValidPixel( iter.GetIndex(), iter.Get() ) )
+      {
+      ++count;
+      sumGradientMagnitude +=
+        gradient->EvaluateAtIndex( iter.GetIndex() ).GetNorm();
+      }
+    }
+  m_NumberOfValidPixels = count;
+
+  indexes.clear();
+  if( count == 0 || m_NumberOfSamples == 0 )
+    {
+    return;
+    }
+
+  // The weight of a pixel is its gradient magnitude plus the mean
+  //   gradient magnitude, so that flat regions are still sampled
+  double weightOffset = sumGradientMagnitude / count;
+  if( weightOffset <= 0 )
+    {
+    weightOffset = 1;
+    }
+
+  // Weighted sampling without replacement: keep the pixels with the
+  //   largest keys log( u ) / weight, for u uniform in ( 0, 1 ]
+  typedef std::pair< double, OffsetValueType > KeyType;
+  typedef std::priority_queue< KeyType, std::vector< KeyType >,
+    std::greater< KeyType > > HeapType;
+  HeapType heap;
+  for( iter.GoToBegin(); !iter.IsAtEnd(); ++iter )
+    {
+    const IndexType & index = iter.GetIndex();
+    if( !this->IsValidPixel( index, iter.Get() ) )
+      {
+      continue;
+      }
+    double weight = gradient->EvaluateAtIndex( index ).GetNorm()
+      + weightOffset;
+    double u = generator->GetVariateWithOpenRange();
+    KeyType key( std::log( u ) / weight,
+      m_FixedImage->ComputeOffset( index ) );
+    if( heap.size() < m_NumberOfSamples )
+      {
+      heap.push( key );
+      }
+    else if( key.first > heap.top().first )
+      {
+      heap.pop();
+      heap.push( key );
+      }
+    }
+
+  // Store by decreasing key, so that the first samples of the set are
+  //   themselves a weighted sample
+  indexes.resize( heap.size() );
+  for( SizeValueType i = heap.size(); i > 0; i-- )
+    {
+    indexes[i - 1] = m_FixedImage->ComputeIndex( heap.top().second );
+    heap.pop();
+    }
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationSampleSet<TImage>
+::GetFixedImageIndexes( const ImageType * image,
+  unsigned int numberOfSamples, IndexContainerType & indexes ) const
+{
+  indexes.clear();
+
+  SizeValueType size = m_Samples.size();
+  SizeValueType numberOfIndexes = numberOfSamples;
+  if( numberOfIndexes > size )
+    {
+    numberOfIndexes = size;
+    }
+  if( numberOfIndexes == 0 )
+    {
+    return;
+    }
+
+  bool sameGrid = ( image == m_FixedImage.GetPointer() );
+  if( !sameGrid )
+    {
+    sameGrid = ( image->GetLargestPossibleRegion()
+                   == m_FixedImage->GetLargestPossibleRegion()
+                 && image->GetOrigin() == m_FixedImage->GetOrigin()
+                 && image->GetSpacing() == m_FixedImage->GetSpacing()
+                 && image->GetDirection() == m_FixedImage->GetDirection() );
+    }
+
+  // Samples are mapped by their physical point to coarser grids, where
+  //   several of them may fall in the same pixel
+  std::set< OffsetValueType > usedOffsets;
+  IndexType index;
+  indexes.reserve( numberOfIndexes );
+  for( SizeValueType i = 0; i < numberOfIndexes; i++ )
+    {
+    SizeValueType sampleNumber = i;
+    if( m_SamplingStrategyEnum == REGULAR_SAMPLING )
+      {
+      sampleNumber = static_cast< SizeValueType >( (double)i * size
+        / numberOfIndexes );
+      }
+    const SampleType & sample = m_Samples[sampleNumber];
+    if( sameGrid )
+      {
+      indexes.push_back( sample.Index );
+      }
+    else if( image->TransformPhysicalPointToIndex( sample.Point, index ) )
+      {
+      if( usedOffsets.insert( image->ComputeOffset( index ) ).second )
+        {
+        indexes.push_back( index );
+        }
+      }
+    }
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationSampleSet<TImage>
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  if( m_FixedImage.IsNotNull() )
+    {
+    os << indent << "Fixed Image = " << m_FixedImage << std::endl;
+    }
+  os << indent << "Use region of interest = " << m_UseRegionOfInterest
+    << std::endl;
+  os << indent << "Region of interest point1 = " << m_RegionOfInterestPoint1
+    << std::endl;
+  os << indent << "Region of interest point2 = " << m_RegionOfInterestPoint2
+    << std::endl;
+  os << indent << "Use Fixed Image Mask Object = "
+    << m_UseFixedImageMaskObject << std::endl;
+  if( m_FixedImageMaskObject.IsNotNull() )
+    {
+    os << indent << "Fixed Image Mask Object = " << m_FixedImageMaskObject
+      << std::endl;
+    }
+  os << indent << "Use Samples threshold = "
+    << m_UseFixedImageSamplesIntensityThreshold << std::endl;
+  os << indent << "Samples threshold = "
+    << m_FixedImageSamplesIntensityThreshold << std::endl;
+  os << indent << "Number of Samples = " << m_NumberOfSamples << std::endl;
+
+  switch( m_SamplingStrategyEnum )
+    {
+    case REGULAR_SAMPLING:
+      os << indent << "Sampling strategy = Regular" << std::endl;
+      break;
+    case STRATIFIED_SAMPLING:
+      os << indent << "Sampling strategy = Stratified" << std::endl;
+      break;
+    case EDGE_WEIGHTED_SAMPLING:
+      os << indent << "Sampling strategy = Edge weighted" << std::endl;
+      break;
+    }
+
+  os << indent << "Random Number Seed = " << m_RandomNumberSeed
+    << std::endl;
+  os << indent << "Report Progress = " << m_ReportProgress << std::endl;
+  os << indent << "Number of Valid Pixels = " << m_NumberOfValidPixels
+    << std::endl;
+  os << indent << "Number of Selected Samples = " << m_Samples.size()
+    << std::endl;
+}
+
+};
+
+#endif
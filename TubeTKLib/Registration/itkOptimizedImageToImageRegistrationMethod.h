@@ -21,6 +21,7 @@
 #include "itkImage.h"
 
 #include "itkImageToImageRegistrationMethod.h"
+#include "itkImageToImageRegistrationSampleSet.h"
 
 namespace itk
 {
@@ -74,6 +75,9 @@ public:
                                      BSPLINE_INTERPOLATION,
                                      SINC_INTERPOLATION };
 
+  typedef ImageToImageRegistrationSampleSet<TImage>
+  FixedImageSampleSetType;
+
   //
   // Methods from Superclass
   //
@@ -115,6 +119,12 @@ public:
 
   itkGetConstMacro( FixedImageSamplesIntensityThreshold, PixelType );
 
+  /** Fixed image samples shared with other registrations.  When set, the
+   *  metric samples are drawn from it, instead of from a scan of the fixed
+   *  image, unless samples are limited to the fixed/moving overlap. */
+  itkSetObjectMacro( FixedImageSampleSet, FixedImageSampleSetType );
+  itkGetObjectMacro( FixedImageSampleSet, FixedImageSampleSetType );
+
   itkSetMacro( TargetError, double );
   itkGetConstMacro( TargetError, double );
 
@@ -173,6 +183,8 @@ private:
   bool      m_UseFixedImageSamplesIntensityThreshold;
   PixelType m_FixedImageSamplesIntensityThreshold;
 
+  typename FixedImageSampleSetType::Pointer m_FixedImageSampleSet;
+
   double m_TargetError;
 
   int m_RandomNumberSeed;
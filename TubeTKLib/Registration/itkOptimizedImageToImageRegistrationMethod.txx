@@ -164,6 +164,8 @@ OptimizedImageToImageRegistrationMethod<TImage>
   m_FixedImageSamplesIntensityThreshold = 0;
   m_UseFixedImageSamplesIntensityThreshold = false;
 
+  m_FixedImageSampleSet = 0;
+
   m_TargetError = 0.00001;
 
   m_RandomNumberSeed = 0;
@@ -253,7 +255,34 @@ OptimizedImageToImageRegistrationMethod<TImage>
 
   metric->SetNumberOfSpatialSamples( m_NumberOfSamples );
 
-  if( this->GetUseRegionOfInterest() ||
+  // The overlap depends on the current transform, so it cannot be shared
+  bool useFixedImageSampleSet = false;
+  if( m_FixedImageSampleSet.IsNotNull() && !this->GetSampleFromOverlap() )
+    {
+    m_FixedImageSampleSet->Update();
+    useFixedImageSampleSet = !m_FixedImageSampleSet->GetSamples().empty();
+    }
+
+  if( useFixedImageSampleSet )
+    {
+    typename MetricType::FixedImageIndexContainer indexList;
+    m_FixedImageSampleSet->GetFixedImageIndexes( fixedImage,
+      m_NumberOfSamples, indexList );
+    if( indexList.size() != m_NumberOfSamples )
+      {
+      itkWarningMacro(<< "Full set of samples not collected. Collected "
+                      << indexList.size() << " of " << m_NumberOfSamples );
+      this->SetNumberOfSamples( indexList.size() );
+      metric->SetNumberOfSpatialSamples( m_NumberOfSamples );
+      }
+    if( this->GetReportProgress() )
+      {
+      std::cout << "Using shared fixed image samples" << std::endl;
+      std::cout << "  List size = " << indexList.size() << std::endl;
+      }
+    metric->SetFixedImageIndexes( indexList );
+    }
+  else if( this->GetUseRegionOfInterest() ||
       this->GetSampleFromOverlap() ||
       this->GetUseFixedImageSamplesIntensityThreshold() ||
       this->GetUseFixedImageMaskObject() )
@@ -684,6 +713,12 @@ OptimizedImageToImageRegistrationMethod<TImage>
   os << indent << "Samples threshold = " <<
     m_FixedImageSamplesIntensityThreshold << std::endl;
 
+  if( m_FixedImageSampleSet.IsNotNull() )
+    {
+    os << indent << "Fixed Image Sample Set = " << m_FixedImageSampleSet
+      << std::endl;
+    }
+
   os << indent << "Target Error = " << m_TargetError << std::endl;
 
   switch( m_MetricMethodEnum )
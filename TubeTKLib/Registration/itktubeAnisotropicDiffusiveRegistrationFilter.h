@@ -25,12 +25,15 @@ limitations under the License.
 #define __itktubeAnisotropicDiffusiveRegistrationFilter_h
 
 #include "itktubeDiffusiveRegistrationFilter.h"
+#include "itktubeKdTreePointLocator.h"
 
+#include <itkPointSet.h>
+
+#ifdef TubeTK_USE_VTK
 #include <vtkSmartPointer.h>
 
-class vtkFloatArray;
-class vtkPointLocator;
 class vtkPolyData;
+#endif
 
 namespace itk
 {
@@ -53,9 +56,9 @@ namespace tube
  * when considering sliding motion.
  *
  * The regularization term uses a specified border between the organs
- * ( stored as a vtkPolyData * ) and enforces coupling between the organs
- * while allowing the motion field to exhibit sliding motion at the organ
- * interface.
+ * ( stored as a point set with normals, or as a vtkPolyData * when built
+ * with VTK ) and enforces coupling between the organs while allowing the
+ * motion field to exhibit sliding motion at the organ interface.
  *
  * See: D.F. Pace et al., Deformable image registration of sliding organs
  * using anisotropic diffusive regularization, ISBI 2011.
@@ -180,22 +183,46 @@ public:
 
   typedef typename WeightImageType::RegionType ThreadWeightImageRegionType;
 
+  /** Organ boundary point types: the border points carry their normals
+   *  as point data */
+  typedef PointSet< NormalVectorType, ImageDimension >
+      BorderPointSetType;
+  typedef typename BorderPointSetType::Pointer
+      BorderPointSetPointer;
+  typedef KdTreePointLocator< ImageDimension >
+      BorderPointLocatorType;
+  typedef std::vector< NormalVectorType >
+      BorderNormalContainerType;
+
+#ifdef TubeTK_USE_VTK
   /** Organ boundary surface types */
   typedef vtkPolyData                                 BorderSurfaceType;
   typedef vtkSmartPointer< BorderSurfaceType >        BorderSurfacePointer;
+#endif
 
   /** The number of div( Tensor \grad u )v terms we sum for the regularizer.
    *  Reimplement in derived classes. */
   virtual int GetNumberOfTerms( void ) const
     { return 2; }
 
+  /** Set/get the organ boundary points and their normals, which must be
+   * in the same space as the fixed image.  The normal and weight images
+   * are computed from the closest border point of each voxel. */
+  virtual void SetBorderPointSet( BorderPointSetType * border )
+    { m_BorderPointSet = border; }
+  virtual BorderPointSetType * GetBorderPointSet( void ) const
+    { return m_BorderPointSet; }
+
+#ifdef TubeTK_USE_VTK
   /** Set/get the organ boundary polydata, which must be in the same space
    * as the fixed image.  Border normals are computed on this polydata, so
-   * it may be changed over the course of the registration. */
+   * it may be changed over the course of the registration.  The polydata
+   * replaces the border point set when the normals are computed. */
   virtual void SetBorderSurface( BorderSurfaceType * border )
     { m_BorderSurface = border; }
   virtual BorderSurfaceType * GetBorderSurface( void ) const
     { return m_BorderSurface; }
+#endif
 
   /** Set/get the lambda that controls the decay of the weight value w as a
    *  function of the distance to the closest border point.  If gamma=-1,
@@ -255,6 +282,12 @@ protected:
   /** Handy for array indexing. */
   enum DivTerm { TANGENTIAL, NORMAL };
 
+  /** The anisotropic regularization is computed from the diffusion
+   *  tensor, derivative and multiplication vector images, so the
+   *  iterations always use separate passes. */
+  virtual bool CanUseFusedIteration( void ) const
+    { return false; }
+
   /** Allocate the deformation component images and their derivative images.
    *  ( which may be updated throughout the registration ). Reimplement in
    *  derived classes. */
@@ -278,16 +311,19 @@ protected:
    * images. */
   virtual void SetupNormalVectorAndWeightImages( void );
 
-  /** Compute the normals for the border surface. */
+#ifdef TubeTK_USE_VTK
+  /** Compute the normals for the border surface, and set the border point
+   *  set from its points and normals. */
   void ComputeBorderSurfaceNormals( void );
+#endif
 
   /** Computes the normal vector image and weighting factors w given the
-   *  surface border polydata. */
+   *  border points. */
   virtual void ComputeNormalVectorAndWeightImages( bool computeNormals,
                                                    bool computeWeights );
 
-  /** Computes the normal vectors and distances to the closest point given
-   *  an initialized vtkPointLocator and the surface border normals */
+  /** Computes the normal vectors and distances to the closest border
+   *  point, locating the points with a k-d tree */
   virtual void GetNormalsAndDistancesFromClosestSurfacePoint(
       bool computeNormals, bool computeWeights );
 
@@ -296,8 +332,8 @@ protected:
    *  \sa GetNormalsAndDistancesFromClosestSurfacePoint
    *  \sa GetNormalsAndDistancesFromClosestSurfacePointThreaderCallback */
   virtual void ThreadedGetNormalsAndDistancesFromClosestSurfacePoint(
-      vtkPointLocator * pointLocator,
-      vtkFloatArray * normalData,
+      const BorderPointLocatorType * pointLocator,
+      const BorderNormalContainerType & normals,
       ThreadNormalVectorImageRegionType & normalRegionToProcess,
       ThreadWeightImageRegionType & weightRegionToProcess,
       bool computeNormals,
@@ -326,8 +362,8 @@ private:
   struct AnisotropicDiffusiveRegistrationFilterThreadStruct
     {
     AnisotropicDiffusiveRegistrationFilter * Filter;
-    vtkPointLocator * PointLocator;
-    vtkFloatArray * NormalData;
+    const BorderPointLocatorType * PointLocator;
+    const BorderNormalContainerType * Normals;
     ThreadNormalVectorImageRegionType NormalVectorImageLargestPossibleRegion;
     ThreadWeightImageRegionType WeightImageLargestPossibleRegion;
     bool ComputeNormals;
@@ -342,8 +378,13 @@ private:
       GetNormalsAndDistancesFromClosestSurfacePointThreaderCallback(
           void * arg );
 
+  /** Organ boundary points and their normals */
+  BorderPointSetPointer               m_BorderPointSet;
+
+#ifdef TubeTK_USE_VTK
   /** Organ boundary surface and surface of border normals */
   BorderSurfacePointer                m_BorderSurface;
+#endif
 
   /** Image storing information we will need for each voxel on every
    *  registration iteration */
@@ -31,12 +31,13 @@ limitations under the License.
 #include <itkImageRegionSplitter.h>
 #include <itktubeSmoothingRecursiveGaussianImageFilter.h>
 
-#include <vtkFloatArray.h>
+#ifdef TubeTK_USE_VTK
+#include <vtkDataArray.h>
 #include <vtkPointData.h>
-#include <vtkPointLocator.h>
 #include <vtkPolyData.h>
 #include <vtkPolyDataNormals.h>
 #include <vtkVersion.h>
+#endif
 
 namespace itk
 {
@@ -53,7 +54,10 @@ AnisotropicDiffusiveRegistrationFilter
 ::AnisotropicDiffusiveRegistrationFilter( void )
 {
   // Initialize attributes to NULL
+  m_BorderPointSet                              = 0;
+#ifdef TubeTK_USE_VTK
   m_BorderSurface                               = 0;
+#endif
   m_NormalVectorImage                           = 0;
   m_WeightImage                                 = 0;
   m_HighResolutionNormalVectorImage             = 0;
@@ -74,11 +78,18 @@ AnisotropicDiffusiveRegistrationFilter
 ::PrintSelf( std::ostream& os, Indent indent ) const
 {
   Superclass::PrintSelf( os, indent );
+  if( m_BorderPointSet )
+    {
+    os << indent << "Border point set:" << std::endl;
+    m_BorderPointSet->Print( os, indent );
+    }
+#ifdef TubeTK_USE_VTK
   if( m_BorderSurface )
     {
     os << indent << "Border surface:" << std::endl;
     m_BorderSurface->Print( os );
     }
+#endif
   if( m_NormalVectorImage )
     {
     os << indent << "Normal vector image:" << std::endl;
@@ -188,15 +199,21 @@ AnisotropicDiffusiveRegistrationFilter
   // Compute the normal vector and/or weight images if required
   if( computeNormals || computeWeights )
     {
-    // Ensure we have a border surface to work with
-    if( !this->GetBorderSurface() )
+#ifdef TubeTK_USE_VTK
+    // Compute the normals for the surface, which then provides the border
+    // points
+    if( this->GetBorderSurface() )
       {
-      itkExceptionMacro( << "You must provide a border surface, or both a "
-        << "normal vector image and a weight image" );
+      this->ComputeBorderSurfaceNormals();
       }
+#endif
 
-    // Compute the normals for the surface
-    this->ComputeBorderSurfaceNormals();
+    // Ensure we have border points to work with
+    if( !this->GetBorderPointSet() )
+      {
+      itkExceptionMacro( << "You must provide a border surface or border "
+        << "point set, or both a normal vector image and a weight image" );
+      }
 
     // Allocate the normal vector and/or weight images
     if( computeNormals )
@@ -271,6 +288,7 @@ AnisotropicDiffusiveRegistrationFilter
     }
 }
 
+#ifdef TubeTK_USE_VTK
 /**
  * Compute the normals for the border surface
  */
@@ -304,7 +322,38 @@ AnisotropicDiffusiveRegistrationFilter
     itkExceptionMacro( <<
       "Border surface point data does not have normals." );
     }
+
+  // Use the surface points and normals as the border points
+  vtkDataArray * normalData = m_BorderSurface->GetPointData()->GetNormals();
+  vtkIdType numberOfPoints = m_BorderSurface->GetNumberOfPoints();
+  typename BorderPointSetType::PointsContainer::Pointer points
+    = BorderPointSetType::PointsContainer::New();
+  points->Reserve( numberOfPoints );
+  typename BorderPointSetType::PointDataContainer::Pointer normals
+    = BorderPointSetType::PointDataContainer::New();
+  normals->Reserve( numberOfPoints );
+
+  // vtkPolyData points and normals always have three components
+  double borderCoord[3];
+  typename BorderPointSetType::PointType point;
+  NormalVectorType normal;
+  for( vtkIdType id = 0; id < numberOfPoints; id++ )
+    {
+    m_BorderSurface->GetPoint( id, borderCoord );
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      point[i] = borderCoord[i];
+      normal[i] = normalData->GetComponent( id, i );
+      }
+    points->SetElement( id, point );
+    normals->SetElement( id, normal );
+    }
+
+  m_BorderPointSet = BorderPointSetType::New();
+  m_BorderPointSet->SetPoints( points );
+  m_BorderPointSet->SetPointData( normals );
 }
+#endif
 
 /**
  * Computes the normal vectors and distances to the closest point
@@ -316,21 +365,44 @@ AnisotropicDiffusiveRegistrationFilter
 ::GetNormalsAndDistancesFromClosestSurfacePoint( bool computeNormals,
                                                  bool computeWeights )
 {
-  // Setup the point locator and get the normals from the polydata
-  vtkSmartPointer< vtkPointLocator > pointLocator
-    = vtkSmartPointer< vtkPointLocator >::New();
-  pointLocator->SetDataSet( m_BorderSurface );
+  // Setup the point locator and get the normals from the border points
+  typedef typename BorderPointSetType::PointsContainer
+    BorderPointsContainerType;
+  const BorderPointsContainerType * borderPoints
+    = m_BorderPointSet->GetPoints();
+  typename BorderPointLocatorType::PointContainerType points;
+  points.reserve( borderPoints->Size() );
+  BorderNormalContainerType normals;
+  normals.reserve( borderPoints->Size() );
+  NormalVectorType normal;
+  for( typename BorderPointsContainerType::ConstIterator pointIt
+         = borderPoints->Begin();
+       pointIt != borderPoints->End();
+       ++pointIt )
+    {
+    if( !m_BorderPointSet->GetPointData( pointIt.Index(), &normal ) )
+      {
+      itkExceptionMacro( << "Border point " << pointIt.Index()
+        << " does not have a normal." );
+      }
+    points.push_back( pointIt.Value() );
+    normals.push_back( normal );
+    }
+  if( points.empty() )
+    {
+    itkExceptionMacro( << "Border point set does not contain points." );
+    }
+
+  typename BorderPointLocatorType::Pointer pointLocator
+    = BorderPointLocatorType::New();
+  pointLocator->SetPoints( points );
   pointLocator->Initialize();
-  pointLocator->BuildLocator();
-  vtkFloatArray * normalData
-      = static_cast< vtkFloatArray * >
-        ( m_BorderSurface->GetPointData()->GetNormals() );
 
   // Set up struct for multithreaded processing.
   AnisotropicDiffusiveRegistrationFilterThreadStruct str;
   str.Filter = this;
   str.PointLocator = pointLocator;
-  str.NormalData = normalData;
+  str.Normals = &normals;
   str.NormalVectorImageLargestPossibleRegion
       = m_NormalVectorImage->GetLargestPossibleRegion();
   str.WeightImageLargestPossibleRegion
@@ -399,7 +471,7 @@ AnisotropicDiffusiveRegistrationFilter
     {
     str->Filter->ThreadedGetNormalsAndDistancesFromClosestSurfacePoint(
         str->PointLocator,
-        str->NormalData,
+        *str->Normals,
         splitNormalRegion,
         splitWeightRegion,
         str->ComputeNormals,
@@ -412,16 +484,15 @@ AnisotropicDiffusiveRegistrationFilter
 
 /**
  * Does the actual work of computing the normal vectors and distances to the
- * closest point given an initialized vtkPointLocator and the surface border
- * normals
+ * closest point given an initialized point locator and the border normals
  */
 template< class TFixedImage, class TMovingImage, class TDeformationField >
 void
 AnisotropicDiffusiveRegistrationFilter
   < TFixedImage, TMovingImage, TDeformationField >
 ::ThreadedGetNormalsAndDistancesFromClosestSurfacePoint(
-    vtkPointLocator * pointLocator,
-    vtkFloatArray * normalData,
+    const BorderPointLocatorType * pointLocator,
+    const BorderNormalContainerType & normals,
     ThreadNormalVectorImageRegionType & normalRegionToProcess,
     ThreadWeightImageRegionType & weightRegionToProcess,
     bool computeNormals,
@@ -434,55 +505,35 @@ AnisotropicDiffusiveRegistrationFilter
   WeightImageRegionType weightIt( m_WeightImage,
                                  weightRegionToProcess );
 
-  // The normal vector image will hold the normal of the closest point of
-  // the surface polydata, and the weight image will be a function of the
-  // distance between the voxel and this closest point
+  // The normal vector image will hold the normal of the closest border
+  // point, and the weight image will be a function of the distance between
+  // the voxel and this closest point
 
-  itk::Point< double, ImageDimension >  imageCoord;
+  typename BorderPointLocatorType::PointType imageCoord;
   imageCoord.Fill( 0 );
-  double                                borderCoord[ImageDimension];
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-    {
-    borderCoord[i] = 0.0;
-    }
-  vtkIdType                             id = 0;
-  WeightType                            distance = 0;
-  NormalVectorType                      normal;
-  normal.Fill( 0 );
+  typename BorderPointLocatorType::IdentifierType id = 0;
+  double                                distance = 0;
 
   // Determine the normals of and the distances to the nearest border point
   for( normalIt.GoToBegin(), weightIt.GoToBegin();
        !normalIt.IsAtEnd();
        ++normalIt, ++weightIt )
     {
-    // Find the id of the closest surface point to the current voxel
+    // Find the id of the closest border point to the current voxel
     m_NormalVectorImage->TransformIndexToPhysicalPoint( normalIt.GetIndex(),
                                                         imageCoord );
-    id = pointLocator->FindClosestPoint( imageCoord.GetDataPointer() );
+    id = pointLocator->FindClosestPoint( imageCoord, distance );
 
-    // Find the normal of the surface point that is closest to the current
+    // Find the normal of the border point that is closest to the current
     // voxel
     if( computeNormals )
       {
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-        {
-        normal[i] = normalData->GetValue( id * ImageDimension + i );
-        }
-      normalIt.Set( normal );
+      normalIt.Set( normals[id] );
       }
 
-    // Calculate distance between the current coordinate and the border
-    // surface coordinate
+    // The weight image will temporarily store distances
     if( computeWeights )
       {
-      m_BorderSurface->GetPoint( id, borderCoord );
-      distance = 0.0;
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-        {
-        distance += std::pow( imageCoord[i] - borderCoord[i], 2 );
-        }
-      distance = std::sqrt( distance );
-      // The weight image will temporarily store distances
       weightIt.Set( distance );
       }
     }
@@ -499,14 +550,14 @@ AnisotropicDiffusiveRegistrationFilter
   bool computeWeights )
 {
   assert( this->GetComputeRegularizationTerm() );
-  assert( m_BorderSurface->GetPointData()->GetNormals() );
+  assert( m_BorderPointSet );
   assert( m_NormalVectorImage );
   assert( m_WeightImage );
 
   std::cout << "Computing normals and weights... " << std::endl;
 
-  // The normal vector image will hold the normal of the closest point of
-  // the surface polydata, and the weight image will be a function of the
+  // The normal vector image will hold the normal of the closest border
+  // point, and the weight image will be a function of the
   // distance between the voxel and this closest point
   this->GetNormalsAndDistancesFromClosestSurfacePoint( computeNormals,
                                                        computeWeights );
@@ -282,6 +282,13 @@ public:
       PixelType & regularizationTerm,
       const FloatOffsetType& = FloatOffsetType( 0.0 ) );
 
+  /** Computes the intensity distance update term at the given index,
+   *  under the given deformation vector.  Returns a zero vector if the
+   *  intensity distance term is not computed. */
+  virtual PixelType ComputeIntensityDistanceUpdate(
+    const typename NeighborhoodType::IndexType & index,
+    const DeformationVectorType & deformation );
+
   /** Updates the energy associated with the intensity distance term */
   virtual double ComputeIntensityDistanceEnergy(
     const typename NeighborhoodType::IndexType index,
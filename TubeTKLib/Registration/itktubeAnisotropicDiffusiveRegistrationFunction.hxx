@@ -335,6 +335,29 @@ AnisotropicDiffusiveRegistrationFunction
   return regularizationTerm;
 }
 
+/**
+  * Computes the intensity distance update term at an index
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+typename AnisotropicDiffusiveRegistrationFunction
+  < TFixedImage, TMovingImage, TDeformationField >
+::PixelType
+AnisotropicDiffusiveRegistrationFunction
+  < TFixedImage, TMovingImage, TDeformationField >
+::ComputeIntensityDistanceUpdate(
+  const typename NeighborhoodType::IndexType & index,
+  const DeformationVectorType & deformation )
+{
+  PixelType intensityDistanceTerm;
+  intensityDistanceTerm.Fill( 0 );
+  if( this->GetComputeIntensityDistanceTerm() )
+    {
+    intensityDistanceTerm = m_IntensityDistanceFunction->ComputeUpdateAtIndex(
+        index, deformation );
+    }
+  return intensityDistanceTerm;
+}
+
 /**
   * Computes the intensity distance energy
  */
@@ -25,6 +25,7 @@ limitations under the License.
 #define __itktubeAnisotropicDiffusiveSparseRegistrationFilter_h
 
 #include "itktubeDiffusiveRegistrationFilter.h"
+#include "itktubeKdTreePointLocator.h"
 
 #include <itkGroupSpatialObject.h>
 #include <itkVesselTubeSpatialObject.h>
@@ -32,7 +33,6 @@ limitations under the License.
 #include <vtkSmartPointer.h>
 
 class vtkFloatArray;
-class vtkPointLocator;
 class vtkPolyData;
 
 namespace itk
@@ -116,9 +116,27 @@ public:
   typedef typename Superclass::OutputImageRegionType
       OutputImageRegionType;
 
+  /** Typedefs used in multithreading */
+  typedef typename Superclass::UpdateBufferType
+      UpdateBufferType;
+  typedef typename Superclass::ThreadRegionType
+      ThreadRegionType;
+  typedef typename Superclass::ThreadDiffusionTensorImageRegionType
+      ThreadDiffusionTensorImageRegionType;
+  typedef typename Superclass::ThreadScalarDerivativeImageRegionType
+      ThreadScalarDerivativeImageRegionType;
+  typedef typename Superclass::ThreadTensorDerivativeImageRegionType
+      ThreadTensorDerivativeImageRegionType;
+  typedef typename Superclass::StoppingCriterionMaskImageType
+      StoppingCriterionMaskImageType;
+  typedef typename Superclass::ThreadStoppingCriterionMaskImageRegionType
+      ThreadStoppingCriterionMaskImageRegionType;
+
   /** The registration function type */
   typedef typename Superclass::RegistrationFunctionType
       RegistrationFunctionType;
+  typedef typename Superclass::RegularizationFunctionType
+      RegularizationFunctionType;
   typedef typename Superclass::SpacingType
       SpacingType;
 
@@ -137,6 +155,8 @@ public:
       DiffusionTensorImageType;
 
   /** Scalar derivative image types */
+  typedef typename RegistrationFunctionType::ScalarDerivativeType
+      ScalarDerivativeType;
   typedef typename Superclass::ScalarDerivativeImageType
       ScalarDerivativeImageType;
   typedef typename Superclass::ScalarDerivativeImagePointer
@@ -145,6 +165,8 @@ public:
       ScalarDerivativeImageArrayType;
 
   /** Tensor derivative matrix image types */
+  typedef typename RegistrationFunctionType::TensorDerivativeType
+      TensorDerivativeType;
   typedef typename Superclass::TensorDerivativeImageType
       TensorDerivativeImageType;
   typedef typename Superclass::TensorDerivativeImagePointer
@@ -215,6 +237,7 @@ public:
   /** Organ boundary surface types */
   typedef vtkPolyData                               BorderSurfaceType;
   typedef vtkSmartPointer< BorderSurfaceType >      BorderSurfacePointer;
+  typedef KdTreePointLocator< ImageDimension >      PointLocatorType;
 
   /** Tube spatial object types */
   typedef typename itk::SpatialObject< ImageDimension >::ChildrenListType
@@ -228,23 +251,35 @@ public:
   typedef typename TubeType::TubePointType
       TubePointType;
 
-  /** The number of div( Tensor \grad u )v terms we sum for the regularizer.
+  /** The number of div( Tensor \grad u )v terms we sum for the regularizer
+   *  over the image.  In the narrow band mode, only the SMOOTH_TANGENTIAL
+   *  term is summed over the image, with the identity tensor, and the four
+   *  terms are summed over the band voxels from the narrow band storage.
    *  Reimplement in derived classes. */
   virtual int GetNumberOfTerms( void ) const
-    { return 4; }
+    { return this->GetUseNarrowBand() ? 1 : 4; }
 
   /** Set/get the organ boundary polydata, which must be in the same space
    * as the fixed image.  Border normals are computed on this polydata, so
    * it may be changed over the course of the registration. */
   virtual void SetBorderSurface( BorderSurfaceType * border )
-    { m_BorderSurface = border; }
+    {
+    m_BorderSurface = border;
+    m_NarrowBandNormalsComputed = false;
+    this->Modified();
+    }
   virtual BorderSurfaceType * GetBorderSurface( void ) const
     { return m_BorderSurface; }
 
   /** Set/get the list of tube spatial objects, which must be in the same
    * space as the fixed image. */
   virtual void SetTubeList( TubeListType * tubeList )
-    { m_TubeList = tubeList; }
+    {
+    m_TubeList = tubeList;
+    m_TubeSurface = 0;
+    m_NarrowBandNormalsComputed = false;
+    this->Modified();
+    }
   virtual TubeListType * GetTubeList( void ) const
     { return m_TubeList; }
 
@@ -272,6 +307,51 @@ public:
   WeightComponentType GetGamma( void ) const
     { return m_Gamma; }
 
+  /** Set/get the width of the narrow band around the border surface and
+   *  the tube surfaces, in physical units.  If positive and the normal
+   *  matrix and weight images are not set, the normals and weights are
+   *  computed and stored only for the voxels within the band, and the
+   *  regularization is diffusive elsewhere ( w = 0 ).  The tensors, the
+   *  multiplication vectors and the normal deformation components are also
+   *  stored for the band voxels only, and the anisotropic regularization
+   *  replaces the diffusive one at the band voxels.  The band is widened
+   *  to GetNarrowBandMinimumWidth() if needed, so that w is continuous to
+   *  within the narrow band weight tolerance at its edge, and is then
+   *  dilated by the derivative stencils of the regularization, so that the
+   *  derivatives within the band only read voxels of the band.  The normal
+   *  matrix and weight images are not available in this mode.  Zero, the
+   *  default, computes the normals and weights over the entire image. */
+  virtual void SetNarrowBandWidth( double width )
+    {
+    if( m_NarrowBandWidth != width )
+      {
+      m_NarrowBandWidth = width;
+      m_NarrowBandNormalsComputed = false;
+      this->Modified();
+      }
+    }
+  itkGetConstMacro( NarrowBandWidth, double );
+
+  /** Set/get the largest weight w that may be dropped at the edge of the
+   *  narrow band.  Default 0.01. */
+  itkSetMacro( NarrowBandWeightTolerance, WeightComponentType );
+  itkGetConstMacro( NarrowBandWeightTolerance, WeightComponentType );
+
+  /** Get the distance beyond which w, as given by lambda and gamma, is
+   *  below the narrow band weight tolerance */
+  double GetNarrowBandMinimumWidth( void ) const;
+
+  /** Whether the normals and weights are stored in the narrow band only */
+  bool GetUseNarrowBand( void ) const
+    {
+    return m_NarrowBandWidth > 0 && !m_NormalMatrixImage
+      && !m_WeightStructuresImage && !m_WeightRegularizationsImage;
+    }
+
+  /** Get the number of voxels in the narrow band of the current level */
+  SizeValueType GetNumberOfNarrowBandVoxels( void ) const
+    { return m_NarrowBandOffsets.size(); }
+
   /** Set/get the image of the normal vectors.  Setting the normal vector
    * image overrides the border surface polydata if a border surface was
    * also supplied. */
@@ -315,10 +395,16 @@ public:
   /** Get the normal components of the deformation field.  The normal
    *  deformation field component images are the same for both the
    *  SMOOTH_NORMAL
-   *  and PROP_NORMAL terms, so we will return one arbitrarily. */
+   *  and PROP_NORMAL terms, so we will return one arbitrarily.  Not
+   *  available in the narrow band mode, where the normal components are
+   *  stored for the band voxels only. */
   virtual const DeformationFieldType * GetNormalDeformationComponentImage(
     void ) const
     {
+    if( this->GetUseNarrowBand() )
+      {
+      return 0;
+      }
     return this->GetDeformationComponentImage( SMOOTH_NORMAL );
     }
 
@@ -331,6 +417,22 @@ protected:
   enum DivTerm { SMOOTH_TANGENTIAL, SMOOTH_NORMAL, PROP_TANGENTIAL,
     PROP_NORMAL };
 
+  /** The number of terms summed over the narrow band voxels. */
+  enum { NumberOfNarrowBandTerms = 4 };
+
+  /** The anisotropic regularization is computed from the diffusion
+   *  tensor, derivative and multiplication vector images, so the
+   *  iterations always use separate passes. */
+  virtual bool CanUseFusedIteration( void ) const
+    { return false; }
+
+  typedef typename Superclass::UpdateMetricsIntermediateStruct
+      UpdateMetricsIntermediateStruct;
+
+  /** All other initialization done before the initialize / calculate
+   *  change / apply update loop. */
+  virtual void Initialize( void );
+
   /** Allocate the deformation component images and their derivative images.
    *  ( which may be updated throughout the registration ). Reimplement in
    *  derived classes. */
@@ -340,6 +442,10 @@ protected:
    *  Reimplement in derived classes. */
   virtual void ComputeDiffusionTensorImages( void );
 
+  /** Computes the diffusion tensor derivative images, and the diffusion
+   *  tensor derivatives of the narrow band voxels. */
+  virtual void ComputeDiffusionTensorDerivativeImages( void );
+
   /** Allocate and populate the images of multiplication vectors that the
    *  div( T \grad( u ) ) values are multiplied by.  Allocate and populate
    *  all or some of the multiplication vector images in derived classes.
@@ -356,6 +462,38 @@ protected:
    *  to avoid computing the same derivatives multiple times. */
   virtual void ComputeDeformationComponentDerivativeImages( void );
 
+  /** Calculates the update over a region supplied by the multithreading
+   *  mechanism.  In the narrow band mode, replaces the diffusive
+   *  regularization of the band voxels of the region by their anisotropic
+   *  regularization. */
+  virtual TimeStepType ThreadedCalculateChangeGradient(
+      const ThreadRegionType & regionToProcess,
+      const ThreadDiffusionTensorImageRegionType & tensorRegionToProcess,
+      const ThreadTensorDerivativeImageRegionType
+        & tensorDerivativeRegionToProcess,
+      const ThreadScalarDerivativeImageRegionType
+        & scalarDerivativeRegionToProcess,
+      const ThreadStoppingCriterionMaskImageRegionType
+        & stoppingCriterionMaskRegionToProcess,
+      UpdateMetricsIntermediateStruct & updateMetricsIntermediate,
+      int threadId );
+
+  /** Calculates the energies over a region supplied by the multithreading
+   *  mechanism.  In the narrow band mode, replaces the diffusive
+   *  regularization energy of the band voxels of the region by their
+   *  anisotropic regularization energy. */
+  virtual void ThreadedCalculateEnergies(
+      const OutputImagePointer & output,
+      const ThreadRegionType & regionToProcess,
+      const ThreadDiffusionTensorImageRegionType & tensorRegionToProcess,
+      const ThreadScalarDerivativeImageRegionType &
+        scalarDerivativeRegionToProcess,
+      const ThreadStoppingCriterionMaskImageRegionType &
+        stoppingCriterionMaskRegionToProcess,
+      double & intensityDistanceEnergy,
+      double & regularizationEnergy,
+      int threadId );
+
   /** If needed, allocates and computes the normal vector and weight
    * images. */
   virtual void SetupNormalMatrixAndWeightImages( void );
@@ -377,8 +515,98 @@ protected:
       bool computeWeightStructures,
       bool computeWeightRegularizations );
 
-  /** Computes the normal vectors and distances to the closest point given
-   *  an initialized vtkPointLocator and the surface border normals */
+  /** Computes the normal matrix, the distance and the weight structures
+   *  matrix given by the surface or tube point closest to a physical
+   *  point. */
+  void ComputeNormalAndDistanceFromClosestSurfacePoint(
+      const typename PointLocatorType::PointType & point,
+      const PointLocatorType * surfacePointLocator,
+      vtkFloatArray * surfaceNormalData,
+      const PointLocatorType * tubePointLocator,
+      vtkFloatArray * tubeNormal1Data,
+      vtkFloatArray * tubeNormal2Data,
+      vtkFloatArray * tubeRadiusData,
+      NormalMatrixType & normalMatrix,
+      WeightComponentType & distance,
+      WeightMatrixType & weightStructures ) const;
+
+  /** Computes the four diffusion tensors of a voxel from its normal
+   *  matrix N, weight structures matrix A and weight w. */
+  void ComputeDiffusionTensors(
+      const NormalMatrixType & normalMatrix,
+      const WeightMatrixType & weightStructures,
+      WeightComponentType weightRegularization,
+      DiffusionTensorType & smoothTangentialDiffusionTensor,
+      DiffusionTensorType & smoothNormalDiffusionTensor,
+      DiffusionTensorType & propTangentialDiffusionTensor,
+      DiffusionTensorType & propNormalDiffusionTensor ) const;
+
+  /** Finds the voxels of the output within the narrow band, and computes
+   *  their normals and weights. */
+  virtual void ComputeNarrowBand( void );
+
+  /** Computes the normals and weights of a range of narrow band voxels
+   * supplied by the multithreading mechanism.
+   *  \sa ComputeNarrowBand
+   *  \sa ComputeNarrowBandThreaderCallback */
+  virtual void ThreadedComputeNarrowBand(
+      const PointLocatorType * surfacePointLocator,
+      vtkFloatArray * surfaceNormalData,
+      const PointLocatorType * tubePointLocator,
+      vtkFloatArray * tubeNormal1Data,
+      vtkFloatArray * tubeNormal2Data,
+      vtkFloatArray * tubeRadiusData,
+      SizeValueType firstVoxel,
+      SizeValueType endVoxel );
+
+  /** Marks the voxels of the output within a distance of a point. */
+  void MarkNarrowBandVoxels(
+      const typename PointLocatorType::PointType & point,
+      double distance,
+      std::vector< bool > & isInBand ) const;
+
+  /** Marks the voxels of the output within a radius, in voxels, of the
+   *  marked voxels. */
+  void DilateNarrowBand(
+      const typename OutputImageType::SizeType & radius,
+      std::vector< bool > & isInBand ) const;
+
+  /** Finds the band indices of the 3^N stencil neighbors of each band
+   *  voxel, clamped to the image as by the zero flux Neumann boundary
+   *  condition. */
+  void ComputeNarrowBandNeighbors( void );
+
+  /** Returns the position of a neighbor within the 3^N stencil of the
+   *  narrow band neighbors, given its offset along each dimension. */
+  static unsigned int GetNarrowBandStencilPosition(
+      const typename OutputImageType::OffsetType & offset );
+
+  /** Computes the first- and second-order partial derivatives of the
+   *  normal deformation components of a range of narrow band voxels
+   *  supplied by the multithreading mechanism. */
+  virtual void ThreadedComputeNarrowBandNormalComponentDerivatives(
+      SizeValueType firstVoxel,
+      SizeValueType endVoxel );
+
+  /** Finds the range of narrow band voxels within a region. */
+  void GetNarrowBandRange( const ThreadRegionType & region,
+      SizeValueType & firstVoxel, SizeValueType & endVoxel ) const;
+
+  /** Computes the anisotropic regularization update term of a narrow band
+   *  voxel, given the derivative images of the tangential components. */
+  DeformationVectorType ComputeNarrowBandRegularizationUpdate(
+      SizeValueType voxel,
+      const ScalarDerivativeType * const * tangentialFirstOrder,
+      const TensorDerivativeType * const * tangentialSecondOrder ) const;
+
+  /** Computes the anisotropic regularization energy of a narrow band
+   *  voxel, given the derivative images of the tangential components. */
+  double ComputeNarrowBandRegularizationEnergy(
+      SizeValueType voxel,
+      const ScalarDerivativeType * const * tangentialFirstOrder ) const;
+
+  /** Computes the normal vectors and distances to the closest point,
+   *  locating the surface and tube points with k-d trees */
   virtual void GetNormalsAndDistancesFromClosestSurfacePoint(
       bool computeNormals,
       bool computeWeightStructures,
@@ -389,9 +617,9 @@ protected:
    *  \sa GetNormalsAndDistancesFromClosestSurfacePoint
    *  \sa GetNormalsAndDistancesFromClosestSurfacePointThreaderCallback */
   virtual void ThreadedGetNormalsAndDistancesFromClosestSurfacePoint(
-      vtkPointLocator * surfacePointLocator,
+      const PointLocatorType * surfacePointLocator,
       vtkFloatArray * surfaceNormalData,
-      vtkPointLocator * tubePointLocator,
+      const PointLocatorType * tubePointLocator,
       vtkFloatArray * tubeNormal1Data,
       vtkFloatArray * tubeNormal2Data,
       vtkFloatArray * tubeRadiusData,
@@ -403,6 +631,10 @@ protected:
       bool computeWeightRegularizations,
       int threadId );
 
+  /** Fills a point locator with the points of a polydata. */
+  void SetupPointLocator( BorderSurfaceType * surface,
+    PointLocatorType * pointLocator ) const;
+
   /** Computes the weighting factor w from the distance to the border using
    *  exponential decay.  The weight should be 1 near the border and 0 away
    *  from the border. */
@@ -433,9 +665,9 @@ private:
   struct AnisotropicDiffusiveSparseRegistrationFilterThreadStruct
     {
     AnisotropicDiffusiveSparseRegistrationFilter * Filter;
-    vtkPointLocator * SurfacePointLocator;
+    const PointLocatorType * SurfacePointLocator;
     vtkFloatArray * SurfaceNormalData;
-    vtkPointLocator * TubePointLocator;
+    const PointLocatorType * TubePointLocator;
     vtkFloatArray * TubeNormal1Data;
     vtkFloatArray * TubeNormal2Data;
     vtkFloatArray * TubeRadiusData;
@@ -459,6 +691,25 @@ private:
       GetNormalsAndDistancesFromClosestSurfacePointThreaderCallback(
           void * arg );
 
+  /** This callback method splits the narrow band voxels into ranges that
+   * it passes to ThreadedComputeNarrowBand for processing. */
+  static ITK_THREAD_RETURN_TYPE ComputeNarrowBandThreaderCallback(
+      void * arg );
+
+  /** This callback method splits the narrow band voxels into ranges that
+   * it passes to ThreadedComputeNarrowBandNormalComponentDerivatives for
+   * processing. */
+  static ITK_THREAD_RETURN_TYPE
+      ComputeNarrowBandNormalComponentDerivativesThreaderCallback(
+          void * arg );
+
+  /** Sets up the point locators and the normal data of the border surface
+   * and of the tube surface in the thread struct. */
+  void SetupClosestSurfacePointSearch(
+      AnisotropicDiffusiveSparseRegistrationFilterThreadStruct & str,
+      typename PointLocatorType::Pointer & surfacePointLocator,
+      typename PointLocatorType::Pointer & tubePointLocator );
+
   /** Organ boundary surface and surface of border normals */
   BorderSurfacePointer                m_BorderSurface;
   TubeListPointer                     m_TubeList;
@@ -485,6 +736,35 @@ private:
   WeightComponentType                 m_Lambda;
   WeightComponentType                 m_Gamma;
 
+  /** Narrow band storage: buffer offsets of the band voxels in the output
+   *  of the current level, and their normals and weights */
+  double                              m_NarrowBandWidth;
+  WeightComponentType                 m_NarrowBandWeightTolerance;
+  bool                                m_NarrowBandNormalsComputed;
+  std::vector< OffsetValueType >      m_NarrowBandOffsets;
+  std::vector< NormalMatrixType >     m_NarrowBandNormalMatrices;
+  std::vector< WeightMatrixType >     m_NarrowBandWeightStructures;
+  std::vector< WeightComponentType >  m_NarrowBandWeightRegularizations;
+
+  /** Narrow band regularization storage, indexed as the band offsets: the
+   *  band indices of the stencil neighbors of each band voxel ( -1 away
+   *  from the band ), the diffusion tensors and their derivatives for each
+   *  term, the multiplication vectors NAN_l for each l, and the normal
+   *  deformation components and their derivatives for each l */
+  std::vector< OffsetValueType >      m_NarrowBandNeighbors;
+  std::vector< std::vector< DiffusionTensorType > >
+                                      m_NarrowBandDiffusionTensors;
+  std::vector< std::vector< TensorDerivativeType > >
+                                      m_NarrowBandDiffusionTensorDerivatives;
+  std::vector< std::vector< DeformationVectorType > >
+                                      m_NarrowBandMultiplicationVectors;
+  std::vector< DeformationVectorType >
+                                      m_NarrowBandNormalComponents;
+  std::vector< std::vector< ScalarDerivativeType > >
+                            m_NarrowBandNormalFirstOrderDerivatives;
+  std::vector< std::vector< TensorDerivativeType > >
+                            m_NarrowBandNormalSecondOrderDerivatives;
+
 }; // End class AnisotropicDiffusiveSparseRegistrationFilter
 
 } // End namespace tube
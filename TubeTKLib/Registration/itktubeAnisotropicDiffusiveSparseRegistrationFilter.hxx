@@ -30,16 +30,18 @@ limitations under the License.
 #include "itktubeDiffusiveRegistrationFilterUtils.h"
 #include "tubeTubeMath.h"
 
+#include <itkImageRegionConstIteratorWithIndex.h>
 #include <itkImageRegionSplitter.h>
 #include <itktubeSmoothingRecursiveGaussianImageFilter.h>
 
 #include <vtkFloatArray.h>
 #include <vtkPointData.h>
-#include <vtkPointLocator.h>
 #include <vtkPolyData.h>
 #include <vtkPolyDataNormals.h>
 #include <vtkVersion.h>
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -68,6 +70,11 @@ AnisotropicDiffusiveSparseRegistrationFilter
   // Lambda/gamma used to calculate weight from distance
   m_Lambda  = 0.01;
   m_Gamma   = -1.0;
+
+  // By default, compute the normals and weights over the entire image
+  m_NarrowBandWidth           = 0;
+  m_NarrowBandWeightTolerance = 0.01;
+  m_NarrowBandNormalsComputed = false;
 }
 
 /**
@@ -112,6 +119,11 @@ AnisotropicDiffusiveSparseRegistrationFilter
     }
   os << indent << "lambda: " << m_Lambda << std::endl;
   os << indent << "gamma: " << m_Gamma << std::endl;
+  os << indent << "Narrow band width: " << m_NarrowBandWidth << std::endl;
+  os << indent << "Narrow band weight tolerance: "
+     << m_NarrowBandWeightTolerance << std::endl;
+  os << indent << "Number of narrow band voxels: "
+     << m_NarrowBandOffsets.size() << std::endl;
   if( m_HighResolutionNormalMatrixImage )
     {
     os << indent << "High resolution normal vector image:" << std::endl;
@@ -131,6 +143,23 @@ AnisotropicDiffusiveSparseRegistrationFilter
     }
 }
 
+/**
+ * All other initialization done before the initialize / calculate change /
+ * apply update loop
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+void
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::Initialize( void )
+{
+  // The border surface and the tube list may have changed since the last
+  // run, so the narrow band computes their normals again
+  m_NarrowBandNormalsComputed = false;
+
+  Superclass::Initialize();
+}
+
 /**
  * Setup the pointers for the deformation component images
  */
@@ -147,6 +176,32 @@ AnisotropicDiffusiveSparseRegistrationFilter
   // use to store data computed before/during the registration
   OutputImagePointer output = this->GetOutput();
 
+  // In the narrow band mode, only the SMOOTH_TANGENTIAL term is summed
+  // over the image.  The normal components and their derivatives are
+  // stored for the band voxels only.
+  if( this->GetUseNarrowBand() )
+    {
+    this->SetDeformationComponentImage( SMOOTH_TANGENTIAL, output );
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      ScalarDerivativeImagePointer firstOrder =
+        ScalarDerivativeImageType::New();
+      DiffusiveRegistrationFilterUtils::AllocateSpaceForImage(
+        firstOrder, output );
+      TensorDerivativeImagePointer secondOrder =
+        TensorDerivativeImageType::New();
+      DiffusiveRegistrationFilterUtils::AllocateSpaceForImage(
+        secondOrder, output );
+      this->SetDeformationComponentFirstOrderDerivative( SMOOTH_TANGENTIAL,
+        i, firstOrder );
+      this->SetDeformationComponentSecondOrderDerivative( SMOOTH_TANGENTIAL,
+        i, secondOrder );
+      }
+
+    this->SetupNormalMatrixAndWeightImages();
+    return;
+    }
+
   // Setup pointers to the deformation component images - we have the
   // TANGENTIAL component, which is the entire deformation field, and the
   // NORMAL component, which is the deformation vectors projected onto their
@@ -211,6 +266,13 @@ AnisotropicDiffusiveSparseRegistrationFilter
   assert( this->GetComputeRegularizationTerm() );
   assert( this->GetOutput() );
 
+  // The narrow band is computed directly at the resolution of each level
+  if( this->GetUseNarrowBand() )
+    {
+    this->ComputeNarrowBand();
+    return;
+    }
+
   // Whether or not we must compute the normal vector and/or weight images
   bool computeNormals = !m_NormalMatrixImage;
   bool computeWeightStructures = !m_WeightStructuresImage;
@@ -423,31 +485,28 @@ AnisotropicDiffusiveSparseRegistrationFilter
     }
 
   // We store the tube point positions and two normals in a vtkPolyData,
-  // so that
-  // later we can search through them using a vtkPointLocator.  Otherwise,
-  // to
-  // determine the normal matrix and weightings later on we will have a
-  // nested
-  // loop iterating through each tube point for each voxel coordinate
-  // - which
-  // takes forever.  As far as I know, the ITK point locator is not in the
-  // Slicer ITK that tubeTK relies on.
-
-  // Setup the normal float arrays for the tubes
+  // so that later we can search through them using a KdTreePointLocator.
+  // Otherwise, to determine the normal matrix and weightings later on we
+  // will have a nested loop iterating through each tube point for each
+  // voxel coordinate - which takes forever.
+
+  // Setup the normal float arrays for the tubes.  vtkPoints require three
+  // components, and the normals are stored like the polydata normals of
+  // the border surface, so all are three component arrays, also in 2D.
   vtkSmartPointer< vtkFloatArray > positionFloatArray =
     vtkSmartPointer< vtkFloatArray >::New();
-  positionFloatArray->SetNumberOfComponents( ImageDimension );
+  positionFloatArray->SetNumberOfComponents( 3 );
   positionFloatArray->SetNumberOfTuples( numPoints );
 
   vtkSmartPointer< vtkFloatArray > normal1FloatArray =
     vtkSmartPointer< vtkFloatArray >::New();
-  normal1FloatArray->SetNumberOfComponents( ImageDimension );
+  normal1FloatArray->SetNumberOfComponents( 3 );
   normal1FloatArray->SetNumberOfTuples( numPoints );
   normal1FloatArray->SetName( "normal1" );
 
   vtkSmartPointer< vtkFloatArray > normal2FloatArray =
     vtkSmartPointer< vtkFloatArray >::New();
-  normal2FloatArray->SetNumberOfComponents( ImageDimension );
+  normal2FloatArray->SetNumberOfComponents( 3 );
   normal2FloatArray->SetNumberOfTuples( numPoints );
   normal2FloatArray->SetName( "normal2" );
 
@@ -462,6 +521,7 @@ AnisotropicDiffusiveSparseRegistrationFilter
   typename TubePointType::CovariantVectorType pointNormal1;
   typename TubePointType::CovariantVectorType pointNormal2;
   float radius;
+  double tuple[3];
   int pointCounter = 0;
   for( typename TubeListType::iterator tubeIt = m_TubeList->begin();
        tubeIt != m_TubeList->end();
@@ -480,12 +540,22 @@ AnisotropicDiffusiveSparseRegistrationFilter
       pointNormal1 = point->GetNormal1();
       pointNormal2 = point->GetNormal2();
       radius = point->GetRadius();
-      positionFloatArray->SetTuple( pointCounter,
-                                    pointPosition.GetDataPointer() );
-      normal1FloatArray->SetTuple( pointCounter,
-                                   pointNormal1.GetDataPointer() );
-      normal2FloatArray->SetTuple( pointCounter,
-                                   pointNormal2.GetDataPointer() );
+      tuple[0] = tuple[1] = tuple[2] = 0.0;
+      for( unsigned int i = 0; i < ImageDimension; i++ )
+        {
+        tuple[i] = pointPosition[i];
+        }
+      positionFloatArray->SetTuple( pointCounter, tuple );
+      for( unsigned int i = 0; i < ImageDimension; i++ )
+        {
+        tuple[i] = pointNormal1[i];
+        }
+      normal1FloatArray->SetTuple( pointCounter, tuple );
+      for( unsigned int i = 0; i < ImageDimension; i++ )
+        {
+        tuple[i] = pointNormal2[i];
+        }
+      normal2FloatArray->SetTuple( pointCounter, tuple );
       radiusFloatArray->SetValue( pointCounter, radius );
       pointCounter++;
       }
@@ -510,42 +580,39 @@ AnisotropicDiffusiveSparseRegistrationFilter
 }
 
 /**
- * Computes the normal vectors and distances to the closest point
+ * Sets up the point locators and the normal data of the border surface and
+ * of the tube surface
  */
 template< class TFixedImage, class TMovingImage, class TDeformationField >
 void
 AnisotropicDiffusiveSparseRegistrationFilter
   < TFixedImage, TMovingImage, TDeformationField >
-::GetNormalsAndDistancesFromClosestSurfacePoint(
-    bool computeNormals,
-    bool computeWeightStructures,
-    bool computeWeightRegularizations )
+::SetupClosestSurfacePointSearch(
+    AnisotropicDiffusiveSparseRegistrationFilterThreadStruct & str,
+    typename PointLocatorType::Pointer & surfacePointLocator,
+    typename PointLocatorType::Pointer & tubePointLocator )
 {
   // Setup the point locator and get the normals from the surface polydata
-  vtkSmartPointer< vtkPointLocator > surfacePointLocator = 0;
+  surfacePointLocator = 0;
   vtkFloatArray * surfaceNormalData = 0;
   if( this->GetBorderSurface() )
     {
-    surfacePointLocator = vtkSmartPointer< vtkPointLocator >::New();
-    surfacePointLocator->SetDataSet( m_BorderSurface );
-    surfacePointLocator->Initialize();
-    surfacePointLocator->BuildLocator();
+    surfacePointLocator = PointLocatorType::New();
+    this->SetupPointLocator( m_BorderSurface, surfacePointLocator );
     surfaceNormalData = static_cast< vtkFloatArray * >(
         m_BorderSurface->GetPointData()->GetNormals() );
     assert( surfaceNormalData );
     }
 
   // Create a vtk polydata representing the tube points and associated normals
-  vtkSmartPointer< vtkPointLocator > tubePointLocator = 0;
+  tubePointLocator = 0;
   vtkFloatArray * tubeNormal1Data = 0;
   vtkFloatArray * tubeNormal2Data = 0;
   vtkFloatArray * tubeRadiusData = 0;
   if( this->GetTubeSurface() )
     {
-    tubePointLocator = vtkSmartPointer< vtkPointLocator >::New();
-    tubePointLocator->SetDataSet( m_TubeSurface );
-    tubePointLocator->Initialize();
-    tubePointLocator->BuildLocator();
+    tubePointLocator = PointLocatorType::New();
+    this->SetupPointLocator( m_TubeSurface, tubePointLocator );
     tubeNormal1Data = static_cast< vtkFloatArray * >(
         m_TubeSurface->GetFieldData()->GetArray( "normal1" ) );
     tubeNormal2Data = static_cast< vtkFloatArray * >(
@@ -557,15 +624,33 @@ AnisotropicDiffusiveSparseRegistrationFilter
     assert( tubeRadiusData );
     }
 
-  // Set up struct for multithreaded processing.
-  AnisotropicDiffusiveSparseRegistrationFilterThreadStruct str;
   str.Filter = this;
-  str.SurfacePointLocator = surfacePointLocator;
+  str.SurfacePointLocator = surfacePointLocator.GetPointer();
   str.SurfaceNormalData = surfaceNormalData;
-  str.TubePointLocator = tubePointLocator;
+  str.TubePointLocator = tubePointLocator.GetPointer();
   str.TubeNormal1Data = tubeNormal1Data;
   str.TubeNormal2Data = tubeNormal2Data;
   str.TubeRadiusData = tubeRadiusData;
+}
+
+/**
+ * Computes the normal vectors and distances to the closest point
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+void
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::GetNormalsAndDistancesFromClosestSurfacePoint(
+    bool computeNormals,
+    bool computeWeightStructures,
+    bool computeWeightRegularizations )
+{
+  // Set up struct for multithreaded processing.
+  AnisotropicDiffusiveSparseRegistrationFilterThreadStruct str;
+  typename PointLocatorType::Pointer surfacePointLocator = 0;
+  typename PointLocatorType::Pointer tubePointLocator = 0;
+  this->SetupClosestSurfacePointSearch( str, surfacePointLocator,
+    tubePointLocator );
   str.NormalMatrixImageLargestPossibleRegion
       = m_NormalMatrixImage->GetLargestPossibleRegion();
   str.WeightStructuresImageLargestPossibleRegion
@@ -592,6 +677,32 @@ AnisotropicDiffusiveSparseRegistrationFilter
   this->m_WeightRegularizationsImage->Modified();
 }
 
+/**
+ * Fills a point locator with the points of a polydata
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+void
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::SetupPointLocator( BorderSurfaceType * surface,
+  PointLocatorType * pointLocator ) const
+{
+  // vtkPolyData points always have three components
+  double coord[3];
+  typename PointLocatorType::PointContainerType points(
+    surface->GetNumberOfPoints() );
+  for( vtkIdType id = 0; id < surface->GetNumberOfPoints(); id++ )
+    {
+    surface->GetPoint( id, coord );
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      points[id][i] = coord[i];
+      }
+    }
+  pointLocator->SetPoints( points );
+  pointLocator->Initialize();
+}
+
 /**
  * Calls ThreadedGetNormalsAndDistancesFromClosestSurfacePoint for
  * processing
@@ -604,13 +715,13 @@ AnisotropicDiffusiveSparseRegistrationFilter
   void * arg )
 {
   int threadId =
-    ( ( MultiThreader::ThreadInfoStruct * )( arg ) )->ThreadID;
+    ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->WorkUnitID;
   int threadCount =
-    ( ( MultiThreader::ThreadInfoStruct * )( arg ) )->NumberOfThreads;
+    ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->NumberOfWorkUnits;
 
   AnisotropicDiffusiveSparseRegistrationFilterThreadStruct * str
       = ( AnisotropicDiffusiveSparseRegistrationFilterThreadStruct * )
-            ( ( ( MultiThreader::ThreadInfoStruct * )( arg ) )->UserData );
+            ( ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
 
   // Execute the actual method with appropriate output region
   // First find out how many pieces extent can be split into.
@@ -663,13 +774,13 @@ AnisotropicDiffusiveSparseRegistrationFilter
         threadId );
     }
 
-  return ITK_THREAD_RETURN_VALUE;
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
 }
 
 /**
  * Does the actual work of computing the normal vectors and distances to
  * the
- * closest point given an initialized vtkPointLocator and the surface
+ * closest point given initialized point locators and the surface
  * border normals
  */
 template< class TFixedImage, class TMovingImage, class TDeformationField >
@@ -677,9 +788,9 @@ void
 AnisotropicDiffusiveSparseRegistrationFilter
   < TFixedImage, TMovingImage, TDeformationField >
 ::ThreadedGetNormalsAndDistancesFromClosestSurfacePoint(
-    vtkPointLocator * surfacePointLocator,
+    const PointLocatorType * surfacePointLocator,
     vtkFloatArray * surfaceNormalData,
-    vtkPointLocator * tubePointLocator,
+    const PointLocatorType * tubePointLocator,
     vtkFloatArray * tubeNormal1Data,
     vtkFloatArray * tubeNormal2Data,
     vtkFloatArray * tubeRadiusData,
@@ -714,21 +825,11 @@ AnisotropicDiffusiveSparseRegistrationFilter
   itk::Point< double, ImageDimension >  imageCoord;
   imageCoord.Fill( 0 );
 
-  vtkIdType                             surfaceId = -1;
-  WeightComponentType                   surfaceDistance = 0;
-  vtkIdType                             tubeId = -1;
-  WeightComponentType                   tubeDistance = 0;
-
   NormalMatrixType                      normalMatrix;
   normalMatrix.Fill( 0 );
-
-  WeightMatrixType                      surfaceWeightMatrix;
-  surfaceWeightMatrix.Fill( 0 );
-  surfaceWeightMatrix( 0, 0 ) = 1.0;
-  WeightMatrixType                      tubeWeightMatrix;
-  tubeWeightMatrix.Fill( 0 );
-  tubeWeightMatrix( 0, 0 ) = 1.0;
-  tubeWeightMatrix( 1, 1 ) = 1.0;
+  WeightComponentType                   distance = 0;
+  WeightMatrixType                      weightStructures;
+  weightStructures.Fill( 0 );
 
   // Determine the normals of and the distances to the nearest border point
   for( normalIt.GoToBegin(),
@@ -736,112 +837,117 @@ AnisotropicDiffusiveSparseRegistrationFilter
        !normalIt.IsAtEnd();
        ++normalIt, ++weightRegularizationsIt, ++weightStructuresIt )
     {
-    surfaceDistance = 100000000.0;
-    tubeDistance = 100000000.0;
-
-    // Find the id of the closest surface point to the current voxel
     m_NormalMatrixImage->TransformIndexToPhysicalPoint( normalIt.GetIndex(),
                                                         imageCoord );
-    if( surfacePointLocator )
+    this->ComputeNormalAndDistanceFromClosestSurfacePoint( imageCoord,
+      surfacePointLocator, surfaceNormalData, tubePointLocator,
+      tubeNormal1Data, tubeNormal2Data, tubeRadiusData, normalMatrix,
+      distance, weightStructures );
+
+    if( computeNormals )
       {
-      surfaceId = surfacePointLocator->FindClosestPoint(
-          imageCoord.GetDataPointer() );
-      double borderCoord[ImageDimension];
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-        {
-        borderCoord[i] = 0.0;
-        }
-      m_BorderSurface->GetPoint( surfaceId, borderCoord );
-      surfaceDistance = 0.0;
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-        {
-        surfaceDistance += std::pow( imageCoord[i] - borderCoord[i], 2 );
-        }
-      surfaceDistance = std::sqrt( surfaceDistance );
+      normalIt.Set( normalMatrix );
       }
-    if( tubePointLocator )
+    if( computeWeightRegularizations )
       {
-      tubeId = tubePointLocator->FindClosestPoint(
-          imageCoord.GetDataPointer() );
-      double centerlineCoord[ImageDimension];
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-        {
-        centerlineCoord[i] = 0.0;
-        }
-      m_TubeSurface->GetPoint( tubeId, centerlineCoord );
-
-      // We want the distance to the tube surface, not the centerline point
-      // Project the current index coordinate onto the plane defined by the
-      // tube centerline point and its two normals, and consider the
-      // distance
-      // to the surface via the radius.
-      float normal1[ImageDimension];
-      float normal2[ImageDimension];
+      weightRegularizationsIt.Set( distance );
+      }
+    if( computeWeightStructures )
+      {
+      weightStructuresIt.Set( weightStructures );
+      }
+    }
+}
+
+/**
+ * Computes the normal matrix, the distance and the weight structures given
+ * by the surface or tube point closest to a physical point
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+void
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::ComputeNormalAndDistanceFromClosestSurfacePoint(
+    const typename PointLocatorType::PointType & imageCoord,
+    const PointLocatorType * surfacePointLocator,
+    vtkFloatArray * surfaceNormalData,
+    const PointLocatorType * tubePointLocator,
+    vtkFloatArray * tubeNormal1Data,
+    vtkFloatArray * tubeNormal2Data,
+    vtkFloatArray * tubeRadiusData,
+    NormalMatrixType & normalMatrix,
+    WeightComponentType & distance,
+    WeightMatrixType & weightStructures ) const
+{
+  typename PointLocatorType::IdentifierType surfaceId = 0;
+  double                                closestDistance = 0;
+  WeightComponentType                   surfaceDistance = 100000000.0;
+  typename PointLocatorType::IdentifierType tubeId = 0;
+  WeightComponentType                   tubeDistance = 100000000.0;
+
+  // Find the id of the closest surface point to the current voxel
+  if( surfacePointLocator )
+    {
+    surfaceId = surfacePointLocator->FindClosestPoint( imageCoord,
+      closestDistance );
+    surfaceDistance = closestDistance;
+    }
+  if( tubePointLocator )
+    {
+    tubeId = tubePointLocator->FindClosestPoint( imageCoord );
+    // vtkPolyData points always have three components
+    double centerlineCoord[3];
+    m_TubeSurface->GetPoint( tubeId, centerlineCoord );
+
+    // We want the distance to the tube surface, not the centerline point
+    // Project the current index coordinate onto the plane defined by the
+    // tube centerline point and its two normals, and consider the distance
+    // to the surface via the radius.
+    // The normal arrays always have three components
+    float normal1[3];
+    float normal2[3];
 #if VTK_MAJOR_VERSION < 7
-      tubeNormal1Data->GetTupleValue( tubeId, normal1 );
-      tubeNormal2Data->GetTupleValue( tubeId, normal2 );
+    tubeNormal1Data->GetTupleValue( tubeId, normal1 );
+    tubeNormal2Data->GetTupleValue( tubeId, normal2 );
 #else
-      tubeNormal1Data->GetTypedTuple( tubeId, normal1 );
-      tubeNormal2Data->GetTypedTuple( tubeId, normal2 );
+    tubeNormal1Data->GetTypedTuple( tubeId, normal1 );
+    tubeNormal2Data->GetTypedTuple( tubeId, normal2 );
 #endif
 
-      double distanceToCenterCoord = ComputeDistanceToPointOnPlane(
-            centerlineCoord, normal1, normal2, imageCoord );
-      tubeDistance =
-        std::abs( distanceToCenterCoord
-          - tubeRadiusData->GetValue( tubeId ) );
-      }
+    double distanceToCenterCoord = ComputeDistanceToPointOnPlane(
+          centerlineCoord, normal1, normal2, imageCoord );
+    tubeDistance =
+      std::abs( distanceToCenterCoord - tubeRadiusData->GetValue( tubeId ) );
+    }
 
-    // Find the normal of the surface point that is closest to the
-    // current voxel
-    if( computeNormals )
+  // Find the normal of the surface point that is closest to the current
+  // voxel
+  normalMatrix.Fill( 0 );
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    if( surfaceDistance <= tubeDistance )
       {
-      normalMatrix.Fill( 0 );
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-        {
-        if( surfaceDistance <= tubeDistance )
-          {
-          normalMatrix( i, 0 ) =
-            surfaceNormalData->GetValue( surfaceId * ImageDimension + i );
-          }
-        else
-          {
-          normalMatrix( i, 0 ) =
-            tubeNormal1Data->GetValue( tubeId * ImageDimension + i );
-          normalMatrix( i, 1 ) =
-            tubeNormal2Data->GetValue( tubeId * ImageDimension + i );
-          }
-        }
-      normalIt.Set( normalMatrix );
+      normalMatrix( i, 0 ) = surfaceNormalData->GetComponent( surfaceId, i );
       }
-
-    // Calculate distance between the current coordinate and the border
-    // surface
-    // coordinate
-    if( computeWeightRegularizations )
+    else
       {
-      if( surfaceDistance <= tubeDistance )
-        {
-        weightRegularizationsIt.Set( surfaceDistance );
-        }
-      else
-        {
-        weightRegularizationsIt.Set( tubeDistance );
-        }
+      normalMatrix( i, 0 ) = tubeNormal1Data->GetComponent( tubeId, i );
+      normalMatrix( i, 1 ) = tubeNormal2Data->GetComponent( tubeId, i );
       }
+    }
 
-    // Determine the weight structures based on the structure type
-    if( computeWeightStructures )
-      {
-      if( surfaceDistance <= tubeDistance )
-        {
-        weightStructuresIt.Set( surfaceWeightMatrix );
-        }
-      else
-        {
-        weightStructuresIt.Set( tubeWeightMatrix );
-        }
-      }
+  // Determine the distance to the border and the weight structures based
+  // on the structure type
+  weightStructures.Fill( 0 );
+  weightStructures( 0, 0 ) = 1.0;
+  if( surfaceDistance <= tubeDistance )
+    {
+    distance = surfaceDistance;
+    }
+  else
+    {
+    distance = tubeDistance;
+    weightStructures( 1, 1 ) = 1.0;
     }
 }
 
@@ -987,88 +1093,544 @@ AnisotropicDiffusiveSparseRegistrationFilter
 }
 
 /**
- * Calculates the weighting between the anisotropic diffusive and diffusive
- * regularizations, based on a given distance from a voxel to the border,
- * using
- * exponential decay.
+ * Finds the voxels of the output within the narrow band, and computes their
+ * normals and weights
  */
 template< class TFixedImage, class TMovingImage, class TDeformationField >
-typename AnisotropicDiffusiveSparseRegistrationFilter
-  < TFixedImage, TMovingImage, TDeformationField >
-::WeightComponentType
+void
 AnisotropicDiffusiveSparseRegistrationFilter
   < TFixedImage, TMovingImage, TDeformationField >
-::ComputeWeightFromDistanceExponential( const WeightComponentType
-  distance ) const
+::ComputeNarrowBand( void )
 {
-  return std::exp( -1.0 * m_Lambda * distance );
+  assert( this->GetComputeRegularizationTerm() );
+  assert( this->GetOutput() );
+
+  // Ensure we have a border surface or a tube list to work with
+  if( !this->GetBorderSurface() && !this->GetTubeList() )
+    {
+    itkExceptionMacro( << "You must provide a border surface, or a tube "
+      << "list, or both a normal matrix image and a weight "
+      << "image" );
+    }
+
+  // The normals of the border surface and of the tubes are computed once
+  // per run, or again when the surface, the tubes or the band width change
+  if( !m_NarrowBandNormalsComputed )
+    {
+    if( this->GetBorderSurface() )
+      {
+      this->ComputeBorderSurfaceNormals();
+      }
+    if( this->GetTubeList() )
+      {
+      m_TubeSurface = 0;
+      this->ComputeTubeNormals();
+      }
+    m_NarrowBandNormalsComputed = true;
+    }
+
+  AnisotropicDiffusiveSparseRegistrationFilterThreadStruct str;
+  typename PointLocatorType::Pointer surfacePointLocator = 0;
+  typename PointLocatorType::Pointer tubePointLocator = 0;
+  this->SetupClosestSurfacePointSearch( str, surfacePointLocator,
+    tubePointLocator );
+
+  // Widen the band to where w is negligible, so that setting w = 0 beyond
+  // its edge does not introduce a discontinuity in the regularization
+  double bandWidth = m_NarrowBandWidth;
+  const double minimumBandWidth = this->GetNarrowBandMinimumWidth();
+  if( bandWidth < minimumBandWidth )
+    {
+    itkWarningMacro( << "Narrow band width " << bandWidth
+      << " widened to " << minimumBandWidth << ", where w falls below "
+      << m_NarrowBandWeightTolerance );
+    bandWidth = minimumBandWidth;
+    }
+
+  // Mark the voxels within the band of the border surface points, and
+  // within the band of the tube surfaces around the tube points
+  std::vector< bool > isInBand(
+    this->GetOutput()->GetBufferedRegion().GetNumberOfPixels(), false );
+  typename PointLocatorType::PointType point;
+  point.Fill( 0 );
+  // vtkPolyData points always have three components
+  double coord[3];
+  if( m_BorderSurface )
+    {
+    for( vtkIdType id = 0; id < m_BorderSurface->GetNumberOfPoints(); id++ )
+      {
+      m_BorderSurface->GetPoint( id, coord );
+      for( unsigned int i = 0; i < ImageDimension; i++ )
+        {
+        point[i] = coord[i];
+        }
+      this->MarkNarrowBandVoxels( point, bandWidth, isInBand );
+      }
+    }
+  if( m_TubeSurface )
+    {
+    for( vtkIdType id = 0; id < m_TubeSurface->GetNumberOfPoints(); id++ )
+      {
+      m_TubeSurface->GetPoint( id, coord );
+      for( unsigned int i = 0; i < ImageDimension; i++ )
+        {
+        point[i] = coord[i];
+        }
+      this->MarkNarrowBandVoxels( point,
+        str.TubeRadiusData->GetValue( id ) + bandWidth, isInBand );
+      }
+    }
+
+  // The divergence at a band voxel reads the first derivatives of the
+  // normal deformation components and of the tensors at its neighbors,
+  // which in turn read their own neighbors.  Dilate the band by twice the
+  // stencil radius, so that these reads only reach the zero normal
+  // components and the diffusive tensors away from the band where w is
+  // negligible.
+  typename OutputImageType::SizeType stencilRadius =
+    this->GetRegistrationFunctionPointer()->GetRadius();
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    stencilRadius[i] *= 2;
+    }
+  this->DilateNarrowBand( stencilRadius, isInBand );
+
+  // Store the band voxels in buffer order
+  m_NarrowBandOffsets.clear();
+  for( SizeValueType i = 0; i < isInBand.size(); i++ )
+    {
+    if( isInBand[i] )
+      {
+      m_NarrowBandOffsets.push_back( i );
+      }
+    }
+  m_NarrowBandNormalMatrices.resize( m_NarrowBandOffsets.size() );
+  m_NarrowBandWeightStructures.resize( m_NarrowBandOffsets.size() );
+  m_NarrowBandWeightRegularizations.resize( m_NarrowBandOffsets.size() );
+
+  std::cout << "Computing normals and weights in a narrow band of "
+            << m_NarrowBandOffsets.size() << " voxels... " << std::endl;
+
+  // Multithread the execution
+  this->GetMultiThreader()->SetNumberOfThreads( this->GetNumberOfThreads() );
+  this->GetMultiThreader()->SetSingleMethod(
+      this->ComputeNarrowBandThreaderCallback, & str );
+  this->GetMultiThreader()->SingleMethodExecute();
+
+  // Compute the weights from the distances
+  bool useExponential = ( m_Gamma == -1.0 );
+  for( SizeValueType i = 0; i < m_NarrowBandOffsets.size(); i++ )
+    {
+    if( useExponential )
+      {
+      m_NarrowBandWeightRegularizations[i] =
+        this->ComputeWeightFromDistanceExponential(
+          m_NarrowBandWeightRegularizations[i] );
+      }
+    else
+      {
+      m_NarrowBandWeightRegularizations[i] =
+        this->ComputeWeightFromDistanceDirac(
+          m_NarrowBandWeightRegularizations[i] );
+      }
+    }
+
+  this->ComputeNarrowBandNeighbors();
+
+  std::cout << "Finished computing normals and weights." << std::endl;
 }
 
 /**
- * Calculates the weighting between the anisotropic diffusive and diffusive
- * regularizations, based on a given distance from a voxel to the border,
- * using
- * a Dirac-shaped function
+ * Finds the band indices of the stencil neighbors of the band voxels
  */
 template< class TFixedImage, class TMovingImage, class TDeformationField >
-typename AnisotropicDiffusiveSparseRegistrationFilter
+void
+AnisotropicDiffusiveSparseRegistrationFilter
   < TFixedImage, TMovingImage, TDeformationField >
-::WeightComponentType
+::ComputeNarrowBandNeighbors( void )
+{
+  const OutputImageType * output = this->GetOutput();
+  const typename OutputImageType::RegionType & bufferedRegion =
+    output->GetBufferedRegion();
+  const typename OutputImageType::IndexType firstIndex =
+    bufferedRegion.GetIndex();
+  const typename OutputImageType::IndexType lastIndex =
+    bufferedRegion.GetUpperIndex();
+
+  unsigned int stencilSize = 1;
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    stencilSize *= 3;
+    }
+  const SizeValueType numberOfVoxels = m_NarrowBandOffsets.size();
+  m_NarrowBandNeighbors.assign( numberOfVoxels * stencilSize, -1 );
+
+  typename OutputImageType::IndexType index;
+  typename OutputImageType::IndexType neighborIndex;
+  typename std::vector< OffsetValueType >::const_iterator neighborIt;
+  for( SizeValueType k = 0; k < numberOfVoxels; k++ )
+    {
+    index = output->ComputeIndex( m_NarrowBandOffsets[k] );
+    for( unsigned int p = 0; p < stencilSize; p++ )
+      {
+      // The neighbors outside the image are clamped to its boundary, as by
+      // the zero flux Neumann boundary condition
+      unsigned int position = p;
+      for( unsigned int i = 0; i < ImageDimension; i++ )
+        {
+        neighborIndex[i] = index[i]
+          + static_cast< IndexValueType >( position % 3 ) - 1;
+        neighborIndex[i] = std::max( neighborIndex[i], firstIndex[i] );
+        neighborIndex[i] = std::min( neighborIndex[i], lastIndex[i] );
+        position /= 3;
+        }
+      const OffsetValueType neighborOffset =
+        output->ComputeOffset( neighborIndex );
+      neighborIt = std::lower_bound( m_NarrowBandOffsets.begin(),
+        m_NarrowBandOffsets.end(), neighborOffset );
+      if( neighborIt != m_NarrowBandOffsets.end()
+        && *neighborIt == neighborOffset )
+        {
+        m_NarrowBandNeighbors[k * stencilSize + p] =
+          neighborIt - m_NarrowBandOffsets.begin();
+        }
+      }
+    }
+}
+
+/**
+ * Returns the position of a neighbor within the stencil of the narrow band
+ * neighbors
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+unsigned int
 AnisotropicDiffusiveSparseRegistrationFilter
   < TFixedImage, TMovingImage, TDeformationField >
-::ComputeWeightFromDistanceDirac( const WeightComponentType
-  distance ) const
+::GetNarrowBandStencilPosition(
+    const typename OutputImageType::OffsetType & offset )
 {
-  return 1.0 - ( 1.0 / ( 1.0 + m_Lambda * m_Gamma *
-    std::exp( -1.0 * m_Lambda * distance * distance ) ) );
+  unsigned int position = 0;
+  unsigned int stride = 1;
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    position += static_cast< unsigned int >( offset[i] + 1 ) * stride;
+    stride *= 3;
+    }
+  return position;
 }
 
 /**
- * Updates the diffusion tensor image before each run of the registration
+ * Finds the range of narrow band voxels within a region
  */
 template< class TFixedImage, class TMovingImage, class TDeformationField >
 void
 AnisotropicDiffusiveSparseRegistrationFilter
   < TFixedImage, TMovingImage, TDeformationField >
-::ComputeDiffusionTensorImages( void )
+::GetNarrowBandRange( const ThreadRegionType & region,
+    SizeValueType & firstVoxel, SizeValueType & endVoxel ) const
 {
-  assert( this->GetComputeRegularizationTerm() );
-  assert( m_NormalMatrixImage );
-  assert( m_WeightStructuresImage );
-  assert( m_WeightRegularizationsImage );
+  // The band voxels are in buffer order, so those of the region lie
+  // between the offsets of its first and last voxels
+  const OutputImageType * output = this->GetOutput();
+  const OffsetValueType firstOffset =
+    output->ComputeOffset( region.GetIndex() );
+  const OffsetValueType lastOffset =
+    output->ComputeOffset( region.GetUpperIndex() );
+  firstVoxel = std::lower_bound( m_NarrowBandOffsets.begin(),
+    m_NarrowBandOffsets.end(), firstOffset ) - m_NarrowBandOffsets.begin();
+  endVoxel = std::upper_bound( m_NarrowBandOffsets.begin(),
+    m_NarrowBandOffsets.end(), lastOffset ) - m_NarrowBandOffsets.begin();
+}
 
-  // For the anisotropic diffusive regularization, we need to setup the
-  // tangential diffusion tensors and the normal diffusion tensors
+/**
+ * Marks the voxels of the output within a distance of a point
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+void
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::MarkNarrowBandVoxels(
+    const typename PointLocatorType::PointType & point,
+    double distance,
+    std::vector< bool > & isInBand ) const
+{
+  const OutputImageType * output = this->GetOutput();
+  const typename OutputImageType::RegionType & bufferedRegion =
+    output->GetBufferedRegion();
+
+  // Bounding box of the ball in index space.  The image directions are
+  // orthonormal, so the ball spans distance / spacing voxels along each
+  // index axis.
+  ContinuousIndex< double, ImageDimension > center;
+  output->TransformPhysicalPointToContinuousIndex( point, center );
+  typename OutputImageType::RegionType box;
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    const double radius = distance / output->GetSpacing()[i];
+    IndexValueType first = Math::Floor< IndexValueType >(
+      center[i] - radius );
+    IndexValueType last = Math::Ceil< IndexValueType >(
+      center[i] + radius );
+    first = std::max( first, bufferedRegion.GetIndex( i ) );
+    last = std::min( last, static_cast< IndexValueType >(
+      bufferedRegion.GetIndex( i ) + bufferedRegion.GetSize( i ) ) - 1 );
+    if( first > last )
+      {
+      return;
+      }
+    box.SetIndex( i, first );
+    box.SetSize( i, last - first + 1 );
+    }
 
-  // Used to compute the tangential and normal diffusion tensor images:
-  // P = NAN^T
+  typename PointLocatorType::PointType voxelPoint;
+  ImageRegionConstIteratorWithIndex< OutputImageType > it( output, box );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    output->TransformIndexToPhysicalPoint( it.GetIndex(), voxelPoint );
+    if( voxelPoint.EuclideanDistanceTo( point ) <= distance )
+      {
+      isInBand[ output->ComputeOffset( it.GetIndex() ) ] = true;
+      }
+    }
+}
 
-  typedef itk::ImageRegionIterator< DiffusionTensorImageType >
-      DiffusionTensorImageRegionType;
-  typedef itk::Matrix
-      < DeformationVectorComponentType, ImageDimension, ImageDimension >
-      MatrixType;
+/**
+ * Marks the voxels of the output within a radius of the marked voxels
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+void
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::DilateNarrowBand(
+    const typename OutputImageType::SizeType & radius,
+    std::vector< bool > & isInBand ) const
+{
+  const OutputImageType * output = this->GetOutput();
+  const typename OutputImageType::RegionType & bufferedRegion =
+    output->GetBufferedRegion();
+
+  const std::vector< bool > isInUndilatedBand( isInBand );
+  typename OutputImageType::IndexType index;
+  typename OutputImageType::RegionType box;
+  for( SizeValueType i = 0; i < isInUndilatedBand.size(); i++ )
+    {
+    if( !isInUndilatedBand[i] )
+      {
+      continue;
+      }
+    index = output->ComputeIndex( static_cast< OffsetValueType >( i ) );
+    for( unsigned int j = 0; j < ImageDimension; j++ )
+      {
+      index[j] -= static_cast< IndexValueType >( radius[j] );
+      box.SetSize( j, 2 * radius[j] + 1 );
+      }
+    box.SetIndex( index );
+    box.Crop( bufferedRegion );
 
-  NormalMatrixType        N;
-  NormalMatrixType        N_transpose;
-  WeightMatrixType        A;
-  WeightComponentType     w;
-  MatrixType              P;
-  MatrixType              wP;   // wP
-  MatrixType              wP_transpose;
-  MatrixType              I_wP; // I-wP
-  MatrixType              I_wP_transpose;
+    ImageRegionConstIteratorWithIndex< OutputImageType > it( output, box );
+    for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+      {
+      isInBand[ output->ComputeOffset( it.GetIndex() ) ] = true;
+      }
+    }
+}
 
-  MatrixType              smoothTangentialMatrix;  // ( I-wP )^T * ( I-wP )
-  MatrixType              smoothNormalMatrix;      // ( I-wP )^T * wP
-  MatrixType              propTangentialMatrix;    // ( wP )^T * ( I-wP )
-  MatrixType              propNormalMatrix;        // ( wP )^T * wP
+/**
+ * Calls ThreadedComputeNarrowBand for processing
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+ITK_THREAD_RETURN_TYPE
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::ComputeNarrowBandThreaderCallback( void * arg )
+{
+  const ThreadIdType threadId =
+    ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->WorkUnitID;
+  const ThreadIdType threadCount =
+    ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->NumberOfWorkUnits;
+
+  AnisotropicDiffusiveSparseRegistrationFilterThreadStruct * str
+      = ( AnisotropicDiffusiveSparseRegistrationFilterThreadStruct * )
+            ( ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  // Split the band voxels into contiguous ranges
+  const SizeValueType numberOfVoxels =
+    str->Filter->m_NarrowBandOffsets.size();
+  const SizeValueType firstVoxel = numberOfVoxels * threadId / threadCount;
+  const SizeValueType endVoxel =
+    numberOfVoxels * ( threadId + 1 ) / threadCount;
+
+  if( firstVoxel < endVoxel )
+    {
+    str->Filter->ThreadedComputeNarrowBand(
+        str->SurfacePointLocator,
+        str->SurfaceNormalData,
+        str->TubePointLocator,
+        str->TubeNormal1Data,
+        str->TubeNormal2Data,
+        str->TubeRadiusData,
+        firstVoxel,
+        endVoxel );
+    }
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+/**
+ * Computes the normals and the distances of a range of narrow band voxels
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+void
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::ThreadedComputeNarrowBand(
+    const PointLocatorType * surfacePointLocator,
+    vtkFloatArray * surfaceNormalData,
+    const PointLocatorType * tubePointLocator,
+    vtkFloatArray * tubeNormal1Data,
+    vtkFloatArray * tubeNormal2Data,
+    vtkFloatArray * tubeRadiusData,
+    SizeValueType firstVoxel,
+    SizeValueType endVoxel )
+{
+  const OutputImageType * output = this->GetOutput();
+  typename OutputImageType::IndexType index;
+  typename PointLocatorType::PointType imageCoord;
+  for( SizeValueType i = firstVoxel; i < endVoxel; i++ )
+    {
+    index = output->ComputeIndex( m_NarrowBandOffsets[i] );
+    output->TransformIndexToPhysicalPoint( index, imageCoord );
+    this->ComputeNormalAndDistanceFromClosestSurfacePoint( imageCoord,
+      surfacePointLocator, surfaceNormalData, tubePointLocator,
+      tubeNormal1Data, tubeNormal2Data, tubeRadiusData,
+      m_NarrowBandNormalMatrices[i], m_NarrowBandWeightRegularizations[i],
+      m_NarrowBandWeightStructures[i] );
+    }
+}
+
+/**
+ * Returns the distance beyond which the weight w is below the narrow band
+ * weight tolerance
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+double
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::GetNarrowBandMinimumWidth( void ) const
+{
+  if( m_NarrowBandWeightTolerance <= 0 || m_NarrowBandWeightTolerance >= 1 )
+    {
+    itkExceptionMacro( << "Narrow band weight tolerance must be in ( 0, 1 )" );
+    }
+
+  if( m_Gamma == -1.0 )
+    {
+    // e^( -lambda*d ) < tolerance
+    return -std::log( m_NarrowBandWeightTolerance ) / m_Lambda;
+    }
+
+  // 1 - 1 / ( 1 + lambda*gamma*e^( -lambda*d^2 ) ) < tolerance
+  const double logRatio = std::log( m_Lambda * m_Gamma
+    * ( 1.0 - m_NarrowBandWeightTolerance ) / m_NarrowBandWeightTolerance );
+  if( logRatio <= 0 )
+    {
+    return 0;
+    }
+  return std::sqrt( logRatio / m_Lambda );
+}
+
+/**
+ * Calculates the weighting between the anisotropic diffusive and diffusive
+ * regularizations, based on a given distance from a voxel to the border,
+ * using
+ * exponential decay.
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+typename AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::WeightComponentType
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::ComputeWeightFromDistanceExponential( const WeightComponentType
+  distance ) const
+{
+  return std::exp( -1.0 * m_Lambda * distance );
+}
+
+/**
+ * Calculates the weighting between the anisotropic diffusive and diffusive
+ * regularizations, based on a given distance from a voxel to the border,
+ * using
+ * a Dirac-shaped function
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+typename AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::WeightComponentType
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::ComputeWeightFromDistanceDirac( const WeightComponentType
+  distance ) const
+{
+  return 1.0 - ( 1.0 / ( 1.0 + m_Lambda * m_Gamma *
+    std::exp( -1.0 * m_Lambda * distance * distance ) ) );
+}
+
+/**
+ * Updates the diffusion tensor image before each run of the registration
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+void
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::ComputeDiffusionTensorImages( void )
+{
+  assert( this->GetComputeRegularizationTerm() );
+
+  // For the anisotropic diffusive regularization, we need to setup the
+  // tangential diffusion tensors and the normal diffusion tensors
 
   DiffusionTensorType     smoothTangentialDiffusionTensor;
   DiffusionTensorType     smoothNormalDiffusionTensor;
   DiffusionTensorType     propTangentialDiffusionTensor;
   DiffusionTensorType     propNormalDiffusionTensor;
 
+  if( this->GetUseNarrowBand() )
+    {
+    // Away from the band w = 0, so the regularization is diffusive: the
+    // tensor of the SMOOTH_TANGENTIAL term summed over the image is the
+    // identity.  The four tensors of the band voxels are stored with the
+    // band.
+    smoothTangentialDiffusionTensor.SetIdentity();
+    this->GetDiffusionTensorImage( SMOOTH_TANGENTIAL )->FillBuffer(
+      smoothTangentialDiffusionTensor );
+
+    const SizeValueType numberOfVoxels = m_NarrowBandOffsets.size();
+    m_NarrowBandDiffusionTensors.resize( NumberOfNarrowBandTerms );
+    for( int t = 0; t < NumberOfNarrowBandTerms; t++ )
+      {
+      m_NarrowBandDiffusionTensors[t].resize( numberOfVoxels );
+      }
+    for( SizeValueType k = 0; k < numberOfVoxels; k++ )
+      {
+      this->ComputeDiffusionTensors( m_NarrowBandNormalMatrices[k],
+        m_NarrowBandWeightStructures[k],
+        m_NarrowBandWeightRegularizations[k],
+        m_NarrowBandDiffusionTensors[SMOOTH_TANGENTIAL][k],
+        m_NarrowBandDiffusionTensors[SMOOTH_NORMAL][k],
+        m_NarrowBandDiffusionTensors[PROP_TANGENTIAL][k],
+        m_NarrowBandDiffusionTensors[PROP_NORMAL][k] );
+      }
+    return;
+    }
+
+  assert( m_NormalMatrixImage );
+  assert( m_WeightStructuresImage );
+  assert( m_WeightRegularizationsImage );
+
+  typedef itk::ImageRegionIterator< DiffusionTensorImageType >
+      DiffusionTensorImageRegionType;
+
   // Setup iterators
   NormalMatrixImageRegionType normalIt = NormalMatrixImageRegionType(
     m_NormalMatrixImage, m_NormalMatrixImage->GetLargestPossibleRegion() );
@@ -1111,38 +1673,10 @@ AnisotropicDiffusiveSparseRegistrationFilter
     ++smoothTangentialTensorIt, ++smoothNormalTensorIt,
     ++propTangentialTensorIt, ++propNormalTensorIt )
     {
-    N = normalIt.Get();
-    A = weightStructuresIt.Get();
-    w = weightRegularizationsIt.Get();
-
-    // The matrices are used for calculations, and will be copied to the
-    // diffusion tensors afterwards.  The matrices are guaranteed to be
-    // symmetric.
-    P = N * A * N.GetTranspose(); // NAN^T
-    wP = P * w; // wP
-    I_wP.SetIdentity();
-    I_wP = I_wP - wP; // I-wP
-    I_wP_transpose = I_wP.GetTranspose(); // ( I-wP )^T
-    smoothTangentialMatrix = I_wP_transpose * I_wP;
-    // ( I-wP )^T * ( I-wP )
-    smoothNormalMatrix = I_wP_transpose * wP; // ( I-wP )^T * wP
-    wP_transpose = wP.GetTranspose(); // ( wP )^T
-    propTangentialMatrix = wP_transpose * I_wP; // ( wP )^T * ( I-wP )
-    propNormalMatrix = wP_transpose * wP; // ( wP )^T * wP
-
-    // Copy the matrices to the diffusion tensor
-    for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-      for( unsigned int j = 0; j < ImageDimension; j++ )
-        {
-        smoothTangentialDiffusionTensor( i, j ) =
-          smoothTangentialMatrix( i, j );
-        smoothNormalDiffusionTensor( i, j ) = smoothNormalMatrix( i, j );
-        propTangentialDiffusionTensor( i, j ) =
-          propTangentialMatrix( i, j );
-        propNormalDiffusionTensor( i, j ) = propNormalMatrix( i, j );
-        }
-      }
+    this->ComputeDiffusionTensors( normalIt.Get(), weightStructuresIt.Get(),
+      weightRegularizationsIt.Get(), smoothTangentialDiffusionTensor,
+      smoothNormalDiffusionTensor, propTangentialDiffusionTensor,
+      propNormalDiffusionTensor );
 
     // Copy the diffusion tensors to their images
     smoothTangentialTensorIt.Set( smoothTangentialDiffusionTensor );
@@ -1152,6 +1686,156 @@ AnisotropicDiffusiveSparseRegistrationFilter
     }
 }
 
+/**
+ * Updates the diffusion tensor image derivatives and the diffusion tensor
+ * derivatives of the narrow band voxels before each run of the
+ * registration
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+void
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::ComputeDiffusionTensorDerivativeImages( void )
+{
+  Superclass::ComputeDiffusionTensorDerivativeImages();
+
+  if( !this->GetUseNarrowBand() )
+    {
+    return;
+    }
+
+  const SpacingType spacing = this->GetOutput()->GetSpacing();
+  const RegistrationFunctionType * df =
+    this->GetRegistrationFunctionPointer();
+  assert( df );
+  const RegularizationFunctionType * reg =
+    df->GetRegularizationFunctionPointer();
+  assert( reg );
+  const bool useImageSpacing = reg->GetUseImageSpacing();
+
+  // Stencil positions of the neighbors along each dimension
+  unsigned int stencilSize = 1;
+  unsigned int positionA[ImageDimension];
+  unsigned int positionB[ImageDimension];
+  typename OutputImageType::OffsetType offset;
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    stencilSize *= 3;
+    offset.Fill( 0 );
+    offset[i] = 1;
+    positionA[i] = GetNarrowBandStencilPosition( offset );
+    offset[i] = -1;
+    positionB[i] = GetNarrowBandStencilPosition( offset );
+    }
+
+  // Away from the band, the tensors are those of the diffusive
+  // regularization
+  DiffusionTensorType awayTensors[NumberOfNarrowBandTerms];
+  for( int t = 0; t < NumberOfNarrowBandTerms; t++ )
+    {
+    awayTensors[t].Fill( 0 );
+    }
+  awayTensors[SMOOTH_TANGENTIAL].SetIdentity();
+
+  const SizeValueType numberOfVoxels = m_NarrowBandOffsets.size();
+  m_NarrowBandDiffusionTensorDerivatives.resize( NumberOfNarrowBandTerms );
+  for( int t = 0; t < NumberOfNarrowBandTerms; t++ )
+    {
+    const std::vector< DiffusionTensorType > & tensors =
+      m_NarrowBandDiffusionTensors[t];
+    std::vector< TensorDerivativeType > & tensorDerivatives =
+      m_NarrowBandDiffusionTensorDerivatives[t];
+    tensorDerivatives.resize( numberOfVoxels );
+    for( SizeValueType k = 0; k < numberOfVoxels; k++ )
+      {
+      const OffsetValueType * neighbors =
+        & m_NarrowBandNeighbors[k * stencilSize];
+      for( unsigned int i = 0; i < ImageDimension; i++ )
+        {
+        const DiffusionTensorType & tensorA = neighbors[positionA[i]] >= 0
+          ? tensors[ neighbors[positionA[i]] ] : awayTensors[t];
+        const DiffusionTensorType & tensorB = neighbors[positionB[i]] >= 0
+          ? tensors[ neighbors[positionB[i]] ] : awayTensors[t];
+        for( unsigned int j = 0; j < ImageDimension; j++ )
+          {
+          tensorDerivatives[k]( i, j ) =
+            0.5 * ( tensorA( i, j ) - tensorB( i, j ) );
+
+          // Handle image spacing
+          if( useImageSpacing )
+            {
+            tensorDerivatives[k]( i, j ) /= spacing[i];
+            }
+          }
+        }
+      }
+    }
+}
+
+/**
+ * Computes the four diffusion tensors of a voxel
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+void
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::ComputeDiffusionTensors(
+    const NormalMatrixType & N,
+    const WeightMatrixType & A,
+    WeightComponentType w,
+    DiffusionTensorType & smoothTangentialDiffusionTensor,
+    DiffusionTensorType & smoothNormalDiffusionTensor,
+    DiffusionTensorType & propTangentialDiffusionTensor,
+    DiffusionTensorType & propNormalDiffusionTensor ) const
+{
+  // Used to compute the tangential and normal diffusion tensor images:
+  // P = NAN^T
+
+  typedef itk::Matrix
+      < DeformationVectorComponentType, ImageDimension, ImageDimension >
+      MatrixType;
+
+  MatrixType              P;
+  MatrixType              wP;   // wP
+  MatrixType              wP_transpose;
+  MatrixType              I_wP; // I-wP
+  MatrixType              I_wP_transpose;
+
+  MatrixType              smoothTangentialMatrix;  // ( I-wP )^T * ( I-wP )
+  MatrixType              smoothNormalMatrix;      // ( I-wP )^T * wP
+  MatrixType              propTangentialMatrix;    // ( wP )^T * ( I-wP )
+  MatrixType              propNormalMatrix;        // ( wP )^T * wP
+
+  // The matrices are used for calculations, and will be copied to the
+  // diffusion tensors afterwards.  The matrices are guaranteed to be
+  // symmetric.
+  P = N * A * N.GetTranspose(); // NAN^T
+  wP = P * w; // wP
+  I_wP.SetIdentity();
+  I_wP = I_wP - wP; // I-wP
+  I_wP_transpose = I_wP.GetTranspose(); // ( I-wP )^T
+  smoothTangentialMatrix = I_wP_transpose * I_wP;
+  // ( I-wP )^T * ( I-wP )
+  smoothNormalMatrix = I_wP_transpose * wP; // ( I-wP )^T * wP
+  wP_transpose = wP.GetTranspose(); // ( wP )^T
+  propTangentialMatrix = wP_transpose * I_wP; // ( wP )^T * ( I-wP )
+  propNormalMatrix = wP_transpose * wP; // ( wP )^T * wP
+
+  // Copy the matrices to the diffusion tensor
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    for( unsigned int j = 0; j < ImageDimension; j++ )
+      {
+      smoothTangentialDiffusionTensor( i, j ) =
+        smoothTangentialMatrix( i, j );
+      smoothNormalDiffusionTensor( i, j ) = smoothNormalMatrix( i, j );
+      propTangentialDiffusionTensor( i, j ) =
+        propTangentialMatrix( i, j );
+      propNormalDiffusionTensor( i, j ) = propNormalMatrix( i, j );
+      }
+    }
+}
+
 /** Computes the multiplication vectors that the div( Tensor /grad u )
  * values
  *  are multiplied by.
@@ -1164,12 +1848,37 @@ AnisotropicDiffusiveSparseRegistrationFilter
 {
   assert( this->GetComputeRegularizationTerm() );
   assert( this->GetOutput() );
-  assert( this->GetNormalMatrixImage() );
+  assert( this->GetNormalMatrixImage() || this->GetUseNarrowBand() );
 
   // The output will be used as the template to allocate the images we will
   // use to store data computed before/during the registration
   OutputImagePointer output = this->GetOutput();
 
+  if( this->GetUseNarrowBand() )
+    {
+    // The multiplication vectors are only used by the PROP terms, which
+    // are summed over the band voxels only
+    const SizeValueType numberOfVoxels = m_NarrowBandOffsets.size();
+    m_NarrowBandMultiplicationVectors.resize( ImageDimension );
+    DeformationVectorType N_l;
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      // Calculate NAN_l
+      m_NarrowBandMultiplicationVectors[i].resize( numberOfVoxels );
+      for( SizeValueType k = 0; k < numberOfVoxels; k++ )
+        {
+        const NormalMatrixType & N = m_NarrowBandNormalMatrices[k];
+        for( unsigned int j = 0; j < ImageDimension; j++ )
+          {
+          N_l[j] = N[i][j];
+          }
+        m_NarrowBandMultiplicationVectors[i][k] =
+          N * m_NarrowBandWeightStructures[k] * N_l;
+        }
+      }
+    return;
+    }
+
   // Allocate the images needed when using the anisotropic diffusive
   // regularization
   // There are no multiplication vectors for the smooth terms, and the
@@ -1250,6 +1959,42 @@ AnisotropicDiffusiveSparseRegistrationFilter
   // Conveniently, ( NAN_l ) is the PROP multiplication vector ( for both
   // SMOOTH
   // and PROP ), so we don't need to compute it again here
+
+  // In the narrow band mode, the tangential component is the output, and
+  // the normal components are stored for the band voxels only
+  if( this->GetUseNarrowBand() )
+    {
+    this->SetDeformationComponentImage( SMOOTH_TANGENTIAL, output );
+
+    const DeformationVectorType * outputVectors =
+      output->GetBufferPointer();
+    const SizeValueType numberOfVoxels = m_NarrowBandOffsets.size();
+    m_NarrowBandNormalComponents.resize( numberOfVoxels );
+    DeformationVectorType u;
+    DeformationVectorType tangentialDeformationVector;
+    for( SizeValueType k = 0; k < numberOfVoxels; k++ )
+      {
+      u = outputVectors[ m_NarrowBandOffsets[k] ];
+      DeformationVectorType & normalDeformationVector =
+        m_NarrowBandNormalComponents[k];
+      for( unsigned int i = 0; i < ImageDimension; i++ )
+        {
+        normalDeformationVector[i] =
+          m_NarrowBandMultiplicationVectors[i][k] * u;
+        }
+
+      // The normal and tangential components should be orthogonal
+      tangentialDeformationVector = u - normalDeformationVector;
+      if( normalDeformationVector * tangentialDeformationVector > 0.005 )
+        {
+        itkWarningMacro( << "Normal and tangential deformation field "
+                         << "components are not orthogonal" );
+        this->StopRegistration();
+        }
+      }
+    return;
+    }
+
   DeformationVectorImageRegionArrayType NAN_lRegionArray;
   for( unsigned int i = 0; i < ImageDimension; i++ )
     {
@@ -1369,6 +2114,32 @@ AnisotropicDiffusiveSparseRegistrationFilter
       }
     }
 
+  // In the narrow band mode, the derivatives of the normal components are
+  // computed for the band voxels only
+  if( this->GetUseNarrowBand() )
+    {
+    const SizeValueType numberOfVoxels = m_NarrowBandOffsets.size();
+    m_NarrowBandNormalFirstOrderDerivatives.resize( ImageDimension );
+    m_NarrowBandNormalSecondOrderDerivatives.resize( ImageDimension );
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      m_NarrowBandNormalFirstOrderDerivatives[i].resize( numberOfVoxels );
+      m_NarrowBandNormalSecondOrderDerivatives[i].resize( numberOfVoxels );
+      }
+
+    AnisotropicDiffusiveSparseRegistrationFilterThreadStruct str;
+    str.Filter = this;
+
+    // Multithread the execution
+    this->GetMultiThreader()->SetNumberOfThreads(
+      this->GetNumberOfThreads() );
+    this->GetMultiThreader()->SetSingleMethod(
+      this->ComputeNarrowBandNormalComponentDerivativesThreaderCallback,
+      & str );
+    this->GetMultiThreader()->SingleMethodExecute();
+    return;
+    }
+
   for( unsigned int i = 0; i < ImageDimension; i++ )
     {
     assert( this->GetDeformationComponentFirstOrderDerivative(
@@ -1391,6 +2162,479 @@ AnisotropicDiffusiveSparseRegistrationFilter
     }
 }
 
+/**
+ * Calls ThreadedComputeNarrowBandNormalComponentDerivatives for processing
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+ITK_THREAD_RETURN_TYPE
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::ComputeNarrowBandNormalComponentDerivativesThreaderCallback( void * arg )
+{
+  const ThreadIdType threadId =
+    ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->WorkUnitID;
+  const ThreadIdType threadCount =
+    ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->NumberOfWorkUnits;
+
+  AnisotropicDiffusiveSparseRegistrationFilterThreadStruct * str
+      = ( AnisotropicDiffusiveSparseRegistrationFilterThreadStruct * )
+            ( ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  // Split the band voxels into contiguous ranges
+  const SizeValueType numberOfVoxels =
+    str->Filter->m_NarrowBandOffsets.size();
+  const SizeValueType firstVoxel = numberOfVoxels * threadId / threadCount;
+  const SizeValueType endVoxel =
+    numberOfVoxels * ( threadId + 1 ) / threadCount;
+
+  if( firstVoxel < endVoxel )
+    {
+    str->Filter->ThreadedComputeNarrowBandNormalComponentDerivatives(
+        firstVoxel, endVoxel );
+    }
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+/**
+ * Computes the first- and second-order partial derivatives of the normal
+ * deformation components of a range of narrow band voxels
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+void
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::ThreadedComputeNarrowBandNormalComponentDerivatives(
+    SizeValueType firstVoxel,
+    SizeValueType endVoxel )
+{
+  const SpacingType spacing = this->GetOutput()->GetSpacing();
+  const RegistrationFunctionType * df =
+    this->GetRegistrationFunctionPointer();
+  assert( df );
+  const RegularizationFunctionType * reg =
+    df->GetRegularizationFunctionPointer();
+  assert( reg );
+  const bool useImageSpacing = reg->GetUseImageSpacing();
+
+  // Stencil positions of the neighbors used by the finite differences, as
+  // in AnisotropicDiffusionTensorFunction
+  unsigned int stencilSize = 1;
+  unsigned int positionA[ImageDimension];
+  unsigned int positionB[ImageDimension];
+  unsigned int positionAa[ImageDimension][ImageDimension];
+  unsigned int positionBa[ImageDimension][ImageDimension];
+  unsigned int positionCa[ImageDimension][ImageDimension];
+  unsigned int positionDa[ImageDimension][ImageDimension];
+  typename OutputImageType::OffsetType offset;
+  offset.Fill( 0 );
+  const unsigned int center = GetNarrowBandStencilPosition( offset );
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    stencilSize *= 3;
+    offset.Fill( 0 );
+    offset[i] = 1;
+    positionA[i] = GetNarrowBandStencilPosition( offset );
+    offset[i] = -1;
+    positionB[i] = GetNarrowBandStencilPosition( offset );
+    for( unsigned int j = i + 1; j < ImageDimension; j++ )
+      {
+      offset.Fill( 0 );
+      offset[i] = -1;
+      offset[j] = -1;
+      positionAa[i][j] = GetNarrowBandStencilPosition( offset );
+      offset[j] = 1;
+      positionBa[i][j] = GetNarrowBandStencilPosition( offset );
+      offset[i] = 1;
+      offset[j] = -1;
+      positionCa[i][j] = GetNarrowBandStencilPosition( offset );
+      offset[j] = 1;
+      positionDa[i][j] = GetNarrowBandStencilPosition( offset );
+      }
+    }
+
+  // Normal components of the stencil neighbors, which are zero away from
+  // the band
+  std::vector< DeformationVectorComponentType > values( stencilSize );
+  for( SizeValueType k = firstVoxel; k < endVoxel; k++ )
+    {
+    const OffsetValueType * neighbors =
+      & m_NarrowBandNeighbors[k * stencilSize];
+    for( unsigned int l = 0; l < ImageDimension; l++ )
+      {
+      for( unsigned int p = 0; p < stencilSize; p++ )
+        {
+        values[p] = neighbors[p] >= 0
+          ? m_NarrowBandNormalComponents[ neighbors[p] ][l] : 0;
+        }
+
+      ScalarDerivativeType & firstOrder =
+        m_NarrowBandNormalFirstOrderDerivatives[l][k];
+      TensorDerivativeType & secondOrder =
+        m_NarrowBandNormalSecondOrderDerivatives[l][k];
+      for( unsigned int i = 0; i < ImageDimension; i++ )
+        {
+        // First order partial derivatives
+        firstOrder[i] = 0.5 * ( values[positionA[i]]
+          - values[positionB[i]] );
+
+        // Second order partial derivatives
+        secondOrder[i][i] = ( values[positionA[i]] + values[positionB[i]]
+          - 2.0 * values[center] );
+
+        for( unsigned int j = i + 1; j < ImageDimension; j++ )
+          {
+          secondOrder[i][j]
+              = secondOrder[j][i] // Guaranteed symmetric
+                = 0.25 * ( values[positionAa[i][j]]
+                    - values[positionBa[i][j]]
+                    - values[positionCa[i][j]]
+                    + values[positionDa[i][j]] );
+          }
+        }
+
+      // Handle image spacing
+      if( useImageSpacing )
+        {
+        for( unsigned int i = 0; i < ImageDimension; i++ )
+          {
+          firstOrder[i] /= spacing[i];
+          for( unsigned int j = 0; j < ImageDimension; j++ )
+            {
+            secondOrder[i][j] /= ( spacing[i] * spacing[j] );
+            }
+          }
+        }
+      }
+    }
+}
+
+/**
+ * Calculates the update over a region supplied by the multithreading
+ * mechanism
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+typename AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::TimeStepType
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::ThreadedCalculateChangeGradient(
+    const ThreadRegionType & regionToProcess,
+    const ThreadDiffusionTensorImageRegionType & tensorRegionToProcess,
+    const ThreadTensorDerivativeImageRegionType
+      & tensorDerivativeRegionToProcess,
+    const ThreadScalarDerivativeImageRegionType
+      & scalarDerivativeRegionToProcess,
+    const ThreadStoppingCriterionMaskImageRegionType
+      & stoppingCriterionMaskRegionToProcess,
+    UpdateMetricsIntermediateStruct & updateMetricsIntermediate,
+    int threadId )
+{
+  TimeStepType timeStep = Superclass::ThreadedCalculateChangeGradient(
+    regionToProcess, tensorRegionToProcess, tensorDerivativeRegionToProcess,
+    scalarDerivativeRegionToProcess, stoppingCriterionMaskRegionToProcess,
+    updateMetricsIntermediate, threadId );
+
+  if( !this->GetComputeRegularizationTerm() || !this->GetUseNarrowBand() )
+    {
+    return timeStep;
+    }
+
+  const double regularizationWeighting =
+    this->GetRegistrationFunctionPointer()->GetRegularizationWeighting();
+  const OutputImageType * output = this->GetOutput();
+  typename UpdateBufferType::PixelType * updates =
+    this->GetUpdateBuffer()->GetBufferPointer();
+  const StoppingCriterionMaskImageType * stoppingCriterionMask =
+    this->GetStoppingCriterionMask();
+
+  const ScalarDerivativeType * tangentialFirstOrder[ImageDimension];
+  const TensorDerivativeType * tangentialSecondOrder[ImageDimension];
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    tangentialFirstOrder[i] =
+      this->GetDeformationComponentFirstOrderDerivative(
+        SMOOTH_TANGENTIAL, i )->GetBufferPointer();
+    tangentialSecondOrder[i] =
+      this->GetDeformationComponentSecondOrderDerivative(
+        SMOOTH_TANGENTIAL, i )->GetBufferPointer();
+    }
+
+  // Replace the diffusive regularization computed by the superclass at the
+  // band voxels of the region by their anisotropic regularization
+  SizeValueType firstVoxel = 0;
+  SizeValueType endVoxel = 0;
+  this->GetNarrowBandRange( regionToProcess, firstVoxel, endVoxel );
+  DeformationVectorType diffusiveTerm;
+  DeformationVectorType regularizationTerm;
+  DeformationVectorType oldUpdate;
+  DeformationVectorType newUpdate;
+  for( SizeValueType k = firstVoxel; k < endVoxel; k++ )
+    {
+    const OffsetValueType offset = m_NarrowBandOffsets[k];
+    if( !regionToProcess.IsInside( output->ComputeIndex( offset ) ) )
+      {
+      continue;
+      }
+
+    // The superclass summed div( I \grad u_l ), the Laplacian of u_l
+    for( unsigned int l = 0; l < ImageDimension; l++ )
+      {
+      DeformationVectorComponentType laplacian = 0;
+      for( unsigned int i = 0; i < ImageDimension; i++ )
+        {
+        laplacian += tangentialSecondOrder[l][offset]( i, i );
+        }
+      diffusiveTerm[l] = laplacian;
+      }
+    diffusiveTerm *= regularizationWeighting;
+
+    regularizationTerm = this->ComputeNarrowBandRegularizationUpdate( k,
+      tangentialFirstOrder, tangentialSecondOrder );
+    oldUpdate = updates[offset];
+    newUpdate = oldUpdate - diffusiveTerm + regularizationTerm;
+    updates[offset] = newUpdate;
+
+    // Update the metrics
+    if( !stoppingCriterionMask
+      || stoppingCriterionMask->GetBufferPointer()[offset] == 0.0 )
+      {
+      updateMetricsIntermediate.SumOfSquaredTotalUpdateMagnitude
+        += newUpdate.GetSquaredNorm() - oldUpdate.GetSquaredNorm();
+      updateMetricsIntermediate.SumOfSquaredRegularizationUpdateMagnitude
+        += regularizationTerm.GetSquaredNorm()
+        - diffusiveTerm.GetSquaredNorm();
+      updateMetricsIntermediate.SumOfTotalUpdateMagnitude
+        += newUpdate.GetNorm() - oldUpdate.GetNorm();
+      updateMetricsIntermediate.SumOfRegularizationUpdateMagnitude
+        += regularizationTerm.GetNorm() - diffusiveTerm.GetNorm();
+      }
+    }
+
+  return timeStep;
+}
+
+/**
+ * Calculates the energies over a region supplied by the multithreading
+ * mechanism
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+void
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::ThreadedCalculateEnergies(
+    const OutputImagePointer & output,
+    const ThreadRegionType & regionToProcess,
+    const ThreadDiffusionTensorImageRegionType & tensorRegionToProcess,
+    const ThreadScalarDerivativeImageRegionType &
+      scalarDerivativeRegionToProcess,
+    const ThreadStoppingCriterionMaskImageRegionType &
+      stoppingCriterionMaskRegionToProcess,
+    double & intensityDistanceEnergy,
+    double & regularizationEnergy,
+    int threadId )
+{
+  Superclass::ThreadedCalculateEnergies( output, regionToProcess,
+    tensorRegionToProcess, scalarDerivativeRegionToProcess,
+    stoppingCriterionMaskRegionToProcess, intensityDistanceEnergy,
+    regularizationEnergy, threadId );
+
+  if( !this->GetComputeRegularizationTerm() || !this->GetUseNarrowBand() )
+    {
+    return;
+    }
+
+  const double regularizationWeighting =
+    this->GetRegistrationFunctionPointer()->GetRegularizationWeighting();
+  const StoppingCriterionMaskImageType * stoppingCriterionMask =
+    this->GetStoppingCriterionMask();
+
+  const ScalarDerivativeType * tangentialFirstOrder[ImageDimension];
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    tangentialFirstOrder[i] =
+      this->GetDeformationComponentFirstOrderDerivative(
+        SMOOTH_TANGENTIAL, i )->GetBufferPointer();
+    }
+
+  // Replace the diffusive regularization energy computed by the superclass
+  // at the band voxels of the region by their anisotropic regularization
+  // energy
+  SizeValueType firstVoxel = 0;
+  SizeValueType endVoxel = 0;
+  this->GetNarrowBandRange( regionToProcess, firstVoxel, endVoxel );
+  DeformationVectorType gradient;
+  for( SizeValueType k = firstVoxel; k < endVoxel; k++ )
+    {
+    const OffsetValueType offset = m_NarrowBandOffsets[k];
+    if( !regionToProcess.IsInside( output->ComputeIndex( offset ) )
+      || ( stoppingCriterionMask
+        && stoppingCriterionMask->GetBufferPointer()[offset] != 0.0 ) )
+      {
+      continue;
+      }
+
+    // The superclass summed 0.5 | I \grad u_l |^2
+    double diffusiveEnergy = 0.0;
+    for( unsigned int l = 0; l < ImageDimension; l++ )
+      {
+      for( unsigned int i = 0; i < ImageDimension; i++ )
+        {
+        gradient[i] = tangentialFirstOrder[l][offset][i];
+        }
+      diffusiveEnergy += 0.5 * ( gradient * gradient );
+      }
+    diffusiveEnergy *= regularizationWeighting;
+
+    regularizationEnergy += this->ComputeNarrowBandRegularizationEnergy( k,
+      tangentialFirstOrder ) - diffusiveEnergy;
+    }
+}
+
+/**
+ * Computes the anisotropic regularization update term of a narrow band
+ * voxel
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+typename AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::DeformationVectorType
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::ComputeNarrowBandRegularizationUpdate(
+    SizeValueType voxel,
+    const ScalarDerivativeType * const * tangentialFirstOrder,
+    const TensorDerivativeType * const * tangentialSecondOrder ) const
+{
+  const OffsetValueType offset = m_NarrowBandOffsets[voxel];
+
+  DeformationVectorType regularizationTerm;
+  regularizationTerm.Fill( 0 );
+  DeformationVectorType intermediateVector;
+
+  // Iterate over each div( T \grad( u ) )v term, as in
+  // AnisotropicDiffusiveRegistrationFunction
+  for( int term = 0; term < NumberOfNarrowBandTerms; term++ )
+    {
+    const bool isNormalTerm =
+      ( term == SMOOTH_NORMAL || term == PROP_NORMAL );
+    const DiffusionTensorType & tensor =
+      m_NarrowBandDiffusionTensors[term][voxel];
+    const TensorDerivativeType & tensorDerivative =
+      m_NarrowBandDiffusionTensorDerivatives[term][voxel];
+
+    for( unsigned int l = 0; l < ImageDimension; l++ )
+      {
+      const ScalarDerivativeType & dx = isNormalTerm
+        ? m_NarrowBandNormalFirstOrderDerivatives[l][voxel]
+        : tangentialFirstOrder[l][offset];
+      const TensorDerivativeType & dxy = isNormalTerm
+        ? m_NarrowBandNormalSecondOrderDerivatives[l][voxel]
+        : tangentialSecondOrder[l][offset];
+
+      // Compute div( T \grad( u_l ) )
+      DeformationVectorComponentType pdWrtDiffusion[ImageDimension];
+      DeformationVectorComponentType pdWrtImageIntensity[ImageDimension];
+      for( unsigned int i = 0; i < ImageDimension; i++ )
+        {
+        pdWrtDiffusion[i] = 0;
+        pdWrtImageIntensity[i] = 0;
+        for( unsigned int j = 0; j < ImageDimension; j++ )
+          {
+          pdWrtDiffusion[i] += tensorDerivative[i][j] * dx[j];
+          pdWrtImageIntensity[i] += tensor( i, j ) * dxy[i][j];
+          }
+        }
+      DeformationVectorComponentType divergence = 0;
+      for( unsigned int i = 0; i < ImageDimension; i++ )
+        {
+        divergence += pdWrtDiffusion[i];
+        }
+      for( unsigned int i = 0; i < ImageDimension; i++ )
+        {
+        divergence += pdWrtImageIntensity[i];
+        }
+
+      // The PROP terms are multiplied by NAN_l
+      intermediateVector.Fill( 0 );
+      if( term == PROP_TANGENTIAL || term == PROP_NORMAL )
+        {
+        intermediateVector =
+          divergence * m_NarrowBandMultiplicationVectors[l][voxel];
+        }
+      else
+        {
+        intermediateVector[l] = divergence;
+        }
+      regularizationTerm += intermediateVector;
+      }
+    }
+
+  // Weight the regularization term, but don't multiply by the timestep
+  regularizationTerm *=
+    this->GetRegistrationFunctionPointer()->GetRegularizationWeighting();
+
+  return regularizationTerm;
+}
+
+/**
+ * Computes the anisotropic regularization energy of a narrow band voxel
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+double
+AnisotropicDiffusiveSparseRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::ComputeNarrowBandRegularizationEnergy(
+    SizeValueType voxel,
+    const ScalarDerivativeType * const * tangentialFirstOrder ) const
+{
+  const OffsetValueType offset = m_NarrowBandOffsets[voxel];
+
+  // Since we are iterating over terms before iterating over x,y,z
+  // we need to store the sum for each dimension
+  DeformationVectorType termRegularizationEnergies[ImageDimension];
+  for( unsigned int l = 0; l < ImageDimension; l++ )
+    {
+    termRegularizationEnergies[l].Fill( 0.0 );
+    }
+
+  for( int term = 0; term < NumberOfNarrowBandTerms; term++ )
+    {
+    const bool isNormalTerm =
+      ( term == SMOOTH_NORMAL || term == PROP_NORMAL );
+    const DiffusionTensorType & tensor =
+      m_NarrowBandDiffusionTensors[term][voxel];
+    for( unsigned int l = 0; l < ImageDimension; l++ )
+      {
+      const ScalarDerivativeType & dx = isNormalTerm
+        ? m_NarrowBandNormalFirstOrderDerivatives[l][voxel]
+        : tangentialFirstOrder[l][offset];
+      itk::Vector< double, ImageDimension > multVector( 0.0 );
+      for( unsigned int row = 0; row < ImageDimension; row++ )
+        {
+        for( unsigned int col = 0; col < ImageDimension; col++ )
+          {
+          multVector[row] += tensor( row, col ) * dx[col];
+          }
+        }
+      termRegularizationEnergies[l] += multVector;
+      }
+    }
+
+  // Calculate and weight the regularization energy
+  double regularizationEnergy = 0.0;
+  for( unsigned int l = 0; l < ImageDimension; l++ )
+    {
+    regularizationEnergy += 0.5 *
+      ( termRegularizationEnergies[l] * termRegularizationEnergies[l] );
+    }
+  regularizationEnergy *=
+    this->GetRegistrationFunctionPointer()->GetRegularizationWeighting();
+
+  return regularizationEnergy;
+}
+
 /**
  * Get the normal matrix image as a vector image.
  */
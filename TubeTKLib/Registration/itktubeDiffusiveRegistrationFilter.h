@@ -358,6 +358,14 @@ public:
   /** Get current resolution level being processed. */
   itkGetConstReferenceMacro( CurrentLevel, unsigned int );
 
+  /** Get the registration time elapsed on the current level, which is the
+   * sum of the time steps of its iterations. */
+  itkGetConstMacro( TotalTime, TimeStepType );
+
+  /** Get the energies of the output after the last iteration. */
+  const EnergiesStruct & GetEnergies( void ) const
+    { return m_Energies; }
+
   /** Set/get a mask in which the RMS error does not contribute to the
    * stopping criterion.  Any non-zero voxels will not be considered when
    * determining the stopping criterion. */
@@ -387,6 +395,17 @@ public:
   double GetStoppingCriterionMaxTotalEnergyChange( void ) const
     { return m_StoppingCriterionMaxTotalEnergyChange; }
 
+  /** Set/get whether to compute each iteration in a single sweep over
+   *  tiles of the deformation field.  The derivatives, the update, the
+   *  new deformation field and its energies are then computed per tile,
+   *  instead of in separate passes over the images.  Only the diffusive
+   *  regularization of this class is fused, derived filters always use
+   *  the separate passes.  Default false. */
+  void SetUseFusedIteration( bool useFusedIteration )
+    { m_UseFusedIteration = useFusedIteration; }
+  bool GetUseFusedIteration( void ) const
+    { return m_UseFusedIteration; }
+
 protected:
   DiffusiveRegistrationFilter( void );
   virtual ~DiffusiveRegistrationFilter( void ) {}
@@ -433,6 +452,13 @@ protected:
    *  default to e_l, where e_l is the lth canonical unit vector. */
   virtual void ComputeMultiplicationVectorImages( void ) {}
 
+  /** Returns whether the iterations are computed by
+   *  ThreadedCalculateFusedIteration().  Derived filters whose
+   *  regularization is not the diffusive regularization of this class
+   *  must return false. */
+  virtual bool CanUseFusedIteration( void ) const
+    { return m_UseFusedIteration; }
+
   /** Initialize the state of the filter before each iteration. */
   virtual void InitializeIteration( void );
 
@@ -446,6 +472,13 @@ protected:
    *  avoid computing the same derivatives multiple times. */
   virtual void ComputeDeformationComponentDerivativeImages( void );
 
+  /** Updates the deformation component images and their derivatives for
+   *  the given deformation field.  The derivatives computed for the
+   *  energies at the end of an iteration are reused by the next
+   *  iteration, as long as the output has not been modified since. */
+  void UpdateDeformationComponentDerivativeImages(
+      OutputImageType * output );
+
   /** Helper to compute the first- and second-order partial derivatives of
    * the
    *  deformation component images, using the
@@ -626,6 +659,22 @@ protected:
         lhs.SumOfRegularizationUpdateMagnitude
           - rhs.SumOfRegularizationUpdateMagnitude;
       }
+
+    void add( const UpdateMetricsIntermediateStruct & rhs )
+      {
+      NumberOfPixelsProcessed += rhs.NumberOfPixelsProcessed;
+      SumOfSquaredTotalUpdateMagnitude +=
+        rhs.SumOfSquaredTotalUpdateMagnitude;
+      SumOfSquaredIntensityDistanceUpdateMagnitude
+          += rhs.SumOfSquaredIntensityDistanceUpdateMagnitude;
+      SumOfSquaredRegularizationUpdateMagnitude
+          += rhs.SumOfSquaredRegularizationUpdateMagnitude;
+      SumOfTotalUpdateMagnitude += rhs.SumOfTotalUpdateMagnitude;
+      SumOfIntensityDistanceUpdateMagnitude
+          += rhs.SumOfIntensityDistanceUpdateMagnitude;
+      SumOfRegularizationUpdateMagnitude
+          += rhs.SumOfRegularizationUpdateMagnitude;
+      }
     }; // End struct UpdateMetricsIntermediateStruct
 
   struct UpdateMetricsStruct
@@ -726,6 +775,31 @@ protected:
       UpdateMetricsIntermediateStruct & updateMetricsIntermediate,
       int threadId );
 
+  /** Computes a whole iteration in a single sweep, using the
+   * ThreadedCalculateFusedIteration() method and a multithreading
+   * mechanism.  The update buffer and the next deformation field are
+   * populated, and the energies of the next deformation field are
+   * computed.  The next deformation field becomes the output in
+   * ApplyUpdate().  Return value is a time step to be used for the update.
+   * \sa ThreadedCalculateFusedIteration */
+  virtual TimeStepType CalculateFusedIteration( void );
+
+  /** Does the actual work of the fused iteration over a region supplied
+   * by the multithreading mechanism.  The region is processed in tiles.
+   * For each tile, the deformation field is copied with a margin of two
+   * voxels into a local buffer, from which the update is computed on the
+   * tile and on its face neighbors, which are enough to compute the
+   * derivatives of the next deformation field on the tile.
+   * \sa CalculateFusedIteration
+   * \sa CalculateFusedIterationThreaderCallback */
+  virtual void ThreadedCalculateFusedIteration(
+      const ThreadRegionType & regionToProcess,
+      TimeStepType dt,
+      UpdateMetricsIntermediateStruct & updateMetricsIntermediate,
+      double & intensityDistanceEnergy,
+      double & regularizationEnergy,
+      int threadId );
+
   /** Calculates the total, intensity distance and regularization energies,
    *  using the ThreadedCalculateEnergies() method and a multithreading
    *  mechanism.  The stepSize parameter is a uniform scaling parameter
@@ -856,6 +930,18 @@ private:
     double * RegularizationEnergies;
     }; // End struct CalculateEnergiesThreadStruct
 
+  /** Structure for passing information into static callback methods.
+   * Used in
+   *  the threading mechanism for CalculateFusedIteration. */
+  struct CalculateFusedIterationThreadStruct
+    {
+    DiffusiveRegistrationFilter * Filter;
+    TimeStepType TimeStep;
+    UpdateMetricsIntermediateStruct * UpdateMetricsIntermediate;
+    double * IntensityDistanceEnergies;
+    double * RegularizationEnergies;
+    }; // End struct CalculateFusedIterationThreadStruct
+
   /** This callback method uses ImageSource::SplitRequestedRegion to
    * acquire an
    * output region that it passes to ThreadedApplyUpdate for processing. */
@@ -879,6 +965,18 @@ private:
   static ITK_THREAD_RETURN_TYPE CalculateEnergiesThreaderCallback(
     void *arg );
 
+  /** This callback method uses SplitRequestedRegion to acquire a region
+   * which it then passes to ThreadedCalculateFusedIteration for
+   * processing. */
+  static ITK_THREAD_RETURN_TYPE CalculateFusedIterationThreaderCallback(
+    void *arg );
+
+  /** Advances the index to the next index of the region, with the first
+   *  dimension varying fastest.  Returns false past the last index. */
+  static bool IncrementIndexInRegion(
+    typename OutputImageType::IndexType & index,
+    const ThreadRegionType & region );
+
   TimeStepType                              m_OriginalTimeStep;
 
   /** The buffer that holds the updates for an iteration of algorithm,
@@ -904,6 +1002,11 @@ private:
    *  as Initialize() is called on each new level. */
   unsigned int                              m_CurrentLevel;
 
+  /** Time stamp of the output for which the deformation component
+   *  derivatives were last computed, or zero if they must be
+   *  recomputed. */
+  ModifiedTimeType                 m_DeformationComponentDerivativesMTime;
+
   /** Relative weightings between the intensity distance and regularization
    *  update terms.  Stored in a vector so that the user can provide
    *  different
@@ -921,12 +1024,25 @@ private:
   unsigned int                   m_StoppingCriterionEvaluationPeriod;
   double                         m_StoppingCriterionMaxTotalEnergyChange;
 
+  /** State of the stopping criterion on the current level */
+  double                         m_TotalEnergyChangeInEvaluationPeriod;
+  unsigned int                   m_NumberOfEnergyViolations;
+  TimeStepType                   m_TotalTime;
+
   /** Parameters for energies and update magnitude metrics */
   EnergiesStruct                            m_Energies;
   EnergiesStruct                            m_PreviousEnergies;
   UpdateMetricsStruct                       m_UpdateMetrics;
   UpdateMetricsStruct                       m_PreviousUpdateMetrics;
 
+  /** State of the fused iteration.  The fused iteration writes the next
+   *  deformation field to m_FusedOutputBuffer and its energies to
+   *  m_FusedEnergies, which ApplyUpdate() moves to the output. */
+  bool                                      m_UseFusedIteration;
+  bool                                      m_FusedIterationPending;
+  OutputImagePointer                        m_FusedOutputBuffer;
+  EnergiesStruct                            m_FusedEnergies;
+
 }; // End class DiffusiveRegistrationFilter
 
 } // End namespace tube
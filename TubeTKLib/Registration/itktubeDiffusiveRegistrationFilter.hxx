@@ -28,6 +28,8 @@ limitations under the License.
 
 #include "itktubeDiffusiveRegistrationFilterUtils.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -57,6 +59,7 @@ DiffusiveRegistrationFilter
   m_HighResolutionTemplate  = 0;
 
   m_CurrentLevel            = 0;
+  m_DeformationComponentDerivativesMTime = 0;
   m_RegularizationWeightings.push_back( 1.0 );
 
   m_StoppingCriterionMask               = 0;
@@ -64,11 +67,19 @@ DiffusiveRegistrationFilter
 
   m_StoppingCriterionEvaluationPeriod     = 50;
   m_StoppingCriterionMaxTotalEnergyChange = -1;
+  m_TotalEnergyChangeInEvaluationPeriod   = 0;
+  m_NumberOfEnergyViolations              = 0;
+  m_TotalTime                             = 0;
 
   m_Energies.zero();
   m_PreviousEnergies.zero();
   m_UpdateMetrics.zero();
   m_PreviousUpdateMetrics.zero();
+
+  m_UseFusedIteration     = false;
+  m_FusedIterationPending = false;
+  m_FusedOutputBuffer     = nullptr;
+  m_FusedEnergies.zero();
 }
 
 
@@ -145,6 +156,9 @@ DiffusiveRegistrationFilter
      << m_StoppingCriterionEvaluationPeriod << std::endl;
   os << "Stopping criterion maximum total energy change: "
      << m_StoppingCriterionMaxTotalEnergyChange << std::endl;
+  os << indent << "Total time: " << m_TotalTime << std::endl;
+  os << indent << "Use fused iteration: "
+     << ( m_UseFusedIteration ? "on" : "off" ) << std::endl;
 }
 
 
@@ -189,6 +203,23 @@ DiffusiveRegistrationFilter
   assert( output );
   DiffusiveRegistrationFilterUtils::AllocateSpaceForImage( m_UpdateBuffer,
                                                                 output );
+
+  // The fused iteration writes the next deformation field to a second
+  // buffer that looks like the output
+  m_FusedIterationPending = false;
+  if( this->CanUseFusedIteration() )
+    {
+    if( !m_FusedOutputBuffer )
+      {
+      m_FusedOutputBuffer = OutputImageType::New();
+      }
+    DiffusiveRegistrationFilterUtils::AllocateSpaceForImage(
+      m_FusedOutputBuffer, output );
+    }
+  else
+    {
+    m_FusedOutputBuffer = nullptr;
+    }
 }
 
 /**
@@ -233,6 +264,11 @@ DiffusiveRegistrationFilter
   // is 1..N )
   m_CurrentLevel++;
 
+  // The stopping criterion is evaluated separately on each level
+  m_TotalEnergyChangeInEvaluationPeriod = 0;
+  m_NumberOfEnergyViolations = 0;
+  m_TotalTime = 0;
+
   // Check the time step for stability if we are using the diffusive or
   // anisotropic diffusive regularization terms
   RegistrationFunctionType * df = this->GetRegistrationFunctionPointer();
@@ -302,8 +338,13 @@ DiffusiveRegistrationFilter
   this->GetRegistrationFunctionPointer()->SetTimeStep(
     m_OriginalTimeStep );
 
-  // Compute the diffusion tensors and their derivatives
-  if( this->GetComputeRegularizationTerm() )
+  // Compute the diffusion tensors and their derivatives.  The deformation
+  // component derivative images are reallocated, so they must be
+  // recomputed on the first iteration of this level.  The fused iteration
+  // computes the diffusive regularization from the deformation field
+  // directly, and needs none of these images.
+  m_DeformationComponentDerivativesMTime = 0;
+  if( this->GetComputeRegularizationTerm() && !this->CanUseFusedIteration() )
     {
     this->InitializeDeformationComponentAndDerivativeImages();
     this->ComputeDiffusionTensorImages();
@@ -328,7 +369,15 @@ DiffusiveRegistrationFilter
   // use to store data computed before/during the registration
   typename OutputImageType::Pointer output = this->GetOutput();
 
+  // The number of terms may change between runs, for example when a
+  // derived class switches to a narrow band
   int numTerms = this->GetNumberOfTerms();
+  m_DiffusionTensorImages.resize( numTerms );
+  m_DiffusionTensorDerivativeImages.resize( numTerms );
+  m_DeformationComponentImages.resize( numTerms );
+  m_DeformationComponentFirstOrderDerivativeArrays.resize( numTerms );
+  m_DeformationComponentSecondOrderDerivativeArrays.resize( numTerms );
+  m_MultiplicationVectorImageArrays.resize( numTerms );
 
   // Allocate the diffusion tensor images and their derivatives
   // If we are not computing a regularization term, the image arrays will be
@@ -346,30 +395,15 @@ DiffusiveRegistrationFilter
       DiffusiveRegistrationFilterUtils::AllocateSpaceForImage(
             tensorDerivativePointer, output );
       }
-    if( ( int ) m_DiffusionTensorImages.size() < numTerms )
-      {
-      m_DiffusionTensorImages.push_back( diffusionTensorPointer );
-      m_DiffusionTensorDerivativeImages.push_back( tensorDerivativePointer );
-      }
-    else
-      {
-      m_DiffusionTensorImages[i] = diffusionTensorPointer;
-      m_DiffusionTensorDerivativeImages[i] = tensorDerivativePointer;
-      }
+    m_DiffusionTensorImages[i] = diffusionTensorPointer;
+    m_DiffusionTensorDerivativeImages[i] = tensorDerivativePointer;
     }
 
   // Initialize image pointers that may or may not be allocated by individual
   // filters later on, namely deformation derivatives and multiplication vectors
   for( int i = 0; i < numTerms; i++ )
     {
-    if( ( int ) m_DeformationComponentImages.size() < numTerms )
-      {
-      m_DeformationComponentImages.push_back( nullptr );
-      }
-    else
-      {
-      m_DeformationComponentImages[i] = nullptr;
-      }
+    m_DeformationComponentImages[i] = nullptr;
 
     ScalarDerivativeImageArrayType deformationComponentFirstArray;
     TensorDerivativeImageArrayType deformationComponentSecondArray;
@@ -380,36 +414,11 @@ DiffusiveRegistrationFilter
       deformationComponentSecondArray[j] = 0;
       multiplicationVectorArray[j] = 0;
       }
-    if( ( int ) m_DeformationComponentFirstOrderDerivativeArrays.size()
-      < numTerms )
-      {
-      m_DeformationComponentFirstOrderDerivativeArrays.push_back(
-          deformationComponentFirstArray );
-      }
-    else
-      {
-      m_DeformationComponentFirstOrderDerivativeArrays[i]
-          = deformationComponentFirstArray;
-      }
-    if( ( int ) m_DeformationComponentSecondOrderDerivativeArrays.size()
-      < numTerms )
-      {
-      m_DeformationComponentSecondOrderDerivativeArrays.push_back(
-          deformationComponentSecondArray );
-      }
-    else
-      {
-      m_DeformationComponentSecondOrderDerivativeArrays[i]
-          = deformationComponentSecondArray;
-      }
-    if( ( int ) m_MultiplicationVectorImageArrays.size() < numTerms )
-      {
-      m_MultiplicationVectorImageArrays.push_back( multiplicationVectorArray );
-      }
-    else
-      {
-      m_MultiplicationVectorImageArrays[i] = multiplicationVectorArray;
-      }
+    m_DeformationComponentFirstOrderDerivativeArrays[i]
+        = deformationComponentFirstArray;
+    m_DeformationComponentSecondOrderDerivativeArrays[i]
+        = deformationComponentSecondArray;
+    m_MultiplicationVectorImageArrays[i] = multiplicationVectorArray;
     }
 }
 
@@ -604,6 +613,34 @@ DiffusiveRegistrationFilter
     }
 }
 
+/**
+ * Updates the deformation component images and their derivatives, unless
+ * they are already up to date with the output
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+void
+DiffusiveRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::UpdateDeformationComponentDerivativeImages( OutputImageType * output )
+{
+  assert( output );
+  assert( this->GetComputeRegularizationTerm() );
+
+  const bool isOutput = ( output == this->GetOutput() );
+  if( isOutput && m_DeformationComponentDerivativesMTime != 0
+    && m_DeformationComponentDerivativesMTime == output->GetMTime() )
+    {
+    return;
+    }
+
+  this->UpdateDeformationComponentImages( output );
+  this->ComputeDeformationComponentDerivativeImages();
+
+  // Only derivatives of the output itself can be reused by the next
+  // iteration
+  m_DeformationComponentDerivativesMTime = isOutput ? output->GetMTime() : 0;
+}
+
 /**
  * Actually computes the deformation component image derivatives.
  */
@@ -802,11 +839,12 @@ DiffusiveRegistrationFilter
 
   // Update the deformation field component images
   // Since the components depend on the current deformation field, they
-  // must be computed on every registration iteration
-  if( this->GetComputeRegularizationTerm() )
+  // must be computed on every registration iteration.  Except on the first
+  // iteration, they were already computed for the energies at the end of
+  // the previous iteration.
+  if( this->GetComputeRegularizationTerm() && !this->CanUseFusedIteration() )
     {
-    this->UpdateDeformationComponentImages( this->GetOutput() );
-    this->ComputeDeformationComponentDerivativeImages();
+    this->UpdateDeformationComponentDerivativeImages( this->GetOutput() );
     }
 
   // Initialize the energy and update metrics
@@ -872,6 +910,11 @@ DiffusiveRegistrationFilter
   < TFixedImage, TMovingImage, TDeformationField >
 ::CalculateChangeGradient( void )
 {
+  if( this->CanUseFusedIteration() )
+    {
+    return this->CalculateFusedIteration();
+    }
+
   // Set up for multithreaded processing.
   CalculateChangeGradientThreadStruct str;
   str.Filter = this;
@@ -914,27 +957,8 @@ DiffusiveRegistrationFilter
   // of RMS and mean statistics, in UpdateUpdateStatistics
   for( ThreadIdType i = 0; i < this->GetNumberOfThreads(); i++ )
     {
-    m_UpdateMetrics.IntermediateStruct.NumberOfPixelsProcessed
-      += str.UpdateMetricsIntermediate[i].NumberOfPixelsProcessed;
-    m_UpdateMetrics.IntermediateStruct.SumOfSquaredTotalUpdateMagnitude
-      += str.UpdateMetricsIntermediate[i].SumOfSquaredTotalUpdateMagnitude;
-    m_UpdateMetrics.IntermediateStruct
-      .SumOfSquaredIntensityDistanceUpdateMagnitude
-      += str.UpdateMetricsIntermediate[i]
-      .SumOfSquaredIntensityDistanceUpdateMagnitude;
-    m_UpdateMetrics.IntermediateStruct
-      .SumOfSquaredRegularizationUpdateMagnitude
-      += str.UpdateMetricsIntermediate[i]
-      .SumOfSquaredRegularizationUpdateMagnitude;
-    m_UpdateMetrics.IntermediateStruct.SumOfTotalUpdateMagnitude
-      += str.UpdateMetricsIntermediate[i].SumOfTotalUpdateMagnitude;
-    m_UpdateMetrics.IntermediateStruct
-      .SumOfIntensityDistanceUpdateMagnitude
-      += str.UpdateMetricsIntermediate[i]
-      .SumOfIntensityDistanceUpdateMagnitude;
-    m_UpdateMetrics.IntermediateStruct.SumOfRegularizationUpdateMagnitude
-      += str.UpdateMetricsIntermediate[i]
-      .SumOfRegularizationUpdateMagnitude;
+    m_UpdateMetrics.IntermediateStruct.add(
+      str.UpdateMetricsIntermediate[i] );
     }
 
   delete [] str.UpdateMetricsIntermediate;
@@ -1276,6 +1300,474 @@ DiffusiveRegistrationFilter
   return timeStep;
 }
 
+/**
+ * Computes a whole iteration in a single sweep over the output
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+typename DiffusiveRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::TimeStepType
+DiffusiveRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::CalculateFusedIteration( void )
+{
+  assert( m_FusedOutputBuffer );
+
+  // The registration function uses a constant time step
+  const RegistrationFunctionType * df =
+    this->GetRegistrationFunctionPointer();
+  assert( df );
+  const TimeStepType dt = df->GetTimeStep();
+
+  // Set up for multithreaded processing.
+  CalculateFusedIterationThreadStruct str;
+  str.Filter = this;
+  str.TimeStep = dt;
+  str.UpdateMetricsIntermediate
+      = new UpdateMetricsIntermediateStruct[this->GetNumberOfThreads()];
+  str.IntensityDistanceEnergies = new double[this->GetNumberOfThreads()];
+  str.RegularizationEnergies = new double[this->GetNumberOfThreads()];
+  for( ThreadIdType i = 0; i < this->GetNumberOfThreads(); i++ )
+    {
+    str.UpdateMetricsIntermediate[i].zero();
+    str.IntensityDistanceEnergies[i] = 0;
+    str.RegularizationEnergies[i] = 0;
+    }
+
+  // Multithread the execution
+  this->GetMultiThreader()->SetNumberOfThreads(
+    this->GetNumberOfThreads() );
+  this->GetMultiThreader()->SetSingleMethod(
+    this->CalculateFusedIterationThreaderCallback, & str );
+  this->GetMultiThreader()->SingleMethodExecute();
+
+  // Combine the results from the threads.  The metrics are completed in
+  // UpdateUpdateStatistics, and the energies of the next deformation
+  // field are moved to m_Energies along with the field in ApplyUpdate
+  m_FusedEnergies.zero();
+  for( ThreadIdType i = 0; i < this->GetNumberOfThreads(); i++ )
+    {
+    m_UpdateMetrics.IntermediateStruct.add(
+      str.UpdateMetricsIntermediate[i] );
+    m_FusedEnergies.IntensityDistanceEnergy
+      += str.IntensityDistanceEnergies[i];
+    m_FusedEnergies.RegularizationEnergy += str.RegularizationEnergies[i];
+    }
+  m_FusedEnergies.TotalEnergy = m_FusedEnergies.IntensityDistanceEnergy
+    + m_FusedEnergies.RegularizationEnergy;
+
+  delete [] str.UpdateMetricsIntermediate;
+  delete [] str.IntensityDistanceEnergies;
+  delete [] str.RegularizationEnergies;
+
+  // Explicitly call Modified on the buffers written through their
+  // buffer pointers
+  this->m_UpdateBuffer->Modified();
+  m_FusedOutputBuffer->Modified();
+  m_FusedIterationPending = true;
+
+  return dt;
+}
+
+/**
+ * Calls ThreadedCalculateFusedIteration for processing
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+ITK_THREAD_RETURN_TYPE
+DiffusiveRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::CalculateFusedIterationThreaderCallback( void * arg )
+{
+  int threadId = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+  int threadCount = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->NumberOfWorkUnits;
+
+  CalculateFusedIterationThreadStruct * str =
+    ( CalculateFusedIterationThreadStruct * )(
+      ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  // Execute the actual method with appropriate output region
+  // first find out how many pieces extent can be split into.
+  // Using the SplitRequestedRegion method from itk::ImageSource.
+  ThreadRegionType splitRegion;
+  int total = str->Filter->SplitRequestedRegion( threadId,
+                                                 threadCount,
+                                                 splitRegion );
+
+  if( threadId < total )
+    {
+    str->Filter->ThreadedCalculateFusedIteration( splitRegion,
+      str->TimeStep,
+      str->UpdateMetricsIntermediate[threadId],
+      str->IntensityDistanceEnergies[threadId],
+      str->RegularizationEnergies[threadId],
+      threadId );
+    }
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+/**
+ * Does the actual work of the fused iteration over a region supplied by
+ * the multithreading mechanism
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+void
+DiffusiveRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::ThreadedCalculateFusedIteration(
+    const ThreadRegionType & regionToProcess,
+    TimeStepType dt,
+    UpdateMetricsIntermediateStruct & updateMetricsIntermediate,
+    double & intensityDistanceEnergy,
+    double & regularizationEnergy,
+    int )
+{
+  typedef typename OutputImageType::IndexType   FieldIndexType;
+  typedef typename OutputImageType::SizeType    FieldSizeType;
+  typedef typename UpdateBufferType::PixelType  UpdateType;
+
+  // Get the FiniteDifferenceFunction to use in calculations.
+  RegistrationFunctionType * df = this->GetRegistrationFunctionPointer();
+  assert( df );
+  typename RegularizationFunctionType::ConstPointer reg
+      = df->GetRegularizationFunctionPointer();
+  assert( reg );
+
+  // The output, update buffer and next deformation field share the same
+  // buffered region, so a voxel has the same offset in the three buffers
+  OutputImagePointer output = this->GetOutput();
+  const ThreadRegionType bufferedRegion = output->GetBufferedRegion();
+  const DeformationVectorType * field = output->GetBufferPointer();
+  DeformationVectorType * nextField = m_FusedOutputBuffer->GetBufferPointer();
+  UpdateType * updates = m_UpdateBuffer->GetBufferPointer();
+
+  // The derivatives are divided by the spacing only if the regularization
+  // function uses the image spacing, as in
+  // ComputeIntensityFirstAndSecondOrderPartialDerivatives()
+  SpacingType spacing = output->GetSpacing();
+  if( !reg->GetUseImageSpacing() )
+    {
+    spacing.Fill( 1.0 );
+    }
+
+  // Get the type of registration
+  bool computeIntensityDistance = this->GetComputeIntensityDistanceTerm();
+  bool computeRegularization = this->GetComputeRegularizationTerm();
+  bool haveStoppingCriterionMask =
+    ( m_StoppingCriterionMask.GetPointer() != 0 );
+  const double regularizationWeighting = df->GetRegularizationWeighting();
+
+  // The local buffers hold a tile with a margin of two voxels, as vectors
+  // of all the components of a voxel.  The next deformation field is
+  // computed on the tile and its face neighbors, from the deformation
+  // field on the tile and its neighbors at a distance of up to two voxels.
+  const IndexValueType tileSize = 16;
+  const IndexValueType margin = 2;
+  OffsetValueType localStrides[ImageDimension];
+  OffsetValueType localSize = 1;
+  for( unsigned int d = 0; d < ImageDimension; d++ )
+    {
+    localStrides[d] = localSize;
+    localSize *= tileSize + 2 * margin;
+    }
+  std::vector< DeformationVectorType > localField( localSize );
+  std::vector< DeformationVectorType > localNextField( localSize );
+
+  // Initialize the metrics and the energies
+  UpdateMetricsIntermediateStruct localUpdateMetricsIntermediate;
+  localUpdateMetricsIntermediate.zero();
+  double localIntensityDistanceEnergy = 0.0;
+  double localRegularizationEnergy = 0.0;
+
+  // Grid of the tiles covering the region
+  ThreadRegionType tileGrid;
+  FieldSizeType tileGridSize;
+  for( unsigned int d = 0; d < ImageDimension; d++ )
+    {
+    tileGridSize[d] =
+      ( regionToProcess.GetSize()[d] + tileSize - 1 ) / tileSize;
+    }
+  tileGrid.SetSize( tileGridSize );
+
+  FieldIndexType tileGridIndex = tileGrid.GetIndex();
+  while( tileGrid.GetNumberOfPixels() != 0 )
+    {
+    // Region of the tile, cropped to the region to process, and origin of
+    // the local buffers
+    ThreadRegionType tile;
+    FieldIndexType tileIndex;
+    FieldSizeType tileSizes;
+    FieldIndexType localOrigin;
+    for( unsigned int d = 0; d < ImageDimension; d++ )
+      {
+      tileIndex[d] = regionToProcess.GetIndex()[d]
+        + tileGridIndex[d] * tileSize;
+      const IndexValueType regionEnd = regionToProcess.GetIndex()[d]
+        + static_cast< IndexValueType >( regionToProcess.GetSize()[d] );
+      tileSizes[d] = std::min( tileSize, regionEnd - tileIndex[d] );
+      localOrigin[d] = tileIndex[d] - margin;
+      }
+    tile.SetIndex( tileIndex );
+    tile.SetSize( tileSizes );
+    ThreadRegionType fieldTile = tile;
+    fieldTile.PadByRadius( margin );
+    ThreadRegionType nextFieldTile = tile;
+    nextFieldTile.PadByRadius( 1 );
+
+    // Copy the deformation field around the tile.  Voxels outside the
+    // buffered region take the value of the closest voxel, as with the
+    // zero flux Neumann boundary condition of the neighborhood iterators.
+    FieldIndexType index = fieldTile.GetIndex();
+    do
+      {
+      FieldIndexType clampedIndex = index;
+      OffsetValueType localOffset = 0;
+      for( unsigned int d = 0; d < ImageDimension; d++ )
+        {
+        const IndexValueType first = bufferedRegion.GetIndex()[d];
+        const IndexValueType last = first
+          + static_cast< IndexValueType >( bufferedRegion.GetSize()[d] )
+          - 1;
+        clampedIndex[d] = std::max( first, std::min( last, index[d] ) );
+        localOffset += ( index[d] - localOrigin[d] ) * localStrides[d];
+        }
+      localField[localOffset] =
+        field[output->ComputeOffset( clampedIndex )];
+      }
+    while( IncrementIndexInRegion( index, fieldTile ) );
+
+    // Compute the update and the next deformation field on the tile and
+    // on its face neighbors within the buffered region
+    index = nextFieldTile.GetIndex();
+    do
+      {
+      unsigned int numberOfDimensionsOutsideTile = 0;
+      OffsetValueType localOffset = 0;
+      for( unsigned int d = 0; d < ImageDimension; d++ )
+        {
+        if( index[d] < tileIndex[d]
+          || index[d] >= tileIndex[d]
+            + static_cast< IndexValueType >( tileSizes[d] ) )
+          {
+          numberOfDimensionsOutsideTile++;
+          }
+        localOffset += ( index[d] - localOrigin[d] ) * localStrides[d];
+        }
+      if( numberOfDimensionsOutsideTile > 1
+        || !bufferedRegion.IsInside( index ) )
+        {
+        continue;
+        }
+
+      const DeformationVectorType & deformation = localField[localOffset];
+
+      // Compute the intensity distance update term
+      UpdateType intensityDistanceTerm =
+        df->ComputeIntensityDistanceUpdate( index, deformation );
+
+      // Compute the diffusive regularization update term, which is
+      // div( \grad( u_i ) ) for each component u_i since the diffusion
+      // tensor is the identity
+      UpdateType regularizationTerm;
+      regularizationTerm.Fill( 0 );
+      if( computeRegularization )
+        {
+        for( unsigned int i = 0; i < ImageDimension; i++ )
+          {
+          double laplacian = 0.0;
+          for( unsigned int d = 0; d < ImageDimension; d++ )
+            {
+            const double positionA =
+              localField[localOffset + localStrides[d]][i];
+            const double positionB =
+              localField[localOffset - localStrides[d]][i];
+            const double center = deformation[i];
+            laplacian += ( positionA + positionB - 2.0 * center )
+              / ( spacing[d] * spacing[d] );
+            }
+          regularizationTerm[i] =
+            static_cast< DeformationVectorComponentType >( laplacian );
+          }
+        regularizationTerm *= regularizationWeighting;
+        }
+
+      UpdateType updateTerm = intensityDistanceTerm + regularizationTerm;
+      localNextField[localOffset] = deformation
+        + static_cast< DeformationVectorType >( updateTerm * dt );
+      if( numberOfDimensionsOutsideTile != 0 )
+        {
+        continue;
+        }
+
+      const OffsetValueType offset = output->ComputeOffset( index );
+      updates[offset] = updateTerm;
+
+      // Get whether or not to include this pixel in the stopping criterion
+      bool includeInStoppingCriterion = true;
+      if( haveStoppingCriterionMask )
+        {
+        includeInStoppingCriterion
+            = ( m_StoppingCriterionMask->GetPixel( index ) == 0.0 );
+        }
+
+      // Update the metrics
+      if( includeInStoppingCriterion )
+        {
+        double squaredTotalUpdateMagnitude = 0.0;
+        double squaredIntensityDistanceUpdateMagnitude = 0.0;
+        double squaredRegularizationUpdateMagnitude = 0.0;
+        for( unsigned int i = 0; i < ImageDimension; i++ )
+          {
+          squaredTotalUpdateMagnitude += vnl_math::sqr( updateTerm[i] );
+          squaredIntensityDistanceUpdateMagnitude
+              += vnl_math::sqr( intensityDistanceTerm[i] );
+          squaredRegularizationUpdateMagnitude
+              += vnl_math::sqr( regularizationTerm[i] );
+          }
+        localUpdateMetricsIntermediate.NumberOfPixelsProcessed++;
+        localUpdateMetricsIntermediate.SumOfSquaredTotalUpdateMagnitude
+          += squaredTotalUpdateMagnitude;
+        localUpdateMetricsIntermediate
+          .SumOfSquaredIntensityDistanceUpdateMagnitude
+          += squaredIntensityDistanceUpdateMagnitude;
+        localUpdateMetricsIntermediate
+          .SumOfSquaredRegularizationUpdateMagnitude
+          += squaredRegularizationUpdateMagnitude;
+        localUpdateMetricsIntermediate.SumOfTotalUpdateMagnitude
+          += std::sqrt( squaredTotalUpdateMagnitude );
+        localUpdateMetricsIntermediate
+          .SumOfIntensityDistanceUpdateMagnitude
+          += std::sqrt( squaredIntensityDistanceUpdateMagnitude );
+        localUpdateMetricsIntermediate.SumOfRegularizationUpdateMagnitude
+          += std::sqrt( squaredRegularizationUpdateMagnitude );
+        }
+      }
+    while( IncrementIndexInRegion( index, nextFieldTile ) );
+
+    // Face neighbors outside the buffered region take the next deformation
+    // of the closest voxel, which is on the tile
+    index = nextFieldTile.GetIndex();
+    do
+      {
+      if( bufferedRegion.IsInside( index ) )
+        {
+        continue;
+        }
+      FieldIndexType clampedIndex = index;
+      OffsetValueType localOffset = 0;
+      OffsetValueType clampedLocalOffset = 0;
+      for( unsigned int d = 0; d < ImageDimension; d++ )
+        {
+        const IndexValueType first = bufferedRegion.GetIndex()[d];
+        const IndexValueType last = first
+          + static_cast< IndexValueType >( bufferedRegion.GetSize()[d] )
+          - 1;
+        clampedIndex[d] = std::max( first, std::min( last, index[d] ) );
+        localOffset += ( index[d] - localOrigin[d] ) * localStrides[d];
+        clampedLocalOffset +=
+          ( clampedIndex[d] - localOrigin[d] ) * localStrides[d];
+        }
+      localNextField[localOffset] = localNextField[clampedLocalOffset];
+      }
+    while( IncrementIndexInRegion( index, nextFieldTile ) );
+
+    // Write the next deformation field of the tile, and compute its
+    // energies
+    index = tile.GetIndex();
+    do
+      {
+      OffsetValueType localOffset = 0;
+      for( unsigned int d = 0; d < ImageDimension; d++ )
+        {
+        localOffset += ( index[d] - localOrigin[d] ) * localStrides[d];
+        }
+      const DeformationVectorType & nextDeformation =
+        localNextField[localOffset];
+      nextField[output->ComputeOffset( index )] = nextDeformation;
+
+      // Get whether or not to include this pixel in the stopping criterion
+      bool includeInStoppingCriterion = true;
+      if( haveStoppingCriterionMask )
+        {
+        includeInStoppingCriterion
+            = ( m_StoppingCriterionMask->GetPixel( index ) == 0.0 );
+        }
+      if( !includeInStoppingCriterion )
+        {
+        continue;
+        }
+
+      // Calculate intensity distance energy
+      if( computeIntensityDistance )
+        {
+        localIntensityDistanceEnergy +=
+          df->ComputeIntensityDistanceEnergy( index, nextDeformation );
+        }
+
+      // Calculate regularization energy, from the first order derivatives
+      // of each component of the next deformation field
+      if( computeRegularization )
+        {
+        double voxelRegularizationEnergy = 0.0;
+        for( unsigned int i = 0; i < ImageDimension; i++ )
+          {
+          itk::Vector< double, ImageDimension > firstOrderDerivative;
+          for( unsigned int d = 0; d < ImageDimension; d++ )
+            {
+            const double positionA =
+              localNextField[localOffset + localStrides[d]][i];
+            const double positionB =
+              localNextField[localOffset - localStrides[d]][i];
+            firstOrderDerivative[d] =
+              0.5 * ( positionA - positionB ) / spacing[d];
+            }
+          DeformationVectorType termRegularizationEnergy( 0.0 );
+          termRegularizationEnergy += firstOrderDerivative;
+          voxelRegularizationEnergy += 0.5 *
+            ( termRegularizationEnergy * termRegularizationEnergy );
+          }
+        localRegularizationEnergy +=
+          voxelRegularizationEnergy * regularizationWeighting;
+        }
+      }
+    while( IncrementIndexInRegion( index, tile ) );
+
+    if( !IncrementIndexInRegion( tileGridIndex, tileGrid ) )
+      {
+      break;
+      }
+    }
+
+  updateMetricsIntermediate.copyFrom( localUpdateMetricsIntermediate );
+  intensityDistanceEnergy = localIntensityDistanceEnergy;
+  regularizationEnergy = localRegularizationEnergy;
+}
+
+/**
+ * Advances an index to the next index of a region
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+bool
+DiffusiveRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField >
+::IncrementIndexInRegion( typename OutputImageType::IndexType & index,
+                          const ThreadRegionType & region )
+{
+  for( unsigned int d = 0; d < ImageDimension; d++ )
+    {
+    index[d]++;
+    if( index[d] < region.GetIndex()[d]
+      + static_cast< IndexValueType >( region.GetSize()[d] ) )
+      {
+      return true;
+      }
+    index[d] = region.GetIndex()[d];
+    }
+  return false;
+}
+
 /**
  * Computes the intensity distance and regularization energies under the
  * current update buffer.
@@ -1291,10 +1783,9 @@ DiffusiveRegistrationFilter
 
   if( this->GetComputeRegularizationTerm() )
     {
-    this->UpdateDeformationComponentImages( outputField );
-    // TODO this will compute first and second derivatives, we need first
-    // only
-    this->ComputeDeformationComponentDerivativeImages();
+    // The energies need the first order derivatives only, but the second
+    // order derivatives are kept for the next iteration
+    this->UpdateDeformationComponentDerivativeImages( outputField );
     }
 
   // Set up for multithreaded processing.
@@ -1636,6 +2127,26 @@ DiffusiveRegistrationFilter
   < TFixedImage, TMovingImage, TDeformationField >
 ::ApplyUpdate( const TimeStepType & dt )
 {
+  if( m_FusedIterationPending )
+    {
+    // The fused iteration already computed the next deformation field and
+    // its energies, so the output only takes over its buffer.  The
+    // previous buffer of the output is reused by the next iteration.
+    OutputImagePointer output = this->GetOutput();
+    typename OutputImageType::PixelContainerPointer outputPixels =
+      output->GetPixelContainer();
+    output->SetPixelContainer( m_FusedOutputBuffer->GetPixelContainer() );
+    m_FusedOutputBuffer->SetPixelContainer( outputPixels );
+    output->Modified();
+
+    m_Energies.copyFrom( m_FusedEnergies );
+    m_FusedIterationPending = false;
+
+    // Print out energy metrics and evaluate stopping condition
+    this->PostProcessIteration( dt );
+    return;
+    }
+
   // Do the apply update.  After this,
   // - update buffer as for determined step size
   // - energies calculated with determined stepSize ONLY for line search
@@ -1780,8 +2291,7 @@ DiffusiveRegistrationFilter
 ::PostProcessIteration( TimeStepType stepSize )
 {
   // Keep track of the total registration time
-  static TimeStepType totalTime = 0.0;
-  totalTime += stepSize;
+  m_TotalTime += stepSize;
 
   // Get the change in energy and update metrics since the previous
   // iteration
@@ -1794,10 +2304,9 @@ DiffusiveRegistrationFilter
   // Keep track of the total energy change within each stopping criterion
   // evaluation block
   unsigned int elapsedIterations = this->GetElapsedIterations();
-  static double totalEnergyChangeInEvaluationPeriod = 0;
   if( elapsedIterations != 0 )
     {
-    totalEnergyChangeInEvaluationPeriod += energiesChange.TotalEnergy;
+    m_TotalEnergyChangeInEvaluationPeriod += energiesChange.TotalEnergy;
     }
 
   // Print out logging information
@@ -1823,7 +2332,7 @@ DiffusiveRegistrationFilter
   std::cout.precision( 6 );
   std::cout << elapsedIterations << delimiter
     << stepSize << delimiter
-    << totalTime << sectionDelimiter
+    << m_TotalTime << sectionDelimiter
 
     << m_UpdateMetrics.RMSTotalUpdateMagnitude << delimiter
     << m_UpdateMetrics.RMSIntensityDistanceUpdateMagnitude << delimiter
@@ -1854,18 +2363,17 @@ DiffusiveRegistrationFilter
     << energiesChange.IntensityDistanceEnergy << delimiter
     << energiesChange.RegularizationEnergy << sectionDelimiter
 
-    << ",,, " << totalEnergyChangeInEvaluationPeriod << " ,,, ";
+    << ",,, " << m_TotalEnergyChangeInEvaluationPeriod << " ,,, ";
 
 
   // Error checking for energy increase that indicates we should stop
   // This should never happen with the line search turned on
   // TODO this makes tests fail
-  static int numEnergyViolations = 0;
   if( elapsedIterations != 0 && energiesChange.TotalEnergy > 0.0 )
     {
-    numEnergyViolations++;
+    m_NumberOfEnergyViolations++;
     }
-  if( numEnergyViolations > 10 )
+  if( m_NumberOfEnergyViolations > 10 )
     {
     std::cout
       << "Total energy is increasing, indicating numeric instability. "
@@ -1882,15 +2390,15 @@ DiffusiveRegistrationFilter
     ( ( elapsedIterations + 1 ) % m_StoppingCriterionEvaluationPeriod ) ==
     0 )
     {
-    if( totalEnergyChangeInEvaluationPeriod >
+    if( m_TotalEnergyChangeInEvaluationPeriod >
       m_StoppingCriterionMaxTotalEnergyChange )
       {
       std::cout << "Stopping criterion satisfied. "
-                << totalEnergyChangeInEvaluationPeriod << ".  "
+                << m_TotalEnergyChangeInEvaluationPeriod << ".  "
                 << "Registration halting.";
       this->StopRegistration();
       }
-    totalEnergyChangeInEvaluationPeriod = 0;
+    m_TotalEnergyChangeInEvaluationPeriod = 0;
     }
 }
 
@@ -28,6 +28,10 @@ limitations under the License.
 #include <itkCompensatedSummation.h>
 #include <itkGaussianDerivativeImageFunction.h>
 #include <itkImageToSpatialObjectMetric.h>
+#include <itkMultiThreaderBase.h>
+#include <itkVectorLinearInterpolateImageFunction.h>
+
+#include <vector>
 
 namespace itk
 {
@@ -127,7 +131,9 @@ public:
   void GetValueAndDerivative( const ParametersType & parameters,
     MeasureType & Value, DerivativeType  & Derivative ) const;
 
-  /** Initialize the metric */
+  /** Initialize the metric.  The tube points, normals and radii are
+   * gathered here, so Initialize() must be called again if the tubes
+   * change. */
   void Initialize( void ) throw ( ExceptionObject );
 
   /** Control the radius scaling of the metric. */
@@ -154,6 +160,31 @@ public:
     return dynamic_cast<TransformType*>( this->m_Transform.GetPointer() );
     }
 
+  /** Evaluate the metric by interpolating in derivative images that are
+   * precomputed at a few quantized scales, instead of convolving the image
+   * along the normals of every tube point.  The derivative image bank is
+   * computed by Initialize(), once per fixed image and set of scales. */
+  itkSetMacro( UseDerivativeImageBank, bool );
+  itkGetConstMacro( UseDerivativeImageBank, bool );
+  itkBooleanMacro( UseDerivativeImageBank );
+
+  /** Set/Get the number of scales of the derivative image bank.  They are
+   * spaced logarithmically over the scales of the tube points. */
+  itkSetMacro( NumberOfDerivativeImageBankScales, unsigned int );
+  itkGetConstMacro( NumberOfDerivativeImageBankScales, unsigned int );
+
+  /** Get the scales of the derivative image bank */
+  const std::vector< ScalarType > & GetDerivativeImageBankScales( void )
+    const
+    {
+    return m_DerivativeImageBankScales;
+    }
+
+  /** Set/Get the number of threads used to evaluate the tube points.
+   * Zero, the default, uses the global default number of threads. */
+  itkSetMacro( NumberOfThreads, unsigned int );
+  itkGetConstMacro( NumberOfThreads, unsigned int );
+
   /** Downsample the tube points by this integer value. */
 
 protected:
@@ -168,24 +199,103 @@ protected:
   typedef vnl_matrix< ScalarType >                 VnlMatrixType;
   typedef CompensatedSummation< ScalarType >       CompensatedSummationType;
 
+  /** Clones share the images, tubes, transform and interpolators of the
+   * metric, and copy its settings and gathered tube points, so that they
+   * can be evaluated without being initialized again. */
+  virtual LightObject::Pointer InternalClone( void ) const;
+
   virtual void ComputeCenterOfRotation( void );
   SizeValueType CountTubePoints( void );
 
+  /** The gradient and the upper triangle of the Hessian, at one scale */
+  itkStaticConstMacro( NumberOfDerivativeImageComponents, unsigned int,
+    ImageDimension + ImageDimension * ( ImageDimension + 1 ) / 2 );
+  typedef Vector< float, NumberOfDerivativeImageComponents >
+                                                   DerivativePixelType;
+  typedef Image< DerivativePixelType, ImageDimension >
+                                                   DerivativeImageType;
+  typedef VectorLinearInterpolateImageFunction< DerivativeImageType,
+    ScalarType >                                   DerivativeInterpolatorType;
+  typedef typename DerivativeInterpolatorType::OutputType
+                                                   DerivativeValueType;
+
+  /** Compute the derivative images of the fixed image at the bank scales
+   * and assign every tube point to its nearest scale. */
+  void GenerateDerivativeImageBank( void );
+
   void GetDeltaAngles( const OutputPointType & x,
     const VnlVectorType & dx,
     const VectorType & offsets,
     ScalarType angle[3] ) const;
 
+  /** Compute the value and/or the derivative in one pass over the tube
+   * points. */
+  void ComputeValueAndDerivative( const ParametersType & parameters,
+    bool computeValue, MeasureType & value,
+    bool computeDerivative, DerivativeType & derivative ) const;
+
 private:
   ImageToTubeRigidMetric( const Self& ); // purposely not implemented
   void operator=( const Self& ); // purposely not implemented
 
+  /** Number of tube points in a block of work of a thread */
+  itkStaticConstMacro( PointBlockSize, unsigned int, 64 );
+
+  /** Per call state of the tube point blocks.  The sums of every block are
+   * kept apart, so that their total does not depend on the number of
+   * threads. */
+  struct ValueAndDerivativeThreadStruct
+    {
+    const Self *                  Metric;
+    MatrixType                    Matrix;
+    VectorType                    Offset;
+    bool                          ComputeValue;
+    bool                          ComputeDerivative;
+    SizeValueType                 NumberOfBlocks;
+    std::vector< ScalarType >     BlockMeasures;
+    std::vector< ScalarType >     BlockWeights;
+    std::vector< ScalarType >     BlockBiases;
+    std::vector< ScalarType >     BlockDPositions;
+    std::vector< unsigned char >  IsInside;
+    std::vector< ScalarType >     TransformedPoints;
+    std::vector< ScalarType >     DTransformedPoints;
+    }; // End struct ValueAndDerivativeThreadStruct
+
+  static ITK_THREAD_RETURN_TYPE ValueAndDerivativeThreaderCallback(
+    void * arg );
+
+  void ComputePointBlock( SizeValueType block,
+    ValueAndDerivativeThreadStruct * str ) const;
+
   typename DerivativeImageFunctionType::Pointer m_DerivativeImageFunction;
 
   ScalarType m_Kappa;
   ScalarType m_MinimumScalingRadius;
   ScalarType m_Extent;
 
+  unsigned int m_NumberOfThreads;
+
+  bool                       m_UseDerivativeImageBank;
+  unsigned int               m_NumberOfDerivativeImageBankScales;
+  std::vector< ScalarType >  m_DerivativeImageBankScales;
+  std::vector< typename DerivativeInterpolatorType::Pointer >
+                             m_DerivativeImageBank;
+
+  /** The fixed image, and its modified time, of the derivative images */
+  const FixedImageType *     m_DerivativeImageBankImage;
+  ModifiedTimeType           m_DerivativeImageBankImageMTime;
+
+  /** The tube points as a structure of arrays: the values of dimension d
+   * of point p are stored at d * m_NumberOfTubePoints + p. */
+  SizeValueType              m_NumberOfTubePoints;
+  std::vector< ScalarType >  m_TubePointPositions;
+  std::vector< ScalarType >  m_TubePointNormals1;
+  std::vector< ScalarType >  m_TubePointNormals2;
+  std::vector< ScalarType >  m_TubePointRadii;
+
+  /** The derivative image bank scale of every tube point */
+  std::vector< unsigned int >  m_TubePointBankScales;
+
   /** The center of rotation of the weighted tube points. */
   typedef PointType CenterOfRotationType;
   CenterOfRotationType m_CenterOfRotation;
@@ -207,6 +317,19 @@ private:
     const ScalarType scale,
     const OutputPointType & currentPoint ) const;
 
+  /** Approximations of ComputeLaplacianMagnitude() and
+   * ComputeThirdDerivatives() from the derivative images at a scale.  The
+   * convolutions along the normals are replaced by the Gaussian
+   * derivatives of the image, scaled to match them. */
+  ScalarType ComputeLaplacianMagnitudeFromBank(
+    const typename TubePointType::CovariantVectorType & tubeNormal,
+    const ScalarType scale,
+    const DerivativeValueType & derivatives ) const;
+  ScalarType ComputeThirdDerivativesFromBank(
+    const VectorType & v,
+    const ScalarType scale,
+    const DerivativeValueType & derivatives ) const;
+
   /**
    * \warning User is responsible for freeing the list, but not the elements
    * of the list.
@@ -26,6 +26,10 @@ limitations under the License.
 
 #include "itktubeImageToTubeRigidMetric.h"
 
+#include <itkGradientRecursiveGaussianImageFilter.h>
+#include <itkHessianRecursiveGaussianImageFilter.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
 #include <itkLinearInterpolateImageFunction.h>
 
 namespace itk
@@ -44,6 +48,15 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject,
   m_MinimumScalingRadius = 0.1;
   m_Extent = 3.0;
 
+  m_NumberOfThreads = 0;
+
+  m_UseDerivativeImageBank = false;
+  m_NumberOfDerivativeImageBankScales = 4;
+  m_DerivativeImageBankImage = NULL;
+  m_DerivativeImageBankImageMTime = 0;
+
+  m_NumberOfTubePoints = 0;
+
   m_CenterOfRotation.Fill( 0.0 );
 
   m_DerivativeImageFunction = DerivativeImageFunctionType::New();
@@ -64,6 +77,55 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject,
 }
 
 
+template< class TFixedImage, class TMovingSpatialObject,
+          class TTubeSpatialObject >
+LightObject::Pointer
+ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject,
+  TTubeSpatialObject >
+::InternalClone( void ) const
+{
+  LightObject::Pointer loPtr = Superclass::InternalClone();
+
+  Self * rval = dynamic_cast< Self * >( loPtr.GetPointer() );
+  if( rval == NULL )
+    {
+    itkExceptionMacro( << "downcast to type " << this->GetNameOfClass()
+      << " failed." );
+    }
+
+  rval->SetFixedImage( this->m_FixedImage );
+  rval->SetMovingSpatialObject( this->m_MovingSpatialObject );
+  rval->SetTransform( this->m_Transform );
+  rval->SetInterpolator( this->m_Interpolator );
+  rval->m_DerivativeImageFunction = this->m_DerivativeImageFunction;
+
+  rval->m_Kappa = this->m_Kappa;
+  rval->m_MinimumScalingRadius = this->m_MinimumScalingRadius;
+  rval->m_Extent = this->m_Extent;
+  rval->m_NumberOfThreads = this->m_NumberOfThreads;
+  rval->m_CenterOfRotation = this->m_CenterOfRotation;
+  rval->m_FeatureWeights = this->m_FeatureWeights;
+
+  rval->m_UseDerivativeImageBank = this->m_UseDerivativeImageBank;
+  rval->m_NumberOfDerivativeImageBankScales =
+    this->m_NumberOfDerivativeImageBankScales;
+  rval->m_DerivativeImageBankScales = this->m_DerivativeImageBankScales;
+  rval->m_DerivativeImageBank = this->m_DerivativeImageBank;
+  rval->m_DerivativeImageBankImage = this->m_DerivativeImageBankImage;
+  rval->m_DerivativeImageBankImageMTime =
+    this->m_DerivativeImageBankImageMTime;
+
+  rval->m_NumberOfTubePoints = this->m_NumberOfTubePoints;
+  rval->m_TubePointPositions = this->m_TubePointPositions;
+  rval->m_TubePointNormals1 = this->m_TubePointNormals1;
+  rval->m_TubePointNormals2 = this->m_TubePointNormals2;
+  rval->m_TubePointRadii = this->m_TubePointRadii;
+  rval->m_TubePointBankScales = this->m_TubePointBankScales;
+
+  return loPtr;
+}
+
+
 template< class TFixedImage, class TMovingSpatialObject,
           class TTubeSpatialObject >
 void
@@ -108,8 +170,201 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject,
     }
   this->ComputeCenterOfRotation();
 
+  // Gather the tube points once, after their normals have been computed
+  m_NumberOfTubePoints = tubePoints;
+  m_TubePointPositions.resize( TubeDimension * tubePoints );
+  m_TubePointNormals1.resize( TubeDimension * tubePoints );
+  m_TubePointNormals2.resize( TubeDimension * tubePoints );
+  m_TubePointRadii.resize( tubePoints );
+
+  SizeValueType pointCount = 0;
+  typename TubeTreeType::ChildrenListType * tubeList = this->GetTubes();
+  typename TubeTreeType::ChildrenListType::const_iterator tubeIterator;
+  for( tubeIterator = tubeList->begin();
+       tubeIterator != tubeList->end();
+       ++tubeIterator )
+    {
+    TubeType* currentTube = dynamic_cast<TubeType*>(
+      ( *tubeIterator ).GetPointer() );
+
+    if( currentTube != NULL )
+      {
+      typename TubeType::PointListType::const_iterator pointIterator;
+      for( pointIterator = currentTube->GetPoints().begin();
+           pointIterator != currentTube->GetPoints().end();
+           ++pointIterator )
+        {
+        for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+          {
+          const SizeValueType jj = ii * tubePoints + pointCount;
+          m_TubePointPositions[jj] = pointIterator->GetPosition()[ii];
+          m_TubePointNormals1[jj] = pointIterator->GetNormal1()[ii];
+          m_TubePointNormals2[jj] = pointIterator->GetNormal2()[ii];
+          }
+        m_TubePointRadii[pointCount] = pointIterator->GetRadius();
+        ++pointCount;
+        }
+      }
+    }
+  delete tubeList;
+
   this->m_Interpolator->SetInputImage( this->m_FixedImage );
   this->m_DerivativeImageFunction->SetInputImage( this->m_FixedImage );
+
+  if( m_UseDerivativeImageBank )
+    {
+    this->GenerateDerivativeImageBank();
+    }
+}
+
+
+template< class TFixedImage, class TMovingSpatialObject,
+          class TTubeSpatialObject >
+void
+ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject,
+  TTubeSpatialObject >
+::GenerateDerivativeImageBank( void )
+{
+  if( m_NumberOfDerivativeImageBankScales == 0 )
+    {
+    itkExceptionMacro(
+      << "The derivative image bank needs at least one scale." );
+    }
+
+  // Space the scales logarithmically over the scales of the tube points
+  const SizeValueType numberOfPoints = m_NumberOfTubePoints;
+  ScalarType minScale = 0;
+  ScalarType maxScale = 0;
+  for( SizeValueType point = 0; point < numberOfPoints; ++point )
+    {
+    const ScalarType scale = std::max( m_TubePointRadii[point],
+      m_MinimumScalingRadius ) * m_Kappa;
+    if( point == 0 || scale < minScale )
+      {
+      minScale = scale;
+      }
+    if( point == 0 || scale > maxScale )
+      {
+      maxScale = scale;
+      }
+    }
+  if( numberOfPoints == 0 )
+    {
+    minScale = m_MinimumScalingRadius * m_Kappa;
+    maxScale = minScale;
+    }
+
+  unsigned int numberOfScales = m_NumberOfDerivativeImageBankScales;
+  if( maxScale <= minScale )
+    {
+    numberOfScales = 1;
+    }
+  const ScalarType logMinScale = std::log( minScale );
+  ScalarType logScaleStep = 0;
+  if( numberOfScales > 1 )
+    {
+    logScaleStep = ( std::log( maxScale ) - logMinScale )
+      / ( numberOfScales - 1 );
+    }
+  std::vector< ScalarType > scales( numberOfScales );
+  for( unsigned int s = 0; s < numberOfScales; ++s )
+    {
+    scales[s] = std::exp( logMinScale + s * logScaleStep );
+    }
+
+  m_TubePointBankScales.resize( numberOfPoints );
+  for( SizeValueType point = 0; point < numberOfPoints; ++point )
+    {
+    unsigned int s = 0;
+    if( logScaleStep > 0 )
+      {
+      const ScalarType scale = std::max( m_TubePointRadii[point],
+        m_MinimumScalingRadius ) * m_Kappa;
+      s = static_cast< unsigned int >( ( std::log( scale ) - logMinScale )
+        / logScaleStep + 0.5 );
+      if( s >= numberOfScales )
+        {
+        s = numberOfScales - 1;
+        }
+      }
+    m_TubePointBankScales[point] = s;
+    }
+
+  // The images are only computed again for a new fixed image or scales
+  if( m_DerivativeImageBankImage == this->m_FixedImage.GetPointer()
+    && m_DerivativeImageBankImageMTime == this->m_FixedImage->GetMTime()
+    && m_DerivativeImageBankScales == scales )
+    {
+    return;
+    }
+
+  typedef GradientRecursiveGaussianImageFilter< FixedImageType >
+    GradientFilterType;
+  typedef HessianRecursiveGaussianImageFilter< FixedImageType >
+    HessianFilterType;
+  typedef typename GradientFilterType::OutputImageType GradientImageType;
+  typedef typename HessianFilterType::OutputImageType  HessianImageType;
+
+  m_DerivativeImageBank.clear();
+  m_DerivativeImageBankScales = scales;
+  for( unsigned int s = 0; s < numberOfScales; ++s )
+    {
+    typename GradientFilterType::Pointer gradientFilter =
+      GradientFilterType::New();
+    gradientFilter->SetInput( this->m_FixedImage );
+    gradientFilter->SetSigma( scales[s] );
+    gradientFilter->Update();
+
+    typename HessianFilterType::Pointer hessianFilter =
+      HessianFilterType::New();
+    hessianFilter->SetInput( this->m_FixedImage );
+    hessianFilter->SetSigma( scales[s] );
+    hessianFilter->Update();
+
+    typename DerivativeImageType::Pointer derivativeImage =
+      DerivativeImageType::New();
+    derivativeImage->CopyInformation( this->m_FixedImage );
+    derivativeImage->SetRegions(
+      this->m_FixedImage->GetBufferedRegion() );
+    derivativeImage->Allocate();
+
+    ImageRegionConstIterator< GradientImageType > gradientIt(
+      gradientFilter->GetOutput(),
+      derivativeImage->GetBufferedRegion() );
+    ImageRegionConstIterator< HessianImageType > hessianIt(
+      hessianFilter->GetOutput(),
+      derivativeImage->GetBufferedRegion() );
+    ImageRegionIterator< DerivativeImageType > derivativeIt(
+      derivativeImage, derivativeImage->GetBufferedRegion() );
+    DerivativePixelType derivatives;
+    while( !derivativeIt.IsAtEnd() )
+      {
+      unsigned int c = 0;
+      for( unsigned int ii = 0; ii < ImageDimension; ++ii )
+        {
+        derivatives[c++] = gradientIt.Get()[ii];
+        }
+      for( unsigned int ii = 0; ii < ImageDimension; ++ii )
+        {
+        for( unsigned int jj = ii; jj < ImageDimension; ++jj )
+          {
+          derivatives[c++] = hessianIt.Get()( ii, jj );
+          }
+        }
+      derivativeIt.Set( derivatives );
+      ++gradientIt;
+      ++hessianIt;
+      ++derivativeIt;
+      }
+
+    typename DerivativeInterpolatorType::Pointer interpolator =
+      DerivativeInterpolatorType::New();
+    interpolator->SetInputImage( derivativeImage );
+    m_DerivativeImageBank.push_back( interpolator );
+    }
+
+  m_DerivativeImageBankImage = this->m_FixedImage.GetPointer();
+  m_DerivativeImageBankImageMTime = this->m_FixedImage->GetMTime();
 }
 
 
@@ -152,6 +407,8 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
 
   CompensatedSummationType featureWeightSum;
 
+  this->m_CenterOfRotation.Fill( 0.0 );
+
   SizeValueType weightCount = 0;
   typedef typename TubeTreeType::ChildrenListType::iterator TubesIteratorType;
   for( TubesIteratorType tubeIterator = tubeList->begin();
@@ -228,71 +485,351 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
   itkDebugMacro( << "**** Get Value ****" );
   itkDebugMacro( << "Parameters = " << parameters );
 
-  CompensatedSummationType matchMeasure;
-  CompensatedSummationType weightSum;
+  MeasureType value;
+  DerivativeType derivative;
+  this->ComputeValueAndDerivative( parameters, true, value, false,
+    derivative );
+
+  return value;
+}
+
 
+template< class TFixedImage, class TMovingSpatialObject,
+          class TTubeSpatialObject >
+void
+ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
+::ComputeValueAndDerivative( const ParametersType & parameters,
+  bool computeValue, MeasureType & value,
+  bool computeDerivative, DerivativeType & derivative ) const
+{
   // Create a copy of the transform to keep true const correctness (
   // thread-safe )
-  // Set the parameters on the copy and uses the copy.
+  // Set the parameters on the copy, and apply its matrix and offset to the
+  // tube points directly.
   LightObject::Pointer anotherTransform = this->m_Transform->CreateAnother();
   TransformType * transformCopy =
     static_cast< TransformType * >( anotherTransform.GetPointer() );
   transformCopy->SetFixedParameters( this->m_Transform->GetFixedParameters() );
   transformCopy->SetParameters( parameters );
 
-  typename TubeTreeType::ChildrenListType::iterator tubeIterator;
-  typename TubeTreeType::ChildrenListType * tubeList = GetTubes();
-  SizeValueType weightCount = 0;
-  for( tubeIterator = tubeList->begin();
-       tubeIterator != tubeList->end();
-       ++tubeIterator )
+  const SizeValueType numberOfPoints = m_NumberOfTubePoints;
+
+  ValueAndDerivativeThreadStruct str;
+  str.Metric = this;
+  for( unsigned int ii = 0; ii < TubeDimension; ++ii )
     {
-    TubeType * currentTube =
-      dynamic_cast< TubeType * >( ( *tubeIterator ).GetPointer() );
-    if( currentTube != NULL )
+    for( unsigned int jj = 0; jj < TubeDimension; ++jj )
       {
-      typename TubeType::PointListType::iterator pointIterator;
-      for( pointIterator = currentTube->GetPoints().begin();
-           pointIterator != currentTube->GetPoints().end();
-           ++pointIterator )
+      str.Matrix( ii, jj ) = transformCopy->GetMatrix()( ii, jj );
+      }
+    str.Offset[ii] = transformCopy->GetOffset()[ii];
+    }
+  str.ComputeValue = computeValue;
+  str.ComputeDerivative = computeDerivative;
+  str.NumberOfBlocks = ( numberOfPoints + PointBlockSize - 1 )
+    / PointBlockSize;
+  str.BlockMeasures.assign( str.NumberOfBlocks, 0 );
+  str.BlockWeights.assign( str.NumberOfBlocks, 0 );
+  str.IsInside.assign( numberOfPoints, 0 );
+  str.TransformedPoints.resize( TubeDimension * numberOfPoints );
+  if( computeDerivative )
+    {
+    str.BlockBiases.assign( str.NumberOfBlocks * TubeDimension
+      * TubeDimension, 0 );
+    str.BlockDPositions.assign( str.NumberOfBlocks * TubeDimension, 0 );
+    str.DTransformedPoints.resize( TubeDimension * numberOfPoints );
+    }
+
+  unsigned int numberOfThreads = m_NumberOfThreads;
+  if( numberOfThreads == 0 )
+    {
+    numberOfThreads = MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+    }
+  if( numberOfThreads > str.NumberOfBlocks )
+    {
+    numberOfThreads = str.NumberOfBlocks;
+    }
+
+  if( numberOfThreads > 1 )
+    {
+    MultiThreaderBase::Pointer threader = MultiThreaderBase::New();
+    threader->SetMaximumNumberOfThreads( numberOfThreads );
+    threader->SetNumberOfWorkUnits( numberOfThreads );
+    threader->SetSingleMethod( Self::ValueAndDerivativeThreaderCallback,
+      &str );
+    threader->SingleMethodExecute();
+    }
+  else
+    {
+    for( SizeValueType block = 0; block < str.NumberOfBlocks; ++block )
+      {
+      this->ComputePointBlock( block, &str );
+      }
+    }
+
+  if( computeValue )
+    {
+    CompensatedSummationType matchMeasure;
+    CompensatedSummationType weightSum;
+    for( SizeValueType block = 0; block < str.NumberOfBlocks; ++block )
+      {
+      matchMeasure += str.BlockMeasures[block];
+      weightSum += str.BlockWeights[block];
+      }
+
+    if( weightSum.GetSum() == NumericTraits< ScalarType >::Zero )
+      {
+      itkWarningMacro(
+        << "GetValue: All the transformed tube points are outside the "
+        << "image." );
+      value = NumericTraits< ScalarType >::min();
+      }
+    else
+      {
+      value = static_cast< ScalarType >(
+        matchMeasure.GetSum() / weightSum.GetSum() );
+      }
+
+    itkDebugMacro( << "matchMeasure = " << value );
+    }
+
+  if( !computeDerivative )
+    {
+    return;
+    }
+
+  derivative.SetSize( this->GetNumberOfParameters() );
+  derivative.fill( 0.0 );
+
+  VnlMatrixType biasV( TubeDimension, TubeDimension,
+    NumericTraits< ScalarType >::Zero );
+  CompensatedSummationType dPosition[TubeDimension];
+  for( SizeValueType block = 0; block < str.NumberOfBlocks; ++block )
+    {
+    for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+      {
+      for( unsigned int jj = 0; jj < TubeDimension; ++jj )
         {
-        const InputPointType inputPoint = pointIterator->GetPosition();
-        OutputPointType currentPoint;
-        if( this->IsInside( inputPoint, currentPoint, transformCopy ) )
-          {
-          weightSum += m_FeatureWeights[weightCount];
-          ScalarType scalingRadius = pointIterator->GetRadius();
-          scalingRadius = std::max( scalingRadius, m_MinimumScalingRadius );
+        biasV( ii, jj ) += str.BlockBiases[ ( block * TubeDimension + ii )
+          * TubeDimension + jj ];
+        }
+      dPosition[ii] += str.BlockDPositions[ block * TubeDimension + ii ];
+      }
+    }
 
-          const ScalarType scale = scalingRadius * m_Kappa;
+  VnlMatrixType biasVI = vnl_matrix_inverse< ScalarType >( biasV )
+    .inverse();
 
-          matchMeasure += m_FeatureWeights[weightCount] * std::fabs(
-            this->ComputeLaplacianMagnitude( pointIterator->GetNormal1(),
-              scale,
-              currentPoint ) );
-          }
-        ++weightCount;
+  VnlVectorType tV( TubeDimension );
+  for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+    {
+    tV[ii] = dPosition[ii].GetSum();
+    }
+
+  tV *= biasVI;
+
+  VectorType offsets;
+  for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+    {
+    offsets[ii] = tV[ii];
+    }
+
+  // The angles depend on the offsets of all the points, and so take a
+  // second pass.  It only uses the results of the first one.
+  CompensatedSummationType dAngle[TubeDimension];
+  VnlVectorType dXT( TubeDimension );
+  OutputPointType transformedPoint;
+  for( SizeValueType point = 0; point < numberOfPoints; ++point )
+    {
+    if( str.IsInside[point] )
+      {
+      for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+        {
+        dXT[ii] = str.DTransformedPoints[ ii * numberOfPoints + point ];
+        transformedPoint[ii] =
+          str.TransformedPoints[ ii * numberOfPoints + point ];
         }
-      } // end is a tube
+
+      dXT = dXT * biasVI;
+
+      ScalarType angleDelta[TubeDimension];
+      this->GetDeltaAngles( transformedPoint, dXT, offsets, angleDelta );
+      for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+        {
+        dAngle[ii] += m_FeatureWeights[point] * angleDelta[ii];
+        }
+      }
     }
 
-  if( weightSum.GetSum() == NumericTraits< ScalarType >::Zero )
+  derivative[0] = dAngle[0].GetSum();
+  derivative[1] = dAngle[1].GetSum();
+  derivative[2] = dAngle[2].GetSum();
+  derivative[3] = offsets[0];
+  derivative[4] = offsets[1];
+  derivative[5] = offsets[2];
+}
+
+
+template< class TFixedImage, class TMovingSpatialObject,
+          class TTubeSpatialObject >
+ITK_THREAD_RETURN_TYPE
+ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
+::ValueAndDerivativeThreaderCallback( void * arg )
+{
+  unsigned int threadId = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+  unsigned int threadCount = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->NumberOfWorkUnits;
+
+  ValueAndDerivativeThreadStruct * str = ( ValueAndDerivativeThreadStruct * )
+    ( ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  for( SizeValueType block = threadId; block < str->NumberOfBlocks;
+       block += threadCount )
     {
-    itkWarningMacro(
-      << "GetValue: All the transformed tube points are outside the image." );
-    matchMeasure = NumericTraits< ScalarType >::min();
+    str->Metric->ComputePointBlock( block, str );
     }
-  else
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+
+template< class TFixedImage, class TMovingSpatialObject,
+          class TTubeSpatialObject >
+void
+ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
+::ComputePointBlock( SizeValueType block,
+  ValueAndDerivativeThreadStruct * str ) const
+{
+  const SizeValueType numberOfPoints = m_NumberOfTubePoints;
+  const SizeValueType pointBegin = block * PointBlockSize;
+  SizeValueType pointEnd = pointBegin + PointBlockSize;
+  if( pointEnd > numberOfPoints )
     {
-    const ScalarType normalizedMeasure =
-      static_cast< ScalarType >( matchMeasure.GetSum() / weightSum.GetSum() );
-    matchMeasure = normalizedMeasure;
+    pointEnd = numberOfPoints;
     }
 
-  itkDebugMacro( << "matchMeasure = " << matchMeasure.GetSum() );
+  CompensatedSummationType matchMeasure;
+  CompensatedSummationType weightSum;
+  CompensatedSummationType dPosition[TubeDimension];
+  VnlMatrixType biasV( TubeDimension, TubeDimension,
+    NumericTraits< ScalarType >::Zero );
 
-  delete tubeList;
-  return matchMeasure.GetSum();
+  OutputPointType currentPoint;
+  typename TubePointType::CovariantVectorType normal1;
+  VectorType v1;
+  VectorType v2;
+  for( SizeValueType point = pointBegin; point < pointEnd; ++point )
+    {
+    for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+      {
+      currentPoint[ii] = str->Offset[ii];
+      v1[ii] = 0;
+      v2[ii] = 0;
+      for( unsigned int jj = 0; jj < TubeDimension; ++jj )
+        {
+        const SizeValueType kk = jj * numberOfPoints + point;
+        currentPoint[ii] += str->Matrix( ii, jj ) * m_TubePointPositions[kk];
+        v1[ii] += str->Matrix( ii, jj ) * m_TubePointNormals1[kk];
+        v2[ii] += str->Matrix( ii, jj ) * m_TubePointNormals2[kk];
+        }
+      }
+
+    if( !this->m_Interpolator->IsInsideBuffer( currentPoint ) )
+      {
+      continue;
+      }
+
+    str->IsInside[point] = 1;
+    for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+      {
+      str->TransformedPoints[ ii * numberOfPoints + point ] =
+        currentPoint[ii];
+      }
+
+    const ScalarType weight = m_FeatureWeights[point];
+    ScalarType scale = std::max( m_TubePointRadii[point],
+      m_MinimumScalingRadius ) * m_Kappa;
+
+    DerivativeValueType derivatives;
+    if( m_UseDerivativeImageBank )
+      {
+      const unsigned int bankScale = m_TubePointBankScales[point];
+      scale = m_DerivativeImageBankScales[bankScale];
+      derivatives = m_DerivativeImageBank[bankScale]->Evaluate(
+        currentPoint );
+      }
+
+    if( str->ComputeValue )
+      {
+      for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+        {
+        normal1[ii] = m_TubePointNormals1[ ii * numberOfPoints + point ];
+        }
+      weightSum += weight;
+      if( m_UseDerivativeImageBank )
+        {
+        matchMeasure += weight * std::fabs(
+          this->ComputeLaplacianMagnitudeFromBank( normal1, scale,
+            derivatives ) );
+        }
+      else
+        {
+        matchMeasure += weight * std::fabs(
+          this->ComputeLaplacianMagnitude( normal1, scale,
+            currentPoint ) );
+        }
+      }
+
+    if( str->ComputeDerivative )
+      {
+      for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+        {
+        for( unsigned int jj = 0; jj < TubeDimension; ++jj )
+          {
+          biasV( ii, jj ) += weight * ( v1[ii] * v1[jj] + v2[ii] * v2[jj] );
+          }
+        }
+
+      ScalarType dXProj1;
+      ScalarType dXProj2;
+      if( m_UseDerivativeImageBank )
+        {
+        dXProj1 = this->ComputeThirdDerivativesFromBank( v1, scale,
+          derivatives );
+        dXProj2 = this->ComputeThirdDerivativesFromBank( v2, scale,
+          derivatives );
+        }
+      else
+        {
+        dXProj1 = this->ComputeThirdDerivatives( v1, scale, currentPoint );
+        dXProj2 = this->ComputeThirdDerivatives( v2, scale, currentPoint );
+        }
+
+      for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+        {
+        const ScalarType dX = dXProj1 * v1[ii] + dXProj2 * v2[ii];
+        str->DTransformedPoints[ ii * numberOfPoints + point ] = dX;
+        dPosition[ii] += weight * dX;
+        }
+      }
+    }
+
+  str->BlockMeasures[block] = matchMeasure.GetSum();
+  str->BlockWeights[block] = weightSum.GetSum();
+  if( str->ComputeDerivative )
+    {
+    for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+      {
+      for( unsigned int jj = 0; jj < TubeDimension; ++jj )
+        {
+        str->BlockBiases[ ( block * TubeDimension + ii ) * TubeDimension
+          + jj ] = biasV( ii, jj );
+        }
+      str->BlockDPositions[ block * TubeDimension + ii ] =
+        dPosition[ii].GetSum();
+      }
+    }
 }
 
 
@@ -309,18 +846,23 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
   const OutputPointType & currentPoint ) const
 {
   // We convolve the 1D signal defined by the direction v at point
-  // currentPoint with a second derivative of a Gaussian
+  // currentPoint with a second derivative of a Gaussian.  The kernel is
+  // made zero-mean over the samples inside the image, which is applied
+  // after a single pass:
+  //   sum( v * ( k - mean( k ) ) ) = sum( v * k ) - mean( k ) * sum( v )
   const ScalarType scaleSquared = scale * scale;
   const ScalarType scaleExtentProduct = scale * m_Extent;
   CompensatedSummationType kernelSum;
+  CompensatedSummationType valueSum;
+  CompensatedSummationType weightedValueSum;
   SizeValueType numberOfKernelPoints = 0;
 
+  typename FixedImageType::PointType point;
   for( ScalarType distance = -scaleExtentProduct;
        distance <= scaleExtentProduct;
        //! \todo better calculation of the increment instead of just +1
        ++distance )
     {
-    typename FixedImageType::PointType point;
     for( unsigned int ii = 0; ii < ImageDimension; ++ii )
       {
       point[ii] = currentPoint[ii] + distance * tubeNormal.GetElement( ii );
@@ -329,44 +871,30 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
     if( this->m_Interpolator->IsInsideBuffer( point ) )
       {
       const ScalarType distanceSquared = distance * distance;
-      //! \todo cache this value, so it can be used in the next loop
-      kernelSum += ( -1.0 + ( distanceSquared / scaleSquared ) )
+      const ScalarType kernelValue =
+        ( -1.0 + ( distanceSquared / scaleSquared ) )
         * std::exp( -0.5 * distanceSquared / scaleSquared );
+      const ScalarType value =
+        static_cast< ScalarType >(
+          this->m_Interpolator->Evaluate( point ) );
+      kernelSum += kernelValue;
+      valueSum += value;
+      weightedValueSum += value * kernelValue;
       ++numberOfKernelPoints;
       }
     }
 
+  if( numberOfKernelPoints == 0 )
+    {
+    return 0;
+    }
+
   //! \todo check this normalization
   //( //where is the 1/( scale * sqrt( 2 pi ) )
   //term?
   const ScalarType error = kernelSum.GetSum() / numberOfKernelPoints;
-  CompensatedSummationType result;
-  for( ScalarType distance = -scaleExtentProduct;
-       distance <= scaleExtentProduct;
-       //! \todo better calculation of the increment instead of just +1
-       ++distance )
-    {
-    const ScalarType distanceSquared = distance * distance;
-    const ScalarType kernelValue =
-      ( -1.0 + ( distanceSquared / scaleSquared ) )
-      * std::exp( -0.5 * distanceSquared / scaleSquared ) - error;
 
-    typename FixedImageType::PointType point;
-    for( unsigned int ii = 0; ii < ImageDimension; ++ii )
-      {
-      point[ii] = currentPoint[ii] + distance * tubeNormal.GetElement( ii );
-      }
-
-    if( this->m_Interpolator->IsInsideBuffer( point ) )
-      {
-      const ScalarType value =
-        static_cast< ScalarType >(
-          this->m_Interpolator->Evaluate( point ) );
-      result += value * kernelValue;
-      }
-    }
-
-  return result.GetSum();
+  return weightedValueSum.GetSum() - error * valueSum.GetSum();
 }
 
 
@@ -395,192 +923,12 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
 ::GetDerivative( const ParametersType & parameters,
                  DerivativeType & derivative ) const
 {
-  derivative.SetSize( this->GetNumberOfParameters() );
-
-  // Create a copy of the transform to keep true const correctness
-  // ( thread-safe )
-  // Set the parameters on the copy and uses the copy.
-  LightObject::Pointer anotherTransform =
-    this->m_Transform->CreateAnother();
-  TransformType * transformCopy =
-    static_cast< TransformType * >( anotherTransform.GetPointer() );
-  transformCopy->SetFixedParameters( this->m_Transform->GetFixedParameters() );
-  transformCopy->SetParameters( parameters );
-
   itkDebugMacro( << "**** Get Derivative ****" );
   itkDebugMacro( << "parameters = "<< parameters )
 
-  VnlMatrixType biasV( TubeDimension, TubeDimension,
-    NumericTraits< ScalarType >::Zero );
-  VnlMatrixType biasVI( TubeDimension, TubeDimension,
-    NumericTraits< ScalarType >::Zero );
-
-  SizeValueType weightCount = 0;
-
-  CompensatedSummationType dPosition[TubeDimension];
-
-  VnlMatrixType tM( TubeDimension, TubeDimension );
-  VnlVectorType v1T( TubeDimension );
-  VnlVectorType v2T( TubeDimension );
-
-  typedef std::vector< OutputPointType > TubePointsContainerType;
-  TubePointsContainerType transformedTubePoints;
-  transformedTubePoints.reserve( m_FeatureWeights.GetSize() );
-
-  typedef std::vector< VectorType >      dTubePointsContainerType;
-  dTubePointsContainerType dtransformedTubePoints;
-  dtransformedTubePoints.reserve( m_FeatureWeights.GetSize() );
-
-  derivative.fill( 0.0 );
-
-  typename TubeTreeType::ChildrenListType * tubeList = GetTubes();
-  typename TubeTreeType::ChildrenListType::const_iterator tubeIterator;
-  for( tubeIterator = tubeList->begin();
-       tubeIterator != tubeList->end();
-       ++tubeIterator )
-    {
-    TubeType* currentTube = dynamic_cast<TubeType*>(
-      ( *tubeIterator ).GetPointer() );
-
-    if( currentTube != NULL )
-      {
-      typename TubeType::PointListType::const_iterator pointIterator;
-      for( pointIterator = currentTube->GetPoints().begin();
-           pointIterator != currentTube->GetPoints().end();
-           ++pointIterator )
-        {
-        InputPointType inputPoint = pointIterator->GetPosition();
-        OutputPointType currentPoint;
-        if( this->IsInside( inputPoint, currentPoint, transformCopy ) )
-          {
-          transformedTubePoints.push_back( currentPoint );
-
-          //! \todo: these should be CovariantVectors?
-          VectorType v1;
-          VectorType v2;
-          for( unsigned int ii = 0; ii < TubeDimension; ++ii )
-            {
-            v1[ii] = pointIterator->GetNormal1()[ii];
-            v2[ii] = pointIterator->GetNormal2()[ii];
-            }
-
-          for( unsigned int ii = 0; ii < TubeDimension; ++ii )
-            {
-            v1T[ii] = transformCopy->TransformVector( v1 )[ii];
-            v2T[ii] = transformCopy->TransformVector( v2 )[ii];
-            }
-          tM = outer_product( v1T, v1T );
-          tM = tM + outer_product( v2T, v2T );
-          tM = m_FeatureWeights[weightCount] * tM;
-          biasV += tM;
-
-          v1 = transformCopy->TransformVector( v1 );
-          v2 = transformCopy->TransformVector( v2 );
-
-          ScalarType scalingRadius = pointIterator->GetRadius();
-          scalingRadius = std::max( scalingRadius, m_MinimumScalingRadius );
-
-          const ScalarType scale = scalingRadius * m_Kappa;
-
-          const ScalarType dXProj1
-            = this->ComputeThirdDerivatives( v1, scale, currentPoint );
-          const ScalarType dXProj2
-            = this->ComputeThirdDerivatives( v2, scale, currentPoint );
-
-          VectorType dtransformedTubePoint;
-          for( unsigned int ii = 0; ii < TubeDimension; ++ii )
-            {
-            dtransformedTubePoint[ii] =
-              ( dXProj1 * v1[ii] + dXProj2 * v2[ii] );
-            dPosition[ii] +=
-              m_FeatureWeights[weightCount] * ( dtransformedTubePoint[ii] );
-            }
-          dtransformedTubePoints.push_back( dtransformedTubePoint );
-          }
-        ++weightCount;
-        }
-      }
-    }
-
-  biasVI = vnl_matrix_inverse< ScalarType >( biasV ).inverse();
-
-  VnlVectorType tV( TubeDimension );
-  for( unsigned int ii = 0; ii < TubeDimension; ++ii )
-    {
-    tV[ii] = dPosition[ii].GetSum();
-    }
-
-  tV *= biasVI;
-
-  for( unsigned int ii = 0; ii < TubeDimension; ++ii )
-    {
-    dPosition[ii] = tV[ii];
-    }
-
-  CompensatedSummationType dAngle[TubeDimension];
-  VectorType offsets;
-  for( unsigned int ii = 0; ii < TubeDimension; ++ii )
-    {
-    offsets[ii] = dPosition[ii].GetSum();
-    }
-  typename TubePointsContainerType::const_iterator transformedTubePointsIt =
-    transformedTubePoints.begin();
-  typename dTubePointsContainerType::const_iterator
-    dtransformedTubePointsIt = dtransformedTubePoints.begin();
-  weightCount = 0;
-  for( tubeIterator = tubeList->begin();
-       tubeIterator != tubeList->end();
-       ++tubeIterator )
-    {
-    TubeType* currentTube = dynamic_cast<TubeType*>(
-      ( *tubeIterator ).GetPointer() );
-
-    if( currentTube != NULL )
-      {
-      typename TubeType::PointListType::const_iterator pointIterator;
-      for( pointIterator = currentTube->GetPoints().begin();
-           pointIterator != currentTube->GetPoints().end();
-           ++pointIterator )
-        {
-        InputPointType inputPoint = pointIterator->GetPosition();
-        OutputPointType currentPoint;
-        //! \todo this checking is not necessary, but we have to make sure
-        //have
-        //the corresponding weight -- should cache the result and use it
-        //here.
-        if( this->IsInside( inputPoint, currentPoint, transformCopy ) )
-          {
-          VnlVectorType dXT( TubeDimension );
-          for( unsigned int ii = 0; ii < TubeDimension; ++ii )
-            {
-            dXT[ii] = ( *dtransformedTubePointsIt )[ii];
-            }
-
-          dXT = dXT * biasVI;
-
-          ScalarType angleDelta[TubeDimension];
-          this->GetDeltaAngles( *transformedTubePointsIt, dXT, offsets,
-            angleDelta );
-          for( unsigned int ii = 0; ii < TubeDimension; ++ii )
-            {
-            dAngle[ii] += m_FeatureWeights[weightCount] * angleDelta[ii];
-            }
-          ++dtransformedTubePointsIt;
-          ++transformedTubePointsIt;
-          }
-        ++weightCount;
-        }
-      }
-    }
-
-  derivative[0] = dAngle[0].GetSum();
-  derivative[1] = dAngle[1].GetSum();
-  derivative[2] = dAngle[2].GetSum();
-  derivative[3] = dPosition[0].GetSum();
-  derivative[4] = dPosition[1].GetSum();
-  derivative[5] = dPosition[2].GetSum();
-
-  delete tubeList;
+  MeasureType value;
+  this->ComputeValueAndDerivative( parameters, false, value, true,
+    derivative );
 }
 
 
@@ -592,8 +940,8 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
                          MeasureType & value,
                          DerivativeType & derivative ) const
 {
-  value = this->GetValue( parameters );
-  this->GetDerivative( parameters, derivative );
+  this->ComputeValueAndDerivative( parameters, true, value, true,
+    derivative );
 }
 
 
@@ -645,6 +993,60 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
 }
 
 
+template< class TFixedImage, class TMovingSpatialObject,
+          class TTubeSpatialObject >
+typename ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject,
+  TTubeSpatialObject >::ScalarType
+ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
+::ComputeLaplacianMagnitudeFromBank(
+  const typename TubePointType::CovariantVectorType & tubeNormal,
+  const ScalarType scale,
+  const DerivativeValueType & derivatives ) const
+{
+  // The kernel of ComputeLaplacianMagnitude() is the second derivative of
+  // a normalized Gaussian, times sqrt( 2 pi ) scale^3
+  ScalarType secondDerivative = 0;
+  unsigned int c = ImageDimension;
+  for( unsigned int ii = 0; ii < ImageDimension; ++ii )
+    {
+    secondDerivative += derivatives[c++] * tubeNormal[ii] * tubeNormal[ii];
+    for( unsigned int jj = ii + 1; jj < ImageDimension; ++jj )
+      {
+      secondDerivative += 2 * derivatives[c++] * tubeNormal[ii]
+        * tubeNormal[jj];
+      }
+    }
+
+  return std::sqrt( 2 * vnl_math::pi ) * scale * scale * scale
+    * secondDerivative;
+}
+
+
+template< class TFixedImage, class TMovingSpatialObject,
+          class TTubeSpatialObject >
+typename ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject,
+  TTubeSpatialObject >::ScalarType
+ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
+::ComputeThirdDerivativesFromBank(
+  const VectorType & v,
+  const ScalarType scale,
+  const DerivativeValueType & derivatives ) const
+{
+  // The kernel of ComputeThirdDerivatives(), normalized by its absolute
+  // sum over +/- m_Extent scales, is a multiple of the first derivative of
+  // a normalized Gaussian
+  ScalarType firstDerivative = 0;
+  for( unsigned int ii = 0; ii < ImageDimension; ++ii )
+    {
+    firstDerivative += derivatives[ii] * v[ii];
+    }
+
+  return std::sqrt( 2 * vnl_math::pi ) * scale
+    / ( 2 * ( 1 - std::exp( -0.5 * m_Extent * m_Extent ) ) )
+    * firstDerivative;
+}
+
+
 template< class TFixedImage, class TMovingSpatialObject,
           class TTubeSpatialObject >
 bool
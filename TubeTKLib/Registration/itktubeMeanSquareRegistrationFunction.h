@@ -164,6 +164,11 @@ public:
     void *globalData,
     const FloatOffsetType &offset = FloatOffsetType( 0.0 ) );
 
+  /** Computes the update at the given index, under the given deformation
+   *  vector instead of the one of the displacement field. */
+  virtual PixelType ComputeUpdateAtIndex( const IndexType & index,
+    const DeformationFieldPixelType & itvec );
+
   /** Computes the intensity difference between the fixed and moving image
    *  at the given index, under the given deformation vector. */
   virtual double ComputeIntensityDifference( const IndexType & index,
@@ -130,10 +130,24 @@ MeanSquareRegistrationFunction<TFixedImage, TMovingImage, TDeformationField>
 ::ComputeUpdate( const NeighborhoodType &it, void * itkNotUsed(
     globalData ), const FloatOffsetType& itkNotUsed( offset ) )
 {
-  // Get fixed image related information
   // Note: no need to check the index is within
   // fixed image buffer. This is done by the external filter.
   const IndexType index = it.GetIndex();
+  return this->ComputeUpdateAtIndex( index,
+    this->GetDisplacementField()->GetPixel( index ) );
+}
+
+/**
+ * Compute update at an index, under the given deformation vector
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField >
+typename MeanSquareRegistrationFunction<TFixedImage, TMovingImage,
+  TDeformationField>::PixelType
+MeanSquareRegistrationFunction<TFixedImage, TMovingImage, TDeformationField>
+::ComputeUpdateAtIndex( const IndexType & index,
+                        const DeformationFieldPixelType & itvec )
+{
+  // Get fixed image related information
   const CovariantVectorType fixedGradient =
     m_FixedImageGradientCalculator->EvaluateAtIndex( index );
   double fixedGradientSquaredMagnitude = 0.0;
@@ -144,8 +158,6 @@ MeanSquareRegistrationFunction<TFixedImage, TMovingImage, TDeformationField>
     }
 
   // Compute update
-  DeformationFieldPixelType itvec = this->GetDisplacementField()->GetPixel(
-    index );
   const double speedValue = this->ComputeIntensityDifference( index, itvec );
 
   const bool normalizemetric=this->GetNormalizeGradient();
@@ -0,0 +1,125 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __itktubeMultiResolutionDiffusiveRegistrationFilter_h
+#define __itktubeMultiResolutionDiffusiveRegistrationFilter_h
+
+#include "itktubeDiffusiveRegistrationFilter.h"
+
+#include <itkMultiResolutionPDEDeformableRegistration.h>
+#include <itkRecursiveMultiResolutionPyramidImageFilter.h>
+
+namespace itk
+{
+
+namespace tube
+{
+
+/** \class MultiResolutionDiffusiveRegistrationFilter
+ * \brief Coarse-to-fine driver for the diffusive registration filters.
+ *
+ * The fixed and moving images are downsampled once by recursive
+ * pyramids that do not use the shrink filter, so that the deformation
+ * field is not Gaussian smoothed on the last level.  The maximum error of
+ * their Gaussian kernels defaults to 0.01.  The deformation
+ * field of each level is expanded to initialize the next level.
+ *
+ * The registration filter is given the full resolution geometry as its
+ * high resolution template, so that the border normal and weight images
+ * are computed once at full resolution and only resampled on each level.
+ * The template is created again on every run, so that it follows changes
+ * of the fixed image, unless the registration filter was given a template
+ * of its own.
+ * Each level stops early on its own once the stopping criterion of the
+ * registration filter is satisfied.
+ *
+ * \sa DiffusiveRegistrationFilter
+ * \ingroup DeformableImageRegistration
+ */
+template< class TFixedImage, class TMovingImage, class TDeformationField,
+  class TRealType = float >
+class MultiResolutionDiffusiveRegistrationFilter
+  : public MultiResolutionPDEDeformableRegistration< TFixedImage,
+    TMovingImage, TDeformationField, TRealType >
+{
+public:
+  /** Standard class typedefs. */
+  typedef MultiResolutionDiffusiveRegistrationFilter       Self;
+  typedef MultiResolutionPDEDeformableRegistration< TFixedImage,
+    TMovingImage, TDeformationField, TRealType >           Superclass;
+  typedef SmartPointer< Self >                             Pointer;
+  typedef SmartPointer< const Self >                       ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information ( and related methods ). */
+  itkTypeMacro( MultiResolutionDiffusiveRegistrationFilter,
+    MultiResolutionPDEDeformableRegistration );
+
+  /** Convenient typedefs from the superclass. */
+  typedef typename Superclass::FixedImageType         FixedImageType;
+  typedef typename Superclass::MovingImageType        MovingImageType;
+  typedef typename Superclass::FloatImageType         FloatImageType;
+  typedef typename Superclass::DisplacementFieldType  DeformationFieldType;
+
+  /** The diffusive registration filter run on each level */
+  typedef DiffusiveRegistrationFilter< FloatImageType, FloatImageType,
+    DeformationFieldType >                 DiffusiveRegistrationFilterType;
+
+  /** The pyramids used to downsample the fixed and moving images */
+  typedef RecursiveMultiResolutionPyramidImageFilter< FixedImageType,
+    FloatImageType >                       RecursiveFixedImagePyramidType;
+  typedef RecursiveMultiResolutionPyramidImageFilter< MovingImageType,
+    FloatImageType >                       RecursiveMovingImagePyramidType;
+
+protected:
+  MultiResolutionDiffusiveRegistrationFilter( void );
+  virtual ~MultiResolutionDiffusiveRegistrationFilter( void ) {}
+
+  void PrintSelf( std::ostream& os, Indent indent ) const;
+
+  /** Provides the high resolution template to the diffusive registration
+   *  filter, then runs the levels. */
+  virtual void GenerateData( void );
+
+private:
+  // Purposely not implemented
+  MultiResolutionDiffusiveRegistrationFilter( const Self& );
+  void operator=( const Self& ); // Purposely not implemented
+
+  /** The high resolution template last given to the registration filter */
+  typename FloatImageType::Pointer    m_HighResolutionTemplate;
+
+}; // End class MultiResolutionDiffusiveRegistrationFilter
+
+} // End namespace tube
+
+} // End namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itktubeMultiResolutionDiffusiveRegistrationFilter.hxx"
+#endif
+
+#endif
+// End !defined( __itktubeMultiResolutionDiffusiveRegistrationFilter_h )
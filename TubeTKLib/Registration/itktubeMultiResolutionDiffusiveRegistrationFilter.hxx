@@ -0,0 +1,119 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __itktubeMultiResolutionDiffusiveRegistrationFilter_hxx
+#define __itktubeMultiResolutionDiffusiveRegistrationFilter_hxx
+
+#include "itktubeMultiResolutionDiffusiveRegistrationFilter.h"
+
+namespace itk
+{
+
+namespace tube
+{
+
+template< class TFixedImage, class TMovingImage, class TDeformationField,
+  class TRealType >
+MultiResolutionDiffusiveRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField, TRealType >
+::MultiResolutionDiffusiveRegistrationFilter( void )
+{
+  // The registration filter does its own regularization, so the pyramids
+  // must not shrink the images
+  typename RecursiveFixedImagePyramidType::Pointer fixedImagePyramid =
+    RecursiveFixedImagePyramidType::New();
+  fixedImagePyramid->SetMaximumError( 0.01 );
+  fixedImagePyramid->UseShrinkImageFilterOff();
+  this->SetFixedImagePyramid( fixedImagePyramid );
+
+  typename RecursiveMovingImagePyramidType::Pointer movingImagePyramid =
+    RecursiveMovingImagePyramidType::New();
+  movingImagePyramid->SetMaximumError( 0.01 );
+  movingImagePyramid->UseShrinkImageFilterOff();
+  this->SetMovingImagePyramid( movingImagePyramid );
+
+  m_HighResolutionTemplate = 0;
+}
+
+
+template< class TFixedImage, class TMovingImage, class TDeformationField,
+  class TRealType >
+void
+MultiResolutionDiffusiveRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField, TRealType >
+::PrintSelf( std::ostream& os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  if( m_HighResolutionTemplate )
+    {
+    os << indent << "High resolution template:" << std::endl;
+    m_HighResolutionTemplate->Print( os, indent );
+    }
+}
+
+
+template< class TFixedImage, class TMovingImage, class TDeformationField,
+  class TRealType >
+void
+MultiResolutionDiffusiveRegistrationFilter
+  < TFixedImage, TMovingImage, TDeformationField, TRealType >
+::GenerateData( void )
+{
+  const FixedImageType * fixedImage = this->GetFixedImage();
+  if( !fixedImage )
+    {
+    itkExceptionMacro( << "Fixed image not set." );
+    }
+
+  // The normal and weight images of the anisotropic filters are computed
+  // at the resolution of this template, and resampled on each level.  A
+  // template set by the user is kept, but the one created here is created
+  // again from the current fixed image.
+  DiffusiveRegistrationFilterType * registrator =
+    dynamic_cast< DiffusiveRegistrationFilterType * >(
+      this->GetModifiableRegistrationFilter() );
+  if( registrator && ( !registrator->GetHighResolutionTemplate()
+    || registrator->GetHighResolutionTemplate()
+    == m_HighResolutionTemplate.GetPointer() ) )
+    {
+    // Only the image attributes of the template are used, so its buffer is
+    // not allocated
+    m_HighResolutionTemplate = FloatImageType::New();
+    m_HighResolutionTemplate->CopyInformation( fixedImage );
+    m_HighResolutionTemplate->SetRequestedRegion(
+      fixedImage->GetLargestPossibleRegion() );
+    m_HighResolutionTemplate->SetBufferedRegion(
+      fixedImage->GetLargestPossibleRegion() );
+    registrator->SetHighResolutionTemplate( m_HighResolutionTemplate );
+    }
+
+  Superclass::GenerateData();
+}
+
+} // End namespace tube
+
+} // End namespace itk
+
+#endif
+// End !defined( __itktubeMultiResolutionDiffusiveRegistrationFilter_hxx )
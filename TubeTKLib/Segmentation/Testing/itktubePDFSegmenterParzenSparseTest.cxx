@@ -0,0 +1,362 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubePDFSegmenterParzen.h"
+
+#include "itktubeFeatureVectorGenerator.h"
+
+#include <itkImageRegionIterator.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkMersenneTwisterRandomVariateGenerator.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+enum { Dimension = 2 };
+
+typedef float                                        PixelType;
+typedef itk::Image< PixelType, Dimension >           ImageType;
+
+typedef itk::tube::PDFSegmenterParzen< ImageType, ImageType >
+  FilterType;
+
+/** Label map with class 255 in the left 40 columns and class 127 in the
+ *  right 24 columns.  A new image is created for each filter, because the
+ *  classification overwrites it. */
+ImageType::Pointer CreateLabelMap( void )
+{
+  ImageType::SizeType size;
+  size.Fill( 64 );
+  ImageType::Pointer labelMap = ImageType::New();
+  labelMap->SetRegions( size );
+  labelMap->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it( labelMap,
+    labelMap->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    it.Set( ( it.GetIndex()[0] < 40 ) ? 255 : 127 );
+    }
+  return labelMap;
+}
+
+FilterType::Pointer CreateFilter(
+  FilterType::FeatureVectorGeneratorType * fvGen, bool useSparseHistogram,
+  double histogramSmoothing )
+{
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetFeatureVectorGenerator( fvGen );
+  filter->SetLabelMap( CreateLabelMap() );
+  filter->SetObjectId( 255 );
+  filter->AddObjectId( 127 );
+  filter->SetVoidId( 0 );
+  filter->SetErodeRadius( 0 );
+  filter->SetHoleFillIterations( 0 );
+  filter->SetProbabilityImageSmoothingStandardDeviation( 0 );
+  filter->SetHistogramSmoothingStandardDeviation( histogramSmoothing );
+  filter->SetReclassifyObjectLabels( true );
+  filter->SetReclassifyNotObjectLabels( true );
+  filter->SetForceClassification( true );
+  filter->SetUseSparseHistogram( useSparseHistogram );
+  filter->Update();
+  filter->ClassifyImages();
+  return filter;
+}
+
+/** Compares the probabilities of the two filters at the feature vectors
+ *  of the image, to within tolerance times the largest dense probability
+ *  of each class, and counts the pixels labeled differently */
+bool CompareFilters( const char * name, const ImageType * image,
+  FilterType::FeatureVectorGeneratorType * fvGen,
+  FilterType * denseFilter, FilterType * sparseFilter,
+  double tolerance, unsigned int maximumNumberOfLabelDifferences )
+{
+  const unsigned int numClasses = denseFilter->GetNumberOfClasses();
+  std::vector< FilterType::ProbabilityVectorType > denseProb;
+  std::vector< FilterType::ProbabilityVectorType > sparseProb;
+  std::vector< double > maxDenseProb( numClasses, 0 );
+  itk::ImageRegionConstIteratorWithIndex< ImageType > it( image,
+    image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    FilterType::FeatureVectorType fv =
+      fvGen->GetFeatureVector( it.GetIndex() );
+    denseProb.push_back( denseFilter->GetProbabilityVector( fv ) );
+    sparseProb.push_back( sparseFilter->GetProbabilityVector( fv ) );
+    for( unsigned int c = 0; c < numClasses; ++c )
+      {
+      maxDenseProb[c] = std::max( maxDenseProb[c],
+        static_cast< double >( denseProb.back()[c] ) );
+      }
+    }
+
+  for( unsigned int i = 0; i < denseProb.size(); ++i )
+    {
+    for( unsigned int c = 0; c < numClasses; ++c )
+      {
+      if( std::fabs( denseProb[i][c] - sparseProb[i][c] )
+        > tolerance * maxDenseProb[c] )
+        {
+        std::cerr << name << ": class " << c << " probability "
+          << sparseProb[i][c] << " differs from the dense "
+          << denseProb[i][c] << std::endl;
+        return false;
+        }
+      }
+    }
+
+  unsigned int numberOfLabelDifferences = 0;
+  itk::ImageRegionConstIteratorWithIndex< ImageType > denseIt(
+    denseFilter->GetLabelMap(),
+    denseFilter->GetLabelMap()->GetLargestPossibleRegion() );
+  itk::ImageRegionConstIteratorWithIndex< ImageType > sparseIt(
+    sparseFilter->GetLabelMap(),
+    sparseFilter->GetLabelMap()->GetLargestPossibleRegion() );
+  for( ; !denseIt.IsAtEnd(); ++denseIt, ++sparseIt )
+    {
+    if( denseIt.Get() != sparseIt.Get() )
+      {
+      ++numberOfLabelDifferences;
+      }
+    }
+  std::cout << name << ": " << numberOfLabelDifferences
+    << " pixels labeled differently" << std::endl;
+  if( numberOfLabelDifferences > maximumNumberOfLabelDifferences )
+    {
+    std::cerr << name << ": too many pixels labeled differently"
+      << std::endl;
+    return false;
+    }
+
+  return true;
+}
+
+/** Feature image whose values are drawn from a normal distribution of
+ *  the given mean and variance in each class of the label map */
+ImageType::Pointer CreateFeatureImage( const ImageType * labelMap,
+  itk::Statistics::MersenneTwisterRandomVariateGenerator * rnd,
+  double objectMean, double notObjectMean, double variance )
+{
+  ImageType::Pointer image = ImageType::New();
+  image->CopyInformation( labelMap );
+  image->SetRegions( labelMap->GetLargestPossibleRegion() );
+  image->Allocate();
+
+  itk::ImageRegionConstIterator< ImageType > labelIt( labelMap,
+    labelMap->GetLargestPossibleRegion() );
+  itk::ImageRegionIterator< ImageType > it( image,
+    image->GetLargestPossibleRegion() );
+  for( ; !labelIt.IsAtEnd(); ++labelIt, ++it )
+    {
+    it.Set( rnd->GetNormalVariate( ( labelIt.Get() == 255 ) ? objectMean
+      : notObjectMean, variance ) );
+    }
+  return image;
+}
+
+/** Counts the pixels whose label differs from the label map used for
+ *  training */
+unsigned int CountMislabeledPixels( FilterType * filter )
+{
+  ImageType::Pointer labelMap = CreateLabelMap();
+  unsigned int numberOfMislabeledPixels = 0;
+  itk::ImageRegionConstIterator< ImageType > labelIt( labelMap,
+    labelMap->GetLargestPossibleRegion() );
+  itk::ImageRegionConstIterator< ImageType > it( filter->GetLabelMap(),
+    filter->GetLabelMap()->GetLargestPossibleRegion() );
+  for( ; !labelIt.IsAtEnd(); ++labelIt, ++it )
+    {
+    if( labelIt.Get() != it.Get() )
+      {
+      ++numberOfMislabeledPixels;
+      }
+    }
+  return numberOfMislabeledPixels;
+}
+
+} // End namespace
+
+int itktubePDFSegmenterParzenSparseTest( int argc, char * argv[] )
+{
+  if( argc != 1 )
+    {
+    std::cout << "Usage: " << argv[0] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Two features, whose distributions overlap between the classes
+  ImageType::Pointer labelMap = CreateLabelMap();
+  ImageType::Pointer image1 = ImageType::New();
+  image1->CopyInformation( labelMap );
+  image1->SetRegions( labelMap->GetLargestPossibleRegion() );
+  image1->Allocate();
+  ImageType::Pointer image2 = ImageType::New();
+  image2->CopyInformation( labelMap );
+  image2->SetRegions( labelMap->GetLargestPossibleRegion() );
+  image2->Allocate();
+
+  itk::Statistics::MersenneTwisterRandomVariateGenerator::Pointer rnd =
+    itk::Statistics::MersenneTwisterRandomVariateGenerator::New();
+  rnd->Initialize( 1234 );
+  itk::ImageRegionIteratorWithIndex< ImageType > labelIt( labelMap,
+    labelMap->GetLargestPossibleRegion() );
+  itk::ImageRegionIteratorWithIndex< ImageType > it1( image1,
+    image1->GetLargestPossibleRegion() );
+  itk::ImageRegionIteratorWithIndex< ImageType > it2( image2,
+    image2->GetLargestPossibleRegion() );
+  for( ; !labelIt.IsAtEnd(); ++labelIt, ++it1, ++it2 )
+    {
+    if( labelIt.Get() == 255 )
+      {
+      it1.Set( rnd->GetNormalVariate( 100, 100 ) );
+      it2.Set( rnd->GetNormalVariate( 50, 64 ) );
+      }
+    else
+      {
+      it1.Set( rnd->GetNormalVariate( 120, 100 ) );
+      it2.Set( rnd->GetNormalVariate( 40, 64 ) );
+      }
+    }
+
+  FilterType::FeatureVectorGeneratorType::Pointer fvGen =
+    FilterType::FeatureVectorGeneratorType::New();
+  fvGen->SetInput( image1 );
+  fvGen->AddInput( image2 );
+
+  try
+    {
+    // Without smoothing, the sparse PDFs are the normalized bin counts of
+    // the dense PDFs, and give the same labels
+    FilterType::Pointer denseFilter = CreateFilter( fvGen, false, 0 );
+    FilterType::Pointer sparseFilter = CreateFilter( fvGen, true, 0 );
+    if( sparseFilter->GetClassPDFImage( 0 ).IsNotNull()
+      || denseFilter->GetClassPDFImage( 0 ).IsNull() )
+      {
+      std::cerr << "Only the dense filter should have PDF images"
+        << std::endl;
+      return EXIT_FAILURE;
+      }
+    if( !CompareFilters( "Unsmoothed", image1, fvGen, denseFilter,
+      sparseFilter, 1e-5, 0 ) )
+      {
+      return EXIT_FAILURE;
+      }
+
+    // The query time Parzen sum of the sparse PDFs must match the lookup
+    // in the dense PDFs blurred with a recursive Gaussian.  The two
+    // kernels differ slightly, which may flip the labels of a few pixels
+    // whose class probabilities are nearly equal.
+    denseFilter = CreateFilter( fvGen, false, 2 );
+    sparseFilter = CreateFilter( fvGen, true, 2 );
+    if( !CompareFilters( "Smoothed", image1, fvGen, denseFilter,
+      sparseFilter, 0.05, 40 ) )
+      {
+      return EXIT_FAILURE;
+      }
+
+    // Six features exceed the dense histogram dimension, so the sparse
+    // histograms are used although they were not requested
+    FilterType::FeatureVectorGeneratorType::Pointer fvGen6 =
+      FilterType::FeatureVectorGeneratorType::New();
+    for( unsigned int i = 0; i < 6; ++i )
+      {
+      ImageType::Pointer image = CreateFeatureImage( labelMap, rnd,
+        100 + 5 * i, 130 - 5 * i, 100 );
+      if( i == 0 )
+        {
+        fvGen6->SetInput( image );
+        }
+      else
+        {
+        fvGen6->AddInput( image );
+        }
+      }
+    FilterType::Pointer filter = CreateFilter( fvGen6, false, 1 );
+    if( filter->GetUseSparseHistogram()
+      || !filter->GetUsingSparseHistogram()
+      || filter->GetClassPDFImage( 0 ).IsNotNull() )
+      {
+      std::cerr << "Six features did not switch to sparse histograms, or"
+        << " changed the UseSparseHistogram option" << std::endl;
+      return EXIT_FAILURE;
+      }
+    unsigned int numberOfMislabeledPixels = CountMislabeledPixels( filter );
+    std::cout << "Six features: " << numberOfMislabeledPixels
+      << " pixels mislabeled" << std::endl;
+    if( numberOfMislabeledPixels > 64 * 64 / 20 )
+      {
+      std::cerr << "Six features: too many pixels mislabeled" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    // A later run of the same filter with two features returns to the
+    // dense histograms
+    filter->SetFeatureVectorGenerator( fvGen );
+    filter->SetLabelMap( CreateLabelMap() );
+    filter->Update();
+    filter->ClassifyImages();
+    if( filter->GetUsingSparseHistogram()
+      || filter->GetClassPDFImage( 0 ).IsNull() )
+      {
+      std::cerr << "Two features after six did not use dense histograms"
+        << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  catch( itk::ExceptionObject & e )
+    {
+    std::cerr << "Exception caught: " << e << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Sparse histograms are limited to PARZEN_MAX_NUMBER_OF_SPARSE_FEATURES
+  FilterType::FeatureVectorGeneratorType::Pointer fvGenTooMany =
+    FilterType::FeatureVectorGeneratorType::New();
+  fvGenTooMany->SetInput( image1 );
+  for( unsigned int i = 1; i <= PARZEN_MAX_NUMBER_OF_SPARSE_FEATURES; ++i )
+    {
+    fvGenTooMany->AddInput( ( i % 2 == 0 ) ? image1 : image2 );
+    }
+  bool caughtException = false;
+  try
+    {
+    CreateFilter( fvGenTooMany, false, 1 );
+    }
+  catch( itk::ExceptionObject & e )
+    {
+    std::cout << "Expected exception caught: " << e.GetDescription()
+      << std::endl;
+    caughtException = true;
+    }
+  if( !caughtException )
+    {
+    std::cerr << "More than " << PARZEN_MAX_NUMBER_OF_SPARSE_FEATURES
+      << " features did not throw an exception" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
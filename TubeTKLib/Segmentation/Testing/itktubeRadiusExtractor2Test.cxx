@@ -25,6 +25,7 @@ limitations under the License.
 #include "tubeMessage.h"
 
 #include <itkImageFileReader.h>
+#include <itkImageRegionIterator.h>
 #include <itkMersenneTwisterRandomVariateGenerator.h>
 #include <itkSpatialObjectReader.h>
 
@@ -216,6 +217,76 @@ int itktubeRadiusExtractor2Test( int argc, char * argv[] )
     std::cout << "   Result = " << r1 << std::endl;
     }
 
+  // Edit the image in place around a tube point.  Neither the image
+  //   pointer nor its MTime change, so the kernel must read the edited
+  //   pixels, as an extractor created after the edit does.
+  TubeType::Pointer editTube = static_cast< TubeType * >(
+    tubeList->begin()->GetPointer() );
+  PointListType editPointList = editTube->GetPoints();
+  if( editPointList.size() < 9 )
+    {
+    tube::ErrorMessage( "First tube has fewer than 9 points" );
+    delete tubeList;
+    return EXIT_FAILURE;
+    }
+  unsigned int editPointNum = editPointList.size() / 2;
+  std::vector< TubePointType > editTubePoints( 3 );
+  editTubePoints[0] = editPointList[ editPointNum - 4 ];
+  editTubePoints[1] = editPointList[ editPointNum ];
+  editTubePoints[2] = editPointList[ editPointNum + 4 ];
+
+  double rEditStart = editPointList[ editPointNum ].GetRadius();
+  if( rEditStart < 1 )
+    {
+    rEditStart = 1;
+    }
+  double rBeforeEdit = rEditStart;
+  radiusOp->GetPointVectorOptimalRadius( editTubePoints, rBeforeEdit,
+    0.33, 15, 0.25, 0.125 );
+
+  ImageType::IndexType editIndex;
+  ImageType::SizeType editSize;
+  for( unsigned int i = 0; i < 3; ++i )
+    {
+    editIndex[i] = static_cast< long >(
+      editPointList[ editPointNum ].GetPosition()[i] - rEditStart ) - 2;
+    editSize[i] = static_cast< unsigned long >( 2 * rEditStart ) + 5;
+    }
+  ImageType::RegionType editRegion( editIndex, editSize );
+  editRegion.Crop( im->GetLargestPossibleRegion() );
+  itk::ImageRegionIterator< ImageType > editIt( im, editRegion );
+  for( editIt.GoToBegin(); !editIt.IsAtEnd(); ++editIt )
+    {
+    editIt.Set( dataMax + dataMin - editIt.Get() );
+    }
+
+  double rEdited = rEditStart;
+  bool editedFound = radiusOp->GetPointVectorOptimalRadius( editTubePoints,
+    rEdited, 0.33, 15, 0.25, 0.125 );
+
+  RadiusOpType::Pointer freshRadiusOp = RadiusOpType::New();
+  freshRadiusOp->SetInputImage( im );
+  freshRadiusOp->SetDataMin( dataMin );
+  freshRadiusOp->SetDataMax( dataMax );
+  freshRadiusOp->SetRadiusMin( radiusOp->GetRadiusMin() );
+  freshRadiusOp->SetRadiusMax( radiusOp->GetRadiusMax() );
+  freshRadiusOp->SetRadiusStart( radiusOp->GetRadiusStart() );
+  freshRadiusOp->SetMinMedialness( radiusOp->GetMinMedialness() );
+  freshRadiusOp->SetMinMedialnessStart(
+    radiusOp->GetMinMedialnessStart() );
+  double rFresh = rEditStart;
+  bool freshFound = freshRadiusOp->GetPointVectorOptimalRadius(
+    editTubePoints, rFresh, 0.33, 15, 0.25, 0.125 );
+
+  std::cout << "Radius before edit = " << rBeforeEdit
+    << "   after edit = " << rEdited
+    << "   new extractor = " << rFresh << std::endl;
+  if( editedFound != freshFound || rEdited != rFresh )
+    {
+    tube::ErrorMessage( "Radius after image edit != new extractor radius" );
+    returnStatus = EXIT_FAILURE;
+    }
+
   delete tubeList;
 
   std::cout << "Number of failures = " << failures << std::endl;
@@ -293,6 +293,38 @@ int itktubeRidgeExtractorTest2( int argc, char * argv[] )
       code ) ) << std::endl;
     }
 
+  std::cout << "Intensity cache:" << std::endl;
+  std::cout << "   Hits = " << ridgeOp->GetIntensityCacheHits()
+    << std::endl;
+  std::cout << "   Misses = " << ridgeOp->GetIntensityCacheMisses()
+    << std::endl;
+  std::cout << "   Hit rate = " << ridgeOp->GetIntensityCacheHitRate()
+    << std::endl;
+  std::cout << "   Blocks = " << ridgeOp->GetIntensityCacheNumberOfBlocks()
+    << std::endl;
+  std::cout << "   Memory = " << ridgeOp->GetIntensityCacheMemorySize()
+    << std::endl;
+  if( ridgeOp->GetIntensityCacheHits() == 0 )
+    {
+    std::cout << "Intensity cache never hit." << std::endl;
+    ++failures;
+    }
+
+  RidgeOpType::IndexType indx;
+  for( unsigned int i=0; i<ImageType::ImageDimension; i++ )
+    {
+    indx[i] = ( imMinX[i] + imMaxX[i] ) / 2;
+    }
+  ridgeOp->SetUseIntensityCache( true );
+  double cachedIntensity = ridgeOp->Intensity( indx );
+  ridgeOp->SetUseIntensityCache( false );
+  double blurredIntensity = ridgeOp->Intensity( indx );
+  if( cachedIntensity != blurredIntensity )
+    {
+    std::cout << "Cached intensity != blurred intensity" << std::endl;
+    ++failures;
+    }
+
   std::cout << "Number of failures = " << failures << std::endl;
   if( failures > 0 )
     {
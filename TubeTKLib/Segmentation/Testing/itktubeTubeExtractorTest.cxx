@@ -53,6 +53,33 @@ int itktubeTubeExtractorTest( int argc, char * argv[] )
   tubeOp->SetInputImage( im );
   tubeOp->SetRadius( 2.0 );
 
+  std::vector< double > scaleSpaceScales( 3 );
+  scaleSpaceScales[0] = 1.0;
+  scaleSpaceScales[1] = 2.0;
+  scaleSpaceScales[2] = 4.0;
+  tubeOp->GenerateScaleSpace( scaleSpaceScales );
+  ImageType::IndexType centerX;
+  for( unsigned int i=0; i<ImageType::ImageDimension; i++ )
+    {
+    centerX[i] = ( tubeOp->GetExtractBoundMin()[i]
+      + tubeOp->GetExtractBoundMax()[i] ) / 2;
+    }
+  tubeOp->GetRidgeOp()->SetUseIntensityCache( false );
+  tubeOp->SetUseScaleSpace( true );
+  double scaleSpaceIntensity = tubeOp->GetRidgeOp()->Intensity( centerX );
+  tubeOp->SetUseScaleSpace( false );
+  double blurredIntensity = tubeOp->GetRidgeOp()->Intensity( centerX );
+  tubeOp->GetRidgeOp()->SetUseIntensityCache( true );
+  std::cout << "Scale space intensity = " << scaleSpaceIntensity
+    << std::endl;
+  std::cout << "Blurred intensity = " << blurredIntensity << std::endl;
+  if( std::fabs( scaleSpaceIntensity - blurredIntensity ) > 0.05 )
+    {
+    std::cout << "Scale space intensity differs from blurred intensity."
+      << std::endl;
+    return EXIT_FAILURE;
+    }
+
   typedef itk::SpatialObjectReader<>                   ReaderType;
   typedef itk::SpatialObject<>::ChildrenListType       ObjectListType;
   typedef itk::GroupSpatialObject<>                    GroupType;
@@ -28,6 +28,7 @@ limitations under the License.
 void RegisterTests( void )
 {
   REGISTER_TEST( tubeBaseSegmentationPrintTest );
+  REGISTER_TEST( itktubePDFSegmenterParzenSparseTest );
   REGISTER_TEST( itktubePDFSegmenterParzenTest );
 #ifdef TubeTK_USE_LIBSVM
   REGISTER_TEST( itktubePDFSegmenterSVMTest );
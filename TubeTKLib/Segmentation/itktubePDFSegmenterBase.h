@@ -28,6 +28,7 @@ limitations under the License.
 
 #include <itkImage.h>
 #include <itkListSample.h>
+#include <itkMultiThreaderBase.h>
 
 #include <vector>
 
@@ -145,6 +146,12 @@ public:
   itkSetMacro( BalanceClassSampleSize, bool );
   itkGetMacro( BalanceClassSampleSize, bool );
 
+  /** Number of threads used to compute the probability images and the
+   * label map.  The feature vector generator and GetProbabilityVector
+   * must be thread-safe.  Zero uses the global default.  Default is 0. */
+  itkSetMacro( NumberOfThreads, unsigned int );
+  itkGetMacro( NumberOfThreads, unsigned int );
+
   void SetProgressProcessInformation( void * processInfo, double fraction,
     double start );
 
@@ -180,6 +187,14 @@ protected:
 
   void PrintSelf( std::ostream & os, Indent indent ) const;
 
+  typedef typename LabelMapType::RegionType    LabelMapRegionType;
+  typedef std::vector< LabelMapRegionType >    LabelMapRegionListType;
+
+  /** Split the label map into pieces that are distributed over the
+   * threads by the threaded stages of ApplyPDFs. */
+  LabelMapRegionListType SplitLabelMapRegion( unsigned int numberOfThreads )
+    const;
+
   typedef std::vector< typename ProbabilityImageType::Pointer >
                                               ProbabilityImageVectorType;
   typedef std::vector< ProbabilityPixelType > ListVectorType;
@@ -211,6 +226,18 @@ private:
   PDFSegmenterBase( const Self & );      // Purposely not implemented
   void operator = ( const Self & );      // Purposely not implemented
 
+  /** Structure for passing information into static callback methods */
+  struct ApplyPDFsThreadStruct
+    {
+    PDFSegmenterBase *                      Segmenter;
+    const LabelMapRegionListType *          Regions;
+    typename ProbabilityImageType::Pointer  MaxProbabilityImage;
+    }; // End struct ApplyPDFsThreadStruct
+
+  static ITK_THREAD_RETURN_TYPE ProbabilityThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_TYPE LabelThreaderCallback( void * arg );
+
   VectorDoubleType    m_PDFWeightList;
 
   int                 m_ErodeRadius;
@@ -223,6 +250,8 @@ private:
 
   bool                m_BalanceClassSampleSize;
 
+  unsigned int        m_NumberOfThreads;
+
 }; // End class PDFSegmenterBase
 
 } // End namespace tube
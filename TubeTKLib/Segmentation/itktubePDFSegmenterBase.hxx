@@ -38,6 +38,7 @@ limitations under the License.
 #include <itkImage.h>
 #include <itkImageFileReader.h>
 #include <itkImageFileWriter.h>
+#include <itkImageRegionSplitterSlowDimension.h>
 #include <itkJoinImageFilter.h>
 #include <itkTimeProbesCollectorBase.h>
 #include <itkVotingBinaryIterativeHoleFillingImageFilter.h>
@@ -80,6 +81,8 @@ PDFSegmenterBase< TImage, TLabelMap >
   m_ForceClassification = false;
   m_BalanceClassSampleSize = true;
 
+  m_NumberOfThreads = 0;
+
   m_ProbabilityImageVector.resize( 0 );
 
   m_ProgressProcessInfo = NULL;
@@ -411,10 +414,6 @@ PDFSegmenterBase< TImage, TLabelMap >
   //
   m_ProbabilityImageVector.resize( numClasses );
 
-  typedef itk::ImageRegionIterator<ProbabilityImageType>
-    ProbabilityImageIteratorType;
-  std::vector< ProbabilityImageIteratorType * > probIt( numClasses );
-
   for( unsigned int c = 0; c < numClasses; c++ )
     {
     m_ProbabilityImageVector[c] = ProbabilityImageType::New();
@@ -423,11 +422,6 @@ PDFSegmenterBase< TImage, TLabelMap >
     m_ProbabilityImageVector[c]->CopyInformation( m_FeatureVectorGenerator->
       GetInput( 0 ) );
     m_ProbabilityImageVector[c]->Allocate();
-
-    probIt[c] = new ProbabilityImageIteratorType(
-      m_ProbabilityImageVector[c],
-      m_ProbabilityImageVector[c]->GetLargestPossibleRegion() );
-    probIt[c]->GoToBegin();
     }
 
   if( m_LabelMap.IsNull() )
@@ -441,34 +435,25 @@ PDFSegmenterBase< TImage, TLabelMap >
     m_ForceClassification = true;
     }
 
-  typedef itk::ImageRegionConstIteratorWithIndex< LabelMapType >
-    ConstLabelMapIteratorType;
-  ConstLabelMapIteratorType itInLabelMap( m_LabelMap,
-    m_LabelMap->GetLargestPossibleRegion() );
-  itInLabelMap.GoToBegin();
-
-  FeatureVectorType fv;
-  typename LabelMapType::IndexType indx;
-  while( !itInLabelMap.IsAtEnd() )
+  unsigned int numberOfThreads = m_NumberOfThreads;
+  if( numberOfThreads == 0 )
     {
-    indx = itInLabelMap.GetIndex();
-    fv = m_FeatureVectorGenerator->GetFeatureVector( indx );
+    numberOfThreads = MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+    }
 
-    ProbabilityVectorType probV = this->GetProbabilityVector( fv );
-    for( unsigned int c=0; c<numClasses; ++c )
-      {
-      probIt[c]->Set( m_PDFWeightList[c] * probV[c] );
+  LabelMapRegionListType regions = this->SplitLabelMapRegion(
+    numberOfThreads );
 
-      ++( *( probIt[c] ) );
-      }
+  ApplyPDFsThreadStruct str;
+  str.Segmenter = this;
+  str.Regions = &regions;
 
-    ++itInLabelMap;
-    }
+  MultiThreaderBase::Pointer threader = MultiThreaderBase::New();
+  threader->SetMaximumNumberOfThreads( numberOfThreads );
+  threader->SetNumberOfWorkUnits( numberOfThreads );
 
-  for( unsigned int c = 0; c < numClasses; ++c )
-    {
-    delete probIt[c];
-    }
+  threader->SetSingleMethod( this->ProbabilityThreaderCallback, &str );
+  threader->SingleMethodExecute();
 
   if( m_ProbabilityImageSmoothingStandardDeviation > 0 )
     {
@@ -503,7 +488,7 @@ PDFSegmenterBase< TImage, TLabelMap >
   //  Create label image
   //
 
-  typename LabelMapType::IndexType labelImageIndex;
+  typename LabelMapType::IndexType indx;
 
   typename LabelMapType::Pointer tmpLabelImage = LabelMapType::New();
   tmpLabelImage->SetRegions( m_LabelMap->GetLargestPossibleRegion() );
@@ -513,30 +498,32 @@ PDFSegmenterBase< TImage, TLabelMap >
 
   if( !m_ForceClassification )
     {
+    // A class is the most likely class at a pixel if its probability is
+    // not exceeded by any other class, i.e., if it equals the maximum.
+    str.MaxProbabilityImage = ProbabilityImageType::New();
+    str.MaxProbabilityImage->SetRegions(
+      m_LabelMap->GetLargestPossibleRegion() );
+    str.MaxProbabilityImage->CopyInformation( m_LabelMap );
+    str.MaxProbabilityImage->Allocate();
+
+    threader->SetSingleMethod( this->LabelThreaderCallback, &str );
+    threader->SingleMethodExecute();
+
     for( unsigned int c = 0; c < numClasses; c++ )
       {
       // For this class, label all pixels for which it is the most
       // likely class.
-      itk::ImageRegionIteratorWithIndex<LabelMapType> labelIt(
+      itk::ImageRegionIterator<LabelMapType> labelIt(
         tmpLabelImage, tmpLabelImage->GetLargestPossibleRegion() );
-      labelIt.GoToBegin();
+      itk::ImageRegionConstIterator<ProbabilityImageType> probIt(
+        m_ProbabilityImageVector[c],
+        m_ProbabilityImageVector[c]->GetLargestPossibleRegion() );
+      itk::ImageRegionConstIterator<ProbabilityImageType> maxProbIt(
+        str.MaxProbabilityImage,
+        str.MaxProbabilityImage->GetLargestPossibleRegion() );
       while( !labelIt.IsAtEnd() )
         {
-        labelImageIndex = labelIt.GetIndex();
-        bool maxPC = true;
-        double maxP = m_ProbabilityImageVector[c]->GetPixel(
-          labelImageIndex );
-        for( unsigned int oc = 0; oc < numClasses; oc++ )
-          {
-          if( oc != c &&
-              m_ProbabilityImageVector[oc]->GetPixel( labelImageIndex )
-              > maxP )
-            {
-            maxPC = false;
-            break;
-            }
-          }
-        if( maxPC )
+        if( probIt.Get() >= maxProbIt.Get() )
           {
           labelIt.Set( 128 );
           }
@@ -545,6 +532,8 @@ PDFSegmenterBase< TImage, TLabelMap >
           labelIt.Set( 0 );
           }
         ++labelIt;
+        ++probIt;
+        ++maxProbIt;
         }
 
       typedef itk::ConnectedThresholdImageFilter<LabelMapType,
@@ -816,59 +805,194 @@ PDFSegmenterBase< TImage, TLabelMap >
     }
   else
     {
-    // Merge with input mask
-    typedef itk::ImageRegionIteratorWithIndex< LabelMapType >
-      LabelMapIteratorType;
-    LabelMapIteratorType itInLM( m_LabelMap,
-      m_LabelMap->GetLargestPossibleRegion() );
-    itInLM.GoToBegin();
+    // Pick the most likely class and merge with the input mask in a
+    // single pass
+    threader->SetSingleMethod( this->LabelThreaderCallback, &str );
+    threader->SingleMethodExecute();
+    }
+
+  m_ClassProbabilityImagesUpToDate = true;
+}
+
+template< class TImage, class TLabelMap >
+typename PDFSegmenterBase< TImage, TLabelMap >::LabelMapRegionListType
+PDFSegmenterBase< TImage, TLabelMap >
+::SplitLabelMapRegion( unsigned int numberOfThreads ) const
+{
+  // Use several pieces per thread so that threads that finish early
+  // (e.g., pieces that are mostly background) pick up more work.
+  const LabelMapRegionType region = m_LabelMap->GetLargestPossibleRegion();
+
+  ImageRegionSplitterSlowDimension::Pointer splitter =
+    ImageRegionSplitterSlowDimension::New();
+  const unsigned int numberOfPieces = splitter->GetNumberOfSplits( region,
+    4 * numberOfThreads );
+
+  LabelMapRegionListType regions( numberOfPieces, region );
+  for( unsigned int i = 0; i < numberOfPieces; ++i )
+    {
+    splitter->GetSplit( i, numberOfPieces, regions[i] );
+    }
+
+  return regions;
+}
+
+/**
+ * Compute the weighted class probabilities of a set of label map pieces */
+template< class TImage, class TLabelMap >
+ITK_THREAD_RETURN_TYPE
+PDFSegmenterBase< TImage, TLabelMap >
+::ProbabilityThreaderCallback( void * arg )
+{
+  unsigned int threadId = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+  unsigned int threadCount = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->NumberOfWorkUnits;
+
+  ApplyPDFsThreadStruct * str = ( ApplyPDFsThreadStruct * )
+    ( ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
 
+  const PDFSegmenterBase * segmenter = str->Segmenter;
+  const unsigned int numClasses = segmenter->m_ObjectIdList.size();
+
+  typedef itk::ImageRegionIterator< ProbabilityImageType >
+    ProbabilityImageIteratorType;
+  std::vector< ProbabilityImageIteratorType > probIt( numClasses );
+
+  FeatureVectorType fv;
+  for( size_t r = threadId; r < str->Regions->size(); r += threadCount )
+    {
+    const LabelMapRegionType & region = ( *str->Regions )[r];
+    for( unsigned int c = 0; c < numClasses; ++c )
+      {
+      probIt[c] = ProbabilityImageIteratorType(
+        segmenter->m_ProbabilityImageVector[c], region );
+      }
+
+    ImageRegionConstIteratorWithIndex< LabelMapType > itInLabelMap(
+      segmenter->m_LabelMap, region );
+    while( !itInLabelMap.IsAtEnd() )
+      {
+      fv = segmenter->m_FeatureVectorGenerator->GetFeatureVector(
+        itInLabelMap.GetIndex() );
+
+      ProbabilityVectorType probV = segmenter->GetProbabilityVector( fv );
+      for( unsigned int c = 0; c < numClasses; ++c )
+        {
+        probIt[c].Set( segmenter->m_PDFWeightList[c] * probV[c] );
+        ++probIt[c];
+        }
+
+      ++itInLabelMap;
+      }
+    }
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+/**
+ * Find the most likely class of each pixel of a set of label map pieces.
+ * If a maximum probability image is given, only the maximum probability
+ * is recorded; otherwise the most likely class is merged into the label
+ * map. */
+template< class TImage, class TLabelMap >
+ITK_THREAD_RETURN_TYPE
+PDFSegmenterBase< TImage, TLabelMap >
+::LabelThreaderCallback( void * arg )
+{
+  unsigned int threadId = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+  unsigned int threadCount = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->NumberOfWorkUnits;
+
+  ApplyPDFsThreadStruct * str = ( ApplyPDFsThreadStruct * )
+    ( ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  const PDFSegmenterBase * segmenter = str->Segmenter;
+  const unsigned int numClasses = segmenter->m_ObjectIdList.size();
+  const bool reclassifyObject = segmenter->m_ReclassifyObjectLabels;
+  const bool reclassifyNotObject = segmenter->m_ReclassifyNotObjectLabels;
+  const LabelMapPixelType voidId = segmenter->m_VoidId;
+
+  typedef itk::ImageRegionConstIterator< ProbabilityImageType >
+    ProbabilityImageIteratorType;
+  std::vector< ProbabilityImageIteratorType > probIt( numClasses );
+
+  for( size_t r = threadId; r < str->Regions->size(); r += threadCount )
+    {
+    const LabelMapRegionType & region = ( *str->Regions )[r];
+    for( unsigned int c = 0; c < numClasses; ++c )
+      {
+      probIt[c] = ProbabilityImageIteratorType(
+        segmenter->m_ProbabilityImageVector[c], region );
+      }
+
+    if( str->MaxProbabilityImage.IsNotNull() )
+      {
+      ImageRegionIterator< ProbabilityImageType > maxProbIt(
+        str->MaxProbabilityImage, region );
+      while( !maxProbIt.IsAtEnd() )
+        {
+        ProbabilityPixelType maxP = probIt[0].Get();
+        ++probIt[0];
+        for( unsigned int c = 1; c < numClasses; ++c )
+          {
+          if( probIt[c].Get() > maxP )
+            {
+            maxP = probIt[c].Get();
+            }
+          ++probIt[c];
+          }
+        maxProbIt.Set( maxP );
+        ++maxProbIt;
+        }
+      continue;
+      }
+
+    ImageRegionIterator< LabelMapType > itInLM( segmenter->m_LabelMap,
+      region );
     while( !itInLM.IsAtEnd() )
       {
-      labelImageIndex = itInLM.GetIndex();
       unsigned int maxPC = 0;
-      double maxP = m_ProbabilityImageVector[0]->GetPixel(
-        labelImageIndex );
-      for( unsigned int c = 1; c < numClasses; c++ )
+      ProbabilityPixelType maxP = probIt[0].Get();
+      ++probIt[0];
+      for( unsigned int c = 1; c < numClasses; ++c )
         {
-        double p = m_ProbabilityImageVector[c]->GetPixel(
-          labelImageIndex );
-        if( p > maxP )
+        if( probIt[c].Get() > maxP )
           {
-          maxP = p;
+          maxP = probIt[c].Get();
           maxPC = c;
           }
+        ++probIt[c];
         }
-      if( itInLM.Get() == m_VoidId
-        || ( m_ReclassifyObjectLabels && m_ReclassifyNotObjectLabels ) )
+
+      const LabelMapPixelType label = itInLM.Get();
+      if( label == voidId || ( reclassifyObject && reclassifyNotObject ) )
         {
-        itInLM.Set( m_ObjectIdList[maxPC] );
+        itInLM.Set( segmenter->m_ObjectIdList[maxPC] );
         }
-      else
+      else if( reclassifyObject || reclassifyNotObject )
         {
-        if( m_ReclassifyObjectLabels || m_ReclassifyNotObjectLabels )
+        bool isObjectId = false;
+        for( unsigned int oc = 0; oc < numClasses; oc++ )
           {
-          bool isObjectId = false;
-          for( unsigned int oc = 0; oc < numClasses; oc++ )
-            {
-            if( itInLM.Get() == m_ObjectIdList[oc] )
-              {
-              isObjectId = true;
-              break;
-              }
-            }
-          if( ( isObjectId && m_ReclassifyObjectLabels ) ||
-              ( !isObjectId && m_ReclassifyNotObjectLabels ) )
+          if( label == segmenter->m_ObjectIdList[oc] )
             {
-            itInLM.Set( m_ObjectIdList[maxPC] );
+            isObjectId = true;
+            break;
             }
           }
+        if( ( isObjectId && reclassifyObject ) ||
+            ( !isObjectId && reclassifyNotObject ) )
+          {
+          itInLM.Set( segmenter->m_ObjectIdList[maxPC] );
+          }
         }
       ++itInLM;
       }
     }
 
-  m_ClassProbabilityImagesUpToDate = true;
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
 }
 
 template< class TImage, class TLabelMap >
@@ -955,6 +1079,8 @@ PDFSegmenterBase< TImage, TLabelMap >
     << std::endl;
   os << indent << "ReclassifyNotObjectLabels = "
     << m_ReclassifyNotObjectLabels << std::endl;
+  os << indent << "Number of threads = " << m_NumberOfThreads
+    << std::endl;
   os << indent << "Number of probability images = "
     << m_ProbabilityImageVector.size() << std::endl;
   os << indent << "InClassList size = " << m_InClassList.size()
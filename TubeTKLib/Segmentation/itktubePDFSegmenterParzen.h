@@ -26,9 +26,11 @@ limitations under the License.
 
 #include "itktubePDFSegmenterBase.h"
 
+#include <itkFixedArray.h>
 #include <itkImage.h>
 #include <itkListSample.h>
 
+#include <unordered_map>
 #include <vector>
 
 namespace itk
@@ -39,6 +41,8 @@ namespace tube
 
 #define PARZEN_MAX_NUMBER_OF_FEATURES 4
 
+#define PARZEN_MAX_NUMBER_OF_SPARSE_FEATURES 16
+
 template< class TImage, class TLabelMap >
 class PDFSegmenterParzen : public PDFSegmenterBase< TImage, TLabelMap >
 {
@@ -102,6 +106,29 @@ public:
   typedef Image< LabelMapPixelType, PARZEN_MAX_NUMBER_OF_FEATURES >
     LabeledFeatureSpaceType;
 
+  /** Bin index and storage of a sparse histogram.  Only the occupied
+   * bins are stored, so memory grows with the number of samples rather
+   * than with the number of bins. */
+  typedef FixedArray< unsigned short, PARZEN_MAX_NUMBER_OF_SPARSE_FEATURES >
+    SparseBinIndexType;
+
+  struct SparseBinIndexHash
+    {
+    size_t operator()( const SparseBinIndexType & indx ) const
+      {
+      size_t h = 0;
+      for( unsigned int i = 0; i < PARZEN_MAX_NUMBER_OF_SPARSE_FEATURES;
+        ++i )
+        {
+        h = h * 131 + indx[i];
+        }
+      return h;
+      }
+    }; // End struct SparseBinIndexHash
+
+  typedef std::unordered_map< SparseBinIndexType, HistogramPixelType,
+    SparseBinIndexHash >                       SparseHistogramType;
+
   //
   // Methods
   //
@@ -110,12 +137,32 @@ public:
   itkSetMacro( OutlierRejectPortion, double );
   itkGetMacro( OutlierRejectPortion, double );
 
+  /** Store each class PDF as a sparse histogram of bin counts instead of
+   * a dense image.  Smoothing is then applied when a probability is
+   * queried, and GetClassPDFImage and GetLabeledFeatureSpace return
+   * NULL.  Always used when there are more than
+   * PARZEN_MAX_NUMBER_OF_FEATURES features.  Default is false. */
+  itkSetMacro( UseSparseHistogram, bool );
+  itkGetMacro( UseSparseHistogram, bool );
+
+  /** Whether the current class PDFs are sparse histograms, either because
+   * UseSparseHistogram is set, because the last PDFs had more than
+   * PARZEN_MAX_NUMBER_OF_FEATURES features, or because they were set
+   * using SetClassSparseHistogram. */
+  itkGetConstMacro( UsingSparseHistogram, bool );
+
   typename PDFImageType::Pointer GetClassPDFImage(
     unsigned int classNum ) const;
 
   void SetClassPDFImage( unsigned int classNum,
     typename PDFImageType::Pointer classPDF );
 
+  const SparseHistogramType & GetClassSparseHistogram(
+    unsigned int classNum ) const;
+
+  void SetClassSparseHistogram( unsigned int classNum,
+    const SparseHistogramType & classHistogram );
+
   const VectorUIntType & GetNumberOfBinsPerFeature( void ) const;
   void             SetNumberOfBinsPerFeature( const VectorUIntType & nBin );
   const VectorDoubleType & GetBinMin( void ) const;
@@ -147,6 +194,12 @@ protected:
 
   virtual void GeneratePDFs( void );
 
+  /** Build the search tree used to smooth a sparse class histogram */
+  void GenerateSparseHistogramTree( unsigned int classNum );
+
+  ProbabilityVectorType GetSparseProbabilityVector(
+    const FeatureVectorType & fv, unsigned int numFeatures ) const;
+
   void PrintSelf( std::ostream & os, Indent indent ) const;
 
 private:
@@ -166,7 +219,41 @@ private:
   typedef std::vector< typename HistogramImageType::Pointer >
     ClassHistogramImageType;
 
+  /** K-d tree over the occupied bins of a sparse histogram.  Node
+   * [lo,hi) splits at mid=(lo+hi)/2 along SplitFeature[mid]. */
+  typedef std::pair< SparseBinIndexType, HistogramPixelType >
+    SparseHistogramEntryType;
+
+  struct SparseHistogramTreeType
+    {
+    std::vector< SparseHistogramEntryType >  Entry;
+    std::vector< unsigned char >             SplitFeature;
+    double                                   TotalCount;
+    }; // End struct SparseHistogramTreeType
+
+  /** Orders histogram entries by the bin index of one feature */
+  struct SparseHistogramEntryLess
+    {
+    unsigned int Feature;
+    bool operator()( const SparseHistogramEntryType & a,
+      const SparseHistogramEntryType & b ) const
+      {
+      return a.first[Feature] < b.first[Feature];
+      }
+    }; // End struct SparseHistogramEntryLess
+
+  void BuildSparseHistogramTree( SparseHistogramTreeType & tree,
+    unsigned int lo, unsigned int hi, unsigned int numFeatures );
+
+  double SparseHistogramKernelSum( const SparseHistogramTreeType & tree,
+    unsigned int lo, unsigned int hi, const SparseBinIndexType & binIndex,
+    unsigned int numFeatures, int radius, const double * kernel ) const;
+
   ClassHistogramImageType         m_InClassHistogram;
+  std::vector< SparseHistogramType >      m_InClassSparseHistogram;
+  std::vector< SparseHistogramTreeType >  m_InClassSparseHistogramTree;
+  bool                            m_UseSparseHistogram;
+  bool                            m_UsingSparseHistogram;
   VectorDoubleType                m_HistogramBinMin;
   VectorDoubleType                m_HistogramBinSize;
   VectorUIntType                  m_HistogramNumberOfBin;
@@ -46,6 +46,7 @@ limitations under the License.
 
 #include <vnl/vnl_matrix.h>
 
+#include <algorithm>
 #include <limits>
 
 namespace itk
@@ -59,6 +60,10 @@ PDFSegmenterParzen< TImage, TLabelMap >
 ::PDFSegmenterParzen( void )
 {
   m_InClassHistogram.clear();
+  m_InClassSparseHistogram.clear();
+  m_InClassSparseHistogramTree.clear();
+  m_UseSparseHistogram = false;
+  m_UsingSparseHistogram = false;
 
   m_HistogramBinMin.clear();
   m_HistogramBinSize.clear();
@@ -100,6 +105,39 @@ PDFSegmenterParzen< TImage, TLabelMap >
     m_InClassHistogram.resize( this->m_ObjectIdList.size() );
     }
   m_InClassHistogram[classNum] = classPDF;
+  m_UsingSparseHistogram = false;
+  this->m_SampleUpToDate = false;
+  this->m_PDFsUpToDate = true;
+  this->m_ClassProbabilityImagesUpToDate = false;
+}
+
+template< class TImage, class TLabelMap >
+const typename PDFSegmenterParzen< TImage, TLabelMap >::SparseHistogramType &
+PDFSegmenterParzen< TImage, TLabelMap >
+::GetClassSparseHistogram( unsigned int classNum ) const
+{
+  if( classNum >= m_InClassSparseHistogram.size() )
+    {
+    itkExceptionMacro( << "Sparse histogram of class " << classNum
+      << " does not exist." );
+    }
+  return m_InClassSparseHistogram[classNum];
+}
+
+template< class TImage, class TLabelMap >
+void
+PDFSegmenterParzen< TImage, TLabelMap >
+::SetClassSparseHistogram( unsigned int classNum,
+  const SparseHistogramType & classHistogram )
+{
+  if( this->m_ObjectIdList.size() != m_InClassSparseHistogram.size() )
+    {
+    m_InClassSparseHistogram.resize( this->m_ObjectIdList.size() );
+    m_InClassSparseHistogramTree.resize( this->m_ObjectIdList.size() );
+    }
+  m_InClassSparseHistogram[classNum] = classHistogram;
+  this->GenerateSparseHistogramTree( classNum );
+  m_UsingSparseHistogram = true;
   this->m_SampleUpToDate = false;
   this->m_PDFsUpToDate = true;
   this->m_ClassProbabilityImagesUpToDate = false;
@@ -421,6 +459,70 @@ PDFSegmenterParzen< TImage, TLabelMap >
       }
     }
 
+  m_UsingSparseHistogram = m_UseSparseHistogram
+    || numFeatures > PARZEN_MAX_NUMBER_OF_FEATURES;
+
+  if( m_UsingSparseHistogram )
+    {
+    if( numFeatures > PARZEN_MAX_NUMBER_OF_SPARSE_FEATURES )
+      {
+      itkExceptionMacro( << "Sparse histograms support at most "
+        << PARZEN_MAX_NUMBER_OF_SPARSE_FEATURES << " features." );
+      }
+    for( unsigned int i = 0; i < numFeatures; i++ )
+      {
+      if( m_HistogramNumberOfBin[i] >
+        std::numeric_limits< unsigned short >::max() )
+        {
+        itkExceptionMacro( << "Too many bins for a sparse histogram." );
+        }
+      }
+
+    //
+    //  Count the occupied bins of the joint histograms
+    //
+    m_InClassHistogram.clear();
+    m_InClassSparseHistogram.resize( numClasses );
+    m_InClassSparseHistogramTree.resize( numClasses );
+    for( unsigned int c = 0; c < numClasses; c++ )
+      {
+      m_InClassSparseHistogram[c].clear();
+
+      typename ListSampleType::const_iterator
+        inClassListIt( this->m_InClassList[c].begin() );
+      typename ListSampleType::const_iterator
+        inClassListItEnd( this->m_InClassList[c].end() );
+      SparseBinIndexType binIndex;
+      binIndex.Fill( 0 );
+      while( inClassListIt != inClassListItEnd )
+        {
+        for( unsigned int i = 0; i < numFeatures; i++ )
+          {
+          double binV = ( *inClassListIt )[i];
+          int binN = static_cast< int >( ( binV - m_HistogramBinMin[i] )
+            / m_HistogramBinSize[i] );
+          if( binN < 0 )
+            {
+            binN = 0;
+            }
+          else if( static_cast< unsigned int >( binN )
+            >= m_HistogramNumberOfBin[i] )
+            {
+            binN = m_HistogramNumberOfBin[i] - 1;
+            }
+          binIndex[i] = binN;
+          }
+        ++( m_InClassSparseHistogram[c][binIndex] );
+        ++inClassListIt;
+        }
+
+      this->GenerateSparseHistogramTree( c );
+      }
+    return;
+    }
+  m_InClassSparseHistogram.clear();
+  m_InClassSparseHistogramTree.clear();
+
   //
   //  Create joint histograms
   //
@@ -533,11 +635,136 @@ PDFSegmenterParzen< TImage, TLabelMap >
     }
 }
 
+template< class TImage, class TLabelMap >
+void
+PDFSegmenterParzen< TImage, TLabelMap >
+::GenerateSparseHistogramTree( unsigned int classNum )
+{
+  const SparseHistogramType & histogram = m_InClassSparseHistogram[classNum];
+  SparseHistogramTreeType & tree = m_InClassSparseHistogramTree[classNum];
+
+  tree.Entry.assign( histogram.begin(), histogram.end() );
+  tree.SplitFeature.resize( tree.Entry.size() );
+  tree.TotalCount = 0;
+  for( unsigned int i = 0; i < tree.Entry.size(); ++i )
+    {
+    tree.TotalCount += tree.Entry[i].second;
+    }
+
+  this->BuildSparseHistogramTree( tree, 0, tree.Entry.size(),
+    m_HistogramNumberOfBin.size() );
+}
+
+template< class TImage, class TLabelMap >
+void
+PDFSegmenterParzen< TImage, TLabelMap >
+::BuildSparseHistogramTree( SparseHistogramTreeType & tree,
+  unsigned int lo, unsigned int hi, unsigned int numFeatures )
+{
+  // Small nodes are searched exhaustively
+  if( hi - lo <= 8 )
+    {
+    return;
+    }
+
+  // Split along the feature with the largest spread of bins
+  SparseHistogramEntryLess entryLess;
+  entryLess.Feature = 0;
+  int maxSpread = -1;
+  for( unsigned int f = 0; f < numFeatures; ++f )
+    {
+    int binMin = tree.Entry[lo].first[f];
+    int binMax = binMin;
+    for( unsigned int i = lo + 1; i < hi; ++i )
+      {
+      int bin = tree.Entry[i].first[f];
+      if( bin < binMin )
+        {
+        binMin = bin;
+        }
+      else if( bin > binMax )
+        {
+        binMax = bin;
+        }
+      }
+    if( binMax - binMin > maxSpread )
+      {
+      maxSpread = binMax - binMin;
+      entryLess.Feature = f;
+      }
+    }
+
+  unsigned int mid = ( lo + hi ) / 2;
+  std::nth_element( tree.Entry.begin() + lo, tree.Entry.begin() + mid,
+    tree.Entry.begin() + hi, entryLess );
+  tree.SplitFeature[mid] = entryLess.Feature;
+
+  this->BuildSparseHistogramTree( tree, lo, mid, numFeatures );
+  this->BuildSparseHistogramTree( tree, mid + 1, hi, numFeatures );
+}
+
+template< class TImage, class TLabelMap >
+double
+PDFSegmenterParzen< TImage, TLabelMap >
+::SparseHistogramKernelSum( const SparseHistogramTreeType & tree,
+  unsigned int lo, unsigned int hi, const SparseBinIndexType & binIndex,
+  unsigned int numFeatures, int radius, const double * kernel ) const
+{
+  double sum = 0;
+
+  unsigned int mid = ( lo + hi ) / 2;
+  bool leaf = ( hi - lo <= 8 );
+  unsigned int first = leaf ? lo : mid;
+  unsigned int last = leaf ? hi : mid + 1;
+  for( unsigned int i = first; i < last; ++i )
+    {
+    double w = tree.Entry[i].second;
+    for( unsigned int f = 0; f < numFeatures; ++f )
+      {
+      int d = std::abs( static_cast< int >( tree.Entry[i].first[f] )
+        - static_cast< int >( binIndex[f] ) );
+      if( d > radius )
+        {
+        w = 0;
+        break;
+        }
+      w *= kernel[d];
+      }
+    sum += w;
+    }
+  if( leaf )
+    {
+    return sum;
+    }
+
+  unsigned int f = tree.SplitFeature[mid];
+  int split = tree.Entry[mid].first[f];
+  if( static_cast< int >( binIndex[f] ) - radius <= split && lo < mid )
+    {
+    sum += this->SparseHistogramKernelSum( tree, lo, mid, binIndex,
+      numFeatures, radius, kernel );
+    }
+  if( static_cast< int >( binIndex[f] ) + radius >= split && mid + 1 < hi )
+    {
+    sum += this->SparseHistogramKernelSum( tree, mid + 1, hi, binIndex,
+      numFeatures, radius, kernel );
+    }
+
+  return sum;
+}
+
 template< class TImage, class TLabelMap >
 void
 PDFSegmenterParzen< TImage, TLabelMap >
 ::GenerateLabeledFeatureSpace( void )
 {
+  if( m_UsingSparseHistogram )
+    {
+    // Feature space is too large to be labeled densely
+    m_LabeledFeatureSpace = NULL;
+    return;
+    }
+
   unsigned int numFeatures = this->m_FeatureVectorGenerator->
     GetNumberOfFeatures();
   m_LabeledFeatureSpace = LabeledFeatureSpaceType::New();
@@ -623,6 +850,12 @@ PDFSegmenterParzen< TImage, TLabelMap >
 {
   unsigned int numFeatures = this->m_FeatureVectorGenerator->
     GetNumberOfFeatures();
+
+  if( m_UsingSparseHistogram )
+    {
+    return this->GetSparseProbabilityVector( fv, numFeatures );
+    }
+
   typename HistogramImageType::IndexType binIndex;
   binIndex.Fill( 0 );
   for( unsigned int i = 0; i < numFeatures; i++ )
@@ -650,6 +883,75 @@ PDFSegmenterParzen< TImage, TLabelMap >
   return prob;
 }
 
+template< class TImage, class TLabelMap >
+typename PDFSegmenterParzen< TImage, TLabelMap >::ProbabilityVectorType
+PDFSegmenterParzen< TImage, TLabelMap >
+::GetSparseProbabilityVector( const FeatureVectorType & fv,
+  unsigned int numFeatures ) const
+{
+  SparseBinIndexType binIndex;
+  binIndex.Fill( 0 );
+  for( unsigned int i = 0; i < numFeatures; i++ )
+    {
+    int binN = static_cast< int >( ( fv[i] - m_HistogramBinMin[i] )
+      / m_HistogramBinSize[i] );
+    if( binN < 0 )
+      {
+      binN = 0;
+      }
+    else if( static_cast< unsigned int >( binN )
+      >= m_HistogramNumberOfBin[i] )
+      {
+      binN = m_HistogramNumberOfBin[i] - 1;
+      }
+    binIndex[i] = binN;
+    }
+
+  unsigned int numClasses = this->m_ObjectIdList.size();
+  ProbabilityVectorType prob( numClasses, 0 );
+  if( m_HistogramSmoothingStandardDeviation > 0 )
+    {
+    // Parzen window estimate: the bin counts are blurred by a Gaussian
+    //   ( in units of bins ) truncated at 3 standard deviations and
+    //   normalized so that the PDF sums to one, as for dense histograms.
+    const double sigma = m_HistogramSmoothingStandardDeviation;
+    const int radius = static_cast< int >( std::ceil( 3 * sigma ) );
+    std::vector< double > kernel( radius + 1 );
+    double kernelSum = 0;
+    for( int d = 0; d <= radius; ++d )
+      {
+      kernel[d] = std::exp( -0.5 * d * d / ( sigma * sigma ) );
+      kernelSum += ( d == 0 ) ? kernel[d] : 2 * kernel[d];
+      }
+    const double kernelNorm = std::pow( kernelSum,
+      static_cast< double >( numFeatures ) );
+
+    for( unsigned int c = 0; c < numClasses; ++c )
+      {
+      const SparseHistogramTreeType & tree = m_InClassSparseHistogramTree[c];
+      if( tree.TotalCount > 0 )
+        {
+        prob[c] = this->SparseHistogramKernelSum( tree, 0,
+          tree.Entry.size(), binIndex, numFeatures, radius, &( kernel[0] ) )
+          / ( tree.TotalCount * kernelNorm );
+        }
+      }
+    }
+  else
+    {
+    for( unsigned int c = 0; c < numClasses; ++c )
+      {
+      typename SparseHistogramType::const_iterator iter =
+        m_InClassSparseHistogram[c].find( binIndex );
+      if( iter != m_InClassSparseHistogram[c].end() )
+        {
+        prob[c] = iter->second / m_InClassSparseHistogramTree[c].TotalCount;
+        }
+      }
+    }
+  return prob;
+}
+
 template< class TImage, class TLabelMap >
 void
 PDFSegmenterParzen< TImage, TLabelMap >
@@ -680,6 +982,12 @@ PDFSegmenterParzen< TImage, TLabelMap >
     << m_HistogramSmoothingStandardDeviation << std::endl;
   os << indent << "InClassHistogram size = "
     << m_InClassHistogram.size() << std::endl;
+  os << indent << "UseSparseHistogram = " << m_UseSparseHistogram
+    << std::endl;
+  os << indent << "UsingSparseHistogram = " << m_UsingSparseHistogram
+    << std::endl;
+  os << indent << "InClassSparseHistogram size = "
+    << m_InClassSparseHistogram.size() << std::endl;
   if( m_HistogramBinMin.size() > 0 )
     {
     os << indent << "HistogramBinMin = " << m_HistogramBinMin[0]
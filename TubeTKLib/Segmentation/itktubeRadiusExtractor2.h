@@ -35,6 +35,7 @@ limitations under the License.
 
 #include <itkMath.h>
 
+#include <algorithm>
 #include <vector>
 
 namespace itk
@@ -216,8 +217,31 @@ protected:
   void RecordOptimaAtTubePoints( unsigned int tubePointNum,
     TubeType * tube );
 
+  /** Sort the kernel voxels by normal distance, so that medialness and
+   *  branchness only visit the voxels within their distance range */
+  void GenerateKernelIndex( void );
+
 private:
 
+  itkStaticConstMacro( KernelHistogramBins, int, 500 );
+
+  struct KernelIndexEntryType
+    {
+    double         distance;
+    double         tangentDistance;
+    int            bin;
+    };
+
+  struct KernelIndexEntryLess
+    {
+    bool operator()( const KernelIndexEntryType & a,
+      const KernelIndexEntryType & b ) const;
+    bool operator()( const KernelIndexEntryType & a, double b ) const;
+    bool operator()( double a, const KernelIndexEntryType & b ) const;
+    };
+
+  typedef std::vector< KernelIndexEntryType >   KernelIndexType;
+
   RadiusExtractor2( const Self& );
   void operator=( const Self& );
 
@@ -247,6 +271,7 @@ private:
   std::vector< double >                   m_KernelValues;
   std::vector< double >                   m_KernelDistances;
   std::vector< double >                   m_KernelTangentDistances;
+  KernelIndexType                         m_KernelIndex;
 
   double                                  m_KernelOptimalRadius;
   double                                  m_KernelOptimalRadiusMedialness;
@@ -107,6 +107,7 @@ RadiusExtractor2<TInputImage>
   m_KernelValues.clear();
   m_KernelDistances.clear();
   m_KernelTangentDistances.clear();
+  m_KernelIndex.clear();
 
   m_KernelOptimalRadius = 0;
   m_KernelOptimalRadiusMedialness = 0;
@@ -381,6 +382,62 @@ RadiusExtractor2<TInputImage>
       done = true;
       }
     }
+
+  this->GenerateKernelIndex();
+}
+
+template< class TInputImage >
+bool
+RadiusExtractor2<TInputImage>::KernelIndexEntryLess
+::operator()( const KernelIndexEntryType & a,
+  const KernelIndexEntryType & b ) const
+{
+  return a.distance < b.distance;
+}
+
+template< class TInputImage >
+bool
+RadiusExtractor2<TInputImage>::KernelIndexEntryLess
+::operator()( const KernelIndexEntryType & a, double b ) const
+{
+  return a.distance < b;
+}
+
+template< class TInputImage >
+bool
+RadiusExtractor2<TInputImage>::KernelIndexEntryLess
+::operator()( double a, const KernelIndexEntryType & b ) const
+{
+  return a < b.distance;
+}
+
+template< class TInputImage >
+void
+RadiusExtractor2<TInputImage>
+::GenerateKernelIndex( void )
+{
+  const int histoBins = KernelHistogramBins;
+
+  unsigned int kernelSize = m_KernelDistances.size();
+  m_KernelIndex.resize( kernelSize );
+  for( unsigned int i = 0; i < kernelSize; ++i )
+    {
+    int bin = m_KernelValues[i] * histoBins;
+    if( bin < 0 )
+      {
+      bin = 0;
+      }
+    else if( bin > histoBins - 1 )
+      {
+      bin = histoBins - 1;
+      }
+    m_KernelIndex[i].distance = m_KernelDistances[i];
+    m_KernelIndex[i].tangentDistance = m_KernelTangentDistances[i];
+    m_KernelIndex[i].bin = bin;
+    }
+
+  std::sort( m_KernelIndex.begin(), m_KernelIndex.end(),
+    KernelIndexEntryLess() );
 }
 
 template< class TInputImage >
@@ -427,10 +484,6 @@ RadiusExtractor2<TInputImage>
   double pVal = 0;
   double nVal = 0;
 
-  std::vector< double >::iterator iterDist;
-  std::vector< double >::iterator iterTanDist;
-  std::vector< double >::iterator iterValue;
-
   double areaR = r * r * vnl_math::pi;
   double distMax = ( r + 1.0 );
   double areaMax = distMax * distMax * vnl_math::pi;
@@ -450,7 +503,7 @@ RadiusExtractor2<TInputImage>
     std::cout << "   Area = " << areaPos << " - " << areaNeg << std::endl;
     }
 
-  const int histoBins = 500;
+  const int histoBins = KernelHistogramBins;
   unsigned int histoPos[histoBins];
   unsigned int histoNeg[histoBins];
   unsigned int histoPosCount = 0;
@@ -461,37 +514,27 @@ RadiusExtractor2<TInputImage>
     histoNeg[i] = 0;
     }
   int bin = 0;
-  iterDist = m_KernelDistances.begin();
-  iterTanDist = m_KernelTangentDistances.begin();
-  iterValue = m_KernelValues.begin();
-  while( iterDist != m_KernelDistances.end() )
+  typename KernelIndexType::const_iterator iter = std::lower_bound(
+    m_KernelIndex.begin(), m_KernelIndex.end(), distMin,
+    KernelIndexEntryLess() );
+  typename KernelIndexType::const_iterator iterEnd = std::upper_bound(
+    iter, m_KernelIndex.end(), distMax, KernelIndexEntryLess() );
+  while( iter != iterEnd )
     {
-    if( ( ( *iterTanDist ) < r || ( *iterTanDist ) < 1 )
-      && ( *iterDist ) >= distMin && ( *iterDist ) <= distMax )
+    if( iter->tangentDistance < r || iter->tangentDistance < 1 )
       {
-      bin = ( *iterValue ) * histoBins;
-      if( bin < 0 )
-        {
-        bin = 0;
-        }
-      else if( bin > histoBins - 1 )
-        {
-        bin = histoBins - 1;
-        }
-      if( ( *iterDist ) <= r )
+      if( iter->distance <= r )
         {
-        ++histoPos[bin];
+        ++histoPos[iter->bin];
         ++histoPosCount;
         }
       else
         {
-        ++histoNeg[bin];
+        ++histoNeg[iter->bin];
         ++histoNegCount;
         }
       }
-    ++iterValue;
-    ++iterDist;
-    ++iterTanDist;
+    ++iter;
     }
 
   int binCount = 0;
@@ -555,14 +598,10 @@ RadiusExtractor2<TInputImage>
   double pVal = 0;
   double nVal = 0;
 
-  std::vector< double >::iterator iterDist;
-  std::vector< double >::iterator iterTanDist;
-  std::vector< double >::iterator iterValue;
-
   double distMax = r * this->GetKernelExtent();
   double distMin = 0;
 
-  const int histoBins = 500;
+  const int histoBins = KernelHistogramBins;
   unsigned int histoPos[histoBins];
   unsigned int histoNeg[histoBins];
   unsigned int histoPosCount = 0;
@@ -573,37 +612,27 @@ RadiusExtractor2<TInputImage>
     histoNeg[i] = 0;
     }
   int bin = 0;
-  iterDist = m_KernelDistances.begin();
-  iterTanDist = m_KernelTangentDistances.begin();
-  iterValue = m_KernelValues.begin();
-  while( iterDist != m_KernelDistances.end() )
+  typename KernelIndexType::const_iterator iter = std::lower_bound(
+    m_KernelIndex.begin(), m_KernelIndex.end(), distMin,
+    KernelIndexEntryLess() );
+  typename KernelIndexType::const_iterator iterEnd = std::upper_bound(
+    iter, m_KernelIndex.end(), distMax, KernelIndexEntryLess() );
+  while( iter != iterEnd )
     {
-    if( ( *iterTanDist ) < r
-      && ( *iterDist ) >= distMin && ( *iterDist ) <= distMax )
+    if( iter->tangentDistance < r )
       {
-      bin = ( *iterValue ) * histoBins;
-      if( bin < 0 )
-        {
-        bin = 0;
-        }
-      else if( bin > histoBins - 1 )
-        {
-        bin = histoBins - 1;
-        }
-      if( ( *iterDist ) <= r )
+      if( iter->distance <= r )
         {
-        ++histoPos[bin];
+        ++histoPos[iter->bin];
         ++histoPosCount;
         }
       else
         {
-        ++histoNeg[bin];
+        ++histoNeg[iter->bin];
         ++histoNegCount;
         }
       }
-    ++iterValue;
-    ++iterDist;
-    ++iterTanDist;
+    ++iter;
     }
 
   int binCount = 0;
@@ -993,6 +1022,7 @@ RadiusExtractor2<TInputImage>
     << std::endl;
   os << indent << "KernelTangentDistances = " << m_KernelTangentDistances.size()
     << std::endl;
+  os << indent << "KernelIndex = " << m_KernelIndex.size() << std::endl;
 
   os << indent << "KernelOptimalRadius = " << m_KernelOptimalRadius
     << std::endl;
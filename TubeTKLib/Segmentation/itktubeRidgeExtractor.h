@@ -40,6 +40,9 @@ limitations under the License.
 
 #include <cmath>
 #include <list>
+#include <map>
+#include <utility>
+#include <vector>
 
 namespace itk
 {
@@ -107,6 +110,16 @@ public:
   /** Defines the type of vectors used */
   typedef typename TubeType::CovariantVectorType CovariantVectorType;
 
+  /** Type of the images of the optional scale-space volume */
+  typedef Image< float, TInputImage::ImageDimension >     ScaleSpaceImageType;
+
+  typedef std::vector< typename ScaleSpaceImageType::Pointer >
+                                                ScaleSpaceImageListType;
+
+  /** Tube mask values keyed by their offset into the mask buffer */
+  typedef std::map< OffsetValueType,
+    typename TubeMaskImageType::PixelType >     TubeMaskOverlayType;
+
   typedef enum { SUCCESS, EXITED_IMAGE, REVISITED_VOXEL, RIDGE_FAIL,
     ROUND_FAIL, CURVE_FAIL, LEVEL_FAIL, TANGENT_FAIL, DISTANCE_FAIL,
     OTHER_FAIL }                                FailureCodeEnum;
@@ -123,6 +136,26 @@ public:
   /** Set the mask image */
   itkSetObjectMacro( TubeMaskImage, TubeMaskImageType );
 
+  /** When enabled, the tube mask image is treated as read-only.  Voxels
+   *  marked during extraction are kept in a private overlay, and the mask
+   *  value first seen at every voxel visited is recorded.  This allows
+   *  several extractors to share one mask, e.g., in SegmentTubes. */
+  itkSetMacro( UseTubeMaskOverlay, bool );
+  itkGetMacro( UseTubeMaskOverlay, bool );
+
+  /** Get the voxels marked since the overlay was last cleared */
+  const TubeMaskOverlayType & GetTubeMaskOverlay( void ) const;
+
+  /** Get the mask values seen since the overlay was last cleared */
+  const TubeMaskOverlayType & GetTubeMaskVisited( void ) const;
+
+  /** Clear the overlay and the record of visited voxels */
+  void ClearTubeMaskOverlay( void );
+
+  /** Get the tube mask value at a voxel, including overlay marks */
+  typename TubeMaskImageType::PixelType GetTubeMaskValue(
+    const IndexType & indx );
+
   /** Set Data Minimum */
   void SetDataMin( double dataMin );
 
@@ -253,6 +286,65 @@ public:
    * local tube radius estimates. */
   itkGetMacro( DynamicStepSize, bool );
 
+  /** Set a scale-space volume: the input image blurred at each of the
+   *  given, increasing scales.  Intensities at scales within that range
+   *  are linearly interpolated between the two nearest scales instead of
+   *  being blurred exactly. */
+  void SetScaleSpace( const std::vector< double > & scales,
+    const ScaleSpaceImageListType & images );
+
+  /** Compute the scale-space volume from the input image using recursive
+   *  Gaussian filters */
+  void GenerateScaleSpace( const std::vector< double > & scales );
+
+  /** Remove the scale-space volume */
+  void ClearScaleSpace( void );
+
+  /** Get the scales of the scale-space volume */
+  const std::vector< double > & GetScaleSpaceScales( void ) const;
+
+  /** Get the images of the scale-space volume */
+  const ScaleSpaceImageListType & GetScaleSpaceImages( void ) const;
+
+  /** Use the scale-space volume, when set.  When off, intensities are
+   *  always blurred exactly. */
+  void SetUseScaleSpace( bool useScaleSpace );
+  itkGetMacro( UseScaleSpace, bool );
+
+  /** Keep the blurred intensities at spline lattice nodes in a cache of
+   *  sparse voxel blocks, keyed by scale, so that nodes revisited during
+   *  traversal, by later seeds, or after a return to a previous scale are
+   *  not blurred again */
+  itkSetMacro( UseIntensityCache, bool );
+  itkGetMacro( UseIntensityCache, bool );
+
+  /** Set the maximum number of blocks held by the intensity cache.  The
+   *  least recently used block is evicted when the limit is reached.
+   *  Zero disables eviction. */
+  itkSetMacro( IntensityCacheMaximumNumberOfBlocks, unsigned int );
+  itkGetMacro( IntensityCacheMaximumNumberOfBlocks, unsigned int );
+
+  /** Number of lattice values returned from the intensity cache */
+  itkGetMacro( IntensityCacheHits, SizeValueType );
+
+  /** Number of lattice values that had to be blurred */
+  itkGetMacro( IntensityCacheMisses, SizeValueType );
+
+  /** Fraction of lattice values returned from the intensity cache */
+  double GetIntensityCacheHitRate( void ) const;
+
+  /** Number of blocks currently held by the intensity cache */
+  unsigned int GetIntensityCacheNumberOfBlocks( void ) const;
+
+  /** Approximate memory, in bytes, used by the intensity cache */
+  SizeValueType GetIntensityCacheMemorySize( void ) const;
+
+  /** Drop all blocks of the intensity cache */
+  void ClearIntensityCache( void );
+
+  /** Reset the intensity cache hit and miss counts */
+  void ResetIntensityCacheStatistics( void );
+
   /** Set the Recovery Maximum */
   itkSetMacro( MaxRecoveryAttempts, int );
 
@@ -336,6 +428,8 @@ public:
   unsigned int      GetNumberOfFailureCodes( void ) const;
   const std::string GetFailureCodeName( FailureCodeEnum code ) const;
   unsigned int      GetFailureCodeCount( FailureCodeEnum code ) const;
+  void              IncrementFailureCodeCount( FailureCodeEnum code,
+                      unsigned int count = 1 );
   void              ResetFailureCodeCounts( void );
 
   /** Set the idle callback */
@@ -352,6 +446,21 @@ protected:
 
   void PrintSelf( std::ostream & os, Indent indent ) const;
 
+  /** Set the tube mask value at a voxel, or mark it in the overlay */
+  void SetTubeMaskValue( const IndexType & indx,
+    typename TubeMaskImageType::PixelType value );
+
+  /** Set a voxel of a mask drawn by AddTube or DeleteTube.  Voxels of the
+   *  tube mask are set using SetTubeMaskValue, so that they honor the
+   *  overlay. */
+  template< class TDrawMask >
+  void SetDrawMaskValue( TDrawMask * drawMask,
+    const typename TDrawMask::IndexType & indx,
+    typename TDrawMask::PixelType value );
+
+  /** Return the blurred intensity at x, from the cache when possible */
+  double GetCachedBlurredIntensity( const IndexType & x );
+
   /** Traverse the ridge one way */
   bool  TraverseOneWay( ContinuousIndexType & newX, VectorType & newT,
     MatrixType & newN, int dir, bool verbose=false );
@@ -361,12 +470,32 @@ private:
   RidgeExtractor( const Self& );
   void operator=( const Self& );
 
+  itkStaticConstMacro( IntensityCacheBlockEdge, unsigned int, 8 );
+
+  struct IntensityCacheBlockType
+    {
+    double                   scale;
+    OffsetValueType          blockNumber;
+    std::vector< double >    values;
+    std::vector< bool >      valid;
+    };
+
+  /** Blocks are kept in order of use, most recently used first */
+  typedef std::list< IntensityCacheBlockType >     IntensityCacheListType;
+
+  typedef std::map< std::pair< double, OffsetValueType >,
+    typename IntensityCacheListType::iterator >    IntensityCacheMapType;
+
   typename ImageType::Pointer                        m_InputImage;
 
   typename BlurImageFunction<ImageType>::Pointer     m_DataFunc;
 
   typename TubeMaskImageType::Pointer                m_TubeMaskImage;
 
+  bool                                               m_UseTubeMaskOverlay;
+  TubeMaskOverlayType                                m_TubeMaskOverlay;
+  TubeMaskOverlayType                                m_TubeMaskVisited;
+
   bool                                               m_DynamicScale;
   double                                             m_DynamicScaleUsed;
   bool                                               m_DynamicStepSize;
@@ -390,6 +519,18 @@ private:
   ::tube::SplineND                                 * m_DataSpline;
   ::tube::UserFunction< vnl_vector<int>, double >  * m_SplineValueFunc;
 
+  bool                                               m_UseScaleSpace;
+  std::vector< double >                              m_ScaleSpaceScales;
+  ScaleSpaceImageListType                            m_ScaleSpaceImages;
+
+  bool                                               m_UseIntensityCache;
+  unsigned int                       m_IntensityCacheMaximumNumberOfBlocks;
+  IntensityCacheListType                             m_IntensityCache;
+  IntensityCacheMapType                              m_IntensityCacheMap;
+  OffsetValueType                m_IntensityCacheBlockStride[ ImageDimension ];
+  SizeValueType                                      m_IntensityCacheHits;
+  SizeValueType                                      m_IntensityCacheMisses;
+
   FailureCodeEnum                                    m_CurrentFailureCode;
   IntVectorType                                      m_FailureCodeCount;
 
@@ -34,6 +34,7 @@ limitations under the License.
 #endif
 
 #include "itktubeRidgeExtractor.h"
+#include "itktubeSmoothingRecursiveGaussianImageFilter.h"
 #include "tubeMatrixMath.h"
 
 #include <itkImageRegionIterator.h>
@@ -149,6 +150,21 @@ RidgeExtractor<TInputImage>
   vnl_vector< double > xStep( ImageDimension, 0.1 );
   m_DataSpline->GetOptimizerND()->SetXStep( xStep );
 
+  m_UseScaleSpace = true;
+  m_ScaleSpaceScales.clear();
+  m_ScaleSpaceImages.clear();
+
+  m_UseIntensityCache = true;
+  m_IntensityCacheMaximumNumberOfBlocks = 4096;
+  m_IntensityCache.clear();
+  m_IntensityCacheMap.clear();
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    m_IntensityCacheBlockStride[i] = 0;
+    }
+  m_IntensityCacheHits = 0;
+  m_IntensityCacheMisses = 0;
+
   m_IdleCallBack = NULL;
   m_StatusCallBack = NULL;
 
@@ -157,6 +173,8 @@ RidgeExtractor<TInputImage>
   m_FailureCodeCount.fill( 0 );
 
   m_Tube = NULL;
+
+  m_UseTubeMaskOverlay = false;
 }
 
 /**
@@ -228,6 +246,16 @@ RidgeExtractor<TInputImage>
     m_DataSpline->SetXMin( vMin );
     m_DataSpline->SetXMax( vMax );
 
+    this->ClearScaleSpace();
+    this->ClearIntensityCache();
+    OffsetValueType blockStride = 1;
+    for( unsigned int i=0; i<ImageDimension; i++ )
+      {
+      m_IntensityCacheBlockStride[i] = blockStride;
+      blockStride *= ( region.GetSize()[i] + IntensityCacheBlockEdge - 1 )
+        / IntensityCacheBlockEdge;
+      }
+
     if( this->GetDebug() )
       {
       std::cout << "  Origin = " << m_InputImage->GetOrigin() << std::endl;
@@ -255,6 +283,106 @@ RidgeExtractor<TInputImage>
   return m_InputImage;
 }
 
+/**
+ * Get the voxels marked in the tube mask overlay */
+template< class TInputImage >
+const typename RidgeExtractor<TInputImage>::TubeMaskOverlayType &
+RidgeExtractor<TInputImage>
+::GetTubeMaskOverlay( void ) const
+{
+  return m_TubeMaskOverlay;
+}
+
+/**
+ * Get the tube mask values seen while the overlay was in use */
+template< class TInputImage >
+const typename RidgeExtractor<TInputImage>::TubeMaskOverlayType &
+RidgeExtractor<TInputImage>
+::GetTubeMaskVisited( void ) const
+{
+  return m_TubeMaskVisited;
+}
+
+/**
+ * Clear the tube mask overlay */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::ClearTubeMaskOverlay( void )
+{
+  m_TubeMaskOverlay.clear();
+  m_TubeMaskVisited.clear();
+}
+
+/**
+ * Get the tube mask value at a voxel */
+template< class TInputImage >
+typename RidgeExtractor<TInputImage>::TubeMaskImageType::PixelType
+RidgeExtractor<TInputImage>
+::GetTubeMaskValue( const IndexType & indx )
+{
+  if( !m_UseTubeMaskOverlay )
+    {
+    return m_TubeMaskImage->GetPixel( indx );
+    }
+
+  OffsetValueType offset = m_TubeMaskImage->ComputeOffset( indx );
+  typename TubeMaskOverlayType::const_iterator iter =
+    m_TubeMaskOverlay.find( offset );
+  if( iter != m_TubeMaskOverlay.end() )
+    {
+    return iter->second;
+    }
+
+  typename TubeMaskImageType::PixelType value =
+    m_TubeMaskImage->GetPixel( indx );
+  m_TubeMaskVisited.insert( std::make_pair( offset, value ) );
+
+  return value;
+}
+
+/**
+ * Set the tube mask value at a voxel */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::SetTubeMaskValue( const IndexType & indx,
+  typename TubeMaskImageType::PixelType value )
+{
+  if( !m_UseTubeMaskOverlay )
+    {
+    m_TubeMaskImage->SetPixel( indx, value );
+    return;
+    }
+
+  OffsetValueType offset = m_TubeMaskImage->ComputeOffset( indx );
+  m_TubeMaskVisited.insert( std::make_pair( offset,
+    m_TubeMaskImage->GetPixel( indx ) ) );
+  m_TubeMaskOverlay[ offset ] = value;
+}
+
+/**
+ * Set a voxel of a mask drawn by AddTube or DeleteTube */
+template< class TInputImage >
+template< class TDrawMask >
+void
+RidgeExtractor<TInputImage>
+::SetDrawMaskValue( TDrawMask * drawMask,
+  const typename TDrawMask::IndexType & indx,
+  typename TDrawMask::PixelType value )
+{
+  if( static_cast< void * >( drawMask )
+    == static_cast< void * >( m_TubeMaskImage.GetPointer() ) )
+    {
+    this->SetTubeMaskValue( indx,
+      static_cast< typename TubeMaskImageType::PixelType >( value ) );
+    }
+  else
+    {
+    drawMask->SetPixel( indx, value );
+    }
+}
+
 /**
  * Set Data Min value */
 template< class TInputImage >
@@ -310,6 +438,10 @@ RidgeExtractor<TInputImage>
 ::SetScaleKernelExtent( double extent )
 {
   m_DataSpline->SetNewData( true );
+  if( extent != m_DataFunc->GetExtent() )
+    {
+    this->ClearIntensityCache();
+    }
   m_DataFunc->SetExtent( extent );
 }
 
@@ -324,6 +456,184 @@ RidgeExtractor<TInputImage>
   return m_DataFunc->GetExtent();
 }
 
+/**
+ * Set the scale-space volume */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::SetScaleSpace( const std::vector< double > & scales,
+  const ScaleSpaceImageListType & images )
+{
+  if( m_InputImage.IsNull() )
+    {
+    itkExceptionMacro( << "Input image must be set before the scale space" );
+    }
+  if( scales.size() != images.size() || scales.size() < 2 )
+    {
+    itkExceptionMacro( << "Scale space requires at least two scales and "
+      << "one image per scale" );
+    }
+  for( unsigned int i=0; i<scales.size(); i++ )
+    {
+    if( i > 0 && scales[i] <= scales[i-1] )
+      {
+      itkExceptionMacro( << "Scale space scales must be increasing" );
+      }
+    if( images[i].IsNull() || images[i]->GetLargestPossibleRegion()
+      != m_InputImage->GetLargestPossibleRegion() )
+      {
+      itkExceptionMacro( << "Scale space image " << i
+        << " does not match the input image region" );
+      }
+    }
+
+  m_ScaleSpaceScales = scales;
+  m_ScaleSpaceImages = images;
+  m_DataSpline->SetNewData( true );
+}
+
+/**
+ * Compute the scale-space volume */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::GenerateScaleSpace( const std::vector< double > & scales )
+{
+  if( m_InputImage.IsNull() )
+    {
+    itkExceptionMacro( << "Input image must be set before the scale space" );
+    }
+
+  typedef SmoothingRecursiveGaussianImageFilter< ImageType,
+    ScaleSpaceImageType >                         FilterType;
+
+  // BlurImageFunction measures scale in units of the first spacing
+  double spacing = m_InputImage->GetSpacing()[0];
+
+  ScaleSpaceImageListType images( scales.size() );
+  for( unsigned int i=0; i<scales.size(); i++ )
+    {
+    typename FilterType::Pointer filter = FilterType::New();
+    filter->SetInput( m_InputImage );
+    filter->SetSigma( scales[i] * spacing );
+    filter->Update();
+    images[i] = filter->GetOutput();
+    }
+
+  this->SetScaleSpace( scales, images );
+}
+
+/**
+ * Remove the scale-space volume */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::ClearScaleSpace( void )
+{
+  m_ScaleSpaceScales.clear();
+  m_ScaleSpaceImages.clear();
+  m_DataSpline->SetNewData( true );
+}
+
+/**
+ * Use the scale-space volume, when set */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::SetUseScaleSpace( bool useScaleSpace )
+{
+  if( m_UseScaleSpace != useScaleSpace )
+    {
+    m_UseScaleSpace = useScaleSpace;
+    m_DataSpline->SetNewData( true );
+    }
+}
+
+/**
+ * Get the scales of the scale-space volume */
+template< class TInputImage >
+const std::vector< double > &
+RidgeExtractor<TInputImage>
+::GetScaleSpaceScales( void ) const
+{
+  return m_ScaleSpaceScales;
+}
+
+/**
+ * Get the images of the scale-space volume */
+template< class TInputImage >
+const typename RidgeExtractor<TInputImage>::ScaleSpaceImageListType &
+RidgeExtractor<TInputImage>
+::GetScaleSpaceImages( void ) const
+{
+  return m_ScaleSpaceImages;
+}
+
+/**
+ * Get the fraction of lattice values found in the intensity cache */
+template< class TInputImage >
+double
+RidgeExtractor<TInputImage>
+::GetIntensityCacheHitRate( void ) const
+{
+  SizeValueType total = m_IntensityCacheHits + m_IntensityCacheMisses;
+  if( total == 0 )
+    {
+    return 0;
+    }
+  return static_cast< double >( m_IntensityCacheHits ) / total;
+}
+
+/**
+ * Get the number of blocks in the intensity cache */
+template< class TInputImage >
+unsigned int
+RidgeExtractor<TInputImage>
+::GetIntensityCacheNumberOfBlocks( void ) const
+{
+  return m_IntensityCacheMap.size();
+}
+
+/**
+ * Get the approximate memory used by the intensity cache */
+template< class TInputImage >
+SizeValueType
+RidgeExtractor<TInputImage>
+::GetIntensityCacheMemorySize( void ) const
+{
+  SizeValueType blockSize = 1;
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    blockSize *= IntensityCacheBlockEdge;
+    }
+  SizeValueType bytesPerBlock = blockSize * sizeof( double )
+    + ( blockSize + 7 ) / 8 + sizeof( IntensityCacheBlockType )
+    + sizeof( typename IntensityCacheMapType::value_type );
+  return m_IntensityCacheMap.size() * bytesPerBlock;
+}
+
+/**
+ * Clear the intensity cache */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::ClearIntensityCache( void )
+{
+  m_IntensityCache.clear();
+  m_IntensityCacheMap.clear();
+}
+
+/**
+ * Reset the intensity cache statistics */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::ResetIntensityCacheStatistics( void )
+{
+  m_IntensityCacheHits = 0;
+  m_IntensityCacheMisses = 0;
+}
+
 /**
  * Get the data spline */
 template< class TInputImage >
@@ -392,7 +702,32 @@ double
 RidgeExtractor<TInputImage>
 ::Intensity( const IndexType & x )
 {
-  double tf = ( m_DataFunc->EvaluateAtIndex( x )-m_DataMin )/m_DataRange;
+  double tf = 0;
+  double scale = m_DataFunc->GetScale();
+  if( m_UseScaleSpace && !m_ScaleSpaceScales.empty()
+    && scale >= m_ScaleSpaceScales.front()
+    && scale <= m_ScaleSpaceScales.back() )
+    {
+    unsigned int i = 1;
+    while( i < m_ScaleSpaceScales.size() - 1
+      && m_ScaleSpaceScales[i] < scale )
+      {
+      ++i;
+      }
+    double w = ( scale - m_ScaleSpaceScales[i-1] )
+      / ( m_ScaleSpaceScales[i] - m_ScaleSpaceScales[i-1] );
+    double v = ( 1 - w ) * m_ScaleSpaceImages[i-1]->GetPixel( x )
+      + w * m_ScaleSpaceImages[i]->GetPixel( x );
+    tf = ( v-m_DataMin )/m_DataRange;
+    }
+  else if( m_UseIntensityCache )
+    {
+    tf = ( this->GetCachedBlurredIntensity( x )-m_DataMin )/m_DataRange;
+    }
+  else
+    {
+    tf = ( m_DataFunc->EvaluateAtIndex( x )-m_DataMin )/m_DataRange;
+    }
 
   if( tf<0 )
     {
@@ -406,6 +741,83 @@ RidgeExtractor<TInputImage>
   return tf;
 }
 
+/**
+ * Return the blurred intensity, using the intensity cache */
+template< class TInputImage >
+double
+RidgeExtractor<TInputImage>
+::GetCachedBlurredIntensity( const IndexType & x )
+{
+  typename ImageType::RegionType region =
+    m_InputImage->GetLargestPossibleRegion();
+
+  OffsetValueType blockNumber = 0;
+  OffsetValueType voxelNumber = 0;
+  OffsetValueType voxelStride = 1;
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    OffsetValueType d = x[i] - region.GetIndex()[i];
+    if( d < 0 || d >= static_cast< OffsetValueType >(
+      region.GetSize()[i] ) )
+      {
+      ++m_IntensityCacheMisses;
+      return m_DataFunc->EvaluateAtIndex( x );
+      }
+    blockNumber += ( d / IntensityCacheBlockEdge )
+      * m_IntensityCacheBlockStride[i];
+    voxelNumber += ( d % IntensityCacheBlockEdge ) * voxelStride;
+    voxelStride *= IntensityCacheBlockEdge;
+    }
+
+  // The block in use is always at the front of the list
+  double scale = m_DataFunc->GetScale();
+  if( m_IntensityCache.empty()
+    || m_IntensityCache.front().scale != scale
+    || m_IntensityCache.front().blockNumber != blockNumber )
+    {
+    std::pair< double, OffsetValueType > key( scale, blockNumber );
+    typename IntensityCacheMapType::iterator iter =
+      m_IntensityCacheMap.find( key );
+    if( iter != m_IntensityCacheMap.end() )
+      {
+      m_IntensityCache.splice( m_IntensityCache.begin(), m_IntensityCache,
+        iter->second );
+      }
+    else
+      {
+      while( m_IntensityCacheMaximumNumberOfBlocks > 0
+        && m_IntensityCacheMap.size() >=
+        m_IntensityCacheMaximumNumberOfBlocks )
+        {
+        m_IntensityCacheMap.erase( std::make_pair(
+          m_IntensityCache.back().scale,
+          m_IntensityCache.back().blockNumber ) );
+        m_IntensityCache.pop_back();
+        }
+      m_IntensityCache.push_front( IntensityCacheBlockType() );
+      IntensityCacheBlockType & block = m_IntensityCache.front();
+      block.scale = scale;
+      block.blockNumber = blockNumber;
+      block.values.resize( voxelStride, 0 );
+      block.valid.resize( voxelStride, false );
+      m_IntensityCacheMap[ key ] = m_IntensityCache.begin();
+      }
+    }
+
+  IntensityCacheBlockType & block = m_IntensityCache.front();
+  if( block.valid[ voxelNumber ] )
+    {
+    ++m_IntensityCacheHits;
+    return block.values[ voxelNumber ];
+    }
+
+  ++m_IntensityCacheMisses;
+  block.values[ voxelNumber ] = m_DataFunc->EvaluateAtIndex( x );
+  block.valid[ voxelNumber ] = true;
+
+  return block.values[ voxelNumber ];
+}
+
 /**
  * Ridgeness
  */
@@ -460,9 +872,37 @@ RidgeExtractor<TInputImage>
     std::cout << "  XH = " << m_XH << std::endl;
     }
 
-  ::tube::ComputeRidgeness<double>( m_XH, m_XD, prevTangent,
-    m_XRidgeness, m_XRoundness, m_XCurvature, m_XLevelness, m_XHEVect,
-    m_XHEVal );
+  // Use the fixed size solver: it is called at every step of the
+  // traversal and must not allocate
+  vnl_matrix_fixed< double, ImageDimension, ImageDimension > xH;
+  vnl_vector_fixed< double, ImageDimension > xD;
+  vnl_vector_fixed< double, ImageDimension > xPrevTangent;
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    xD[i] = m_XD[i];
+    if( !prevTangent.empty() )
+      {
+      xPrevTangent[i] = prevTangent[i];
+      }
+    for( unsigned int j=0; j<ImageDimension; j++ )
+      {
+      xH( i, j ) = m_XH( i, j );
+      }
+    }
+  vnl_matrix_fixed< double, ImageDimension, ImageDimension > xHEVect;
+  vnl_vector_fixed< double, ImageDimension > xHEVal;
+  ::tube::ComputeRidgeness( xH, xD,
+    prevTangent.empty() ? NULL : &xPrevTangent,
+    m_XRidgeness, m_XRoundness, m_XCurvature, m_XLevelness, xHEVect,
+    xHEVal );
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    m_XHEVal[i] = xHEVal[i];
+    for( unsigned int j=0; j<ImageDimension; j++ )
+      {
+      m_XHEVect( i, j ) = xHEVect( i, j );
+      }
+    }
 
   intensity = m_XVal;
   roundness = m_XRoundness;
@@ -582,6 +1022,14 @@ RidgeExtractor<TInputImage>
     os << indent << "DynamicScale = False" << std::endl;
     }
   os << indent << "DynamicScaleUsed = " << m_DynamicScaleUsed << std::endl;
+  if( m_UseTubeMaskOverlay )
+    {
+    os << indent << "UseTubeMaskOverlay = True" << std::endl;
+    }
+  else
+    {
+    os << indent << "UseTubeMaskOverlay = False" << std::endl;
+    }
   if( m_DynamicStepSize )
     {
     os << indent << "DynamicStepSize = True" << std::endl;
@@ -604,6 +1052,19 @@ RidgeExtractor<TInputImage>
   os << indent << "DataSpline1D = " << m_DataSpline1D << std::endl;
   os << indent << "DataSplineOpt = " << m_DataSplineOpt << std::endl;
   os << indent << "DataSpline = " << m_DataSpline << std::endl;
+  os << indent << "UseScaleSpace = " << m_UseScaleSpace << std::endl;
+  os << indent << "ScaleSpaceScales = " << m_ScaleSpaceScales.size()
+    << std::endl;
+  os << indent << "UseIntensityCache = " << m_UseIntensityCache
+    << std::endl;
+  os << indent << "IntensityCacheMaximumNumberOfBlocks = "
+    << m_IntensityCacheMaximumNumberOfBlocks << std::endl;
+  os << indent << "IntensityCacheNumberOfBlocks = "
+    << m_IntensityCacheMap.size() << std::endl;
+  os << indent << "IntensityCacheHits = " << m_IntensityCacheHits
+    << std::endl;
+  os << indent << "IntensityCacheMisses = " << m_IntensityCacheMisses
+    << std::endl;
   os << indent << "SplineValueFunc = " << m_SplineValueFunc << std::endl;
   os << indent << "MinRidgeness = " << m_MinRidgeness << std::endl;
   os << indent << "MinRidgenessStart = " << m_MinRidgenessStart
@@ -726,7 +1187,7 @@ RidgeExtractor<TInputImage>
   pnts.clear();
 
   typename TubeMaskImageType::PixelType value =
-    m_TubeMaskImage->GetPixel( indx );
+    GetTubeMaskValue( indx );
   if( value != 0 && ( int )value != tubeId )
     {
     if( verbose || this->GetDebug() )
@@ -740,7 +1201,7 @@ RidgeExtractor<TInputImage>
     }
   else
     {
-    m_TubeMaskImage->SetPixel( indx, ( float )( tubeId
+    SetTubeMaskValue( indx, ( float )( tubeId
       + ( tubePointCount/10000.0 ) ) );
     if( dir == 1 )
       {
@@ -1143,7 +1604,7 @@ RidgeExtractor<TInputImage>
       {
       indx[i] = ( int )( lX[i]+0.5 );
       }
-    double maskVal = m_TubeMaskImage->GetPixel( indx );
+    double maskVal = GetTubeMaskValue( indx );
 
     if( maskVal != 0 )
       {
@@ -1168,7 +1629,7 @@ RidgeExtractor<TInputImage>
       }
     else
       {
-      m_TubeMaskImage->SetPixel( indx, ( float )( tubeId
+      SetTubeMaskValue( indx, ( float )( tubeId
         + ( tubePointCount/10000.0 ) ) );
       }
 
@@ -1411,6 +1872,14 @@ RidgeExtractor<TInputImage>
   return m_FailureCodeCount[ code ];
 }
 
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::IncrementFailureCodeCount( FailureCodeEnum code, unsigned int count )
+{
+  m_FailureCodeCount[ code ] += count;
+}
+
 template< class TInputImage >
 void
 RidgeExtractor<TInputImage>
@@ -1522,7 +1991,7 @@ RidgeExtractor<TInputImage>
         }
       }
 
-    if( m_TubeMaskImage->GetPixel( indx ) != 0 )
+    if( GetTubeMaskValue( indx ) != 0 )
       {
       if( m_StatusCallBack )
         {
@@ -1531,7 +2000,7 @@ RidgeExtractor<TInputImage>
       if( verbose || this->GetDebug() )
         {
         std::cout << "RidgeExtractor::LocalRidge() : Revisited voxel 3"
-          << m_TubeMaskImage->GetPixel( indx ) << std::endl;
+          << GetTubeMaskValue( indx ) << std::endl;
         }
       return REVISITED_VOXEL;
       }
@@ -1685,7 +2154,7 @@ RidgeExtractor<TInputImage>
     indx[i] = ( int )( lX[i] + 0.5 );
     }
   typename TubeMaskImageType::PixelType value =
-    m_TubeMaskImage->GetPixel( indx );
+    GetTubeMaskValue( indx );
   if( value != 0 && ( int )value != tubeId )
     {
     m_CurrentFailureCode = REVISITED_VOXEL;
@@ -1906,7 +2375,7 @@ RidgeExtractor<TInputImage>
 
     if( inside )
       {
-      drawMask->SetPixel( indx, zero );
+      this->SetDrawMaskValue( drawMask, indx, zero );
       r = ( *pnt ).GetRadius() + 0.5;
       if( r > 1 )
         {
@@ -1939,7 +2408,7 @@ RidgeExtractor<TInputImage>
               }
             if( dist <= rr )
               {
-              it.SetPixel( i, zero );
+              this->SetDrawMaskValue( drawMask, it.GetIndex( i ), zero );
               }
             }
           }
@@ -1953,9 +2422,10 @@ RidgeExtractor<TInputImage>
               double tf = it.GetOffset( i )[j];
               dist += tf * tf;
               }
-            if( dist <= rr )
+            if( dist <= rr && drawMask->GetLargestPossibleRegion()
+              .IsInside( it.GetIndex( i ) ) )
               {
-              it.SetPixel( i, zero, inside );
+              this->SetDrawMaskValue( drawMask, it.GetIndex( i ), zero );
               }
             }
           }
@@ -1989,7 +2459,8 @@ RidgeExtractor<TInputImage>
     std::cout << "*** START: AddTube" << std::endl;
     }
 
-  typedef NeighborhoodIterator< TDrawMask > NeighborhoodIteratorType;
+  typedef typename TDrawMask::PixelType      DrawPixelType;
+  typedef NeighborhoodIterator< TDrawMask >  NeighborhoodIteratorType;
 
   int tubeId = tube->GetId();
   int tubePointCount = 0;
@@ -2031,7 +2502,7 @@ RidgeExtractor<TInputImage>
 
     if( inside )
       {
-      drawMask->SetPixel( indx, ( PixelType )( tubeId +
+      this->SetDrawMaskValue( drawMask, indx, ( DrawPixelType )( tubeId +
           ( tubePointCount/10000.0 ) ) );
       r = ( *pnt ).GetRadius() + 0.5;
       if( r > 1 )
@@ -2066,8 +2537,8 @@ RidgeExtractor<TInputImage>
               }
             if( dist <= rr )
               {
-              it.SetPixel( i, ( PixelType )( tubeId +
-                  ( tubePointCount/10000.0 ) ) );
+              this->SetDrawMaskValue( drawMask, it.GetIndex( i ),
+                ( DrawPixelType )( tubeId + ( tubePointCount/10000.0 ) ) );
               }
             }
           }
@@ -2081,10 +2552,11 @@ RidgeExtractor<TInputImage>
               double tf = it.GetOffset( i )[j];
               dist += tf * tf;
               }
-            if( dist <= rr )
+            if( dist <= rr && drawMask->GetLargestPossibleRegion()
+              .IsInside( it.GetIndex( i ) ) )
               {
-              it.SetPixel( i, ( PixelType )( tubeId +
-                  ( tubePointCount/10000.0 ) ), inside );
+              this->SetDrawMaskValue( drawMask, it.GetIndex( i ),
+                ( DrawPixelType )( tubeId + ( tubePointCount/10000.0 ) ) );
               }
             }
           }
@@ -30,6 +30,7 @@ limitations under the License.
 #define __itktubeSegmentTubes_h
 
 #include "itkImage.h"
+#include "itkMultiThreaderBase.h"
 #include "itkObject.h"
 #include "itktubeTubeExtractor.h"
 #include "itktubeRidgeExtractor.h"
@@ -89,6 +90,8 @@ public:
   /* Parameters file type*/
   typedef itk::tube::TubeExtractorIO< ImageType >      TubeExtractorIOType;
   typedef itk::tube::RidgeExtractor< ImageType >       RidgeExtractorFilterType;
+  typedef typename RidgeExtractorFilterType::TubeMaskOverlayType
+    TubeMaskOverlayType;
 
   /** Set/Get the input image */
   itkSetObjectMacro( InputImage, ImageType );
@@ -127,6 +130,29 @@ public:
   /** Set Border */
   itkSetMacro( Border, double );
 
+  /** Set/Get the number of threads used to extract tubes from the seeds.
+   *  With more than one thread, seeds are extracted in batches by
+   *  per-thread tube extractors that share the tube mask read-only.  The
+   *  tubes of a batch are then committed in seed order, and a seed whose
+   *  extraction read mask voxels changed by an earlier seed of its batch
+   *  is extracted again, so the result matches a single-threaded run.
+   *  Zero uses the global default number of threads. */
+  itkSetMacro( NumberOfThreads, unsigned int );
+  itkGetMacro( NumberOfThreads, unsigned int );
+
+  /** Set/Get the scales of an optional scale-space volume.  The volume is
+   *  generated once from the input image, and the per-thread extractors
+   *  share its images read-only.  An empty list blurs on demand. */
+  void SetScaleSpaceScales( const std::vector< double > & scales );
+  const std::vector< double > & GetScaleSpaceScales( void ) const;
+
+  /** Set/Get the intensity cache settings of every ridge extractor,
+   *  including the per-thread ones */
+  itkSetMacro( UseIntensityCache, bool );
+  itkGetMacro( UseIntensityCache, bool );
+  itkSetMacro( IntensityCacheMaximumNumberOfBlocks, unsigned int );
+  itkGetMacro( IntensityCacheMaximumNumberOfBlocks, unsigned int );
+
   /* Get the list of tubes that have been extracted */
   typename TubeGroupType::Pointer GetTubeGroup( void );
 
@@ -140,11 +166,38 @@ protected:
   virtual ~SegmentTubes( void );
   void PrintSelf( std::ostream & os, Indent indent ) const;
 
+  /** Apply the parameter file, bounds, scale space and cache settings */
+  void InitializeTubeExtractor( TubeExtractorFilterType * tubeExtractor );
+
+  /** Extract tubes from the seed list using several threads */
+  bool ExtractTubesInParallel( unsigned int numberOfThreads );
+
 private:
 
   SegmentTubes( const Self& );
   void operator=( const Self& );
 
+  /** Result of the speculative extraction from one seed */
+  struct SeedResultType
+    {
+    typename TubeType::Pointer  Tube;
+    TubeMaskOverlayType         Overlay;
+    TubeMaskOverlayType         Visited;
+    std::vector< unsigned int > FailureCodeCounts;
+    }; // End struct SeedResultType
+
+  /** Structure for passing information into the static callback method
+   *  used by ExtractTubesInParallel. */
+  struct ExtractTubesThreadStruct
+    {
+    SegmentTubes *                                          Filter;
+    std::vector< typename TubeExtractorFilterType::Pointer > * TubeExtractors;
+    std::vector< SeedResultType > *                         Results;
+    size_t                                                  BatchStart;
+    }; // End struct ExtractTubesThreadStruct
+
+  static ITK_THREAD_RETURN_TYPE ExtractTubesThreaderCallback( void * arg );
+
   typename ImageType::Pointer               m_InputImage;
   typename ImageType::Pointer               m_RadiusInputImage;
   typename TubeExtractorFilterType::Pointer m_TubeExtractorFilter;
@@ -164,6 +217,10 @@ private:
   bool                               m_UseExistingTubes;
   std::string                        m_ParameterFile;
   double                             m_Border;
+  unsigned int                       m_NumberOfThreads;
+  std::vector< double >              m_ScaleSpaceScales;
+  bool                               m_UseIntensityCache;
+  unsigned int                       m_IntensityCacheMaximumNumberOfBlocks;
   typename TubeGroupType::Pointer    m_TubeGroup;
 
 
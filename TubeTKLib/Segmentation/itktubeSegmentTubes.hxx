@@ -54,6 +54,10 @@ SegmentTubes<TInputImage>
 
   m_UseExistingTubes = false;
   m_Border = 5.0;
+  m_NumberOfThreads = 1;
+  m_ScaleSpaceScales.clear();
+  m_UseIntensityCache = true;
+  m_IntensityCacheMaximumNumberOfBlocks = 4096;
   m_TubeGroup = TubeGroupType::New();
 }
 
@@ -132,6 +136,30 @@ SegmentTubes<TInputImage>
   m_UseExistingTubes = true;
 }
 
+/**
+ * Set the scales of the scale-space volume */
+template< class TInputImage >
+void
+SegmentTubes<TInputImage>
+::SetScaleSpaceScales( const std::vector< double > & scales )
+{
+  if( m_ScaleSpaceScales != scales )
+    {
+    m_ScaleSpaceScales = scales;
+    this->Modified();
+    }
+}
+
+/**
+ * Get the scales of the scale-space volume */
+template< class TInputImage >
+const std::vector< double > &
+SegmentTubes<TInputImage>
+::GetScaleSpaceScales( void ) const
+{
+  return m_ScaleSpaceScales;
+}
+
 /**
  * Update */
 template< class TInputImage >
@@ -212,62 +240,50 @@ SegmentTubes<TInputImage>
       }
     }
 
-  if( m_ParameterFile.empty() == false )
-    {
-    TubeExtractorIOType teReader;
-    teReader.SetTubeExtractor( this->m_TubeExtractorFilter );
-    teReader.Read( m_ParameterFile.c_str() );
-    }
-
-  this->m_TubeExtractorFilter->SetDebug( false );
-  this->m_TubeExtractorFilter->GetRidgeOp()->SetDebug( false );
-  this->m_TubeExtractorFilter->GetRadiusOp()->SetDebug( false );
+  this->InitializeTubeExtractor( this->m_TubeExtractorFilter );
 
-  if( m_Border > 0 )
+  unsigned int numberOfThreads = m_NumberOfThreads;
+  if( numberOfThreads == 0 )
     {
-    typename ImageType::IndexType minIndx = this->m_InputImage->
-      GetLargestPossibleRegion().GetIndex();
-    typename ImageType::SizeType size = this->m_InputImage->
-      GetLargestPossibleRegion().GetSize();
-    typename ImageType::IndexType maxIndx = minIndx + size;
-    for( unsigned int i = 0; i < ImageDimension; ++i )
-      {
-      minIndx[i] += m_Border;
-      maxIndx[i] -= m_Border;
-      }
-    this->m_TubeExtractorFilter->SetExtractBoundMin( minIndx );
-    this->m_TubeExtractorFilter->SetExtractBoundMax( maxIndx );
+    numberOfThreads = MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
     }
 
-  typename std::vector< ContinuousIndexType >::iterator seedIndexIter =
-    this->m_SeedIndexList.begin();
-  typename std::vector< ScaleType >::iterator seedRadiusIter =
-    this->m_SeedRadiusList.begin();
-  unsigned int count = 1;
   bool foundOneTube = false;
-  while( seedIndexIter != this->m_SeedIndexList.end() )
+  if( numberOfThreads > 1 && this->m_SeedIndexList.size() > 1 )
     {
-    this->m_TubeExtractorFilter->SetRadius( *seedRadiusIter );
-
-    std::cout << "Extracting from index point " << *seedIndexIter
-      << " at radius " << *seedRadiusIter << std::endl;
-    typename TubeType::Pointer xTube =
-      this->m_TubeExtractorFilter->ExtractTube( *seedIndexIter, count,
-        true );
-    if( !xTube.IsNull() )
-      {
-      this->m_TubeExtractorFilter->AddTube( xTube );
-      std::cout << "  Extracted " << xTube->GetPoints().size() << " points."
-        << std::endl;
-      foundOneTube = true;
-      }
-    else
+    foundOneTube = this->ExtractTubesInParallel( numberOfThreads );
+    }
+  else
+    {
+    typename std::vector< ContinuousIndexType >::iterator seedIndexIter =
+      this->m_SeedIndexList.begin();
+    typename std::vector< ScaleType >::iterator seedRadiusIter =
+      this->m_SeedRadiusList.begin();
+    unsigned int count = 1;
+    while( seedIndexIter != this->m_SeedIndexList.end() )
       {
-      std::cout << " Error: Ridge not found for seed # " << count;
+      this->m_TubeExtractorFilter->SetRadius( *seedRadiusIter );
+
+      std::cout << "Extracting from index point " << *seedIndexIter
+        << " at radius " << *seedRadiusIter << std::endl;
+      typename TubeType::Pointer xTube =
+        this->m_TubeExtractorFilter->ExtractTube( *seedIndexIter, count,
+          true );
+      if( !xTube.IsNull() )
+        {
+        this->m_TubeExtractorFilter->AddTube( xTube );
+        std::cout << "  Extracted " << xTube->GetPoints().size() << " points."
+          << std::endl;
+        foundOneTube = true;
+        }
+      else
+        {
+        std::cout << " Error: Ridge not found for seed # " << count;
+        }
+      ++seedIndexIter;
+      ++seedRadiusIter;
+      ++count;
       }
-    ++seedIndexIter;
-    ++seedRadiusIter;
-    ++count;
     }
   if( !foundOneTube )
     {
@@ -310,6 +326,236 @@ SegmentTubes<TInputImage>
     }
 }
 
+/**
+ * Apply the parameter file, debug state, extraction bounds, scale space
+ * and intensity cache settings */
+template< class TInputImage >
+void
+SegmentTubes<TInputImage>
+::InitializeTubeExtractor( TubeExtractorFilterType * tubeExtractor )
+{
+  if( m_ParameterFile.empty() == false )
+    {
+    TubeExtractorIOType teReader;
+    teReader.SetTubeExtractor( tubeExtractor );
+    teReader.Read( m_ParameterFile.c_str() );
+    }
+
+  tubeExtractor->SetDebug( false );
+  tubeExtractor->GetRidgeOp()->SetDebug( false );
+  tubeExtractor->GetRadiusOp()->SetDebug( false );
+
+  tubeExtractor->GetRidgeOp()->SetUseIntensityCache( m_UseIntensityCache );
+  tubeExtractor->GetRidgeOp()->SetIntensityCacheMaximumNumberOfBlocks(
+    m_IntensityCacheMaximumNumberOfBlocks );
+
+  if( m_Border > 0 )
+    {
+    typename ImageType::IndexType minIndx = this->m_InputImage->
+      GetLargestPossibleRegion().GetIndex();
+    typename ImageType::SizeType size = this->m_InputImage->
+      GetLargestPossibleRegion().GetSize();
+    typename ImageType::IndexType maxIndx = minIndx + size;
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      minIndx[i] += m_Border;
+      maxIndx[i] -= m_Border;
+      }
+    tubeExtractor->SetExtractBoundMin( minIndx );
+    tubeExtractor->SetExtractBoundMax( maxIndx );
+    }
+
+  if( !m_ScaleSpaceScales.empty() )
+    {
+    if( tubeExtractor == this->m_TubeExtractorFilter.GetPointer() )
+      {
+      tubeExtractor->GenerateScaleSpace( m_ScaleSpaceScales );
+      }
+    else
+      {
+      // The scale-space images are only read once generated, so the
+      //   per-thread extractors use those of the primary extractor
+      typename RidgeExtractorFilterType::Pointer ridgeOp =
+        this->m_TubeExtractorFilter->GetRidgeOp();
+      tubeExtractor->SetScaleSpace( ridgeOp->GetScaleSpaceScales(),
+        ridgeOp->GetScaleSpaceImages() );
+      }
+    }
+}
+
+/**
+ * Extract tubes from the seed list using several threads */
+template< class TInputImage >
+bool
+SegmentTubes<TInputImage>
+::ExtractTubesInParallel( unsigned int numberOfThreads )
+{
+  typename TubeMaskImageType::Pointer tubeMask =
+    this->m_TubeExtractorFilter->GetTubeMaskImage();
+  typename RidgeExtractorFilterType::Pointer ridgeOp =
+    this->m_TubeExtractorFilter->GetRidgeOp();
+
+  // Each thread owns its ridge and radius extractors, and all of them
+  //   read the tube mask of the primary extractor.
+  std::vector< typename TubeExtractorFilterType::Pointer > tubeExtractors(
+    numberOfThreads );
+  for( unsigned int t = 0; t < numberOfThreads; ++t )
+    {
+    tubeExtractors[t] = TubeExtractorFilterType::New();
+    tubeExtractors[t]->SetInputImage( this->m_InputImage );
+    if( this->m_RadiusInputImage )
+      {
+      tubeExtractors[t]->SetRadiusInputImage( this->m_RadiusInputImage );
+      }
+    this->InitializeTubeExtractor( tubeExtractors[t] );
+    tubeExtractors[t]->SetTubeMaskImage( tubeMask );
+    tubeExtractors[t]->GetRidgeOp()->SetUseTubeMaskOverlay( true );
+    }
+
+  std::vector< SeedResultType > results( numberOfThreads );
+
+  ExtractTubesThreadStruct str;
+  str.Filter = this;
+  str.TubeExtractors = &tubeExtractors;
+  str.Results = &results;
+
+  MultiThreaderBase::Pointer threader = MultiThreaderBase::New();
+  threader->SetMaximumNumberOfThreads( numberOfThreads );
+  threader->SetNumberOfWorkUnits( numberOfThreads );
+
+  typename TubeMaskImageType::PixelType * maskBuffer =
+    tubeMask->GetBufferPointer();
+
+  bool foundOneTube = false;
+  size_t numberOfSeeds = this->m_SeedIndexList.size();
+  for( size_t batchStart = 0; batchStart < numberOfSeeds;
+    batchStart += numberOfThreads )
+    {
+    str.BatchStart = batchStart;
+    threader->SetSingleMethod( this->ExtractTubesThreaderCallback, &str );
+    threader->SingleMethodExecute();
+
+    // Commit the batch in seed order.  A result is kept only if every
+    //   mask voxel it read still holds the value it saw; otherwise an
+    //   earlier seed of this batch changed its input, and the seed is
+    //   extracted again using the updated mask.
+    for( unsigned int t = 0; t < numberOfThreads
+      && batchStart + t < numberOfSeeds; ++t )
+      {
+      size_t seedNum = batchStart + t;
+      SeedResultType & result = results[t];
+
+      std::cout << "Extracting from index point "
+        << this->m_SeedIndexList[seedNum] << " at radius "
+        << this->m_SeedRadiusList[seedNum] << std::endl;
+
+      bool isValid = true;
+      typename TubeMaskOverlayType::const_iterator iter =
+        result.Visited.begin();
+      while( iter != result.Visited.end() )
+        {
+        if( maskBuffer[ iter->first ] != iter->second )
+          {
+          isValid = false;
+          break;
+          }
+        ++iter;
+        }
+
+      typename TubeType::Pointer xTube;
+      if( isValid )
+        {
+        iter = result.Overlay.begin();
+        while( iter != result.Overlay.end() )
+          {
+          maskBuffer[ iter->first ] = iter->second;
+          ++iter;
+          }
+        for( unsigned int code = 0; code < result.FailureCodeCounts.size();
+          ++code )
+          {
+          ridgeOp->IncrementFailureCodeCount(
+            typename RidgeExtractorFilterType::FailureCodeEnum( code ),
+            result.FailureCodeCounts[code] );
+          }
+        xTube = result.Tube;
+        }
+      else
+        {
+        this->m_TubeExtractorFilter->SetRadius(
+          this->m_SeedRadiusList[seedNum] );
+        xTube = this->m_TubeExtractorFilter->ExtractTube(
+          this->m_SeedIndexList[seedNum], seedNum + 1, true );
+        }
+
+      if( !xTube.IsNull() )
+        {
+        this->m_TubeExtractorFilter->AddTube( xTube );
+        std::cout << "  Extracted " << xTube->GetPoints().size()
+          << " points." << std::endl;
+        foundOneTube = true;
+        }
+      else
+        {
+        std::cout << " Error: Ridge not found for seed # " << seedNum + 1;
+        }
+
+      result.Tube = nullptr;
+      result.Overlay.clear();
+      result.Visited.clear();
+      }
+    }
+  tubeMask->Modified();
+
+  return foundOneTube;
+}
+
+/**
+ * Extract the tubes of one batch of seeds */
+template< class TInputImage >
+ITK_THREAD_RETURN_TYPE
+SegmentTubes<TInputImage>
+::ExtractTubesThreaderCallback( void * arg )
+{
+  unsigned int threadId = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+  unsigned int threadCount = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->NumberOfWorkUnits;
+
+  ExtractTubesThreadStruct * str = ( ExtractTubesThreadStruct * )
+    ( ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  SegmentTubes * filter = str->Filter;
+  size_t numberOfSeeds = filter->m_SeedIndexList.size();
+  for( size_t t = threadId; t < str->Results->size()
+    && str->BatchStart + t < numberOfSeeds; t += threadCount )
+    {
+    size_t seedNum = str->BatchStart + t;
+    typename TubeExtractorFilterType::Pointer tubeExtractor =
+      ( *str->TubeExtractors )[t];
+    typename RidgeExtractorFilterType::Pointer ridgeOp =
+      tubeExtractor->GetRidgeOp();
+    SeedResultType & result = ( *str->Results )[t];
+
+    ridgeOp->ClearTubeMaskOverlay();
+    ridgeOp->ResetFailureCodeCounts();
+    tubeExtractor->SetRadius( filter->m_SeedRadiusList[seedNum] );
+    result.Tube = tubeExtractor->ExtractTube(
+      filter->m_SeedIndexList[seedNum], seedNum + 1 );
+    result.Overlay = ridgeOp->GetTubeMaskOverlay();
+    result.Visited = ridgeOp->GetTubeMaskVisited();
+    result.FailureCodeCounts.resize( ridgeOp->GetNumberOfFailureCodes() );
+    for( unsigned int code = 0; code < result.FailureCodeCounts.size();
+      ++code )
+      {
+      result.FailureCodeCounts[code] = ridgeOp->GetFailureCodeCount(
+        typename RidgeExtractorFilterType::FailureCodeEnum( code ) );
+      }
+    }
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
 /**
  * Get list of extracted tubes */
 template< class TInputImage >
@@ -356,6 +602,15 @@ void SegmentTubes<TInputImage>
     {
     os << indent << "Radius Input Image = NULL" << std::endl;
     }
+
+  os << indent << "Number Of Threads = " << this->m_NumberOfThreads
+    << std::endl;
+  os << indent << "Number Of Scale Space Scales = "
+    << this->m_ScaleSpaceScales.size() << std::endl;
+  os << indent << "Use Intensity Cache = " << this->m_UseIntensityCache
+    << std::endl;
+  os << indent << "Intensity Cache Maximum Number Of Blocks = "
+    << this->m_IntensityCacheMaximumNumberOfBlocks << std::endl;
 }
 
 } // End namespace tube
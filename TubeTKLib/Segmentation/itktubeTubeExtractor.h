@@ -36,6 +36,8 @@ limitations under the License.
 
 #include <itkObject.h>
 
+#include <vector>
+
 namespace itk
 {
 
@@ -163,6 +165,28 @@ public:
    * Get the radius */
   double GetRadius( void );
 
+  typedef typename RidgeOpType::ScaleSpaceImageListType
+                                                    ScaleSpaceImageListType;
+
+  /**
+   * Optionally set a scale-space volume: the input image pre-blurred at a
+   * few increasing scales.  Ridge measures at scales within that range
+   * then interpolate between those images instead of blurring on demand */
+  void SetScaleSpace( const std::vector< double > & scales,
+    const ScaleSpaceImageListType & images );
+
+  /**
+   * Compute the scale-space volume from the input image */
+  void GenerateScaleSpace( const std::vector< double > & scales );
+
+  /**
+   * Use the scale-space volume, when set, or always blur exactly */
+  void SetUseScaleSpace( bool useScaleSpace );
+
+  /**
+   * Is the scale-space volume used, when set */
+  bool GetUseScaleSpace( void ) const;
+
   /**
    * Get the ridge extractor */
   typename RidgeExtractor<ImageType>::Pointer GetRidgeOp( void );
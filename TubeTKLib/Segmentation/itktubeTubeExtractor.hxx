@@ -292,6 +292,67 @@ TubeExtractor<TInputImage>
   return this->m_RidgeOp->GetScale();
 }
 
+/**
+ * Set the scale-space volume */
+template< class TInputImage >
+void
+TubeExtractor<TInputImage>
+::SetScaleSpace( const std::vector< double > & scales,
+  const ScaleSpaceImageListType & images )
+{
+  if( this->m_RidgeOp.IsNull() )
+    {
+    throw( "Input data must be set first in TubeExtractor" );
+    }
+
+  this->m_RidgeOp->SetScaleSpace( scales, images );
+}
+
+/**
+ * Compute the scale-space volume */
+template< class TInputImage >
+void
+TubeExtractor<TInputImage>
+::GenerateScaleSpace( const std::vector< double > & scales )
+{
+  if( this->m_RidgeOp.IsNull() )
+    {
+    throw( "Input data must be set first in TubeExtractor" );
+    }
+
+  this->m_RidgeOp->GenerateScaleSpace( scales );
+}
+
+/**
+ * Set the use of the scale-space volume */
+template< class TInputImage >
+void
+TubeExtractor<TInputImage>
+::SetUseScaleSpace( bool useScaleSpace )
+{
+  if( this->m_RidgeOp.IsNull() )
+    {
+    throw( "Input data must be set first in TubeExtractor" );
+    }
+
+  this->m_RidgeOp->SetUseScaleSpace( useScaleSpace );
+}
+
+/**
+ * Get the use of the scale-space volume */
+template< class TInputImage >
+bool
+TubeExtractor<TInputImage>
+::GetUseScaleSpace( void ) const
+{
+  if( this->m_RidgeOp.IsNull() )
+    {
+    throw( "Input data must be set first in TubeExtractor" );
+    }
+
+  return this->m_RidgeOp->GetUseScaleSpace();
+}
+
 /**
  * Get the ridge extractor */
 template< class TInputImage >
@@ -347,7 +408,7 @@ TubeExtractor<TInputImage>
     {
     xi[i] = x[i];
     }
-  if( this->m_RidgeOp->GetTubeMaskImage()->GetPixel( xi ) != 0 )
+  if( this->m_RidgeOp->GetTubeMaskValue( xi ) != 0 )
     {
     if( this->GetDebug() )
       {
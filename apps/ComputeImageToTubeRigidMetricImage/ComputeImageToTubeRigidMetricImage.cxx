@@ -105,6 +105,15 @@ int DoIt( int argc, char * argv[] )
   costFunction->SetFeatureWeights( pointWeights );
   TransformType::Pointer transform = TransformType::New();
   costFunction->SetTransform( transform );
+  if( derivativeImageBankScales > 0 )
+    {
+    costFunction->SetUseDerivativeImageBank( true );
+    costFunction->SetNumberOfDerivativeImageBankScales(
+      derivativeImageBankScales );
+    }
+  // The parameter grid is evaluated in parallel, by single threaded clones
+  // of the metric.
+  costFunction->SetNumberOfThreads( 1 );
   costFunction->Initialize();
 
   const unsigned int NumberOfParameters = 6;
@@ -113,6 +122,9 @@ int DoIt( int argc, char * argv[] )
   CostFunctionImageSourceType::Pointer costFunctionImageSource =
     CostFunctionImageSourceType::New();
   costFunctionImageSource->SetCostFunction( costFunction );
+  costFunctionImageSource->SetCloneCostFunction( true );
+  costFunctionImageSource->SetComputeDerivative(
+    !outputMetricDerivativeImage.empty() );
 
   typedef CostFunctionImageSourceType::ParametersType ParametersType;
 
@@ -185,6 +197,38 @@ int DoIt( int argc, char * argv[] )
     timeCollector.Report();
     return EXIT_FAILURE;
     }
+
+  if( !outputMetricDerivativeImage.empty() )
+    {
+    typedef itk::Image< itk::Vector< float, NumberOfParameters >,
+      NumberOfParameters > OutputDerivativeImageType;
+    typedef itk::CastImageFilter<
+      CostFunctionImageSourceType::DerivativeImageType,
+      OutputDerivativeImageType > DerivativeCasterType;
+    DerivativeCasterType::Pointer derivativeCaster =
+      DerivativeCasterType::New();
+    derivativeCaster->SetInput(
+      costFunctionImageSource->GetDerivativeOutput() );
+
+    typedef itk::ImageFileWriter< OutputDerivativeImageType >
+      DerivativeWriterType;
+    DerivativeWriterType::Pointer derivativeWriter =
+      DerivativeWriterType::New();
+    derivativeWriter->SetFileName( outputMetricDerivativeImage.c_str() );
+    derivativeWriter->SetInput( derivativeCaster->GetOutput() );
+    try
+      {
+      derivativeWriter->Update();
+      }
+    catch( itk::ExceptionObject & err )
+      {
+      tube::ErrorMessage(
+        "Writing output derivative image: Exception caught: "
+        + std::string( err.GetDescription() ) );
+      timeCollector.Report();
+      return EXIT_FAILURE;
+      }
+    }
   timeCollector.Stop( "Save data" );
 
   progress = 1.0;
@@ -27,6 +27,7 @@ limitations under the License.
 #include <boost/filesystem.hpp>
 
 #include <itkMatrix.h>
+#include <itkMultiThreaderBase.h>
 
 #include "ComputeTubeGraphSimilarityKernelMatrixCLP.h"
 
@@ -273,6 +274,70 @@ tube::GraphKernel::GraphType loadGraph( std::string graphFile,
 }
 
 
+/** Structure for passing information into the kernel matrix callback.
+ *  Each work unit computes the rows i = workUnitId + k * numberOfWorkUnits
+ *  of the kernel matrix. */
+struct KernelMatrixThreadStruct
+  {
+  int                                                   graphKernelType;
+  const std::vector< tube::GraphKernel::GraphType > *   graphsA;
+  const std::vector< tube::GraphKernel::GraphType > *   graphsB;
+  const std::vector< tube::ShortestPathKernel::PathHistogramType > *
+                                                        pathHistogramsA;
+  const std::vector< tube::ShortestPathKernel::PathHistogramType > *
+                                                        pathHistogramsB;
+  const tube::WLSubtreeKernel::LabelMapVectorType *     labelMap;
+  int                                                   labelCount;
+  int                                                   subtreeHeight;
+  vnl_matrix<double> *                                  kernel;
+  };
+
+/** Computes the kernel matrix rows assigned to a work unit.
+ *  Graphs, histograms and the label map are only read, and every row is
+ *  written by exactly one work unit. */
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION KernelMatrixThreaderCallback(
+  void * arg )
+{
+  typedef itk::MultiThreaderBase::WorkUnitInfo WorkUnitInfoType;
+  const WorkUnitInfoType * info = static_cast< WorkUnitInfoType * >( arg );
+  const KernelMatrixThreadStruct * str
+    = static_cast< KernelMatrixThreadStruct * >( info->UserData );
+
+  vnl_matrix<double> & K = *( str->kernel );
+  const int N = K.rows();
+  const int M = K.cols();
+
+  for( int i = info->WorkUnitID; i < N;
+    i += static_cast< int >( info->NumberOfWorkUnits ) )
+    {
+    for( int j = 0; j < M; ++j )
+      {
+      switch( str->graphKernelType )
+        {
+        case GK_SPKernel:
+          {
+          K[i][j] = tube::ShortestPathKernel::ComputeFromPathHistograms(
+            ( *str->pathHistogramsA )[i], ( *str->pathHistogramsB )[j] );
+          break;
+          }
+        case GK_WLKernel:
+          {
+          tube::WLSubtreeKernel gk( ( *str->graphsA )[i],
+                                    ( *str->graphsB )[j],
+                                    *str->labelMap,
+                                    str->labelCount,
+                                    str->subtreeHeight );
+          K[i][j] = gk.Compute();
+          break;
+          }
+        }
+      }
+    }
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+
 int main( int argc, char * argv[] )
 {
   PARSE_ARGS;
@@ -357,49 +422,84 @@ int main( int argc, char * argv[] )
 
 
     /*
-     * Next, we build the kernel matrix K, where the K_ij-th entry
-     * is the WL kernel value between the i-th graph of the first
-     * ( i.e., 'listA' ) list and the j-th graph of the second list
-     * ( i.e., 'listB' ).
+     * Every graph is loaded only once. For the shortest-path kernel, the
+     * Floyd transform of each graph is reduced to its shortest-path
+     * histogram up front, so that a kernel entry only compares two
+     * histograms.
      */
 
+    std::vector< tube::GraphKernel::GraphType > graphsA( N );
+    std::vector< tube::GraphKernel::GraphType > graphsB( M );
+    std::vector< tube::ShortestPathKernel::PathHistogramType >
+      pathHistogramsA;
+    std::vector< tube::ShortestPathKernel::PathHistogramType >
+      pathHistogramsB;
+
     for( int i = 0; i < N; ++i )
       {
-      tube::GraphKernel::GraphType f = loadGraph( listA[i],
-        defLabelType, argGlobalLabelFileName );
+      graphsA[i] = loadGraph( listA[i], defLabelType,
+        argGlobalLabelFileName );
+      }
+    for( int j = 0; j < M; ++j )
+      {
+      graphsB[j] = loadGraph( listB[j], defLabelType,
+        argGlobalLabelFileName );
+      }
+
+    if( argGraphKernelType == GK_SPKernel )
+      {
+      pathHistogramsA.resize( N );
+      for( int i = 0; i < N; ++i )
+        {
+        pathHistogramsA[i] =
+          tube::ShortestPathKernel::ComputePathHistogram( graphsA[i] );
+        }
+      pathHistogramsB.resize( M );
       for( int j = 0; j < M; ++j )
         {
-        tube::GraphKernel::GraphType g = loadGraph( listB[j],
-          defLabelType, argGlobalLabelFileName );
+        pathHistogramsB[j] =
+          tube::ShortestPathKernel::ComputePathHistogram( graphsB[j] );
+        }
+      }
 
-        tube::FmtInfoMessage( "Running kernel on graphs ( %d,%d )",
-          i, j );
+    /*
+     * Next, we build the kernel matrix K, where the K_ij-th entry
+     * is the kernel value between the i-th graph of the first
+     * ( i.e., 'listA' ) list and the j-th graph of the second list
+     * ( i.e., 'listB' ).
+     */
 
-        tube::GraphKernel *gk = 0;
-        switch( argGraphKernelType )
-          {
-          case GK_SPKernel:
-            {
-            gk = new tube::ShortestPathKernel( f, g );
-            K[i][j] = gk->Compute();
-            delete gk;
-            break;
-            }
-          case GK_WLKernel:
-            {
-            gk = new tube::WLSubtreeKernel( f,
-                                            g,
-                                            labelMap,
-                                            labelCount,
-                                            argSubtreeHeight );
-
-            K[i][j] = gk->Compute();
-            delete gk;
-            break;
-            }
-          }
-        }
+    unsigned int numberOfThreads = argNumberOfThreads;
+    if( numberOfThreads == 0 )
+      {
+      numberOfThreads =
+        itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
       }
+    if( numberOfThreads > static_cast< unsigned int >( N ) )
+      {
+      numberOfThreads = N;
+      }
+
+    tube::FmtInfoMessage( "Computing %d x %d kernel matrix using %u threads",
+      N, M, numberOfThreads );
+
+    KernelMatrixThreadStruct str;
+    str.graphKernelType = argGraphKernelType;
+    str.graphsA = &graphsA;
+    str.graphsB = &graphsB;
+    str.pathHistogramsA = &pathHistogramsA;
+    str.pathHistogramsB = &pathHistogramsB;
+    str.labelMap = &labelMap;
+    str.labelCount = labelCount;
+    str.subtreeHeight = argSubtreeHeight;
+    str.kernel = &K;
+
+    itk::MultiThreaderBase::Pointer threader =
+      itk::MultiThreaderBase::New();
+    threader->SetMaximumNumberOfThreads( numberOfThreads );
+    threader->SetNumberOfWorkUnits( numberOfThreads );
+    threader->SetSingleMethod( KernelMatrixThreaderCallback, &str );
+    threader->SingleMethodExecute();
 
     /*
      * Eventually, dump the kernel to disk - 1 ) in LIBSVM comp.
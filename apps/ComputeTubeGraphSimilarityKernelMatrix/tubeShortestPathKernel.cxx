@@ -25,6 +25,9 @@ limitations under the License.
 
 #include <vnl/vnl_math.h>
 
+#include <cmath>
+#include <limits>
+
 namespace tube
 {
 
@@ -84,83 +87,119 @@ ShortestPathKernel::FloydTransform( const GraphType &in )
 
 
 //-----------------------------------------------------------------------------
-double ShortestPathKernel::Compute( void )
+bool ShortestPathKernel::PathHistogramBinType::operator<(
+  const PathHistogramBinType & rhs ) const
 {
-  double kernelValue = 0.0;
-  long int cntEdgeEvaluations = 0;
-  EdgeIteratorType aIt, aEnd;
+  if( srcLabel != rhs.srcLabel )
+    {
+    return srcLabel < rhs.srcLabel;
+    }
+  if( dstLabel != rhs.dstLabel )
+    {
+    return dstLabel < rhs.dstLabel;
+    }
+  return length < rhs.length;
+}
+
 
+//-----------------------------------------------------------------------------
+ShortestPathKernel::PathHistogramType
+ShortestPathKernel::ComputePathHistogram( const GraphType & g )
+{
   tube::FmtDebugMessage( "Computing Floyd transform." );
-  m_FG0 = FloydTransform( m_G0 );
-  m_FG1 = FloydTransform( m_G1 );
+  GraphType fg = FloydTransform( g );
 
+  EdgeWeightMapType wmFG = boost::get( boost::edge_weight, fg );
 
-  // Get the weight maps for both Floyd-transformed graphs
-  EdgeWeightMapType wmFG0 = boost::get( boost::edge_weight, m_FG0 );
-  EdgeWeightMapType wmFG1 = boost::get( boost::edge_weight, m_FG1 );
+  PathHistogramType paths;
+  paths.reserve( num_edges( fg ) );
 
-  // Iterate over all the edges of Floyd-transformed graph fg0
-  for( tie( aIt, aEnd ) = edges( m_FG0 ); aIt != aEnd; ++aIt )
+  EdgeIteratorType aIt, aEnd;
+  for( tie( aIt, aEnd ) = edges( fg ); aIt != aEnd; ++aIt )
     {
-    const EdgeDescriptorType &e0 = *aIt;
+    PathHistogramBinType bin;
+    bin.srcLabel = fg[source( *aIt, fg )].type;
+    bin.dstLabel = fg[target( *aIt, fg )].type;
+    ensureOrder( bin.srcLabel, bin.dstLabel );
+    bin.length = wmFG[*aIt];
+    bin.count = 1;
+    paths.push_back( bin );
+    }
 
-    int srcLabel = m_FG0[source( e0, m_FG0 )].type; // Type of start vertex
-    int dstLabel = m_FG0[target( e0, m_FG0 )].type; // Type of end vertex
-    ensureOrder( srcLabel, dstLabel );
+  std::sort( paths.begin(), paths.end() );
 
-    // Iterate over all the edges of Floyd-transformed graph fg1
-    EdgeIteratorType bIt, bEnd;
-    for( tie( bIt, bEnd ) = edges( m_FG1 ); bIt != bEnd; ++bIt )
+  // Merge paths with identical labels and length
+  PathHistogramType histogram;
+  for( PathHistogramType::const_iterator it = paths.begin();
+    it != paths.end(); ++it )
+    {
+    if( !histogram.empty()
+      && !( histogram.back() < *it ) )
       {
-      cntEdgeEvaluations++;
-      const EdgeDescriptorType &e1 = *bIt;
-
-      // We only consider walks of equal length --- At this point we
-      // only support weights of 1, since this gives integer lengths
-      // of the shortest paths and makes it easy to check for equality.
-      //
-      // We could also use a Brownian bridge kernel to bound the max.
-      // shortest-path length, e.g., max( 0,c - |len( e )-len( e' )| )
-
-      double weightE0 = wmFG0[*aIt];
-      double weightE1 = wmFG1[*bIt];
-
-      // Skip edges, unless the weights are equal
-      if( !( std::fabs( weightE0 - weightE1 ) <
-          std::numeric_limits<double>::epsilon() ) )
-        {
-        continue;
-        }
+      ++histogram.back().count;
+      }
+    else
+      {
+      histogram.push_back( *it );
+      }
+    }
+
+  return histogram;
+}
+
+
+//-----------------------------------------------------------------------------
+double ShortestPathKernel::ComputeFromPathHistograms(
+  const PathHistogramType & h0, const PathHistogramType & h1 )
+{
+  const double eps = std::numeric_limits<double>::epsilon();
 
-      double edgeKernelValue = 0.0;
-      switch( m_EdgeKernelType )
+  double kernelValue = 0.0;
+  long int cntBinEvaluations = 0;
+
+  for( PathHistogramType::const_iterator aIt = h0.begin();
+    aIt != h0.end(); ++aIt )
+    {
+    // Paths are compared as in Compute( void ): their lengths must differ
+    // by less than eps.  Start a little before that window and test each
+    // candidate exactly.
+    PathHistogramBinType first = *aIt;
+    first.length = aIt->length - 2 * eps;
+
+    for( PathHistogramType::const_iterator bIt
+      = std::lower_bound( h1.begin(), h1.end(), first );
+      bIt != h1.end()
+      && bIt->srcLabel == aIt->srcLabel
+      && bIt->dstLabel == aIt->dstLabel
+      && bIt->length <= aIt->length + 2 * eps; ++bIt )
+      {
+      cntBinEvaluations++;
+      if( std::fabs( aIt->length - bIt->length ) < eps )
         {
-        case EDGE_KERNEL_DEL:
-          int cmpSrcLabel = m_FG1[source( e1, m_FG1 )].type;
-          int cmpDstLabel = m_FG1[target( e1, m_FG1 )].type;
-          ensureOrder( cmpSrcLabel, cmpDstLabel );
-
-          bool vertexTypeCheck =
-            ( srcLabel == cmpSrcLabel ) &&
-            ( dstLabel == cmpDstLabel );
-          if( !vertexTypeCheck )
-            {
-            continue;
-            }
-          else
-            {
-            edgeKernelValue = 1.0;
-            }
-          break;
+        kernelValue += static_cast< double >( aIt->count )
+          * static_cast< double >( bIt->count );
         }
-      kernelValue += edgeKernelValue;
       }
     }
 
-  tube::FmtInfoMessage( "Performed %ld edge evaluations",
-    cntEdgeEvaluations );
+  tube::FmtDebugMessage( "Performed %ld histogram bin evaluations",
+    cntBinEvaluations );
   return kernelValue;
 }
 
 
+//-----------------------------------------------------------------------------
+double ShortestPathKernel::Compute( void )
+{
+  // Only the Dirac edge kernel is supported
+  if( m_EdgeKernelType != EDGE_KERNEL_DEL )
+    {
+    return 0.0;
+    }
+
+  return ComputeFromPathHistograms( ComputePathHistogram( m_G0 ),
+    ComputePathHistogram( m_G1 ) );
+}
+
+
 } // End namespace tube
@@ -24,6 +24,7 @@ limitations under the License.
 #include "../CLI/tubeCLIProgressReporter.h"
 #include "tubeMessage.h"
 
+#include "itktubeTubeBinaryIO.h"
 #include "itktubeTubeXIO.h"
 
 #include "itkGroupSpatialObject.h"
@@ -40,8 +41,10 @@ int main( int argc, char * argv[] )
   PARSE_ARGS;
 
   typedef itk::tube::TubeXIO< 3 >       TubeXIOType;
+  typedef itk::tube::TubeBinaryIO< 3 >  TubeBinaryIOType;
   typedef itk::SpatialObjectReader< 3 > SOReaderType;
   typedef itk::SpatialObjectWriter< 3 > SOWriterType;
+  typedef TubeXIOType::TubeGroupType    TubeGroupType;
 
   // The image type does not matter. We're only interested in the image size.
   typedef itk::Image< float, 3 >            ImageType;
@@ -62,16 +65,32 @@ int main( int argc, char * argv[] )
   if( !reverse )
     {
     timeCollector.Start( "Load data" );
-    TubeXIOType::Pointer reader = TubeXIOType::New();
-    try
+    TubeGroupType::Pointer tubeGroup;
+    if( TubeBinaryIOType::CanReadFile( inputTREFileName ) )
       {
-      reader->Read( inputTREFileName.c_str() );
+      TubeBinaryIOType::Pointer reader = TubeBinaryIOType::New();
+      if( !reader->Read( inputTREFileName ) )
+        {
+        tube::ErrorMessage( "Error reading binary tube file. " );
+        timeCollector.Report();
+        return EXIT_FAILURE;
+        }
+      tubeGroup = reader->GetTubeGroup();
       }
-    catch( ... )
+    else
       {
-      tube::ErrorMessage( "Error reading TubeX file. " );
-      timeCollector.Report();
-      return EXIT_FAILURE;
+      TubeXIOType::Pointer reader = TubeXIOType::New();
+      try
+        {
+        reader->Read( inputTREFileName.c_str() );
+        }
+      catch( ... )
+        {
+        tube::ErrorMessage( "Error reading TubeX file. " );
+        timeCollector.Report();
+        return EXIT_FAILURE;
+        }
+      tubeGroup = reader->GetTubeGroup();
       }
     timeCollector.Stop( "Load data" );
 
@@ -79,18 +98,32 @@ int main( int argc, char * argv[] )
     progressReporter.Report( progress );
 
     timeCollector.Start( "Save data" );
-    SOWriterType::Pointer writer = SOWriterType::New();
-    writer->SetFileName( outputTREFileName.c_str() );
-    writer->SetInput( reader->GetTubeGroup() );
-    try
+    if( binary )
       {
-      writer->Update();
+      TubeBinaryIOType::Pointer writer = TubeBinaryIOType::New();
+      writer->SetTubeGroup( tubeGroup );
+      if( !writer->Write( outputTREFileName ) )
+        {
+        tube::ErrorMessage( "Error writing binary tube file." );
+        timeCollector.Report();
+        return EXIT_FAILURE;
+        }
       }
-    catch( ... )
+    else
       {
-      tube::ErrorMessage( "Error writing spatial objects file." );
-      timeCollector.Report();
-      return EXIT_FAILURE;
+      SOWriterType::Pointer writer = SOWriterType::New();
+      writer->SetFileName( outputTREFileName.c_str() );
+      writer->SetInput( tubeGroup );
+      try
+        {
+        writer->Update();
+        }
+      catch( ... )
+        {
+        tube::ErrorMessage( "Error writing spatial objects file." );
+        timeCollector.Report();
+        return EXIT_FAILURE;
+        }
       }
     timeCollector.Stop( "Save data" );
 
@@ -104,17 +137,33 @@ int main( int argc, char * argv[] )
   else
     {
     timeCollector.Start( "Load data" );
-    SOReaderType::Pointer reader = SOReaderType::New();
-    reader->SetFileName( inputTREFileName.c_str() );
-    try
+    TubeGroupType::Pointer tubeGroup;
+    if( TubeBinaryIOType::CanReadFile( inputTREFileName ) )
       {
-      reader->Update();
+      TubeBinaryIOType::Pointer reader = TubeBinaryIOType::New();
+      if( !reader->Read( inputTREFileName ) )
+        {
+        tube::ErrorMessage( "Error reading binary tube file." );
+        timeCollector.Report();
+        return EXIT_FAILURE;
+        }
+      tubeGroup = reader->GetTubeGroup();
       }
-    catch( ... )
+    else
       {
-      tube::ErrorMessage( "Error reading spatial objects file." );
-      timeCollector.Report();
-      return EXIT_FAILURE;
+      SOReaderType::Pointer reader = SOReaderType::New();
+      reader->SetFileName( inputTREFileName.c_str() );
+      try
+        {
+        reader->Update();
+        }
+      catch( ... )
+        {
+        tube::ErrorMessage( "Error reading spatial objects file." );
+        timeCollector.Report();
+        return EXIT_FAILURE;
+        }
+      tubeGroup = reader->GetGroup();
       }
 
     ImageReaderType::Pointer inputImageReader = ImageReaderType::New();
@@ -137,8 +186,28 @@ int main( int argc, char * argv[] )
     progressReporter.Report( progress );
 
     timeCollector.Start( "Save data" );
+    if( binary )
+      {
+      TubeBinaryIOType::Pointer writer = TubeBinaryIOType::New();
+      writer->SetTubeGroup( tubeGroup );
+      if( !writer->Write( outputTREFileName ) )
+        {
+        tube::ErrorMessage( "Error writing binary tube file." );
+        timeCollector.Report();
+        return EXIT_FAILURE;
+        }
+      timeCollector.Stop( "Save data" );
+
+      progress = 1.0;
+      progressReporter.Report( progress );
+      progressReporter.End();
+
+      timeCollector.Report();
+      return EXIT_SUCCESS;
+      }
+
     TubeXIOType::Pointer writer = TubeXIOType::New();
-    writer->SetTubeGroup( reader->GetGroup() );
+    writer->SetTubeGroup( tubeGroup );
 
     SizeType size;
     size.Fill( 1 );
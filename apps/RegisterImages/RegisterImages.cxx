@@ -296,6 +296,31 @@ int DoIt( int argc, char * argv[] )
     std::cout << "###sampleFromOverlap: " << sampleFromOverlap << std::endl;
     }
 
+  if( fixedImageSampling != "PerStage" )
+    {
+    reger->SetUseFixedImageSampleSet( true );
+    if( fixedImageSampling == "Stratified" )
+      {
+      reger->SetFixedImageSamplingStrategyEnum( RegistrationType
+        ::FixedImageSampleSetType::STRATIFIED_SAMPLING );
+      }
+    else if( fixedImageSampling == "EdgeWeighted" )
+      {
+      reger->SetFixedImageSamplingStrategyEnum( RegistrationType
+        ::FixedImageSampleSetType::EDGE_WEIGHTED_SAMPLING );
+      }
+    else
+      {
+      reger->SetFixedImageSamplingStrategyEnum( RegistrationType
+        ::FixedImageSampleSetType::REGULAR_SAMPLING );
+      }
+    }
+  if( verbosity >= STANDARD )
+    {
+    std::cout << "###fixedImageSampling: " << fixedImageSampling
+      << std::endl;
+    }
+
   typedef typename itk::ImageFileReader<
     itk::Image< unsigned char, TDimension > > ImageReader;
   typedef typename itk::ImageMaskSpatialObject< TDimension >
@@ -23,13 +23,13 @@ limitations under the License.
 
 #include "itktubeAnisotropicDiffusiveRegistrationFilter.h"
 #include "itktubeAnisotropicDiffusiveSparseRegistrationFilter.h"
+#include "itktubeMultiResolutionDiffusiveRegistrationFilter.h"
 #include "../CLI/tubeCLIFilterWatcher.h"
 #include "../CLI/tubeCLIProgressReporter.h"
 #include "tubeMessage.h"
 
 #include <itkImageFileReader.h>
 #include <itkImageFileWriter.h>
-#include <itkMultiResolutionPDEDeformableRegistration.h>
 #include <itkOrientImageFilter.h>
 #include <itkSpatialObjectReader.h>
 #include <itkTimeProbesCollectorBase.h>
@@ -702,6 +702,7 @@ int DoIt( int argc, char * argv[] )
     {
     sparseAnisotropicRegistrator->SetLambda( lambda );
     sparseAnisotropicRegistrator->SetGamma( gamma );
+    sparseAnisotropicRegistrator->SetNarrowBandWidth( narrowBandWidth );
     }
   registrator->SetMaximumRMSError( maximumRMSError );
   registrator->SetRegularizationWeightings( regularizationWeightings );
@@ -711,48 +712,20 @@ int DoIt( int argc, char * argv[] )
   registrator->SetStoppingCriterionMaxTotalEnergyChange(
     maximumTotalEnergyChange );
 
-  // Setup the multiresolution PDE filter - we use the recursive pyramid because
-  // we don't want the deformation field to undergo Gaussian smoothing on the
-  // last iteration, which undermines the efforts we are making with anisotropic
-  // diffusion
-
-  // Setup the levels, iterations and max error of Gaussian kernel
+  // Setup the levels and iterations
   int numberOfLevels = numberOfIterations.size();
   unsigned int * iterations = new unsigned int [ numberOfLevels ];
   std::copy( numberOfIterations.begin(), numberOfIterations.end(), iterations );
-  // This is the maximum error for the multiresolution pyramid smoother, not
-  // the registration filter
-  double maximumError = 0.01;
-
-  // Setup the multiresolution pyramids
-  typedef TPixel MultiResolutionRealType;
-  typedef itk::Image< MultiResolutionRealType, ImageDimension >
-      MultiResolutionRealImageType;
-  typedef itk::RecursiveMultiResolutionPyramidImageFilter
-      < FixedImageType, MultiResolutionRealImageType > FixedImagePyramidType;
-  typename FixedImagePyramidType::Pointer fixedImagePyramid =
-      FixedImagePyramidType::New();
-  fixedImagePyramid->SetNumberOfLevels( numberOfLevels );
-  fixedImagePyramid->SetMaximumError( maximumError );
-  fixedImagePyramid->UseShrinkImageFilterOff();
-
-  typedef itk::RecursiveMultiResolutionPyramidImageFilter
-      < MovingImageType, MultiResolutionRealImageType > MovingImagePyramidType;
-  typename MovingImagePyramidType::Pointer movingImagePyramid
-      = MovingImagePyramidType::New();
-  movingImagePyramid->SetNumberOfLevels( numberOfLevels );
-  movingImagePyramid->SetMaximumError( maximumError );
-  movingImagePyramid->UseShrinkImageFilterOff();
-
-  // Setup the diffusion filter to work with multiresolution registration
-  registrator->SetHighResolutionTemplate( orientFixed->GetOutput() );
-
-  // Setup the multiresolution registrator
-  typedef itk::MultiResolutionPDEDeformableRegistration
+
+  // Setup the multiresolution registrator.  It downsamples the fixed and
+  // moving images once, without Gaussian smoothing the deformation field on
+  // the last level, and provides the high resolution template to the
+  // diffusion filter.
+  typedef itk::tube::MultiResolutionDiffusiveRegistrationFilter
       < FixedImageType,
       MovingImageType,
       VectorImageType,
-      MultiResolutionRealType > MultiResolutionRegistrationFilterType;
+      TPixel > MultiResolutionRegistrationFilterType;
   typename MultiResolutionRegistrationFilterType::Pointer multires
       = MultiResolutionRegistrationFilterType::New();
   multires->SetRegistrationFilter( registrator );
@@ -760,8 +733,6 @@ int DoIt( int argc, char * argv[] )
   multires->SetMovingImage( orientMoving->GetOutput() );
   multires->SetArbitraryInitialDisplacementField(
     orientInitField->GetOutput() );
-  multires->SetFixedImagePyramid( fixedImagePyramid );
-  multires->SetMovingImagePyramid( movingImagePyramid );
   multires->SetNumberOfLevels( numberOfLevels );
   multires->SetNumberOfIterations( iterations );
 
@@ -867,6 +838,20 @@ int DoIt( int argc, char * argv[] )
     timeCollector.Stop( "Write resampled moving image" );
     }
 
+  // The narrow band mode does not store the normal and weight images
+  if( sparseAnisotropicRegistrator
+      && sparseAnisotropicRegistrator->GetUseNarrowBand()
+      && ( outputNormalVectorImageFileName != ""
+        || outputWeightRegularizationsImageFileName != ""
+        || outputWeightStructuresImageFileName != "" ) )
+    {
+    tube::WarningMessage( "Normal and weight images are not written when "
+      "using a narrow band" );
+    outputNormalVectorImageFileName = "";
+    outputWeightRegularizationsImageFileName = "";
+    outputWeightStructuresImageFileName = "";
+    }
+
   // Write the normal vector image ( in the space of the fixed image ) if we are
   // using the anisotropic regularization
   if( haveAnisotropicRegistrator && outputNormalVectorImageFileName != "" )
@@ -272,7 +272,12 @@ int DoIt( int argc, char * argv[] )
   writer->SetInput( pdfSegmenter->GetLabelMap() );
   writer->Update();
 
-  if( saveClassPDFBase.size() > 0 )
+  if( saveClassPDFBase.size() > 0 && pdfSegmenter->GetUsingSparseHistogram() )
+    {
+    std::cerr << "Class PDF images are not available for sparse histograms."
+      << std::endl;
+    }
+  else if( saveClassPDFBase.size() > 0 )
     {
     unsigned int numClasses = pdfSegmenter->GetNumberOfClasses();
     for( unsigned int i = 0; i < numClasses; i++ )
@@ -286,6 +286,8 @@ int DoIt( int argc, char * argv[] )
 
   segmentTubesFilter->SetBorder( border );
 
+  segmentTubesFilter->SetNumberOfThreads( numberOfThreads );
+
   timeCollector.Start( "Ridge Extractor" );
 
   segmentTubesFilter->Update();
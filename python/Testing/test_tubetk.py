@@ -62,6 +62,44 @@ def VesselTubeToNumPyTest(tubes, baseline_array):
 
     return all_fields_close
 
+def VesselTubeColumnsToNumPyTest(tubes, output_tubes):
+    import numpy as np
+    from tubetk.numpy import tube_columns_from_file, tubes_to_file
+
+    print( 'Reading file: '+tubes )
+    columns = tube_columns_from_file(tubes)
+    number_of_points = columns['NumberOfPoints'].sum()
+    print(columns['TubeId'])
+    print(columns['Position'])
+
+    success = True
+    if columns['Position'].shape != (number_of_points, 3):
+        print('The Position column has the wrong shape!')
+        success = False
+    if columns['Radius'].base is None:
+        print('The Radius column is not a view of the tube columns!')
+        success = False
+
+    # Modify every radius in place, and write the tubes back.
+    radius = columns['Radius'].copy()
+    columns['Radius'] *= 2
+    print('Writing file: '+output_tubes)
+    tubes_to_file(columns, output_tubes, 1)
+
+    # Binary tube files are mapped read-only.
+    output_columns = tube_columns_from_file(output_tubes)
+    if output_columns['Radius'].flags.writeable:
+        print('The mapped Radius column is writable!')
+        success = False
+    if not np.allclose(output_columns['Radius'], 2 * radius):
+        print('The written radii do not match!')
+        success = False
+    if not np.allclose(output_columns['Position'], columns['Position']):
+        print('The written positions do not match!')
+        success = False
+
+    return success
+
 if __name__ == '__main__':
     usage = 'Usage: ' + sys.argv[0] + \
             ' <TestName> [TestArg1 TestArg2 ...  TestArgN]'
@@ -29,9 +29,11 @@ limitations under the License.
 #include <numpy/arrayobject.h>
 
 #include "itktubeExtractTubePointsSpatialObjectFilter.h"
+#include "itktubeTubeBinaryIO.h"
 
 #include <itkGroupSpatialObject.h>
 #include <itkSpatialObjectReader.h>
+#include <itkSpatialObjectWriter.h>
 #include <itkVesselTubeSpatialObject.h>
 
 
@@ -333,9 +335,315 @@ extern "C"
     }
 
 
+  // The tube columns share the columnar layout of the binary tube files.
+  // They are owned by a capsule that is the base of every column view.
+  typedef itk::tube::TubeBinaryIO< 3 > TubeColumnsType;
+
+  static const char * TubeColumnsCapsuleName = "tubetk.TubeColumns";
+
+  static void tubetk_numpy_tube_columns_destructor( PyObject * capsule )
+    {
+    TubeColumnsType * columns = static_cast< TubeColumnsType * >(
+      PyCapsule_GetPointer( capsule, TubeColumnsCapsuleName ) );
+    if( columns != NULL )
+      {
+      columns->UnRegister();
+      }
+    }
+
+
+  // Return a view of one or more consecutive columns.  Vector columns,
+  // e.g. the position, are returned as a numberOfPoints x
+  // numberOfComponents array.
+  static PyObject * tubetk_numpy_column_view( PyObject * capsule,
+    TubeColumnsType * columns, unsigned int column,
+    unsigned int numberOfComponents )
+    {
+    npy_intp dims[2];
+    npy_intp strides[2];
+    dims[0] = columns->GetNumberOfPoints();
+    dims[1] = numberOfComponents;
+    strides[0] = sizeof( double );
+    strides[1] = dims[0] * sizeof( double );
+    int nd = ( numberOfComponents > 1 ) ? 2 : 1;
+
+    double * data = columns->GetMutableColumn( column );
+    int flags = NPY_ARRAY_WRITEABLE;
+    if( data == NULL )
+      {
+      // The columns refer to a mapped file.
+      data = const_cast< double * >( columns->GetColumn( column ) );
+      flags = 0;
+      }
+    if( data == NULL )
+      {
+      return PyArray_ZEROS( nd, dims, NPY_DOUBLE, 0 );
+      }
+
+    PyObject * array = PyArray_New( &PyArray_Type, nd, dims, NPY_DOUBLE,
+      strides, data, sizeof( double ), flags, NULL );
+    if( array == NULL )
+      {
+      return NULL;
+      }
+    Py_INCREF( capsule );
+    if( PyArray_SetBaseObject( ( PyArrayObject * )array, capsule ) != 0 )
+      {
+      Py_DECREF( array );
+      return NULL;
+      }
+    return array;
+    }
+
+
+  static PyObject * tubetk_numpy_tube_columns_from_file(
+    PyObject * itkNotUsed( self ), PyObject * args )
+    {
+    const char * inputTubeTree;
+    int writable = 0;
+    if( !PyArg_ParseTuple( args, "s|i", &inputTubeTree, &writable ) )
+      {
+      return NULL;
+      }
+
+    TubeColumnsType::Pointer columns = TubeColumnsType::New();
+    if( TubeColumnsType::CanReadFile( inputTubeTree ) )
+      {
+      // Binary tube files are mapped, unless the columns must be writable.
+      if( !writable )
+        {
+        if( !columns->Open( inputTubeTree ) )
+          {
+          PyErr_SetString( PyExc_IOError,
+            "Could not open the binary tube file." );
+          return NULL;
+          }
+        }
+      else
+        {
+        if( !columns->Read( inputTubeTree ) )
+          {
+          PyErr_SetString( PyExc_IOError,
+            "Could not read the binary tube file." );
+          return NULL;
+          }
+        columns->GenerateColumns();
+        }
+      }
+    else
+      {
+      typedef itk::SpatialObjectReader< 3 >  ReaderType;
+      ReaderType::Pointer reader = ReaderType::New();
+      reader->SetFileName( inputTubeTree );
+      try
+        {
+        reader->Update();
+        }
+      catch( itk::ExceptionObject & error )
+        {
+        PyErr_SetString( PyExc_RuntimeError, error.what() );
+        return NULL;
+        }
+      columns->SetTubeGroup( reader->GetGroup() );
+      columns->GenerateColumns();
+      }
+
+    const char * columnNames[] = { "Position", "Radius", "Tangent",
+      "Normal1", "Normal2", "Medialness", "Ridgeness", "Branchness",
+      "Alpha1", "Alpha2", "Alpha3", "PointId" };
+    const unsigned int numberOfColumnNames = 12;
+
+    const unsigned int numberOfTubes = columns->GetNumberOfTubes();
+    npy_intp dims[1];
+    dims[0] = numberOfTubes;
+
+    PyObject * capsule = NULL;
+    PyObject * result = NULL;
+    PyObject * item = NULL;
+    unsigned int column = 0;
+
+    columns->Register();
+    capsule = PyCapsule_New( columns.GetPointer(), TubeColumnsCapsuleName,
+      tubetk_numpy_tube_columns_destructor );
+    if( capsule == NULL )
+      {
+      columns->UnRegister();
+      return NULL;
+      }
+
+    result = PyDict_New();
+    if( result == NULL )
+      {
+      goto fail;
+      }
+
+    for( unsigned int i = 0; i < numberOfColumnNames; ++i )
+      {
+      unsigned int numberOfComponents = 1;
+      if( column == TubeColumnsType::PositionColumn
+        || column == TubeColumnsType::TangentColumn
+        || column == TubeColumnsType::Normal1Column
+        || column == TubeColumnsType::Normal2Column )
+        {
+        numberOfComponents = 3;
+        }
+      item = tubetk_numpy_column_view( capsule, columns, column,
+        numberOfComponents );
+      if( item == NULL
+        || PyDict_SetItemString( result, columnNames[i], item ) != 0 )
+        {
+        goto fail;
+        }
+      Py_DECREF( item );
+      item = NULL;
+      column += numberOfComponents;
+      }
+
+    // The tube index is small, and is copied.
+    item = PyArray_SimpleNew( 1, dims, NPY_INT );
+    if( item == NULL )
+      {
+      goto fail;
+      }
+    for( unsigned int t = 0; t < numberOfTubes; ++t )
+      {
+      *( int * )PyArray_GETPTR1( ( PyArrayObject * )item, t ) =
+        columns->GetTubeId( t );
+      }
+    if( PyDict_SetItemString( result, "TubeId", item ) != 0 )
+      {
+      goto fail;
+      }
+    Py_DECREF( item );
+
+    item = PyArray_SimpleNew( 1, dims, NPY_INTP );
+    if( item == NULL )
+      {
+      goto fail;
+      }
+    for( unsigned int t = 0; t < numberOfTubes; ++t )
+      {
+      *( npy_intp * )PyArray_GETPTR1( ( PyArrayObject * )item, t ) =
+        columns->GetTubeFirstPoint( t );
+      }
+    if( PyDict_SetItemString( result, "FirstPoint", item ) != 0 )
+      {
+      goto fail;
+      }
+    Py_DECREF( item );
+
+    item = PyArray_SimpleNew( 1, dims, NPY_INTP );
+    if( item == NULL )
+      {
+      goto fail;
+      }
+    for( unsigned int t = 0; t < numberOfTubes; ++t )
+      {
+      *( npy_intp * )PyArray_GETPTR1( ( PyArrayObject * )item, t ) =
+        columns->GetTubeNumberOfPoints( t );
+      }
+    if( PyDict_SetItemString( result, "NumberOfPoints", item ) != 0 )
+      {
+      goto fail;
+      }
+    Py_DECREF( item );
+    item = NULL;
+
+    if( PyDict_SetItemString( result, "_columns", capsule ) != 0 )
+      {
+      goto fail;
+      }
+    Py_DECREF( capsule );
+
+    return result;
+
+    fail:
+      Py_XDECREF( item );
+      Py_XDECREF( result );
+      Py_XDECREF( capsule );
+      return NULL;
+    }
+
+
+  static PyObject * tubetk_numpy_tubes_to_file(
+    PyObject * itkNotUsed( self ), PyObject * args )
+    {
+    PyObject * tubeColumns;
+    const char * outputTubeTree;
+    int binary = 0;
+    if( !PyArg_ParseTuple( args, "Os|i", &tubeColumns, &outputTubeTree,
+      &binary ) )
+      {
+      return NULL;
+      }
+
+    PyObject * capsule = tubeColumns;
+    if( PyDict_Check( tubeColumns ) )
+      {
+      capsule = PyDict_GetItemString( tubeColumns, "_columns" );
+      }
+    if( capsule == NULL
+      || !PyCapsule_IsValid( capsule, TubeColumnsCapsuleName ) )
+      {
+      PyErr_SetString( PyExc_TypeError,
+        "Expected tube columns from tube_columns_from_file." );
+      return NULL;
+      }
+    TubeColumnsType * columns = static_cast< TubeColumnsType * >(
+      PyCapsule_GetPointer( capsule, TubeColumnsCapsuleName ) );
+
+    // Rebuild the tubes from the, possibly modified, columns.
+    const unsigned int Dimension = 3;
+    typedef itk::GroupSpatialObject< Dimension >  GroupSpatialObjectType;
+    GroupSpatialObjectType::Pointer group = GroupSpatialObjectType::New();
+    for( unsigned int t = 0; t < columns->GetNumberOfTubes(); ++t )
+      {
+      group->AddSpatialObject( columns->GetTube( t ) );
+      }
+
+    if( binary )
+      {
+      TubeColumnsType::Pointer writer = TubeColumnsType::New();
+      writer->SetTubeGroup( group );
+      if( !writer->Write( outputTubeTree ) )
+        {
+        PyErr_SetString( PyExc_IOError,
+          "Could not write the binary tube file." );
+        return NULL;
+        }
+      }
+    else
+      {
+      typedef itk::SpatialObjectWriter< Dimension >  WriterType;
+      WriterType::Pointer writer = WriterType::New();
+      writer->SetFileName( outputTubeTree );
+      writer->SetInput( group );
+      try
+        {
+        writer->Update();
+        }
+      catch( itk::ExceptionObject & error )
+        {
+        PyErr_SetString( PyExc_RuntimeError, error.what() );
+        return NULL;
+        }
+      }
+
+    Py_RETURN_NONE;
+    }
+
+
   static PyMethodDef _tubetk_numpyMethods[] = {
     { "tubes_from_file", tubetk_numpy_tubes_from_file, METH_VARARGS,
     "Read tube points from the file and return a NumPy array." },
+    { "tube_columns_from_file", tubetk_numpy_tube_columns_from_file,
+    METH_VARARGS,
+    "Read tubes from the file and return a dict of NumPy views of their "
+    "point columns.  Binary tube files are memory-mapped, and their "
+    "views are read-only, unless the optional writable flag is set." },
+    { "tubes_to_file", tubetk_numpy_tubes_to_file, METH_VARARGS,
+    "Write the tubes of the columns returned by tube_columns_from_file, "
+    "as a binary tube file if the optional binary flag is set." },
     { NULL, NULL, 0, NULL } /* Sentinel */
     };
 
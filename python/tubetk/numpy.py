@@ -25,3 +25,5 @@
 
 from tubetk import _tubetk_numpy
 from _tubetk_numpy import tubes_from_file
+from _tubetk_numpy import tube_columns_from_file
+from _tubetk_numpy import tubes_to_file